@@ -1,88 +0,0 @@
-/* ***** BEGIN LICENSE BLOCK ***** 
- * Version: RCSL 1.0/RPSL 1.0 
- *  
- * Portions Copyright (c) 1995-2002 RealNetworks, Inc. All Rights Reserved. 
- *      
- * The contents of this file, and the files included with this file, are 
- * subject to the current version of the RealNetworks Public Source License 
- * Version 1.0 (the "RPSL") available at 
- * http://www.helixcommunity.org/content/rpsl unless you have licensed 
- * the file under the RealNetworks Community Source License Version 1.0 
- * (the "RCSL") available at http://www.helixcommunity.org/content/rcsl, 
- * in which case the RCSL will apply. You may also obtain the license terms 
- * directly from RealNetworks.  You may not use this file except in 
- * compliance with the RPSL or, if you have a valid RCSL with RealNetworks 
- * applicable to this file, the RCSL.  Please see the applicable RPSL or 
- * RCSL for the rights, obligations and limitations governing use of the 
- * contents of the file.  
- *  
- * This file is part of the Helix DNA Technology. RealNetworks is the 
- * developer of the Original Code and owns the copyrights in the portions 
- * it created. 
- *  
- * This file, and the files included with this file, is distributed and made 
- * available on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER 
- * EXPRESS OR IMPLIED, AND REALNETWORKS HEREBY DISCLAIMS ALL SUCH WARRANTIES, 
- * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY, FITNESS 
- * FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT. 
- * 
- * Technology Compatibility Kit Test Suite(s) Location: 
- *    http://www.helixcommunity.org/content/tck 
- * 
- * Contributor(s): 
- *  
- * ***** END LICENSE BLOCK ***** */ 
-
-/**************************************************************************************
- * Fixed-point MP3 decoder
- * Jon Recker (jrecker@real.com), Ken Cooke (kenc@real.com)
- * June 2003
- *
- * statname.h - name mangling macros for static linking
- **************************************************************************************/
-
-#ifndef _STATNAME_H
-#define _STATNAME_H
-
-/* define STAT_PREFIX to a unique name for static linking 
- * all the C functions and global variables will be mangled by the preprocessor
- *   e.g. void FFT(int *fftbuf) becomes void cook_FFT(int *fftbuf)
- */
-#define STAT_PREFIX		xmp3fixpt
-
-#define STATCC1(x,y,z)	STATCC2(x,y,z)
-#define STATCC2(x,y,z)	x##y##z  
-
-#ifdef STAT_PREFIX
-#define STATNAME(func)	STATCC1(STAT_PREFIX, _, func)
-#else
-#define STATNAME(func)	func
-#endif
-
-/* these symbols are common to all implementations */
-#define	CheckPadBit			STATNAME(CheckPadBit)
-#define	UnpackFrameHeader	STATNAME(UnpackFrameHeader)
-#define	UnpackSideInfo		STATNAME(UnpackSideInfo)
-#define	AllocateBuffers		STATNAME(AllocateBuffers)
-#define	FreeBuffers			STATNAME(FreeBuffers)
-#define	DecodeHuffman		STATNAME(DecodeHuffman)
-#define	Dequantize			STATNAME(Dequantize)
-#define	IMDCT				STATNAME(IMDCT)
-#define	UnpackScaleFactors	STATNAME(UnpackScaleFactors)
-#define	Subband				STATNAME(Subband)
-
-#define	samplerateTab		STATNAME(samplerateTab)
-#define	bitrateTab			STATNAME(bitrateTab)
-#define	samplesPerFrameTab	STATNAME(samplesPerFrameTab)
-#define	bitsPerSlotTab		STATNAME(bitsPerSlotTab)
-#define	sideBytesTab		STATNAME(sideBytesTab)
-#define	slotTab				STATNAME(slotTab)
-#define	sfBandTable			STATNAME(sfBandTable)
-
-/* in your implementation's top-level include file (e.g. real\coder.h) you should
- *   add new #define sym STATNAME(sym) lines for all the
- *   additional global functions or variables which your
- *   implementation uses
- */
-
-#endif /* _STATNAME_H */
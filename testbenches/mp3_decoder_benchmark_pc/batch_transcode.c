@@ -0,0 +1,415 @@
+/***************************************************************************//**
+  @file     batch_transcode.c
+  @brief    Decodes MP3 files (or the MP3 files of directories) to WAV, or to a null sink, on a pool of worker
+            threads with one decoder each. The files are dealt in slices to the workers, a worker that runs out
+            of files steals them from the end of the slice of another one. Reports the real time multiple of
+            each file and of the whole batch, and fails if a file could not be decoded, to check the contents
+            of a card before it is used in the player.
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "lib/mp3decoder/mp3decoder.h"
+#include "bench_util.h"
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define MAX_WORKERS         64
+#define MAX_PATH_LENGTH     1024
+#define WAV_HEADER_BYTES    44
+
+/*******************************************************************************
+ * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
+ ******************************************************************************/
+
+typedef struct
+{
+  const char*   path;
+  bool          loaded;         // The file could be opened and decoded
+  bool          stolen;         // Decoded by a worker that took it from another one
+  uint8_t       worker;         // Worker that decoded it
+  uint8_t       channels;
+  uint32_t      sampleRate;
+  uint64_t      samples;        // Samples per channel
+  uint32_t      frames;         // Frames decoded
+  uint32_t      dropped;        // Frames that could not be decoded
+  double        seconds;        // Decoding time
+} job_t;
+
+typedef struct
+{
+  pthread_t               thread;
+  uint8_t                 id;
+  uint64_t                range;          // Jobs left in the slice of the worker, next one in the low half, end in the high half
+  mp3decoder_storage_t    storage;        // Decoder of the worker
+  short                   pcm[MP3_DECODED_BUFFER_SIZE];
+} worker_t;
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES FOR PRIVATE FUNCTIONS WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+/*
+ * @brief Orders the jobs by path, for qsort
+ */
+static int comparePaths(const void* a, const void* b);
+
+/*
+ * @brief Adds a file, or the MP3 files of a directory sorted by name, to the job list
+ */
+static void addPath(const char* path);
+
+/*
+ * @brief Takes the next job of the own slice, from its start
+ * @returns Job index, -1 if the slice is empty
+ */
+static int32_t popJob(worker_t* worker);
+
+/*
+ * @brief Takes a job from the end of the slice of another worker
+ * @returns Job index, -1 if every slice is empty
+ */
+static int32_t stealJob(worker_t* thief);
+
+/*
+ * @brief Worker thread, decodes jobs until there are none left
+ */
+static void* workerRun(void* arg);
+
+/*
+ * @brief Decodes one file with the decoder of the worker
+ */
+static void decodeJob(worker_t* worker, mp3decoder_t* decoder, job_t* job);
+
+/*
+ * @brief Writes a 16 bit PCM WAV header, with the sizes once the data is known
+ */
+static void writeWavHeader(FILE* fp, uint32_t sampleRate, uint8_t channels, uint32_t dataBytes);
+
+/*******************************************************************************
+ * VARIABLES WITH LOCAL SCOPE
+ ******************************************************************************/
+
+static job_t*       jobs;
+static uint32_t     jobCount;
+static worker_t*    workers;
+static uint8_t      workerCount;
+static const char*  outputDir;      // NULL for the null sink
+
+/*******************************************************************************
+ *******************************************************************************
+                        GLOBAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+int main(int argc, char* argv[])
+{
+  long cores = sysconf(_SC_NPROCESSORS_ONLN);
+  workerCount = (cores > 0) ? ((cores < MAX_WORKERS) ? cores : MAX_WORKERS) : 1;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "j:o:")) != -1)
+  {
+    if ((opt == 'j') && (atoi(optarg) > 0))
+    {
+      workerCount = (atoi(optarg) < MAX_WORKERS) ? atoi(optarg) : MAX_WORKERS;
+    }
+    else if (opt == 'o')
+    {
+      outputDir = optarg;
+    }
+    else
+    {
+      optind = argc + 1;
+    }
+  }
+  if (optind >= argc)
+  {
+    printf("Usage: %s [-j workers] [-o wav_dir] file.mp3|dir [file.mp3|dir ...]\n", argv[0]);
+    printf("       Without -o the PCM goes to a null sink, workers default to the cores online\n");
+    return 1;
+  }
+
+  for (int i = optind; i < argc; i++)
+  {
+    addPath(argv[i]);
+  }
+  if (outputDir)
+  {
+    mkdir(outputDir, 0777);
+  }
+
+  // Contiguous slices, so the files of each worker are read in order
+  workers = calloc(workerCount, sizeof(worker_t));
+  for (uint8_t w = 0; w < workerCount; w++)
+  {
+    uint64_t first = (uint64_t)jobCount * w / workerCount;
+    uint64_t end = (uint64_t)jobCount * (w + 1) / workerCount;
+    workers[w].id = w;
+    workers[w].range = first | (end << 32);
+  }
+
+  double start = now();
+  for (uint8_t w = 0; w < workerCount; w++)
+  {
+    pthread_create(&workers[w].thread, NULL, workerRun, &workers[w]);
+  }
+  for (uint8_t w = 0; w < workerCount; w++)
+  {
+    pthread_join(workers[w].thread, NULL);
+  }
+  double wall = now() - start;
+
+  // Results in the order of the command line
+  bool ok = (jobCount > 0);
+  double audio = 0, busy = 0;
+  uint32_t stolen = 0;
+  for (uint32_t j = 0; j < jobCount; j++)
+  {
+    job_t* job = &jobs[j];
+    double length = job->sampleRate ? (double)job->samples / job->sampleRate : 0;
+    audio += length;
+    busy += job->seconds;
+    stolen += job->stolen;
+    ok = ok && job->loaded;
+    if (job->loaded)
+    {
+      // Dropped frames are reported, a truncated frame at the end of the file is dropped too
+      printf("%-40s %7.1f s %6u Hz %u ch %7.1f ms %6.0fx  worker %u%s", job->path, length, job->sampleRate, job->channels,
+             job->seconds * 1e3, job->seconds > 0 ? length / job->seconds : 0, job->worker, job->stolen ? " (stolen)" : "");
+      printf(job->dropped ? "  %u of %u frames dropped\n" : "\n", job->dropped, job->frames + job->dropped);
+    }
+    else
+    {
+      printf("%-40s FAILED\n", job->path);
+    }
+  }
+
+  printf("Files:             %u, %u stolen, %u workers\n", jobCount, stolen, workerCount);
+  printf("Audio:             %.1f s, decoded in %.2f s (%.2f s of worker time)\n", audio, wall, busy);
+  printf("Real time:         %.0fx aggregate, %.0fx per worker\n", wall > 0 ? audio / wall : 0, busy > 0 ? audio / busy : 0);
+  printf("Check:             %s\n", ok ? "ok" : "FAILED");
+
+  free(workers);
+  return ok ? 0 : 1;
+}
+
+/*******************************************************************************
+ *******************************************************************************
+                        LOCAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+int comparePaths(const void* a, const void* b)
+{
+  return strcmp(((const job_t*)a)->path, ((const job_t*)b)->path);
+}
+
+void addPath(const char* path)
+{
+  struct stat info;
+  uint32_t first = jobCount;
+
+  if ((stat(path, &info) == 0) && S_ISDIR(info.st_mode))
+  {
+    DIR* dir = opendir(path);
+    struct dirent* entry;
+    while (dir && (entry = readdir(dir)))
+    {
+      size_t length = strlen(entry->d_name);
+      if ((length > 4) && !strcasecmp(entry->d_name + length - 4, ".mp3"))
+      {
+        char* file = malloc(strlen(path) + length + 2);
+        sprintf(file, "%s/%s", path, entry->d_name);
+        jobs = realloc(jobs, (jobCount + 1) * sizeof(job_t));
+        jobs[jobCount++] = (job_t){ .path = file };
+      }
+    }
+    if (dir)
+    {
+      closedir(dir);
+    }
+    qsort(jobs + first, jobCount - first, sizeof(job_t), comparePaths);
+  }
+  else
+  {
+    jobs = realloc(jobs, (jobCount + 1) * sizeof(job_t));
+    jobs[jobCount++] = (job_t){ .path = path };
+  }
+}
+
+int32_t popJob(worker_t* worker)
+{
+  uint64_t range = __atomic_load_n(&worker->range, __ATOMIC_ACQUIRE);
+  uint32_t next, end;
+  do
+  {
+    next = (uint32_t)range;
+    end = (uint32_t)(range >> 32);
+    if (next >= end)
+    {
+      return -1;
+    }
+  } while (!__atomic_compare_exchange_n(&worker->range, &range, (next + 1) | ((uint64_t)end << 32), false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+  return next;
+}
+
+int32_t stealJob(worker_t* thief)
+{
+  // Both ends of a slice move in one word, so the owner and the thieves never take the same job
+  for (uint8_t i = 1; i < workerCount; i++)
+  {
+    worker_t* victim = &workers[(thief->id + i) % workerCount];
+    uint64_t range = __atomic_load_n(&victim->range, __ATOMIC_ACQUIRE);
+    uint32_t next, end;
+    bool taken = false;
+    do
+    {
+      next = (uint32_t)range;
+      end = (uint32_t)(range >> 32);
+      if (next >= end)
+      {
+        break;
+      }
+      taken = __atomic_compare_exchange_n(&victim->range, &range, next | ((uint64_t)(end - 1) << 32), false,
+                                          __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+    } while (!taken);
+    if (taken)
+    {
+      return end - 1;
+    }
+  }
+  return -1;
+}
+
+void* workerRun(void* arg)
+{
+  worker_t* worker = (worker_t*)arg;
+  mp3decoder_t* decoder = MP3DecoderCreateStatic(&worker->storage);
+  bool running = (decoder != NULL);
+
+  while (running)
+  {
+    // The own slice first, then the ones of the other workers
+    bool stolen = false;
+    int32_t index = popJob(worker);
+    if (index < 0)
+    {
+      index = stealJob(worker);
+      stolen = true;
+    }
+
+    running = (index >= 0);
+    if (running)
+    {
+      jobs[index].worker = worker->id;
+      jobs[index].stolen = stolen;
+      decodeJob(worker, decoder, &jobs[index]);
+    }
+  }
+
+  if (decoder)
+  {
+    MP3DecoderDestroy(decoder);
+  }
+  return NULL;
+}
+
+void decodeJob(worker_t* worker, mp3decoder_t* decoder, job_t* job)
+{
+  mp3decoder_frame_data_t frameData;
+  mp3decoder_stats_t stats;
+  mp3decoder_result_t res;
+  uint16_t count;
+  uint64_t dataBytes = 0;
+  FILE* wav = NULL;
+
+  if (!MP3DecoderLoadFile(decoder, job->path) || !MP3DecoderGetNextFrameData(decoder, &frameData))
+  {
+    return;
+  }
+  job->loaded = true;
+  job->sampleRate = frameData.sampleRate;
+  job->channels = frameData.channelCount;
+
+  if (outputDir)
+  {
+    char wavPath[MAX_PATH_LENGTH];
+    const char* name = strrchr(job->path, '/') ? strrchr(job->path, '/') + 1 : job->path;
+    const char* extension = strrchr(name, '.');
+    int length = extension ? (int)(extension - name) : (int)strlen(name);
+    snprintf(wavPath, sizeof(wavPath), "%s/%.*s.wav", outputDir, length, name);
+    wav = fopen(wavPath, "wb");
+    job->loaded = (wav != NULL);
+    if (wav)
+    {
+      writeWavHeader(wav, job->sampleRate, job->channels, 0);
+    }
+  }
+
+  double start = now();
+  while ((res = MP3DecoderGetDecodedFrame(decoder, worker->pcm, MP3_DECODED_BUFFER_SIZE, &count)) != MP3DECODER_FILE_END)
+  {
+    if ((res == MP3DECODER_NO_ERROR) && count)
+    {
+      job->samples += count / job->channels;
+      if (wav)
+      {
+        fwrite(worker->pcm, sizeof(short), count, wav);
+        dataBytes += count * sizeof(short);
+      }
+    }
+  }
+  job->seconds = now() - start;
+
+  MP3DecoderGetStats(decoder, &stats);
+  job->frames = stats.framesDecoded;
+  job->dropped = stats.droppedFrames;
+  job->loaded = job->loaded && (job->samples > 0);
+
+  if (wav)
+  {
+    rewind(wav);
+    writeWavHeader(wav, job->sampleRate, job->channels, dataBytes);
+    fclose(wav);
+  }
+}
+
+void writeWavHeader(FILE* fp, uint32_t sampleRate, uint8_t channels, uint32_t dataBytes)
+{
+  uint8_t header[WAV_HEADER_BYTES];
+  uint32_t fields[] = { WAV_HEADER_BYTES - 8 + dataBytes, 16, 1 | ((uint32_t)channels << 16), sampleRate,
+                        sampleRate * channels * sizeof(short), (channels * sizeof(short)) | (16 << 16), dataBytes };
+
+  // Little endian fields, between the chunk ids
+  memcpy(header, "RIFF", 4);
+  memcpy(header + 8, "WAVEfmt ", 8);
+  memcpy(header + 36, "data", 4);
+  const uint8_t offsets[] = { 4, 16, 20, 24, 28, 32, 40 };
+  for (uint8_t f = 0; f < sizeof(offsets); f++)
+  {
+    for (uint8_t b = 0; b < 4; b++)
+    {
+      header[offsets[f] + b] = (uint8_t)(fields[f] >> (8 * b));
+    }
+  }
+  fwrite(header, 1, WAV_HEADER_BYTES, fp);
+}
+
+/******************************************************************************/
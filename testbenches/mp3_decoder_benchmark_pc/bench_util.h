@@ -0,0 +1,129 @@
+/*******************************************************************************
+  @file     bench_util.h
+  @brief    Helpers shared by the host benchmarks and tests: timestamps, random numbers and, when coder.h is
+            included first, running granules of coefficients through the IMDCT and timing the Helix stages
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+#ifndef BENCH_UTIL_H_
+#define BENCH_UTIL_H_
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+/*******************************************************************************
+ * FUNCTION DEFINITIONS
+ ******************************************************************************/
+
+/*
+ * @brief Returns a monotonic timestamp in seconds
+ */
+static inline double now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * @brief Returns the next value of a 32 bit linear congruential generator, seeded with 1 on every run
+ */
+static inline uint32_t lcg(void)
+{
+  static uint32_t seed = 1;
+  seed = seed * 1664525u + 1013904223u;
+  return seed;
+}
+
+#ifdef _CODER_H
+
+/*******************************************************************************
+ * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
+ ******************************************************************************/
+
+typedef struct
+{
+  int   blockType;
+  int   mixedBlock;
+  int   shift;          // Right shift of the coefficients, sets the guard bits
+  int   bandwidth;      // Coefficients kept, the ones above it are zero
+  int   nonZeroBound;   // End of the Huffman region
+  int   bandBound;      // End of the non-zero critical bands, where the IMDCT stops
+} bench_granule_t;
+
+/*
+ * @brief Runs one granule of the benchmarked stages
+ * @param info    Decoder
+ * @param index   Granule index, picks the coefficients
+ * @param arg     Profile of the granules, of the benchmark
+ */
+typedef void (*bench_run_t)(MP3DecInfo* info, uint32_t index, const void* arg);
+
+/*******************************************************************************
+ * FUNCTION DEFINITIONS
+ ******************************************************************************/
+
+/*
+ * @brief Loads coefficients into a channel of granule 0, as the Huffman and dequantization stages leave them,
+ *        and runs the IMDCT stage on it
+ * @param info      Decoder
+ * @param ch        Channel
+ * @param coefs     MAX_NSAMP coefficients
+ * @param granule   Block type, scaling and bounds of the granule
+ */
+static inline void runGranule(MP3DecInfo* info, int ch, const int* coefs, const bench_granule_t* granule)
+{
+  SideInfo* si = (SideInfo*)info->SideInfoPS;
+  HuffmanInfo* hi = (HuffmanInfo*)info->HuffmanInfoPS;
+  int* x = hi->huffDecBuf[ch];
+  int maxAbs = 0;
+
+  for (int i = 0; i < MAX_NSAMP; i++)
+  {
+    x[i] = (i < granule->bandwidth) ? (coefs[i] >> granule->shift) : 0;
+    maxAbs |= (x[i] < 0) ? -x[i] : x[i];
+  }
+  hi->gb[ch] = maxAbs ? __builtin_clz(maxAbs) - 1 : 31;
+  hi->nonZeroBound[ch] = granule->nonZeroBound;
+  hi->bandBound[ch] = granule->bandBound;
+  si->sis[0][ch].blockType = granule->blockType;
+  si->sis[0][ch].mixedBlock = granule->mixedBlock;
+  IMDCT(info, 0, ch);
+}
+
+/*
+ * @brief Times granules in a few runs, each one from a cleared IMDCT overlap and subband history
+ * @param info      Decoder
+ * @param run       Runs one granule
+ * @param arg       Profile of the granules, passed to run
+ * @param granules  Granules timed, split between the runs
+ * @param runs      Timed runs, the best one is reported
+ * @returns Nanoseconds per granule
+ */
+static inline double benchmark(MP3DecInfo* info, bench_run_t run, const void* arg, uint32_t granules, uint8_t runs)
+{
+  double best = 0;
+  for (uint8_t r = 0; r < runs; r++)
+  {
+    memset(info->IMDCTInfoPS, 0, sizeof(IMDCTInfo));
+    memset(info->SubbandInfoPS, 0, sizeof(SubbandInfo));
+    double start = now();
+    for (uint32_t index = 0; index < granules / runs; index++)
+    {
+      run(info, index, arg);
+    }
+    double elapsed = (now() - start) * 1e9 / (granules / runs);
+    best = (r == 0 || elapsed < best) ? elapsed : best;
+  }
+  return best;
+}
+
+#endif /* _CODER_H */
+
+#endif /* BENCH_UTIL_H_ */
@@ -0,0 +1,431 @@
+/***************************************************************************//**
+  @file     huffman_benchmark.c
+  @brief    Huffman-only throughput of the Helix decoder on granules encoded like a high bitrate
+            file (escape tables with linbits at low frequencies, count1 quads at the top). Checks
+            that every granule decodes back to the encoded spectrum, and hashes the output over
+            random data (invalid codes, running out of bits) against the hash of the previous
+            decoder, so the lookahead path is bit-exact
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "coder.h"
+#include "bench_util.h"
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define POOL_GRANULES       64                      // Different encoded granules
+#define GRANULE_BYTES       1024                    // Room for the Huffman data of one granule
+#define HASH_ROUNDS         50000                   // Random granules hashed
+#define BENCH_ROUNDS        100000                  // Granules timed
+#define REFERENCE_HASH      0xf32ee25c0dea5e46ULL   // FNV-1a of the previous decoder output
+
+#define FNV_OFFSET          0xcbf29ce484222325ULL
+#define FNV_PRIME           0x100000001b3ULL
+
+/*******************************************************************************
+ * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
+ ******************************************************************************/
+
+typedef struct
+{
+  uint32_t  code[16][16];   // Codeword of each (x, y), x and y up to 15
+  uint8_t   length[16][16]; // 0 if the table has no such pair
+} pair_code_t;
+
+typedef struct
+{
+  uint8_t   data[GRANULE_BYTES + 8];
+  int       bits;                       // part2_3 bits of the granule
+  int       spectrum[MAX_NSAMP];        // Encoded values
+  SideInfoSub sis;
+} granule_t;
+
+typedef struct
+{
+  uint8_t*  data;
+  uint32_t  position;                   // In bits
+} bit_writer_t;
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES FOR PRIVATE FUNCTIONS WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+/*
+ * @brief Fills the codewords of a pair table walking its (possibly nested) lookup tables
+ */
+static void collectCodes(pair_code_t* codes, const unsigned short* table, uint32_t prefix, uint8_t prefixLength);
+
+/*
+ * @brief Writes the lowest count bits of value
+ */
+static void putBits(bit_writer_t* writer, uint32_t value, uint8_t count);
+
+/*
+ * @brief Bits taken by a region of pairs with a table, or -1 if the table can't code it
+ */
+static int regionBits(const int* values, int count, int tabIdx);
+
+/*
+ * @brief Writes a region of pairs with a table
+ */
+static void encodeRegion(bit_writer_t* writer, const int* values, int count, int tabIdx);
+
+/*
+ * @brief Makes a random spectrum, picks the tables and encodes it
+ */
+static void makeGranule(granule_t* granule, const SFBandTable* sfBand);
+
+/*
+ * @brief Decodes a granule into channel 0, returns DecodeHuffman result
+ */
+static int decodeGranule(MP3DecInfo* info, const granule_t* granule, int* bitOffset);
+
+/*******************************************************************************
+ * VARIABLES WITH LOCAL SCOPE
+ ******************************************************************************/
+
+static pair_code_t pairCodes[HUFF_PAIRTABS];
+static uint32_t quadCodes[2][16];
+static uint8_t quadLengths[2][16];
+static granule_t pool[POOL_GRANULES];
+static granule_t randomGranule;
+
+/*******************************************************************************
+ *******************************************************************************
+                        GLOBAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+int main(void)
+{
+  MP3DecInfo* info = (MP3DecInfo*)MP3InitDecoder();
+  FrameHeader* fh = (FrameHeader*)info->FrameHeaderPS;
+  HuffmanInfo* hi = (HuffmanInfo*)info->HuffmanInfoPS;
+  fh->ver = MPEG1;
+  fh->sfBand = &sfBandTable[MPEG1][0];
+
+  // Code books, from the decoder tables
+  for (int tabIdx = 1; tabIdx < HUFF_PAIRTABS; tabIdx++)
+  {
+    if (huffTabLookup[tabIdx].tabType != invalidTab)
+    {
+      collectCodes(&pairCodes[tabIdx], huffTable + huffTabOffset[tabIdx], 0, 0);
+    }
+  }
+  for (int index = 0; index < 64; index++)
+  {
+    uint8_t length = quadTable[index] >> 4;
+    quadCodes[0][quadTable[index] & 0x0f] = index >> (6 - length);
+    quadLengths[0][quadTable[index] & 0x0f] = length;
+  }
+  for (int index = 0; index < 16; index++)
+  {
+    quadCodes[1][quadTable[64 + index] & 0x0f] = index;
+    quadLengths[1][quadTable[64 + index] & 0x0f] = 4;
+  }
+
+  // Every granule must decode back to its spectrum
+  bool roundTrip = true;
+  uint64_t totalBits = 0;
+  for (uint32_t g = 0; g < POOL_GRANULES; g++)
+  {
+    makeGranule(&pool[g], fh->sfBand);
+    totalBits += pool[g].bits;
+    int bitOffset = 0;
+    int used = decodeGranule(info, &pool[g], &bitOffset);
+    roundTrip &= ((used * 8 + bitOffset) == pool[g].bits);
+    for (uint32_t i = 0; i < MAX_NSAMP; i++)
+    {
+      int value = hi->huffDecBuf[0][i];
+      value = (value < 0) ? -(value & 0x7fffffff) : value;
+      roundTrip &= (value == pool[g].spectrum[i]);
+    }
+  }
+
+  // Random data with random tables and lengths, the decoder state after each granule is hashed
+  uint64_t hash = FNV_OFFSET;
+  for (uint32_t round = 0; round < HASH_ROUNDS; round++)
+  {
+    SideInfoSub* sis = &randomGranule.sis;
+    sis->winSwitchFlag = (lcg() % 4) == 0;
+    sis->blockType = sis->winSwitchFlag ? 1 + lcg() % 3 : 0;
+    sis->mixedBlock = lcg() % 2;
+    sis->region0Count = lcg() % 16;
+    sis->region1Count = lcg() % 8;
+    sis->nBigvals = lcg() % 289;
+    for (uint8_t i = 0; i < 3; i++)
+    {
+      sis->tableSelect[i] = lcg() % HUFF_PAIRTABS;
+    }
+    sis->count1TableSelect = lcg() % 2;
+    for (uint32_t i = 0; i < GRANULE_BYTES; i++)
+    {
+      randomGranule.data[i] = lcg() >> 24;
+    }
+    randomGranule.bits = lcg() % (GRANULE_BYTES * 8);
+
+    int bitOffset = lcg() % 8;
+    memset(hi->huffDecBuf[0], 0, sizeof(hi->huffDecBuf[0]));
+    int used = decodeGranule(info, &randomGranule, &bitOffset);
+    int state[] = { used, bitOffset, (used < 0) ? 0 : hi->nonZeroBound[0] };
+    const uint8_t* bytes = (const uint8_t*)state;
+    for (uint32_t i = 0; i < sizeof(state); i++)
+    {
+      hash = (hash ^ bytes[i]) * FNV_PRIME;
+    }
+    bytes = (const uint8_t*)hi->huffDecBuf[0];
+    for (uint32_t i = 0; i < sizeof(hi->huffDecBuf[0]); i++)
+    {
+      hash = (hash ^ bytes[i]) * FNV_PRIME;
+    }
+  }
+  bool passed = roundTrip && (hash == REFERENCE_HASH);
+
+  // Best of a few runs
+  double best = 0;
+  for (uint8_t run = 0; run < 5; run++)
+  {
+    double start = now();
+    for (uint32_t round = 0; round < BENCH_ROUNDS / 5; round++)
+    {
+      int bitOffset = 0;
+      decodeGranule(info, &pool[round % POOL_GRANULES], &bitOffset);
+    }
+    double elapsed = (now() - start) * 1e9 / (BENCH_ROUNDS / 5);
+    best = (run == 0 || elapsed < best) ? elapsed : best;
+  }
+
+  printf("Lookahead bits:    %d\n", HUFF_LOOK_BITS);
+  printf("Round trip:        %s\n", roundTrip ? "ok" : "MISMATCH");
+  printf("Output hash:       %016llx (%s)\n", (unsigned long long)hash, (hash == REFERENCE_HASH) ? "bit-exact" : "MISMATCH");
+  printf("Granule:           %.0f bits, %.0f ns (%.1f Mbit/s)\n",
+         (double)totalBits / POOL_GRANULES, best, (double)totalBits / POOL_GRANULES / best * 1e3);
+
+  MP3FreeDecoder(info);
+  return passed ? 0 : 1;
+}
+
+/*******************************************************************************
+ *******************************************************************************
+                        LOCAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+void collectCodes(pair_code_t* codes, const unsigned short* table, uint32_t prefix, uint8_t prefixLength)
+{
+  // Same format as DecodeHuffmanPairs reads, see hufftabs.c
+  uint8_t maxBits = table[0] & 0x0f;
+  for (uint32_t index = 0; index < (1u << maxBits); index++)
+  {
+    unsigned short cw = table[index + 1];
+    uint8_t length = cw >> 12;
+    if (length == 0)
+    {
+      collectCodes(codes, table + cw, (prefix << maxBits) | index, prefixLength + maxBits);
+    }
+    else
+    {
+      uint8_t x = (cw >> 4) & 0x0f;
+      uint8_t y = (cw >> 8) & 0x0f;
+      if (codes->length[x][y] == 0)
+      {
+        codes->code[x][y] = (prefix << length) | (index >> (maxBits - length));
+        codes->length[x][y] = prefixLength + length;
+      }
+    }
+  }
+}
+
+void putBits(bit_writer_t* writer, uint32_t value, uint8_t count)
+{
+  for (int8_t bit = count - 1; bit >= 0; bit--)
+  {
+    if ((value >> bit) & 1)
+    {
+      writer->data[writer->position >> 3] |= 0x80 >> (writer->position & 7);
+    }
+    writer->position++;
+  }
+}
+
+int regionBits(const int* values, int count, int tabIdx)
+{
+  int bits = 0;
+  int linBits = (huffTabLookup[tabIdx].tabType == loopLinbits) ? huffTabLookup[tabIdx].linBits : 0;
+  for (int i = 0; i < count; i += 2)
+  {
+    int x = abs(values[i]), y = abs(values[i + 1]);
+    int cx = x, cy = y;
+    if (linBits)
+    {
+      cx = (x > 15) ? 15 : x;
+      cy = (y > 15) ? 15 : y;
+      if ((x >= 15 && x - 15 >= (1 << linBits)) || (y >= 15 && y - 15 >= (1 << linBits)))
+      {
+        return -1;
+      }
+      bits += ((cx == 15) ? linBits : 0) + ((cy == 15) ? linBits : 0);
+    }
+    if (cx > 15 || cy > 15 || pairCodes[tabIdx].length[cx][cy] == 0)
+    {
+      return -1;
+    }
+    bits += pairCodes[tabIdx].length[cx][cy] + (x != 0) + (y != 0);
+  }
+  return bits;
+}
+
+void encodeRegion(bit_writer_t* writer, const int* values, int count, int tabIdx)
+{
+  int linBits = (huffTabLookup[tabIdx].tabType == loopLinbits) ? huffTabLookup[tabIdx].linBits : 0;
+  for (int i = 0; i < count; i += 2)
+  {
+    int x = abs(values[i]), y = abs(values[i + 1]);
+    int cx = (linBits && x > 15) ? 15 : x;
+    int cy = (linBits && y > 15) ? 15 : y;
+    putBits(writer, pairCodes[tabIdx].code[cx][cy], pairCodes[tabIdx].length[cx][cy]);
+    if (linBits && cx == 15)
+    {
+      putBits(writer, x - 15, linBits);
+    }
+    if (x)
+    {
+      putBits(writer, values[i] < 0, 1);
+    }
+    if (linBits && cy == 15)
+    {
+      putBits(writer, y - 15, linBits);
+    }
+    if (y)
+    {
+      putBits(writer, values[i + 1] < 0, 1);
+    }
+  }
+}
+
+void makeGranule(granule_t* granule, const SFBandTable* sfBand)
+{
+  int* x = granule->spectrum;
+  SideInfoSub* sis = &granule->sis;
+
+  // Laplacian values with a decaying envelope, about 320 kbps with the escape tables at the bottom
+  double scale = 8.0 + (lcg() % 120);
+  int top = 400 + lcg() % 176;
+  for (int i = 0; i < MAX_NSAMP; i++)
+  {
+    double u = ((lcg() >> 8) + 0.5) / 16777216.0;
+    double magnitude = (i < top) ? -log(u) * scale * exp(-6.0 * i / top) : 0;
+    int value = (int)magnitude;
+    if (value > 8000)
+    {
+      value = 8000;
+    }
+    x[i] = (lcg() & 0x100) ? -value : value;
+  }
+
+  // Big values up to the last value above 1, then quads up to the last non zero value
+  int bigEnd = 0, count1End;
+  for (int i = 0; i < MAX_NSAMP; i++)
+  {
+    if (abs(x[i]) > 1)
+    {
+      bigEnd = (i + 2) & ~1;
+    }
+  }
+  count1End = bigEnd;
+  for (int i = bigEnd; i < MAX_NSAMP; i++)
+  {
+    if (x[i])
+    {
+      count1End = bigEnd + ((i - bigEnd + 4) & ~3);
+    }
+  }
+  if (count1End > MAX_NSAMP)
+  {
+    count1End -= 4;
+    for (int i = count1End; i < MAX_NSAMP; i++)
+    {
+      x[i] = 0;
+    }
+  }
+
+  memset(sis, 0, sizeof(*sis));
+  sis->nBigvals = bigEnd / 2;
+  sis->region0Count = 7;
+  sis->region1Count = 7;
+  int bounds[4] = { 0, sfBand->l[8], sfBand->l[16], bigEnd };
+  bounds[1] = (bounds[1] < bigEnd) ? bounds[1] : bigEnd;
+  bounds[2] = (bounds[2] < bigEnd) ? bounds[2] : bigEnd;
+
+  // Cheapest table of each region
+  for (uint8_t region = 0; region < 3; region++)
+  {
+    int best = -1;
+    sis->tableSelect[region] = 0;
+    for (int tabIdx = 1; tabIdx < HUFF_PAIRTABS; tabIdx++)
+    {
+      if (huffTabLookup[tabIdx].tabType != invalidTab)
+      {
+        int bits = regionBits(x + bounds[region], bounds[region + 1] - bounds[region], tabIdx);
+        if (bits >= 0 && (best < 0 || bits < best))
+        {
+          best = bits;
+          sis->tableSelect[region] = tabIdx;
+        }
+      }
+    }
+  }
+
+  // Quad table with fewer bits
+  int quadBits[2] = { 0, 0 };
+  for (int i = bigEnd; i < count1End; i += 4)
+  {
+    int value = ((x[i] != 0) << 3) | ((x[i + 1] != 0) << 2) | ((x[i + 2] != 0) << 1) | (x[i + 3] != 0);
+    for (uint8_t t = 0; t < 2; t++)
+    {
+      quadBits[t] += quadLengths[t][value];
+    }
+  }
+  sis->count1TableSelect = (quadBits[1] < quadBits[0]) ? 1 : 0;
+
+  bit_writer_t writer = { granule->data, 0 };
+  memset(granule->data, 0, sizeof(granule->data));
+  for (uint8_t region = 0; region < 3; region++)
+  {
+    encodeRegion(&writer, x + bounds[region], bounds[region + 1] - bounds[region], sis->tableSelect[region]);
+  }
+  for (int i = bigEnd; i < count1End; i += 4)
+  {
+    int value = ((x[i] != 0) << 3) | ((x[i + 1] != 0) << 2) | ((x[i + 2] != 0) << 1) | (x[i + 3] != 0);
+    putBits(&writer, quadCodes[sis->count1TableSelect][value], quadLengths[sis->count1TableSelect][value]);
+    for (uint8_t k = 0; k < 4; k++)
+    {
+      if (x[i + k])
+      {
+        putBits(&writer, x[i + k] < 0, 1);
+      }
+    }
+  }
+  granule->bits = writer.position;
+}
+
+int decodeGranule(MP3DecInfo* info, const granule_t* granule, int* bitOffset)
+{
+  SideInfo* si = (SideInfo*)info->SideInfoPS;
+  si->sis[0][0] = granule->sis;
+  return DecodeHuffman(info, (unsigned char*)granule->data, bitOffset, granule->bits, 0, 0);
+}
+
+/******************************************************************************/
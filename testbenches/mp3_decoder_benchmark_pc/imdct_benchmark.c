@@ -0,0 +1,129 @@
+/***************************************************************************//**
+  @file     imdct_benchmark.c
+  @brief    IMDCT-only throughput of the Helix decoder (AntiAlias, IMDCT36/IMDCT12x3, overlap-add),
+            with a hash of its output to check that the batched path is bit-exact
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "coder.h"
+#include "bench_util.h"
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define POOL_GRANULES       64                      // Different granules of coefficients
+#define HASH_ROUNDS         20000                   // Granules hashed over every block type
+#define BENCH_ROUNDS        200000                  // Granules timed
+#define BENCH_RUNS          5                       // Timed runs, the best one is reported
+#define REFERENCE_HASH      0x45ba7f5137c8af55ULL   // FNV-1a of the scalar path output
+
+#define FNV_OFFSET          0xcbf29ce484222325ULL
+#define FNV_PRIME           0x100000001b3ULL
+
+#if defined(__x86_64__) && defined(__AVX2__)
+#define IMDCT_NAME          "AVX2, 8 subbands per pass"
+#elif defined(__x86_64__) && defined(__SSE4_1__)
+#define IMDCT_NAME          "SSE4.1, 4 subbands per pass"
+#else
+#define IMDCT_NAME          "scalar"
+#endif
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES FOR PRIVATE FUNCTIONS WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+/*
+ * @brief Loads a granule of the pool into channel 0 and runs the IMDCT stage on it
+ * @param type    Block type and guard bits of the granule, a bench_granule_t
+ */
+static void runPool(MP3DecInfo* info, uint32_t index, const void* type);
+
+/*******************************************************************************
+ * VARIABLES WITH LOCAL SCOPE
+ ******************************************************************************/
+
+static int pool[POOL_GRANULES][MAX_NSAMP];
+
+// Block type, mixed block, shift of the random coefficients (guard bits), and the whole granule non-zero
+static const bench_granule_t hashTypes[] = {
+  { 0, 0, 10, MAX_NSAMP, MAX_NSAMP, MAX_NSAMP },     // long, enough guard bits (batched path)
+  { 0, 0, 4,  MAX_NSAMP, MAX_NSAMP, MAX_NSAMP },     // long, rescaled
+  { 1, 0, 10, MAX_NSAMP, MAX_NSAMP, MAX_NSAMP },     // start window
+  { 2, 0, 10, MAX_NSAMP, MAX_NSAMP, MAX_NSAMP },     // short
+  { 2, 1, 10, MAX_NSAMP, MAX_NSAMP, MAX_NSAMP },     // mixed
+  { 3, 0, 10, MAX_NSAMP, MAX_NSAMP, MAX_NSAMP },     // stop window
+  { 0, 0, 10, MAX_NSAMP, MAX_NSAMP, MAX_NSAMP },
+};
+
+/*******************************************************************************
+ *******************************************************************************
+                        GLOBAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+int main(void)
+{
+  MP3DecInfo* info = (MP3DecInfo*)MP3InitDecoder();
+  FrameHeader* fh = (FrameHeader*)info->FrameHeaderPS;
+  IMDCTInfo* mi = (IMDCTInfo*)info->IMDCTInfoPS;
+  fh->ver = MPEG1;
+  fh->sfBand = &sfBandTable[MPEG1][0];
+
+  for (uint32_t g = 0; g < POOL_GRANULES; g++)
+  {
+    for (uint32_t i = 0; i < MAX_NSAMP; i++)
+    {
+      pool[g][i] = (int32_t)lcg();
+    }
+  }
+
+  // Every block type and its transitions, output and overlap hashed after each granule
+  uint64_t hash = FNV_OFFSET;
+  uint8_t typeCount = sizeof(hashTypes) / sizeof(hashTypes[0]);
+  for (uint32_t round = 0; round < HASH_ROUNDS; round++)
+  {
+    runPool(info, round, &hashTypes[(round / 3 + round) % typeCount]);
+    const uint8_t* bytes = (const uint8_t*)mi->outBuf[0];
+    for (uint32_t i = 0; i < sizeof(mi->outBuf[0]); i++)
+    {
+      hash = (hash ^ bytes[i]) * FNV_PRIME;
+    }
+    bytes = (const uint8_t*)mi->overBuf[0];
+    for (uint32_t i = 0; i < sizeof(mi->overBuf[0]); i++)
+    {
+      hash = (hash ^ bytes[i]) * FNV_PRIME;
+    }
+  }
+  bool passed = (hash == REFERENCE_HASH);
+
+  printf("IMDCT path:        %s\n", IMDCT_NAME);
+  printf("Output hash:       %016llx (%s)\n", (unsigned long long)hash, passed ? "bit-exact" : "MISMATCH");
+  printf("Long blocks:       %.0f ns/granule\n", benchmark(info, runPool, &hashTypes[0], BENCH_ROUNDS, BENCH_RUNS));
+  printf("Long, rescaled:    %.0f ns/granule\n", benchmark(info, runPool, &hashTypes[1], BENCH_ROUNDS, BENCH_RUNS));
+  printf("Short blocks:      %.0f ns/granule\n", benchmark(info, runPool, &hashTypes[3], BENCH_ROUNDS, BENCH_RUNS));
+
+  MP3FreeDecoder(info);
+  return passed ? 0 : 1;
+}
+
+/*******************************************************************************
+ *******************************************************************************
+                        LOCAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+void runPool(MP3DecInfo* info, uint32_t index, const void* type)
+{
+  runGranule(info, 0, pool[index % POOL_GRANULES], (const bench_granule_t*)type);
+}
+
+/******************************************************************************/
@@ -0,0 +1,410 @@
+/***************************************************************************//**
+  @file     output_stage_test.c
+  @brief    Tests the fixed-point output stage against the floating point conversion it replaced: error of the
+            volume gains, saturation, the smallest gain, mute, gain ramps and the statistics of the dither, and times both conversions
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <math.h>
+#include "lib/output_stage/output_stage.h"
+#include "bench_util.h"
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define BLOCK_SIZE          4096                    // Samples per block, as in the audio module
+#define TIMING_BLOCKS       2000                    // Blocks converted by each timed run
+#define MIDSCALE            (1 << (OUTPUT_STAGE_BITS - 1))
+#define FULL_SCALE          (1 << OUTPUT_STAGE_BITS)
+
+#define PLAIN_SHIFT         19                      // Same configurations as the audio module
+#define EQ_SHIFT            14
+#define EQ_MAKEUP           25000
+#define RAMP_MS             10
+#define SAMPLE_RATE         44100
+#define RAMP_LENGTH         (RAMP_MS * SAMPLE_RATE / 1000)
+#define RAMP_INPUT          16000                   // 1000 steps at full volume without the equaliser
+
+#define CHECK(condition)    check((condition), #condition, __LINE__)
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES FOR PRIVATE FUNCTIONS WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+/*
+ * @brief Counts a failed condition and prints it
+ */
+static void check(bool condition, const char* text, int line);
+
+/*
+ * @brief Maximum error, in DAC steps, of every 16 bit sample at every volume against the exact product
+ *        of the volume table gain and the makeup gain
+ * @param makeup  Q15 makeup gain
+ * @param shift   Fraction bits of the gain
+ * @param scale   DAC steps per sample step at full volume
+ */
+static double gainError(int16_t makeup, uint8_t shift, double scale);
+
+/*
+ * @brief Checks saturation, the smallest gain and mute
+ */
+static void testLimits(void);
+
+/*
+ * @brief Checks that gain changes ramp without jumps, from the gain being output, and settle on the new gain
+ */
+static void testRamp(void);
+
+/*
+ * @brief Largest difference between consecutive codes, and whether they never go the wrong way
+ * @param codes       Pointer to the codes
+ * @param count       Amount of codes
+ * @param direction   1 rising, -1 falling
+ * @param monotonic   Pointer to variable cleared if the codes go against the direction
+ */
+static uint32_t largestJump(const uint16_t* codes, uint32_t count, int32_t direction, bool* monotonic);
+
+/*
+ * @brief Checks that the dither is TPDF of +-1 step: mean, variance and bounds of the output error
+ */
+static void testDither(void);
+
+/*
+ * @brief Times the floating point loop of the audio module and the output stage
+ */
+static void benchmark(void);
+
+/*******************************************************************************
+ * VARIABLES WITH LOCAL SCOPE
+ ******************************************************************************/
+
+static int16_t input[BLOCK_SIZE];
+static uint16_t output[BLOCK_SIZE];
+static uint32_t failures;
+
+/*******************************************************************************
+ *******************************************************************************
+                        GLOBAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+int main(void)
+{
+  // The volume table follows the dB steps, its Q15 rounding is well under the step
+  double tableError = 0;
+  for (uint8_t volume = 1; volume <= OUTPUT_STAGE_MAX_VOLUME; volume++)
+  {
+    double db = 20 * log10(outputStageVolumeGain(volume) / 32768.0);
+    double error = fabs(db - (volume - OUTPUT_STAGE_MAX_VOLUME) * OUTPUT_STAGE_VOLUME_STEP_DB);
+    tableError = (error > tableError) ? error : tableError;
+  }
+  CHECK(outputStageVolumeGain(0) == 0);
+  CHECK(tableError < OUTPUT_STAGE_VOLUME_STEP_DB / 10);
+  printf("Volume table:      %.3f dB max error\n", tableError);
+
+  // The makeup gain is quantised to Q15, the output may be one step away from the exact one
+  double plainError = gainError(OUTPUT_STAGE_UNITY_GAIN, PLAIN_SHIFT, 1.0 / 16);
+  double eqError = gainError(EQ_MAKEUP, EQ_SHIFT, 5e4 / 32768);
+  CHECK(plainError <= 1.0);
+  CHECK(eqError <= 1.0);
+  printf("Gain error:        %.3f steps decoded, %.3f steps equalised\n", plainError, eqError);
+
+  testLimits();
+  testRamp();
+  testDither();
+  benchmark();
+
+  printf("Output stage:      %s\n", failures ? "FAILED" : "ok");
+  return failures ? 1 : 0;
+}
+
+/*******************************************************************************
+ *******************************************************************************
+                        LOCAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+void check(bool condition, const char* text, int line)
+{
+  if (!condition)
+  {
+    failures++;
+    printf("Line %d: %s\n", line, text);
+  }
+}
+
+double gainError(int16_t makeup, uint8_t shift, double scale)
+{
+  output_stage_t stage;
+  double maxError = 0;
+
+  outputStageInit(&stage);
+  for (uint8_t volume = 0; volume <= OUTPUT_STAGE_MAX_VOLUME; volume++)
+  {
+    double gain = outputStageVolumeGain(volume) / 32768.0;
+    outputStageSetGain(&stage, volume, makeup, shift);
+    for (int32_t start = INT16_MIN; start <= INT16_MAX; start += BLOCK_SIZE)
+    {
+      for (uint32_t i = 0; i < BLOCK_SIZE; i++)
+      {
+        input[i] = (int16_t)(start + i);
+      }
+      outputStageWrite(&stage, input, output, BLOCK_SIZE);
+      for (uint32_t i = 0; i < BLOCK_SIZE; i++)
+      {
+        double exact = input[i] * scale * gain;
+        if (fabs(exact) < MIDSCALE - 1)
+        {
+          double error = fabs(output[i] - MIDSCALE - exact);
+          maxError = (error > maxError) ? error : maxError;
+        }
+      }
+    }
+  }
+  return maxError;
+}
+
+void testLimits(void)
+{
+  output_stage_t stage;
+  bool saturated = true;
+  bool silent = true;
+
+  // Full scale equalised samples are well over the DAC range, they stick to its ends instead of wrapping around
+  outputStageInit(&stage);
+  outputStageSetDither(&stage, true);
+  outputStageSetGain(&stage, OUTPUT_STAGE_MAX_VOLUME, EQ_MAKEUP, EQ_SHIFT);
+  for (uint32_t i = 0; i < BLOCK_SIZE; i++)
+  {
+    input[i] = (i & 1) ? INT16_MAX - (int16_t)(i & 0xFF) : INT16_MIN + (int16_t)(i & 0xFF);
+  }
+  outputStageWrite(&stage, input, output, BLOCK_SIZE);
+  for (uint32_t i = 0; i < BLOCK_SIZE; i++)
+  {
+    saturated = saturated && (output[i] == ((i & 1) ? FULL_SCALE - 1 : 0));
+  }
+  CHECK(saturated);
+
+  // The lowest volume with the smallest makeup gain takes the most fraction bits, full scale samples plus the
+  // rounding and the dither must still fit the accumulator: the output stays within the dither of the exact value
+  const uint8_t shifts[] = { 1, EQ_SHIFT, PLAIN_SHIFT, 29 };
+  bool bounded = true;
+  for (uint32_t i = 0; i < BLOCK_SIZE; i++)
+  {
+    input[i] = (i & 1) ? INT16_MAX : INT16_MIN;
+  }
+  for (uint8_t s = 0; s < sizeof(shifts); s++)
+  {
+    double gain = outputStageVolumeGain(1) / 32768.0 / 32768.0 * pow(2, 15 - shifts[s]);
+    outputStageSetGain(&stage, 1, 1, shifts[s]);
+    outputStageWrite(&stage, input, output, BLOCK_SIZE);
+    for (uint32_t i = 0; i < BLOCK_SIZE; i++)
+    {
+      bounded = bounded && (fabs(output[i] - MIDSCALE - input[i] * gain) < 1.5);
+    }
+  }
+  CHECK(bounded);
+
+  // Mute is plain midscale, even with the dither enabled
+  outputStageSetGain(&stage, 0, EQ_MAKEUP, EQ_SHIFT);
+  outputStageWrite(&stage, input, output, BLOCK_SIZE);
+  for (uint32_t i = 0; i < BLOCK_SIZE; i++)
+  {
+    silent = silent && (output[i] == MIDSCALE);
+  }
+  CHECK(silent);
+
+  // In place, odd count
+  for (uint32_t i = 0; i < 7; i++)
+  {
+    input[i] = (int16_t)(i * 4096 - 12288);
+  }
+  outputStageSetDither(&stage, false);
+  outputStageSetGain(&stage, OUTPUT_STAGE_MAX_VOLUME, OUTPUT_STAGE_UNITY_GAIN, PLAIN_SHIFT);
+  outputStageWrite(&stage, input, (uint16_t*)input, 7);
+  CHECK(((uint16_t*)input)[0] == MIDSCALE - 768 && ((uint16_t*)input)[3] == MIDSCALE && ((uint16_t*)input)[6] == MIDSCALE + 768);
+}
+
+void testRamp(void)
+{
+  output_stage_t stage;
+  bool monotonic = true;
+  uint32_t jump, maxJump = 0;
+  uint32_t expectedJump = 1000 / RAMP_LENGTH + 2;    // Per sample change plus the rounding of both samples
+
+  for (uint32_t i = 0; i < BLOCK_SIZE; i++)
+  {
+    input[i] = RAMP_INPUT;
+  }
+
+  // Fade in from mute, the rest of the block is at the new gain
+  outputStageInit(&stage);
+  outputStageSetRamp(&stage, RAMP_MS, SAMPLE_RATE);
+  outputStageSetGain(&stage, OUTPUT_STAGE_MAX_VOLUME, OUTPUT_STAGE_UNITY_GAIN, PLAIN_SHIFT);
+  CHECK(outputStageIsRamping(&stage));
+  outputStageWrite(&stage, input, output, BLOCK_SIZE);
+  jump = largestJump(output, RAMP_LENGTH, 1, &monotonic);
+  maxJump = (jump > maxJump) ? jump : maxJump;
+  CHECK((int32_t)output[0] - MIDSCALE <= (int32_t)expectedJump);
+  CHECK(output[RAMP_LENGTH - 1] == MIDSCALE + 1000 && output[BLOCK_SIZE - 1] == MIDSCALE + 1000);
+  CHECK(!outputStageIsRamping(&stage));
+
+  // Setting the same gain again does not start a ramp, a new one goes on from the gain being output
+  outputStageSetGain(&stage, OUTPUT_STAGE_MAX_VOLUME, OUTPUT_STAGE_UNITY_GAIN, PLAIN_SHIFT);
+  CHECK(!outputStageIsRamping(&stage));
+  outputStageSetGain(&stage, 0, OUTPUT_STAGE_UNITY_GAIN, PLAIN_SHIFT);
+  outputStageWrite(&stage, input, output, RAMP_LENGTH / 2);
+  outputStageSetGain(&stage, 0, OUTPUT_STAGE_UNITY_GAIN, PLAIN_SHIFT);
+  outputStageWrite(&stage, input + RAMP_LENGTH / 2, output + RAMP_LENGTH / 2, RAMP_LENGTH - RAMP_LENGTH / 2);
+  CHECK(output[RAMP_LENGTH - 1] == MIDSCALE);
+  jump = largestJump(output, RAMP_LENGTH, -1, &monotonic);
+  maxJump = (jump > maxJump) ? jump : maxJump;
+
+  outputStageSetGain(&stage, OUTPUT_STAGE_MAX_VOLUME, OUTPUT_STAGE_UNITY_GAIN, PLAIN_SHIFT);
+  outputStageWrite(&stage, input, output, RAMP_LENGTH / 3);
+  outputStageSetGain(&stage, 0, OUTPUT_STAGE_UNITY_GAIN, PLAIN_SHIFT);
+  outputStageWrite(&stage, input + RAMP_LENGTH / 3, output + RAMP_LENGTH / 3, BLOCK_SIZE - RAMP_LENGTH / 3);
+  CHECK(abs((int32_t)output[RAMP_LENGTH / 3] - (int32_t)output[RAMP_LENGTH / 3 - 1]) <= (int32_t)expectedJump);
+  CHECK(output[RAMP_LENGTH / 3 + RAMP_LENGTH - 1] == MIDSCALE && output[BLOCK_SIZE - 1] == MIDSCALE);
+  jump = largestJump(output + RAMP_LENGTH / 3, RAMP_LENGTH, -1, &monotonic);
+  maxJump = (jump > maxJump) ? jump : maxJump;
+
+  // Switching the equaliser changes the makeup gain and the fraction bits, it ramps between both as well (24 times
+  // the gain in one ramp, the steps are larger)
+  outputStageSetRamp(&stage, 0, SAMPLE_RATE);
+  outputStageSetGain(&stage, 80, OUTPUT_STAGE_UNITY_GAIN, PLAIN_SHIFT);
+  outputStageWrite(&stage, input, output, 1);
+  uint16_t plain = output[0];
+  outputStageSetRamp(&stage, RAMP_MS, SAMPLE_RATE);
+  outputStageSetGain(&stage, 80, EQ_MAKEUP, EQ_SHIFT);
+  outputStageWrite(&stage, input, output, BLOCK_SIZE);
+  jump = largestJump(output, RAMP_LENGTH, 1, &monotonic);
+  CHECK(abs((int32_t)output[0] - (int32_t)plain) <= (int32_t)jump);
+  CHECK(output[BLOCK_SIZE - 1] == FULL_SCALE - 1);
+  CHECK(monotonic);
+  CHECK(maxJump <= expectedJump);
+  printf("Gain ramps:        %u samples, largest step %u codes (%u codes across the equaliser switch)\n",
+         RAMP_LENGTH, maxJump, jump);
+}
+
+uint32_t largestJump(const uint16_t* codes, uint32_t count, int32_t direction, bool* monotonic)
+{
+  uint32_t largest = 0;
+  for (uint32_t i = 1; i < count; i++)
+  {
+    int32_t difference = ((int32_t)codes[i] - (int32_t)codes[i - 1]) * direction;
+    *monotonic = *monotonic && (difference >= 0);
+    largest = ((uint32_t)abs(difference) > largest) ? (uint32_t)abs(difference) : largest;
+  }
+  return largest;
+}
+
+void testDither(void)
+{
+  output_stage_t stage;
+  double sum = 0, sumSquares = 0;
+  uint32_t count = 0;
+  bool bounded = true;
+
+  // Slow ramp over a few steps, the error against the exact value is the rounding plus the dither
+  outputStageInit(&stage);
+  outputStageSetDither(&stage, true);
+  outputStageSetGain(&stage, OUTPUT_STAGE_MAX_VOLUME, OUTPUT_STAGE_UNITY_GAIN, PLAIN_SHIFT);
+  double gain = outputStageVolumeGain(OUTPUT_STAGE_MAX_VOLUME) * (double)OUTPUT_STAGE_UNITY_GAIN / 32768 / 32768 / 16;
+  for (uint32_t block = 0; block < 64; block++)
+  {
+    for (uint32_t i = 0; i < BLOCK_SIZE; i++)
+    {
+      input[i] = (int16_t)((block * BLOCK_SIZE + i) / 512) - 256;
+    }
+    outputStageWrite(&stage, input, output, BLOCK_SIZE);
+    for (uint32_t i = 0; i < BLOCK_SIZE; i++)
+    {
+      double error = output[i] - MIDSCALE - input[i] * gain;
+      bounded = bounded && (fabs(error) < 1.5);
+      sum += error;
+      sumSquares += error * error;
+      count++;
+    }
+  }
+
+  // TPDF of +-1 step has a variance of 1/6, and the rounding adds 1/12
+  double mean = sum / count;
+  double variance = sumSquares / count - mean * mean;
+  CHECK(bounded);
+  CHECK(fabs(mean) < 0.01);
+  CHECK(fabs(variance - 0.25) < 0.02);
+  printf("Dither:            mean %+.4f steps, variance %.4f steps^2 (0.25 expected)\n", mean, variance);
+}
+
+void benchmark(void)
+{
+  output_stage_t stage;
+  volatile uint16_t sink = 0;
+
+  for (uint32_t i = 0; i < BLOCK_SIZE; i++)
+  {
+    input[i] = (int16_t)(sin(i * 0.01) * 30000);
+  }
+
+  // Floating point conversion of the audio module, linear volume
+  double start = now();
+  for (uint32_t block = 0; block < TIMING_BLOCKS; block++)
+  {
+    double volume = 50 / (double)OUTPUT_STAGE_MAX_VOLUME;
+    for (uint32_t i = 0; i < BLOCK_SIZE; i++)
+    {
+      output[i] = (int16_t)(input[i] / 16.0 + 0.5) * volume + MIDSCALE;
+    }
+    sink += output[block % BLOCK_SIZE];
+  }
+  double floatTime = now() - start;
+
+  outputStageInit(&stage);
+  outputStageSetGain(&stage, 50, OUTPUT_STAGE_UNITY_GAIN, PLAIN_SHIFT);
+  start = now();
+  for (uint32_t block = 0; block < TIMING_BLOCKS; block++)
+  {
+    outputStageWrite(&stage, input, output, BLOCK_SIZE);
+    sink += output[block % BLOCK_SIZE];
+  }
+  double stageTime = now() - start;
+
+  outputStageSetDither(&stage, true);
+  start = now();
+  for (uint32_t block = 0; block < TIMING_BLOCKS; block++)
+  {
+    outputStageWrite(&stage, input, output, BLOCK_SIZE);
+    sink += output[block % BLOCK_SIZE];
+  }
+  double ditherTime = now() - start;
+
+  // A ramp in every block: only its samples take the interpolated gain
+  outputStageSetDither(&stage, false);
+  outputStageSetRamp(&stage, RAMP_MS, SAMPLE_RATE);
+  start = now();
+  for (uint32_t block = 0; block < TIMING_BLOCKS; block++)
+  {
+    outputStageSetGain(&stage, (block & 1) ? 50 : 49, OUTPUT_STAGE_UNITY_GAIN, PLAIN_SHIFT);
+    outputStageWrite(&stage, input, output, BLOCK_SIZE);
+    sink += output[block % BLOCK_SIZE];
+  }
+  double rampTime = now() - start;
+
+  double samples = (double)TIMING_BLOCKS * BLOCK_SIZE;
+  printf("Floating point:    %.2f ns/sample\n", floatTime / samples * 1e9);
+  printf("Output stage:      %.2f ns/sample (%.1fx), %.2f ns/sample with dither\n",
+         stageTime / samples * 1e9, floatTime / stageTime, ditherTime / samples * 1e9);
+  printf("Gain ramp:         %.2f ns/sample with a %u sample ramp in every block\n", rampTime / samples * 1e9, RAMP_LENGTH);
+}
+
+/******************************************************************************/
@@ -0,0 +1,235 @@
+/***************************************************************************//**
+  @file     pcm_ring_test.c
+  @brief    Tests the PCM ring between the decoder and the DAC DMA: watermarks, underruns and claims on one
+            thread, then a producer and a consumer that works like the DMA (two blocks claimed, the one being
+            output and the next one) on two threads, checking that every block arrives once, in order and intact
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <sched.h>
+#include "lib/pcm_ring/pcm_ring.h"
+#include "bench_util.h"
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define BLOCK_SIZE          256                     // Samples per block
+#define BLOCK_COUNT         4                       // Depth of the ring
+#define LOW_WATERMARK       1
+#define HIGH_WATERMARK      3
+#define STRESS_BLOCKS       200000                  // Blocks passed between the threads
+#define DMA_SLOTS           2                       // Blocks claimed by the consumer at the same time
+
+#define CHECK(condition)    check((condition), #condition, __LINE__)
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES FOR PRIVATE FUNCTIONS WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+/*
+ * @brief Counts a failed condition and prints it
+ */
+static void check(bool condition, const char* text, int line);
+
+/*
+ * @brief Sample i of the block with the given sequence number
+ */
+static uint16_t pattern(uint32_t sequence, uint32_t i);
+
+/*
+ * @brief Single thread checks of the ring states
+ */
+static void testStates(void);
+
+/*
+ * @brief Producer thread, fills and commits STRESS_BLOCKS blocks
+ */
+static void* producer(void* arg);
+
+/*
+ * @brief Consumer thread, claims the blocks like the DMA slots and checks them before releasing
+ */
+static void* consumer(void* arg);
+
+/*******************************************************************************
+ * VARIABLES WITH LOCAL SCOPE
+ ******************************************************************************/
+
+static uint16_t buffer[BLOCK_COUNT * BLOCK_SIZE];
+static pcm_ring_t ring;
+static uint32_t failures;
+static uint32_t corruptBlocks;
+static uint32_t lowLevels;
+
+/*******************************************************************************
+ *******************************************************************************
+                        GLOBAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+int main(void)
+{
+  testStates();
+
+  // Both sides at full speed, the consumer checks each block while the producer keeps filling the free ones
+  pthread_t producerThread, consumerThread;
+  pcmRingReset(&ring);
+  double start = now();
+  pthread_create(&producerThread, NULL, producer, NULL);
+  pthread_create(&consumerThread, NULL, consumer, NULL);
+  pthread_join(producerThread, NULL);
+  pthread_join(consumerThread, NULL);
+  double elapsed = now() - start;
+  CHECK(corruptBlocks == 0);
+  CHECK(pcmRingLevel(&ring) == 0);
+
+  printf("Blocks passed:     %u (%u samples each, ring of %u)\n", STRESS_BLOCKS, BLOCK_SIZE, BLOCK_COUNT);
+  printf("Throughput:        %.1f Mblocks/s\n", STRESS_BLOCKS / elapsed / 1e6);
+  printf("Underruns:         %u, %u claims at the low watermark\n", pcmRingGetUnderruns(&ring), lowLevels);
+  printf("PCM ring:          %s\n", failures ? "FAILED" : "ok");
+  return failures ? 1 : 0;
+}
+
+/*******************************************************************************
+ *******************************************************************************
+                        LOCAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+void check(bool condition, const char* text, int line)
+{
+  if (!condition)
+  {
+    failures++;
+    printf("Line %d: %s\n", line, text);
+  }
+}
+
+uint16_t pattern(uint32_t sequence, uint32_t i)
+{
+  return (uint16_t)(sequence * 7919 + i);
+}
+
+void testStates(void)
+{
+  uint32_t sequence;
+
+  CHECK(!pcmRingInit(&ring, buffer, BLOCK_SIZE, BLOCK_COUNT, HIGH_WATERMARK, LOW_WATERMARK));
+  CHECK(!pcmRingInit(&ring, buffer, BLOCK_SIZE, PCM_RING_MAX_BLOCKS + 1, LOW_WATERMARK, HIGH_WATERMARK));
+  CHECK(pcmRingInit(&ring, buffer, BLOCK_SIZE, BLOCK_COUNT, LOW_WATERMARK, HIGH_WATERMARK));
+
+  // Empty: the claim is an underrun, acquiring does not take the block
+  CHECK(pcmRingLevel(&ring) == 0 && pcmRingIsLow(&ring) && !pcmRingIsHigh(&ring));
+  CHECK(pcmRingClaim(&ring, NULL) == NULL && pcmRingGetUnderruns(&ring) == 1);
+  CHECK(pcmRingAcquire(&ring) == buffer && pcmRingAcquire(&ring) == buffer);
+
+  // Fill it up, the watermarks follow the level
+  for (uint32_t b = 0; b < BLOCK_COUNT; b++)
+  {
+    CHECK(pcmRingProducerSequence(&ring) == b);
+    CHECK(pcmRingAcquire(&ring) == buffer + b * BLOCK_SIZE);
+    pcmRingCommit(&ring);
+    CHECK(pcmRingIsLow(&ring) == (b + 1 <= LOW_WATERMARK));
+    CHECK(pcmRingIsHigh(&ring) == (b + 1 >= HIGH_WATERMARK));
+  }
+  CHECK(pcmRingAcquire(&ring) == NULL);
+
+  // Claimed blocks keep their place until released, in order
+  CHECK(pcmRingClaim(&ring, &sequence) == buffer && sequence == 0);
+  CHECK(pcmRingClaim(&ring, &sequence) == buffer + BLOCK_SIZE && sequence == 1);
+  CHECK(pcmRingAcquire(&ring) == NULL && pcmRingLevel(&ring) == BLOCK_COUNT);
+  pcmRingRelease(&ring);
+  CHECK(pcmRingAcquire(&ring) == buffer && pcmRingLevel(&ring) == BLOCK_COUNT - 1);
+
+  // A restart of the consumer gives back the claimed block that was not released
+  pcmRingUnclaim(&ring);
+  CHECK(pcmRingClaim(&ring, &sequence) == buffer + BLOCK_SIZE && sequence == 1);
+  for (uint32_t b = 2; b < BLOCK_COUNT; b++)
+  {
+    CHECK(pcmRingClaim(&ring, &sequence) && sequence == b);
+  }
+  CHECK(pcmRingClaim(&ring, NULL) == NULL && pcmRingGetUnderruns(&ring) == 2);
+  for (uint32_t b = 0; b < BLOCK_COUNT; b++)
+  {
+    pcmRingRelease(&ring);
+  }
+  pcmRingRelease(&ring);
+  CHECK(pcmRingLevel(&ring) == 0);
+
+  // Wraps around the buffer
+  CHECK(pcmRingProducerSequence(&ring) == BLOCK_COUNT && pcmRingAcquire(&ring) == buffer);
+}
+
+void* producer(void* arg)
+{
+  (void)arg;
+
+  for (uint32_t sequence = 0; sequence < STRESS_BLOCKS; sequence++)
+  {
+    uint16_t* block;
+    while ((block = pcmRingAcquire(&ring)) == NULL)
+    {
+      sched_yield();
+    }
+    for (uint32_t i = 0; i < BLOCK_SIZE; i++)
+    {
+      block[i] = pattern(sequence, i);
+    }
+    pcmRingCommit(&ring);
+  }
+  return NULL;
+}
+
+void* consumer(void* arg)
+{
+  (void)arg;
+
+  const uint16_t* slots[DMA_SLOTS] = { NULL };
+  uint32_t expected = 0;
+  uint32_t output = 0;
+  uint32_t current = 0;
+
+  while (output < STRESS_BLOCKS)
+  {
+    // Claims the block of the free slot, an empty ring would be a held sample on the DAC
+    uint32_t sequence;
+    lowLevels += pcmRingIsLow(&ring);
+    slots[current] = pcmRingClaim(&ring, &sequence);
+    if (slots[current])
+    {
+      corruptBlocks += (sequence != expected);
+      expected = sequence + 1;
+    }
+
+    // Outputs the block of the other slot, it must not change while it is claimed
+    current = (current + 1) % DMA_SLOTS;
+    const uint16_t* block = slots[current];
+    if (block)
+    {
+      uint32_t blockSequence = output;
+      for (uint32_t i = 0; i < BLOCK_SIZE; i++)
+      {
+        corruptBlocks += (block[i] != pattern(blockSequence, i));
+      }
+      pcmRingRelease(&ring);
+      slots[current] = NULL;
+      output++;
+    }
+    else
+    {
+      sched_yield();
+    }
+  }
+  return NULL;
+}
+
+/******************************************************************************/
@@ -0,0 +1,128 @@
+/***************************************************************************//**
+  @file     polyphase_test.c
+  @brief    Checks that the polyphase kernel picked at build time (AVX2, SSE4.1, C reference) is
+            bit-exact, by hashing its output over pseudo-random vbuf contents against the hash of
+            the C reference. With files as arguments, also prints the hash of their decoded PCM,
+            to be compared between builds.
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include "coder.h"
+#include "bench_util.h"
+#include "lib/mp3decoder/mp3decoder.h"
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define TEST_ROUNDS         20000                   // Calls to each kernel
+#define REFERENCE_HASH      0x2684ca12434cc672ULL   // FNV-1a of the C reference output
+
+#define FNV_OFFSET          0xcbf29ce484222325ULL
+#define FNV_PRIME           0x100000001b3ULL
+
+#if defined(__x86_64__) && defined(__AVX2__)
+#define KERNEL_NAME         "AVX2"
+#elif defined(__x86_64__) && defined(__SSE4_1__)
+#define KERNEL_NAME         "SSE4.1"
+#else
+#define KERNEL_NAME         "C reference"
+#endif
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES FOR PRIVATE FUNCTIONS WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+/*
+ * @brief Adds a block of samples to a FNV-1a hash
+ */
+static uint64_t hashSamples(uint64_t hash, const short* samples, uint32_t count);
+
+/*
+ * @brief Decodes a file and returns the hash of its PCM
+ */
+static uint64_t hashFile(const char* filename);
+
+/*******************************************************************************
+ * VARIABLES WITH LOCAL SCOPE
+ ******************************************************************************/
+
+static int vbuf[MAX_NCHAN * VBUF_LENGTH];
+static short pcm[MP3_DECODED_BUFFER_SIZE];
+
+/*******************************************************************************
+ *******************************************************************************
+                        GLOBAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+int main(int argc, char* argv[])
+{
+  uint64_t hash = FNV_OFFSET;
+
+  for (uint32_t round = 0; round < TEST_ROUNDS; round++)
+  {
+    // Magnitudes from a few bits up to the full range, so the output also clips
+    uint8_t shift = round % 24;
+    for (uint32_t i = 0; i < MAX_NCHAN * VBUF_LENGTH; i++)
+    {
+      vbuf[i] = (int32_t)lcg() >> shift;
+    }
+    PolyphaseMono(pcm, vbuf, polyCoef);
+    hash = hashSamples(hash, pcm, NBANDS);
+    PolyphaseStereo(pcm, vbuf, polyCoef);
+    hash = hashSamples(hash, pcm, 2 * NBANDS);
+  }
+
+  bool passed = (hash == REFERENCE_HASH);
+  printf("Polyphase kernel:  %s\n", KERNEL_NAME);
+  printf("Output hash:       %016llx (%s)\n", (unsigned long long)hash, passed ? "bit-exact" : "MISMATCH");
+
+  for (int i = 1; i < argc; i++)
+  {
+    printf("%s: %016llx\n", argv[i], (unsigned long long)hashFile(argv[i]));
+  }
+  return passed ? 0 : 1;
+}
+
+/*******************************************************************************
+ *******************************************************************************
+                        LOCAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+uint64_t hashSamples(uint64_t hash, const short* samples, uint32_t count)
+{
+  for (uint32_t i = 0; i < count; i++)
+  {
+    hash = (hash ^ (uint16_t)samples[i]) * FNV_PRIME;
+  }
+  return hash;
+}
+
+uint64_t hashFile(const char* filename)
+{
+  uint64_t hash = FNV_OFFSET;
+  uint16_t samples;
+  MP3DecoderInit();
+  if (MP3LoadFile(filename))
+  {
+    mp3decoder_result_t result;
+    while ((result = MP3GetDecodedFrame(pcm, MP3_DECODED_BUFFER_SIZE, &samples)) != MP3DECODER_FILE_END)
+    {
+      if (result == MP3DECODER_NO_ERROR)
+      {
+        hash = hashSamples(hash, pcm, samples);
+      }
+    }
+  }
+  return hash;
+}
+
+/******************************************************************************/
@@ -0,0 +1,121 @@
+/***************************************************************************//**
+  @file     profile_report.c
+  @brief    Decodes files and reports the time spent in each stage of the Helix decoder, 
+            with -half the files are decoded in half rate (MP3DECODER_QUALITY_HALF_RATE)
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "lib/mp3decoder/mp3decoder.h"
+#include "bench_util.h"
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES FOR PRIVATE FUNCTIONS WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+/*******************************************************************************
+ * VARIABLES WITH LOCAL SCOPE
+ ******************************************************************************/
+
+static short pcm[MP3_DECODED_BUFFER_SIZE];
+
+static const char* stageNames[MP3DECODER_STAGE_COUNT] = {
+  "FrameHeader", "SideInfo", "ScaleFactors", "Huffman", "Dequantize", "IMDCT", "Subband"
+};
+
+/*******************************************************************************
+ *******************************************************************************
+                        GLOBAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+int main(int argc, char* argv[])
+{
+  if (argc < 2)
+  {
+    printf("Usage: %s [-half] file.mp3 [file.mp3 ...]\n", argv[0]);
+    return 1;
+  }
+
+  int first = 1;
+  bool halfRate = (strcmp(argv[1], "-half") == 0);
+  if (halfRate)
+  {
+    first++;
+  }
+
+  uint16_t samples;
+  uint64_t channelSamples = 0;
+  uint32_t sampleRate = 0;
+  double elapsed = 0;
+  mp3decoder_frame_data_t frameData;
+  mp3decoder_profile_t profile;
+
+  // The profile is not cleared when a file is loaded, so it adds up over all the files
+  MP3DecoderInit();
+  MP3ResetProfile();
+  MP3SetQuality(halfRate ? MP3DECODER_QUALITY_HALF_RATE : MP3DECODER_QUALITY_FULL);
+  for (int i = first; i < argc; i++)
+  {
+    if (!MP3LoadFile(argv[i]))
+    {
+      printf("Couldnt load %s\n", argv[i]);
+      continue;
+    }
+    double start = now();
+    mp3decoder_result_t result;
+    while ((result = MP3GetDecodedFrame(pcm, MP3_DECODED_BUFFER_SIZE, &samples)) != MP3DECODER_FILE_END)
+    {
+      if ((result == MP3DECODER_NO_ERROR) && MP3GetLastFrameData(&frameData))
+      {
+        channelSamples += samples / frameData.channelCount;
+        sampleRate = frameData.sampleRate;
+      }
+    }
+    elapsed += now() - start;
+  }
+
+  MP3GetProfile(&profile);
+  if (profile.frames == 0)
+  {
+    printf("No frames profiled, build the library with MP3_PROFILE defined\n");
+    return 1;
+  }
+
+  uint64_t total = 0;
+  uint8_t heaviest = 0;
+  for (uint8_t i = 0; i < MP3DECODER_STAGE_COUNT; i++)
+  {
+    total += profile.total[i];
+    heaviest = (profile.total[i] > profile.total[heaviest]) ? i : heaviest;
+  }
+
+  printf("Frames profiled:  %u%s\n", profile.frames, halfRate ? " (half rate)" : "");
+  printf("Audio decoded:    %.1f s in %.3f s (%.1fx realtime)\n",
+         sampleRate ? (double)channelSamples / sampleRate : 0.0, elapsed,
+         (sampleRate && elapsed > 0) ? (double)channelSamples / sampleRate / elapsed : 0.0);
+  printf("\n%-14s %16s %7s %12s %10s %10s\n", "Stage", "Total ticks", "Share", "Ticks/frame", "Min", "Max");
+  for (uint8_t i = 0; i < MP3DECODER_STAGE_COUNT; i++)
+  {
+    printf("%-14s %16llu %6.1f%% %12.0f %10u %10u\n", stageNames[i], (unsigned long long)profile.total[i],
+           total ? 100.0 * profile.total[i] / total : 0.0, (double)profile.total[i] / profile.frames,
+           profile.min[i], profile.max[i]);
+  }
+  printf("%-14s %16llu %6.1f%% %12.0f\n", "MP3Decode", (unsigned long long)total, 100.0, (double)total / profile.frames);
+  printf("\nHeaviest stage:   %s\n", stageNames[heaviest]);
+  return 0;
+}
+
+/*******************************************************************************
+ *******************************************************************************
+                        LOCAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+/******************************************************************************/
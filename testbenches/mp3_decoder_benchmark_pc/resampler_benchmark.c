@@ -0,0 +1,223 @@
+/***************************************************************************//**
+  @file     resampler_benchmark.c
+  @brief    Converts tones from every MPEG sample rate to the DAC rate with each resampler quality, reports
+            the THD+N and the conversion speed, and checks that streaming in any chunk sizes gives the same output
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include "lib/resampler/resampler.h"
+#include "bench_util.h"
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define OUTPUT_RATE         44100                   // DAC rate of the audio module
+#define MAX_INPUT_RATE      48000
+#define SECONDS             1                       // Length of the tones
+#define TONE_HZ             1000
+#define TONE_AMPLITUDE      16384                   // -6 dBFS
+#define EDGE_SAMPLES        64                      // Output samples left out of the THD+N at both ends
+#define TIMING_RUNS         5                       // Conversions of each tone timed, the best one is reported
+#define CHUNK_SEED          12345
+
+#define MAX_OUTPUT          ((MAX_INPUT_RATE > OUTPUT_RATE ? MAX_INPUT_RATE : OUTPUT_RATE) * SECONDS * 6)
+#define PI                  3.14159265358979323846
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES FOR PRIVATE FUNCTIONS WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+/*
+ * @brief Converts the whole input in one call
+ * @returns Amount of output samples
+ */
+static uint32_t convert(resampler_t* resampler, const int16_t* in, uint32_t inCount, int16_t* out);
+
+/*
+ * @brief Converts the input in chunks of random sizes, on both sides
+ * @returns Amount of output samples
+ */
+static uint32_t convertChunked(resampler_t* resampler, const int16_t* in, uint32_t inCount, int16_t* out);
+
+/*
+ * @brief THD+N of a tone, in dB: the residual after fitting the tone (and DC) by least squares, relative to the tone
+ * @param samples     Pointer to the samples
+ * @param count       Amount of samples
+ * @param frequency   Tone frequency, in cycles per sample
+ */
+static double thdN(const int16_t* samples, uint32_t count, double frequency);
+
+/*******************************************************************************
+ * VARIABLES WITH LOCAL SCOPE
+ ******************************************************************************/
+
+static const uint32_t inputRates[] = { 8000, 11025, 12000, 16000, 22050, 24000, 32000, 44100, 48000 };
+static const char* qualityNames[RESAMPLER_QUALITY_COUNT] = { "low", "medium", "high" };
+static const double thdNLimits[RESAMPLER_QUALITY_COUNT] = { -45, -62, -78 };   // dB, for every rate
+
+static resampler_t resampler;
+static int16_t input[MAX_INPUT_RATE * SECONDS];
+static int16_t output[MAX_OUTPUT];
+static int16_t chunked[MAX_OUTPUT];
+
+/*******************************************************************************
+ *******************************************************************************
+                        GLOBAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+int main(void)
+{
+  bool ok = true;
+
+  printf("Output rate:       %u Hz, %u Hz tone at -6 dBFS\n", OUTPUT_RATE, TONE_HZ);
+  printf("%-8s %8s %10s %12s %10s\n", "quality", "input", "THD+N", "Msamples/s", "chunks");
+  for (uint8_t quality = 0; quality < RESAMPLER_QUALITY_COUNT; quality++)
+  {
+    double worst = -200;
+    for (uint32_t r = 0; r < sizeof(inputRates) / sizeof(inputRates[0]); r++)
+    {
+      uint32_t inputRate = inputRates[r];
+      uint32_t inCount = inputRate * SECONDS;
+      for (uint32_t i = 0; i < inCount; i++)
+      {
+        input[i] = (int16_t)lrint(TONE_AMPLITUDE * sin(2 * PI * TONE_HZ * i / inputRate));
+      }
+
+      // Best of a few runs, the filter is designed once per rate outside of the timed part
+      double best = 0;
+      uint32_t outCount = 0;
+      resamplerInit(&resampler, (resampler_quality_t)quality, OUTPUT_RATE);
+      resamplerSetInputRate(&resampler, inputRate);
+      for (uint32_t run = 0; run < TIMING_RUNS; run++)
+      {
+        resamplerReset(&resampler);
+        double start = now();
+        outCount = convert(&resampler, input, inCount, output);
+        double elapsed = now() - start;
+        best = (run == 0 || elapsed < best) ? elapsed : best;
+      }
+
+      // Same output in chunks of any size
+      resamplerReset(&resampler);
+      uint32_t chunkedCount = convertChunked(&resampler, input, inCount, chunked);
+      bool same = (chunkedCount == outCount) && !memcmp(chunked, output, outCount * sizeof(int16_t));
+
+      // Bypass at the same rate
+      if (inputRate == OUTPUT_RATE)
+      {
+        same = same && (outCount + resampler.taps / 2 == inCount) && !memcmp(output, input, outCount * sizeof(int16_t));
+      }
+
+      // The filter delay is compensated: the output tone starts at the first sample
+      double thd = thdN(output + EDGE_SAMPLES, outCount - 2 * EDGE_SAMPLES, (double)TONE_HZ / OUTPUT_RATE);
+      bool expectedLength = (outCount + 1 >= (uint64_t)(inCount - resampler.taps / 2) * OUTPUT_RATE / inputRate);
+      worst = (thd > worst) ? thd : worst;
+      ok = ok && same && expectedLength && (thd < thdNLimits[quality]);
+
+      printf("%-8s %8u %7.1f dB %12.2f %10s\n", qualityNames[quality], inputRate, thd, outCount / best / 1e6,
+             (same && expectedLength) ? "same" : "MISMATCH");
+    }
+    printf("%-8s %8s %7.1f dB (limit %.0f dB)\n", qualityNames[quality], "worst", worst, thdNLimits[quality]);
+  }
+
+  // The filters of the MPEG rates are designed by resamplerInit, a rate change in the audio path only swaps them
+  uint32_t changes = 0;
+  resamplerInit(&resampler, RESAMPLER_QUALITY_HIGH, OUTPUT_RATE);
+  double start = now();
+  for (uint32_t run = 0; run < TIMING_RUNS; run++)
+  {
+    for (uint32_t r = 0; r < sizeof(inputRates) / sizeof(inputRates[0]); r++, changes++)
+    {
+      resamplerSetInputRate(&resampler, inputRates[r]);
+    }
+  }
+  printf("Rate change:       %.2f us\n", (now() - start) / changes * 1e6);
+
+  printf("Resampler:         %s\n", ok ? "ok" : "FAILED");
+  return ok ? 0 : 1;
+}
+
+/*******************************************************************************
+ *******************************************************************************
+                        LOCAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+uint32_t convert(resampler_t* resampler, const int16_t* in, uint32_t inCount, int16_t* out)
+{
+  uint32_t consumed;
+  return resamplerProcess(resampler, in, inCount, out, MAX_OUTPUT, &consumed);
+}
+
+uint32_t convertChunked(resampler_t* resampler, const int16_t* in, uint32_t inCount, int16_t* out)
+{
+  uint32_t seed = CHUNK_SEED;
+  uint32_t inPosition = 0, outPosition = 0;
+  bool running = true;
+
+  while (running)
+  {
+    seed = seed * 1103515245 + 12345;
+    uint32_t inChunk = (seed >> 16) % 1200;
+    uint32_t outChunk = (seed >> 8) % 900 + 1;
+    inChunk = (inChunk < inCount - inPosition) ? inChunk : (inCount - inPosition);
+
+    uint32_t consumed;
+    uint32_t produced = resamplerProcess(resampler, in + inPosition, inChunk, out + outPosition, outChunk, &consumed);
+    inPosition += consumed;
+    outPosition += produced;
+    running = (inPosition < inCount) || (produced == outChunk);
+  }
+  return outPosition;
+}
+
+double thdN(const int16_t* samples, uint32_t count, double frequency)
+{
+  // Normal equations of x = a sin + b cos + c
+  double ss = 0, cc = 0, sc = 0, s1 = 0, c1 = 0, xs = 0, xc = 0, x1 = 0;
+  for (uint32_t i = 0; i < count; i++)
+  {
+    double s = sin(2 * PI * frequency * i), c = cos(2 * PI * frequency * i), x = samples[i];
+    ss += s * s; cc += c * c; sc += s * c; s1 += s; c1 += c;
+    xs += x * s; xc += x * c; x1 += x;
+  }
+  double m[3][4] = { { ss, sc, s1, xs }, { sc, cc, c1, xc }, { s1, c1, count, x1 } };
+  for (uint32_t p = 0; p < 3; p++)
+  {
+    for (uint32_t r = 0; r < 3; r++)
+    {
+      if (r != p)
+      {
+        double factor = m[r][p] / m[p][p];
+        for (uint32_t k = 0; k < 4; k++)
+        {
+          m[r][k] -= factor * m[p][k];
+        }
+      }
+    }
+  }
+  double a = m[0][3] / m[0][0], b = m[1][3] / m[1][1], dc = m[2][3] / m[2][2];
+
+  double tone = 0, residual = 0;
+  for (uint32_t i = 0; i < count; i++)
+  {
+    double fit = a * sin(2 * PI * frequency * i) + b * cos(2 * PI * frequency * i);
+    double error = samples[i] - fit - dc;
+    tone += fit * fit;
+    residual += error * error;
+  }
+  return 10 * log10(residual / tone);
+}
+
+/******************************************************************************/
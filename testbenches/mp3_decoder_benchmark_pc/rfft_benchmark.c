@@ -0,0 +1,293 @@
+/***************************************************************************//**
+  @file     rfft_benchmark.c
+  @brief    Checks the complex and real FFT of the cfft module against a reference DFT and each other, and times
+            the power spectrum of real samples through the complex FFT and through the real FFT
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include "drivers/MCAL/cfft/cfft.h"
+#include "bench_util.h"
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define MAX_SIZE            CFFT_MAX_SIZE
+#define REFERENCE_SIZE      512                     // Size checked against the double precision DFT
+#define ERROR_LIMIT         1e-5                    // RMS error relative to the RMS of the bins
+#define Q15_TONE_BIN        8
+#define Q15_TONE_AMPLITUDE  16384
+#define Q15_LIMIT           2                       // Q15 bins off the scaled float ones, in LSB
+#define TIMING_RUNS         2000                    // Spectra timed per size, the best batch is reported
+#define TIMING_BATCHES      5
+#define SEED                12345
+
+#define PI                  3.14159265358979323846
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES FOR PRIVATE FUNCTIONS WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+/*
+ * @brief Checks one size: the complex FFT against the reference DFT and its inverse, the real FFT and its
+ *        magnitude squared against the complex FFT
+ * @returns True when every error is under the limit
+ */
+static bool checkSize(cfft_size_t size, uint32_t length);
+
+/*
+ * @brief Checks the Q15 real FFT of a tone against the float one, scaled down by half the size as CMSIS, and its layout
+ */
+static bool checkQ15(void);
+
+/*
+ * @brief Times the power spectrum of real samples through the complex FFT and through the real FFT
+ */
+static void timeSize(cfft_size_t size, uint32_t length);
+
+/*
+ * @brief RMS of the difference between two buffers, relative to the RMS of the second one
+ */
+static double relativeError(const float* values, const double* reference, uint32_t count);
+
+/*
+ * @brief Returns a uniform random number in [-1, 1)
+ */
+static float randomSample(void);
+
+/*******************************************************************************
+ * VARIABLES WITH LOCAL SCOPE
+ ******************************************************************************/
+
+static uint32_t seed = SEED;
+
+static float samples[MAX_SIZE];
+static float complexInput[MAX_SIZE * 2];
+static float complexOutput[MAX_SIZE * 2];
+static float realInput[MAX_SIZE];
+static float realOutput[MAX_SIZE];
+static float inverse[MAX_SIZE * 2];
+static float power[MAX_SIZE / 2 + 1];
+static double reference[MAX_SIZE * 2];
+static q15_t q15Input[MAX_SIZE];
+static q15_t q15Output[MAX_SIZE * 2];
+
+/*******************************************************************************
+ *******************************************************************************
+                        GLOBAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+int main(void)
+{
+  bool ok = true;
+
+  for (cfft_size_t size = CFFT_32; size <= CFFT_4096; size++)
+  {
+    ok = checkSize(size, 16u << size) && ok;
+  }
+  ok = checkQ15() && ok;
+
+  printf("%6s %14s %14s %9s %12s %12s\n", "size", "complex (us)", "real (us)", "speed-up", "complex (B)", "real (B)");
+  timeSize(CFFT_512, 512);
+  timeSize(CFFT_4096, 4096);
+
+  printf("Real FFT:          %s\n", ok ? "ok" : "FAILED");
+  return ok ? 0 : 1;
+}
+
+/*******************************************************************************
+ *******************************************************************************
+                        LOCAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+bool checkSize(cfft_size_t size, uint32_t length)
+{
+  for (uint32_t i = 0; i < length; i++)
+  {
+    samples[i] = randomSample();
+    complexInput[2 * i] = samples[i];
+    complexInput[2 * i + 1] = (length == REFERENCE_SIZE) ? randomSample() : 0;
+  }
+
+  // Complex FFT against the reference DFT, only at one size as it is slow
+  cfftInit(size);
+  cfft(complexInput, complexOutput, true);
+  double dftError = 0;
+  if (length == REFERENCE_SIZE)
+  {
+    for (uint32_t k = 0; k < length; k++)
+    {
+      double re = 0, im = 0;
+      for (uint32_t n = 0; n < length; n++)
+      {
+        double angle = -2 * PI * (double)((uint64_t)k * n % length) / length;
+        re += complexInput[2 * n] * cos(angle) - complexInput[2 * n + 1] * sin(angle);
+        im += complexInput[2 * n] * sin(angle) + complexInput[2 * n + 1] * cos(angle);
+      }
+      reference[2 * k] = re;
+      reference[2 * k + 1] = im;
+    }
+    dftError = relativeError(complexOutput, reference, length * 2);
+
+    // From here on the input is real
+    for (uint32_t i = 0; i < length; i++)
+    {
+      complexInput[2 * i + 1] = 0;
+    }
+    cfft(complexInput, complexOutput, true);
+  }
+
+  // Inverse of the complex FFT
+  icfft(complexOutput, inverse, true);
+  for (uint32_t i = 0; i < length * 2; i++)
+  {
+    reference[i] = complexInput[i];
+  }
+  double inverseError = relativeError(inverse, reference, length * 2);
+
+  // Real FFT against the complex one, with the CMSIS packing
+  rfftInit(size);
+  memcpy(realInput, samples, length * sizeof(float));
+  rfft(realInput, realOutput, NULL);
+  for (uint32_t k = 0; k < length / 2; k++)
+  {
+    reference[2 * k] = complexOutput[2 * k];
+    reference[2 * k + 1] = (k == 0) ? complexOutput[length] : complexOutput[2 * k + 1];
+  }
+  double realError = relativeError(realOutput, reference, length);
+
+  // Magnitude squared, in place
+  for (uint32_t k = 0; k <= length / 2; k++)
+  {
+    reference[k] = (double)complexOutput[2 * k] * complexOutput[2 * k] + (double)complexOutput[2 * k + 1] * complexOutput[2 * k + 1];
+  }
+  rfftGetMagSquared(realOutput, realOutput);
+  double powerError = relativeError(realOutput, reference, length / 2 + 1);
+
+  bool ok = (dftError < ERROR_LIMIT) && (inverseError < ERROR_LIMIT) && (realError < ERROR_LIMIT) && (powerError < ERROR_LIMIT);
+  if (!ok || (length == REFERENCE_SIZE))
+  {
+    printf("Size %4u: DFT %.1e, inverse %.1e, real %.1e, power %.1e %s\n", length, dftError, inverseError,
+           realError, powerError, ok ? "" : "FAILED");
+  }
+  return ok;
+}
+
+bool checkQ15(void)
+{
+  uint32_t length = REFERENCE_SIZE;
+  rfftInit(CFFT_512);
+  for (uint32_t i = 0; i < length; i++)
+  {
+    q15Input[i] = (q15_t)lrint(Q15_TONE_AMPLITUDE * sin(2 * PI * Q15_TONE_BIN * i / length + 0.3));
+    realInput[i] = q15Input[i];
+  }
+  rfft(realInput, realOutput, NULL);
+  rfftQ15(q15Input, q15Output, NULL);
+
+  int32_t worst = 0;
+  bool symmetric = true;
+  for (uint32_t k = 1; k < length / 2; k++)
+  {
+    for (uint32_t part = 0; part < 2; part++)
+    {
+      int32_t expected = (int32_t)lrintf(realOutput[2 * k + part] / (length / 2));
+      int32_t error = abs(q15Output[2 * k + part] - expected);
+      worst = (error > worst) ? error : worst;
+    }
+    symmetric = symmetric && (q15Output[2 * (length - k)] == q15Output[2 * k]) &&
+                (q15Output[2 * (length - k) + 1] == -q15Output[2 * k + 1]);
+  }
+
+  // A tone of amplitude A leaves A in its bin (9.7 format), 3.13 power is A^2 >> 17
+  rfftGetMagSquaredQ15(q15Output, q15Output);
+  int32_t tone = q15Output[Q15_TONE_BIN];
+  int32_t expectedTone = Q15_TONE_AMPLITUDE * Q15_TONE_AMPLITUDE >> 17;
+
+  bool ok = (worst <= Q15_LIMIT) && symmetric && (abs(tone - expectedTone) <= 2);
+  printf("Q15 size %u: worst bin error %d LSB, tone power %d (expected %d), %s\n", length, worst, tone, expectedTone,
+         symmetric ? "conjugate symmetric" : "NOT SYMMETRIC");
+  return ok;
+}
+
+void timeSize(cfft_size_t size, uint32_t length)
+{
+  double complexBest = 0, realBest = 0;
+  volatile float sink = 0;
+
+  cfftInit(size);
+  rfftInit(size);
+  for (uint32_t i = 0; i < length; i++)
+  {
+    samples[i] = randomSample();
+  }
+
+  for (uint32_t batch = 0; batch < TIMING_BATCHES; batch++)
+  {
+    // Complex FFT of the samples with zero imaginary parts, as the spectrum analyzer did
+    double start = now();
+    for (uint32_t run = 0; run < TIMING_RUNS; run++)
+    {
+      for (uint32_t i = 0; i < length; i++)
+      {
+        complexInput[2 * i] = samples[i];
+        complexInput[2 * i + 1] = 0;
+      }
+      cfft(complexInput, complexOutput, true);
+      for (uint32_t k = 0; k <= length / 2; k++)
+      {
+        power[k] = complexOutput[2 * k] * complexOutput[2 * k] + complexOutput[2 * k + 1] * complexOutput[2 * k + 1];
+      }
+      sink += power[run % (length / 2)];
+    }
+    double complexTime = (now() - start) / TIMING_RUNS;
+
+    start = now();
+    for (uint32_t run = 0; run < TIMING_RUNS; run++)
+    {
+      memcpy(realInput, samples, length * sizeof(float));
+      rfft(realInput, realOutput, NULL);
+      rfftGetMagSquared(realOutput, realOutput);
+      sink += realOutput[run % (length / 2)];
+    }
+    double realTime = (now() - start) / TIMING_RUNS;
+
+    complexBest = (batch == 0 || complexTime < complexBest) ? complexTime : complexBest;
+    realBest = (batch == 0 || realTime < realBest) ? realTime : realBest;
+  }
+
+  // Input and output buffers of each path
+  printf("%6u %14.2f %14.2f %8.2fx %12zu %12zu\n", length, complexBest * 1e6, realBest * 1e6, complexBest / realBest,
+         2 * length * 2 * sizeof(float), 2 * length * sizeof(float));
+}
+
+double relativeError(const float* values, const double* reference, uint32_t count)
+{
+  double error = 0, total = 0;
+  for (uint32_t i = 0; i < count; i++)
+  {
+    error += (values[i] - reference[i]) * (values[i] - reference[i]);
+    total += reference[i] * reference[i];
+  }
+  return sqrt(error / total);
+}
+
+float randomSample(void)
+{
+  seed = seed * 1103515245 + 12345;
+  return (float)((seed >> 8) & 0xFFFF) / 32768.0f - 1.0f;
+}
+
+/******************************************************************************/
@@ -0,0 +1,201 @@
+/***************************************************************************//**
+  @file     ring_benchmark.c
+  @brief    Measures the encoded bytes copied per frame by the mp3decoder input buffer, and the time
+            spent decoding through the stdio backend (ring buffer) and the mmap backend (zero-copy)
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "lib/mp3decoder/mp3decoder.h"
+#include "bench_util.h"
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define LEGACY_BUFFER_BYTES     6913        // Size of the input buffer before the ring buffer
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES FOR PRIVATE FUNCTIONS WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+/*
+ * @brief Returns the length of the Layer III frame whose header starts at p, or 0 if the header is invalid
+ */
+static uint32_t frameLength(const uint8_t* p);
+
+/*
+ * @brief Replays the legacy policy (compact the buffer with memmove, then fill it up) over the file
+ * @param data      File contents
+ * @param size      File size
+ * @param frames    Pointer to variable that will be updated with the amount of frames found
+ * @returns Total bytes moved by the compaction
+ */
+static uint64_t legacyBytesCopied(const uint8_t* data, uint32_t size, uint32_t* frames);
+
+/*******************************************************************************
+ * VARIABLES WITH LOCAL SCOPE
+ ******************************************************************************/
+
+static short pcm[MP3_DECODED_BUFFER_SIZE];
+
+static const uint16_t bitrates[2][15] = {
+  { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 },    // MPEG-1
+  { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 }          // MPEG-2 / 2.5
+};
+static const uint16_t samplerates[3] = { 44100, 48000, 32000 };
+
+/*******************************************************************************
+ *******************************************************************************
+                        GLOBAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+int main(int argc, char* argv[])
+{
+  if (argc < 2)
+  {
+    printf("Usage: %s file.mp3\n", argv[0]);
+    return 1;
+  }
+
+  // Load the whole file to replay the legacy buffer policy
+  FILE* fp = fopen(argv[1], "rb");
+  if (fp == NULL)
+  {
+    printf("Couldnt open file\n");
+    return 1;
+  }
+  fseek(fp, 0, SEEK_END);
+  uint32_t size = ftell(fp);
+  rewind(fp);
+  uint8_t* data = malloc(size);
+  if (fread(data, 1, size, fp) != size)
+  {
+    printf("Couldnt read file\n");
+    return 1;
+  }
+  fclose(fp);
+
+  uint32_t legacyFrames;
+  uint64_t legacyCopied = legacyBytesCopied(data, size, &legacyFrames);
+  free(data);
+
+  // Decode with the actual library
+  uint16_t samples;
+  mp3decoder_stats_t stats;
+  MP3DecoderInit();
+  if (!MP3LoadFile(argv[1]))
+  {
+    printf("Couldnt load file\n");
+    return 1;
+  }
+  double start = now();
+  while (MP3GetDecodedFrame(pcm, MP3_DECODED_BUFFER_SIZE, &samples) != MP3DECODER_FILE_END);
+  double ringTime = now() - start;
+  MP3GetStats(&stats);
+
+  #ifdef MP3DECODER_IO_MMAP
+  // Same file decoded in place from the mapping
+  mp3decoder_mmap_t mapping;
+  mp3decoder_stream_t stream;
+  mp3decoder_stats_t mmapStats;
+  if (!MP3IoMmapOpen(&mapping, argv[1], &stream))
+  {
+    printf("Couldnt map file\n");
+    return 1;
+  }
+  MP3LoadStream(&stream);
+  start = now();
+  while (MP3GetDecodedFrame(pcm, MP3_DECODED_BUFFER_SIZE, &samples) != MP3DECODER_FILE_END);
+  double mmapTime = now() - start;
+  MP3GetStats(&mmapStats);
+  #endif
+
+  printf("File:                   %s (%u bytes)\n", argv[1], size);
+  printf("Frames decoded:         %u\n", stats.framesDecoded);
+  printf("Frames dropped:         %u\n", stats.droppedFrames);
+  printf("Bytes skipped (resync): %u in %u resyncs\n", stats.skippedBytes, stats.resyncs);
+  printf("Before (memmove):       %llu bytes copied, %.1f bytes/frame\n",
+         (unsigned long long)legacyCopied, legacyFrames ? (double)legacyCopied / legacyFrames : 0.0);
+  printf("After  (mirrored ring): %u bytes copied, %.1f bytes/frame\n",
+         stats.bytesCopied, stats.framesDecoded ? (double)stats.bytesCopied / stats.framesDecoded : 0.0);
+  printf("Decode time (stdio):    %.3f s\n", ringTime);
+  #ifdef MP3DECODER_IO_MMAP
+  printf("Zero-copy (mmap):       %u frames, %u bytes copied, %.3f s\n", mmapStats.framesDecoded, mmapStats.bytesCopied, mmapTime);
+  #endif
+  return 0;
+}
+
+/*******************************************************************************
+ *******************************************************************************
+                        LOCAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+uint32_t frameLength(const uint8_t* p)
+{
+  uint32_t length = 0;
+  if ((p[0] == 0xFF) && ((p[1] & 0xE0) == 0xE0) && ((p[1] & 0x06) == 0x02))
+  {
+    uint8_t version = (p[1] >> 3) & 0x03;       // 3 = MPEG-1, 2 = MPEG-2, 0 = MPEG-2.5
+    uint8_t bitrateIndex = p[2] >> 4;
+    uint8_t samplerateIndex = (p[2] >> 2) & 0x03;
+    uint8_t padding = (p[2] >> 1) & 0x01;
+    if ((version != 1) && (bitrateIndex != 0) && (bitrateIndex != 15) && (samplerateIndex != 3))
+    {
+      uint32_t samplerate = samplerates[samplerateIndex] >> (version == 3 ? 0 : (version == 2 ? 1 : 2));
+      uint32_t bitrate = bitrates[version == 3 ? 0 : 1][bitrateIndex] * 1000;
+      length = (version == 3 ? 144 : 72) * bitrate / samplerate + padding;
+    }
+  }
+  return length;
+}
+
+uint64_t legacyBytesCopied(const uint8_t* data, uint32_t size, uint32_t* frames)
+{
+  uint64_t copied = 0;
+  uint32_t top = 0, bottom = 0, filePos = 0, pos = 0;
+
+  *frames = 0;
+  while (pos + 4 <= size)
+  {
+    uint32_t length = frameLength(data + pos);
+    if (length == 0)
+    {
+      pos++;
+      continue;
+    }
+
+    // Same sequence as the legacy MP3GetDecodedFrame: compact, fill, consume the frame (and any junk before it)
+    if ((top > 0) && (bottom > top))
+    {
+      copied += bottom - top;
+      bottom -= top;
+      top = 0;
+    }
+    else if (bottom == top)
+    {
+      bottom = top = 0;
+    }
+    uint32_t fill = LEGACY_BUFFER_BYTES - bottom;
+    if (fill > size - filePos)
+    {
+      fill = size - filePos;
+    }
+    bottom += fill;
+    filePos += fill;
+
+    uint32_t consumed = (pos + length) - (filePos - (bottom - top));
+    top += (consumed > bottom - top) ? bottom - top : consumed;
+    pos += length;
+    (*frames)++;
+  }
+  return copied;
+}
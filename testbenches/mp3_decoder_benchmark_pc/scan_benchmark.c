@@ -0,0 +1,189 @@
+/***************************************************************************//**
+  @file     scan_benchmark.c
+  @brief    Scans files with MP3Scan (frame headers only), reports the scan throughput through the stdio and mmap
+            backends, and checks the frame count, duration and offset table against a full decode of the file
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "lib/mp3decoder/mp3decoder.h"
+#include "bench_util.h"
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define OFFSET_TABLE_ENTRIES    1000        // Entries of the offset table given to the scan
+#define MIN_TIMING_SECONDS      0.2         // Minimum time spent scanning each file to measure the throughput
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES FOR PRIVATE FUNCTIONS WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+/*
+ * @brief Scans the file loaded in the default decoder as many times as needed to time it
+ * @param scan      Pointer to object to be filled with the results
+ * @param bytes     File size
+ * @returns Throughput in MB/s
+ */
+static double timeScan(mp3decoder_scan_t* scan, uint32_t bytes);
+
+/*
+ * @brief Decodes the whole file loaded in the default decoder
+ * @param frames    Pointer to variable that will be updated with the frames found (decoded or dropped)
+ * @returns Samples per channel output by the decoder
+ */
+static uint32_t decodeAll(uint32_t* frames);
+
+/*
+ * @brief Checks that the entries of the offset table are increasing and point to frame headers of the file
+ */
+static bool checkOffsets(const char* filename, const mp3decoder_scan_t* scan);
+
+/*******************************************************************************
+ * VARIABLES WITH LOCAL SCOPE
+ ******************************************************************************/
+
+static short pcm[MP3_DECODED_BUFFER_SIZE];
+static uint32_t offsets[OFFSET_TABLE_ENTRIES];
+
+/*******************************************************************************
+ *******************************************************************************
+                        GLOBAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+int main(int argc, char* argv[])
+{
+  if (argc < 2)
+  {
+    printf("Usage: %s file.mp3 [file.mp3 ...]\n", argv[0]);
+    return 1;
+  }
+
+  bool ok = true;
+  MP3DecoderInit();
+
+  for (int i = 1; i < argc; i++)
+  {
+    mp3decoder_scan_t scan;
+    mp3decoder_stats_t stats;
+
+    if (!MP3LoadFile(argv[i]))
+    {
+      printf("Couldnt load %s\n", argv[i]);
+      ok = false;
+      continue;
+    }
+
+    // Throughput through the ring buffer (stdio) and in place (mmap)
+    FILE* fp = fopen(argv[i], "rb");
+    fseek(fp, 0, SEEK_END);
+    uint32_t size = ftell(fp);
+    fclose(fp);
+    double stdioRate = timeScan(&scan, size);
+    double mmapRate = 0;
+    #ifdef MP3DECODER_IO_MMAP
+    mp3decoder_mmap_t mapping;
+    mp3decoder_stream_t stream;
+    if (MP3IoMmapOpen(&mapping, argv[i], &stream))
+    {
+      MP3LoadStream(&stream);
+      mmapRate = timeScan(&scan, size);
+    }
+    #endif
+
+    // The scan must agree with the decoder, the duration must be exact after it
+    MP3Scan(&scan, offsets, OFFSET_TABLE_ENTRIES);
+    uint32_t duration = MP3GetDuration();
+    uint32_t frames;
+    uint32_t samples = decodeAll(&frames);
+    MP3GetStats(&stats);
+
+    // Frames dropped by the decoder are missing from its output, and a truncated frame at the end is dropped
+    // by the decoder but not counted by the scan
+    bool match = (stats.framesDecoded <= scan.frames) && (scan.frames <= frames) && (stats.droppedFrames || (samples == scan.samples)) && 
+                 (duration == scan.duration) && checkOffsets(argv[i], &scan);
+    ok = ok && match;
+
+    printf("%s\n", argv[i]);
+    printf("  Frames:         %u (decoder %u, %u dropped)\n", scan.frames, frames, stats.droppedFrames);
+    printf("  Duration:       %u ms, %u samples at %u Hz (decoder %u samples)\n", scan.duration, scan.samples, scan.sampleRate, samples);
+    printf("  Bitrate:        %u bps average, %u bytes of audio, %u skipped\n", scan.bitRate, scan.audioBytes, scan.skippedBytes);
+    printf("  Histogram:     ");
+    for (uint8_t b = 0; b < MP3DECODER_BITRATE_COUNT; b++)
+    {
+      if (scan.bitRateFrames[b])
+      {
+        printf(" %ukbps:%u", scan.bitRates[b], scan.bitRateFrames[b]);
+      }
+    }
+    printf("\n");
+    printf("  Offset table:   %u entries, one every %u frames\n", scan.offsetCount, scan.offsetStep);
+    printf("  Scan speed:     %.0f MB/s (stdio), %.0f MB/s (mmap)\n", stdioRate, mmapRate);
+    printf("  Check:          %s\n", match ? "ok" : "MISMATCH");
+  }
+
+  return ok ? 0 : 1;
+}
+
+/*******************************************************************************
+ *******************************************************************************
+                        LOCAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+double timeScan(mp3decoder_scan_t* scan, uint32_t bytes)
+{
+  uint32_t runs = 0;
+  double start = now();
+  double elapsed;
+  do
+  {
+    MP3Scan(scan, NULL, 0);
+    runs++;
+    elapsed = now() - start;
+  } while (elapsed < MIN_TIMING_SECONDS);
+  return (double)bytes * runs / elapsed / 1e6;
+}
+
+uint32_t decodeAll(uint32_t* frames)
+{
+  uint32_t samples = 0;
+  uint16_t count;
+  mp3decoder_frame_data_t frameData;
+  mp3decoder_result_t res;
+  mp3decoder_stats_t stats;
+
+  while ((res = MP3GetDecodedFrame(pcm, MP3_DECODED_BUFFER_SIZE, &count)) != MP3DECODER_FILE_END)
+  {
+    if ((res == MP3DECODER_NO_ERROR) && MP3GetLastFrameData(&frameData))
+    {
+      samples += count / frameData.channelCount;
+    }
+  }
+  MP3GetStats(&stats);
+  *frames = stats.framesDecoded + stats.droppedFrames;
+  return samples;
+}
+
+bool checkOffsets(const char* filename, const mp3decoder_scan_t* scan)
+{
+  bool ok = (scan->offsetCount > 0);
+  uint8_t header[2];
+  FILE* fp = fopen(filename, "rb");
+
+  for (uint32_t i = 0; ok && (i < scan->offsetCount); i++)
+  {
+    ok = ((i == 0) || (offsets[i] > offsets[i - 1])) && (fseek(fp, offsets[i], SEEK_SET) == 0) && 
+         (fread(header, 1, 2, fp) == 2) && (header[0] == 0xFF) && ((header[1] & 0xE0) == 0xE0);
+  }
+  fclose(fp);
+  return ok;
+}
@@ -0,0 +1,523 @@
+/***************************************************************************//**
+  @file     stream_test.c
+  @brief    Tests the mp3decoder wrapper on synthetic streams, built in memory from valid Layer III frames with
+            real spectra and a bit reservoir (synthetic_stream.h), and compared with a linear decode of the clean
+            stream. Every check runs with the stream mapped and through the ring buffer.
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "lib/mp3decoder/mp3decoder.h"
+#include "synthetic_stream.h"
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define SAMPLE_RATE         STREAM_SAMPLE_RATE
+#define FRAME_SAMPLES       1152                    // Samples per channel of a MPEG-1 Layer III frame
+#define CHANNELS            STREAM_CHANNELS
+#define FRAME_PCM           (FRAME_SAMPLES * CHANNELS)
+
+#define TAG_FRAME_BYTES     417                     // Xing and VBRI frames, 128 kbps
+#define XING_OFFSET         (4 + SIDE_INFO_BYTES)   // Xing or VBRI header in the first frame
+#define XING_TOC_ENTRIES    100
+#define XING_LAME_OFFSET    120                     // LAME tag after the Xing frames, bytes, TOC and quality fields
+#define VBRI_FRAMES_PER_ENTRY 10
+#define ENCODER_DELAY       576                     // Delay and padding of the LAME tag
+#define ENCODER_PADDING     1000
+#define DECODER_DELAY       529                     // Delay of the synthesis filterbank, trimmed with the encoder delay
+#define GAPLESS_START       (ENCODER_DELAY + DECODER_DELAY)
+#define GAPLESS_SAMPLES     (STREAM_FRAMES * FRAME_SAMPLES - ENCODER_DELAY - ENCODER_PADDING)
+#define SEEK_FRAMES         3                       // Frames compared after each seek
+#define TOC_TOLERANCE       4                       // Frames between the target of a Xing TOC seek and the frame reached
+
+#define MAX_BLOCK           4607                    // Largest block of samples (per channel) decoded in one call
+
+#define JUNK_FRAME          200                     // Garbage is inserted before this frame
+#define JUNK_BYTES          333
+#define DAMAGED_FRAME       400                     // The header and side info of this frame are overwritten
+#define DAMAGED_BYTES       40
+#define MAX_LOST_FRAMES     3                       // The damaged frame, and the frames whose reservoir it held
+#define TAIL_FRAMES         100                     // Frames at the end of the damaged stream that must match exactly
+
+#define CHECK(condition)    check((condition), #condition, __LINE__)
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES FOR PRIVATE FUNCTIONS WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+/*
+ * @brief Counts a failed condition and prints it
+ */
+static void check(bool condition, const char* text, int line);
+
+/*
+ * @brief Loads a stream in the decoder, mapped or through the ring buffer
+ */
+static void load(const uint8_t* data, uint32_t size, bool mapped);
+
+/*
+ * @brief Decodes the loaded stream frame by frame up to its end
+ * @param pcm       Decoded samples, room for STREAM_FRAMES frames
+ * @returns Samples decoded (interleaved)
+ */
+static uint32_t decodeAll(short* pcm);
+
+/*
+ * @brief Writes the Xing/Info frame (frame count, stream bytes and TOC) followed by the audio frames
+ * @param lameTag   Adds a LAME tag with ENCODER_DELAY and ENCODER_PADDING
+ * @returns Bytes written
+ */
+static uint32_t buildXing(uint8_t* out, bool lameTag);
+
+/*
+ * @brief Writes the VBRI frame (frame count and the size of every VBRI_FRAMES_PER_ENTRY frames) followed by
+ * the audio frames
+ * @returns Bytes written
+ */
+static uint32_t buildVbri(uint8_t* out);
+
+/*
+ * @brief Decodes frames from the current position and compares them with the reference
+ * @param frame     First frame expected
+ * @param count     Frames compared
+ */
+static bool matchesReference(uint32_t frame, uint32_t count);
+
+/*
+ * @brief Returns the frame that holds a position in milliseconds
+ */
+static uint32_t frameAt(uint32_t milliseconds);
+
+/*
+ * @brief Returns the position of a frame in milliseconds, as reported by the decoder
+ */
+static uint32_t framePosition(uint32_t frame);
+
+/*
+ * @brief Inserts garbage between two frames and damages another one, checks that the decoder locks to the stream
+ * again and that the frames around the damage decode as in the clean stream
+ */
+static void testResync(bool mapped);
+
+/*
+ * @brief Seeks walking the frame headers and with the index they leave, with the Xing TOC and with the VBRI
+ * table, past the end and after the end, and compares the frames decoded with the linear decode
+ */
+static void testSeek(bool mapped);
+
+/*
+ * @brief Checks the samples, duration and positions of a stream with a LAME tag, decoded linearly and after
+ * seeking close to the end, where the padding is trimmed only if the frame number is exact
+ */
+static void testGapless(bool mapped);
+
+/*
+ * @brief Decodes the streams with MP3DecoderDecodeSamples in blocks that straddle frames, a prefetch call now and
+ * then, and compares the samples with the frames decoded one by one
+ */
+static void testBlocks(bool mapped);
+
+/*
+ * @brief Read callbacks of the memory backend without map, so the decoder reads through its ring buffer
+ */
+static size_t ringRead(void* handle, void* buffer, size_t count);
+static bool ringSeek(void* handle, uint32_t position);
+static uint32_t ringTell(void* handle);
+static uint32_t ringSize(void* handle);
+static void ringClose(void* handle);
+
+/*******************************************************************************
+ * ROM CONST VARIABLES WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+static const mp3decoder_io_t ringIo = { ringRead, ringSeek, ringTell, ringSize, NULL, ringClose };
+
+/*******************************************************************************
+ * VARIABLES WITH LOCAL SCOPE
+ ******************************************************************************/
+
+static mp3decoder_storage_t storage;
+static mp3decoder_t* decoder;
+static mp3decoder_memory_t memory;
+
+static uint8_t frames[STREAM_BYTES];                // Audio frames of the clean stream
+static uint32_t frameOffsets[STREAM_FRAMES + 1];
+static uint32_t framesBytes;
+static uint32_t reservoirFrames;                    // Frames whose main data starts in the previous frames
+static uint8_t stream[STREAM_BYTES + MAX_FRAME_BYTES + JUNK_BYTES];   // Stream under test
+static short reference[STREAM_FRAMES * FRAME_PCM];  // Linear decode of the clean stream
+static uint32_t referenceCount;
+static short pcm[STREAM_FRAMES * FRAME_PCM];
+static uint32_t failures;
+
+/*******************************************************************************
+ *******************************************************************************
+                        GLOBAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+int main(void)
+{
+  decoder = MP3DecoderCreateStatic(&storage);
+  CHECK(decoder != NULL);
+
+  // Reference, every frame decodes and the spectra are not silent
+  framesBytes = buildStream(frames, frameOffsets, 0, &reservoirFrames);
+  load(frames, framesBytes, true);
+  referenceCount = decodeAll(reference);
+  mp3decoder_stats_t stats;
+  MP3DecoderGetStats(decoder, &stats);
+  uint32_t peak = 0;
+  for (uint32_t i = 0; i < referenceCount; i++)
+  {
+    uint32_t magnitude = reference[i] < 0 ? -reference[i] : reference[i];
+    peak = magnitude > peak ? magnitude : peak;
+  }
+  CHECK(referenceCount == STREAM_FRAMES * FRAME_PCM);
+  CHECK(stats.framesDecoded == STREAM_FRAMES && stats.droppedFrames == 0 && stats.resyncs == 0);
+  CHECK(peak > 100 && peak < 32767);
+  CHECK(reservoirFrames > STREAM_FRAMES / 4);
+  printf("Stream:            %u frames, %u bytes, %u frames use the bit reservoir, peak %u\n", STREAM_FRAMES, framesBytes, reservoirFrames, peak);
+
+  for (uint8_t mapped = 0; mapped < 2; mapped++)
+  {
+    testResync(mapped);
+    testSeek(mapped);
+    testGapless(mapped);
+    testBlocks(mapped);
+  }
+
+  MP3DecoderDestroy(decoder);
+  printf("Streams:           %s\n", failures ? "FAILED" : "ok");
+  return failures ? 1 : 0;
+}
+
+/*******************************************************************************
+ *******************************************************************************
+                        LOCAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+void check(bool condition, const char* text, int line)
+{
+  if (!condition)
+  {
+    failures++;
+    printf("Line %d: %s\n", line, text);
+  }
+}
+
+void load(const uint8_t* data, uint32_t size, bool mapped)
+{
+  mp3decoder_stream_t input;
+  MP3IoMemoryOpen(&memory, data, size, &input);
+  if (!mapped)
+  {
+    input.io = &ringIo;
+  }
+  MP3DecoderLoadStream(decoder, &input);
+}
+
+uint32_t decodeAll(short* out)
+{
+  uint32_t count = 0;
+  uint16_t samples;
+  mp3decoder_result_t res;
+  while ((res = MP3DecoderGetDecodedFrame(decoder, out + count, MP3_DECODED_BUFFER_SIZE, &samples)) != MP3DECODER_FILE_END)
+  {
+    if (res == MP3DECODER_NO_ERROR)
+    {
+      count += samples;
+    }
+  }
+  return count;
+}
+
+void testResync(bool mapped)
+{
+  // Garbage with a valid header that is not followed by another one, then a frame damaged in place
+  uint32_t seed = 777;
+  uint32_t junkAt = frameOffsets[JUNK_FRAME];
+  memcpy(stream, frames, junkAt);
+  for (uint32_t i = 0; i < JUNK_BYTES; i++)
+  {
+    stream[junkAt + i] = (i % 50 == 0) ? 0xFF : streamRandom(&seed);
+  }
+  memcpy(stream + junkAt + 100, (const uint8_t[]){ 0xFF, 0xFB, 0x90, 0x04 }, 4);
+  memcpy(stream + junkAt + JUNK_BYTES, frames + junkAt, framesBytes - junkAt);
+  uint32_t damagedAt = frameOffsets[DAMAGED_FRAME] + JUNK_BYTES;
+  for (uint32_t i = 0; i < DAMAGED_BYTES; i++)
+  {
+    stream[damagedAt + i] = streamRandom(&seed);
+  }
+
+  load(stream, framesBytes + JUNK_BYTES, mapped);
+  uint32_t count = decodeAll(pcm);
+  mp3decoder_stats_t stats;
+  MP3DecoderGetStats(decoder, &stats);
+  uint32_t lost = (referenceCount - count) / FRAME_PCM;
+  uint32_t tail = TAIL_FRAMES * FRAME_PCM;
+
+  // The garbage costs no frame, the damaged frame costs at most the frames that needed its main data
+  CHECK(stats.resyncs >= 2 && stats.skippedBytes >= JUNK_BYTES);
+  CHECK(count <= referenceCount && (count % FRAME_PCM) == 0 && lost >= 1 && lost <= MAX_LOST_FRAMES);
+  CHECK(!memcmp(pcm, reference, DAMAGED_FRAME * FRAME_PCM * sizeof(short)));
+  CHECK(!memcmp(pcm + count - tail, reference + referenceCount - tail, tail * sizeof(short)));
+  printf("Resync (%s):   %u resyncs, %u bytes skipped, %u frames lost\n", mapped ? "mapped" : "ring  ", stats.resyncs, stats.skippedBytes, lost);
+}
+
+uint32_t buildXing(uint8_t* out, bool lameTag)
+{
+  const uint8_t header[4] = { 0xFF, 0xFB, 0x90, 0x04 };
+  uint8_t* xing = out + XING_OFFSET;
+  uint32_t bytes = TAG_FRAME_BYTES + framesBytes;
+
+  memset(out, 0, TAG_FRAME_BYTES);
+  memcpy(out, header, sizeof(header));
+  memcpy(xing, "Xing\0\0\0\x0F", 8);
+  for (uint8_t i = 0; i < 4; i++)
+  {
+    xing[8 + i] = STREAM_FRAMES >> (24 - 8 * i);
+    xing[12 + i] = bytes >> (24 - 8 * i);
+  }
+
+  // Position of each percent of the song in 1/256 of the stream bytes, relative to the Xing frame
+  for (uint32_t i = 0; i < XING_TOC_ENTRIES; i++)
+  {
+    xing[16 + i] = ((uint64_t)(TAG_FRAME_BYTES + frameOffsets[i * STREAM_FRAMES / XING_TOC_ENTRIES]) * 256) / bytes;
+  }
+
+  // Encoder version, then delay and padding in 12 bits each at the end of the first 24 bytes of the tag
+  if (lameTag)
+  {
+    uint8_t* lame = xing + XING_LAME_OFFSET;
+    memcpy(lame, "LAME3.100", 9);
+    lame[21] = ENCODER_DELAY >> 4;
+    lame[22] = ((ENCODER_DELAY & 0x0F) << 4) | (ENCODER_PADDING >> 8);
+    lame[23] = ENCODER_PADDING & 0xFF;
+  }
+  memcpy(out + TAG_FRAME_BYTES, frames, framesBytes);
+  return bytes;
+}
+
+uint32_t buildVbri(uint8_t* out)
+{
+  const uint8_t header[4] = { 0xFF, 0xFB, 0x90, 0x04 };
+  const uint16_t entries = STREAM_FRAMES / VBRI_FRAMES_PER_ENTRY;
+  const uint16_t fields[] = { 1, 0, 0, 0, 0, 0, 0, entries, 1, 2, VBRI_FRAMES_PER_ENTRY };   // Version to frames per entry
+  uint8_t* vbri = out + XING_OFFSET;
+
+  memset(out, 0, TAG_FRAME_BYTES);
+  memcpy(out, header, sizeof(header));
+  memcpy(vbri, "VBRI", 4);
+  for (uint8_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++)
+  {
+    vbri[4 + 2 * i] = fields[i] >> 8;
+    vbri[5 + 2 * i] = fields[i] & 0xFF;
+  }
+  for (uint8_t i = 0; i < 4; i++)
+  {
+    vbri[10 + i] = (TAG_FRAME_BYTES + framesBytes) >> (24 - 8 * i);
+    vbri[14 + i] = STREAM_FRAMES >> (24 - 8 * i);
+  }
+
+  // Bytes of each entry, 2 bytes each with a scale of 1
+  for (uint16_t i = 0; i < entries; i++)
+  {
+    uint32_t size = frameOffsets[(i + 1) * VBRI_FRAMES_PER_ENTRY] - frameOffsets[i * VBRI_FRAMES_PER_ENTRY];
+    vbri[26 + 2 * i] = size >> 8;
+    vbri[27 + 2 * i] = size & 0xFF;
+  }
+  memcpy(out + TAG_FRAME_BYTES, frames, framesBytes);
+  return TAG_FRAME_BYTES + framesBytes;
+}
+
+bool matchesReference(uint32_t frame, uint32_t count)
+{
+  bool ret = true;
+  for (uint32_t f = frame; (f < frame + count) && ret; f++)
+  {
+    uint16_t samples = 0;
+    ret = (MP3DecoderGetDecodedFrame(decoder, pcm, MP3_DECODED_BUFFER_SIZE, &samples) == MP3DECODER_NO_ERROR) &&
+          (samples == FRAME_PCM) && !memcmp(pcm, reference + f * FRAME_PCM, FRAME_PCM * sizeof(short));
+  }
+  return ret;
+}
+
+uint32_t frameAt(uint32_t milliseconds)
+{
+  return ((uint64_t)milliseconds * SAMPLE_RATE / 1000) / FRAME_SAMPLES;
+}
+
+uint32_t framePosition(uint32_t frame)
+{
+  return ((uint64_t)frame * FRAME_SAMPLES * 1000) / SAMPLE_RATE;
+}
+
+void testSeek(bool mapped)
+{
+  // Forward from the start the decoder walks the frame headers, backwards it starts from the index left by the walks
+  const uint32_t targets[] = { 12000, 3000, 500, 0, 13900, 7777 };
+  load(frames, framesBytes, mapped);
+  for (uint8_t i = 0; i < sizeof(targets) / sizeof(targets[0]); i++)
+  {
+    CHECK(MP3DecoderSeek(decoder, targets[i]));
+    CHECK(MP3DecoderGetPosition(decoder) == framePosition(frameAt(targets[i])));
+    CHECK(matchesReference(frameAt(targets[i]), SEEK_FRAMES));
+  }
+
+  // Past the end the seek fails and the decoding goes on where it was, also after the end of the stream
+  uint16_t samples = 0;
+  CHECK(MP3DecoderSeek(decoder, 5000));
+  CHECK(!MP3DecoderSeek(decoder, 20000));
+  CHECK(matchesReference(frameAt(5000), SEEK_FRAMES));
+  while (MP3DecoderGetDecodedFrame(decoder, pcm, MP3_DECODED_BUFFER_SIZE, &samples) != MP3DECODER_FILE_END);
+  CHECK(MP3DecoderSeek(decoder, 5000) && matchesReference(frameAt(5000), SEEK_FRAMES));
+
+  // Xing TOC, the target is too far from the index so the decoder jumps to the interpolated position. The frame
+  // reached is found in the reference, its number is only estimated by the decoder.
+  uint32_t size = buildXing(stream, false);
+  uint32_t worst = 0;
+  for (uint32_t ms = 8000; ms < 15000; ms += 1700)
+  {
+    uint32_t target = frameAt(ms);
+    load(stream, size, mapped);
+    CHECK(MP3DecoderSeek(decoder, ms));
+    CHECK(MP3DecoderGetPosition(decoder) == framePosition(target));
+    CHECK(MP3DecoderGetDecodedFrame(decoder, pcm, MP3_DECODED_BUFFER_SIZE, &samples) == MP3DECODER_NO_ERROR);
+    int32_t reached = -1;
+    for (uint32_t f = target - TOC_TOLERANCE; (f <= target + TOC_TOLERANCE) && (reached < 0); f++)
+    {
+      reached = memcmp(pcm, reference + f * FRAME_PCM, FRAME_PCM * sizeof(short)) ? -1 : (int32_t)f;
+    }
+    CHECK(reached >= 0 && matchesReference(reached + 1, SEEK_FRAMES));
+    uint32_t error = (reached > (int32_t)target) ? reached - target : target - reached;
+    worst = (reached >= 0) && (error > worst) ? error : worst;
+  }
+  CHECK(!MP3DecoderSeek(decoder, 16000));
+
+  // VBRI, the table indexes the whole stream and every seek is exact
+  size = buildVbri(stream);
+  load(stream, size, mapped);
+  for (uint32_t ms = 15000; ms > 2300; ms -= 2300)
+  {
+    CHECK(MP3DecoderSeek(decoder, ms));
+    CHECK(MP3DecoderGetPosition(decoder) == framePosition(frameAt(ms)));
+    CHECK(matchesReference(frameAt(ms), SEEK_FRAMES));
+  }
+  CHECK(!MP3DecoderSeek(decoder, 16000));
+  printf("Seek (%s):     header walk, index, Xing TOC within %u frames, VBRI\n", mapped ? "mapped" : "ring  ", worst);
+}
+
+void testGapless(bool mapped)
+{
+  // Linear decode, the delay and the padding are trimmed and the rest is the reference
+  uint32_t size = buildXing(stream, true);
+  uint32_t samples = GAPLESS_SAMPLES * CHANNELS;
+  load(stream, size, mapped);
+  CHECK(MP3DecoderGetDuration(decoder) == ((uint64_t)GAPLESS_SAMPLES * 1000) / SAMPLE_RATE);
+  CHECK(MP3DecoderGetPosition(decoder) == 0);
+  CHECK(decodeAll(pcm) == samples);
+  CHECK(!memcmp(pcm, reference + GAPLESS_START * CHANNELS, samples * sizeof(short)));
+
+  // The scan gives the same count
+  mp3decoder_scan_t scan;
+  CHECK(MP3DecoderScan(decoder, &scan, NULL, 0));
+  CHECK(scan.frames == STREAM_FRAMES && scan.samples == GAPLESS_SAMPLES);
+
+  // From the index the frame number is exact, the position does not count the delay and the padding is trimmed
+  const uint32_t target = 15000;
+  uint32_t frame = ((uint64_t)target * SAMPLE_RATE / 1000 + GAPLESS_START) / FRAME_SAMPLES;
+  uint32_t first = frame * FRAME_SAMPLES - GAPLESS_START;
+  CHECK(MP3DecoderSeek(decoder, target));
+  CHECK(MP3DecoderGetPosition(decoder) == ((uint64_t)first * 1000) / SAMPLE_RATE);
+  uint32_t count = decodeAll(pcm);
+  CHECK(count == (GAPLESS_SAMPLES - first) * CHANNELS);
+  CHECK(!memcmp(pcm, reference + frame * FRAME_PCM, count * sizeof(short)));
+
+  // From the Xing TOC the frame number is estimated, so the frames are output whole up to the end of the stream
+  load(stream, size, mapped);
+  CHECK(MP3DecoderSeek(decoder, target));
+  count = decodeAll(pcm);
+  CHECK((count % FRAME_PCM) == 0 && count > FRAME_PCM);
+  CHECK(!memcmp(pcm + count - FRAME_PCM, reference + referenceCount - FRAME_PCM, FRAME_PCM * sizeof(short)));
+  printf("Gapless (%s):  %u samples (delay %u, padding %u), %u ms\n", mapped ? "mapped" : "ring  ", GAPLESS_SAMPLES, ENCODER_DELAY, ENCODER_PADDING, MP3DecoderGetDuration(decoder));
+}
+
+void testBlocks(bool mapped)
+{
+  static short block[MAX_BLOCK * CHANNELS];
+  const uint16_t sizes[] = { 1, 100, 0, 1151, 1152, 1153, 3000, MAX_BLOCK, 577, 0, 0, 2 };
+
+  for (uint8_t lameTag = 0; lameTag < 2; lameTag++)
+  {
+    // Without the LAME tag every frame is whole, with it the first and the last ones are trimmed
+    uint32_t size = buildXing(stream, lameTag);
+    uint32_t expected = lameTag ? GAPLESS_SAMPLES * CHANNELS : referenceCount;
+    const short* samples = reference + (lameTag ? GAPLESS_START * CHANNELS : 0);
+    mp3decoder_result_t res = MP3DECODER_NO_ERROR;
+    uint32_t count = 0;
+    uint32_t calls = 0;
+    bool ordered = true;
+
+    load(stream, size, mapped);
+    while ((res == MP3DECODER_NO_ERROR) && ordered)
+    {
+      uint16_t request = sizes[calls++ % (sizeof(sizes) / sizeof(sizes[0]))];
+      uint16_t decoded = 0;
+      uint16_t channels = 0;
+      res = MP3DecoderDecodeSamples(decoder, block, request, &decoded, &channels);
+      ordered = (decoded <= request) && (!decoded || (channels == CHANNELS)) && (count + decoded * CHANNELS <= expected) &&
+                !memcmp(block, samples + count, decoded * CHANNELS * sizeof(short));
+      count += decoded * CHANNELS;
+
+      // Only a block cut by the end of the stream is short, and the position follows the samples returned
+      ordered = ordered && ((decoded == request) || (res != MP3DECODER_NO_ERROR));
+      ordered = ordered && (MP3DecoderGetPosition(decoder) == ((uint64_t)count / CHANNELS * 1000) / SAMPLE_RATE);
+    }
+    CHECK(ordered && (res == MP3DECODER_FILE_END) && (count == expected));
+  }
+  printf("Blocks (%s):   %u block sizes, with and without gapless trim\n", mapped ? "mapped" : "ring  ", (uint32_t)(sizeof(sizes) / sizeof(sizes[0])));
+}
+
+size_t ringRead(void* handle, void* buffer, size_t count)
+{
+  mp3decoder_memory_t* input = handle;
+  size_t bytes = (input->position + count <= input->size) ? count : input->size - input->position;
+  memcpy(buffer, input->data + input->position, bytes);
+  input->position += bytes;
+  return bytes;
+}
+
+bool ringSeek(void* handle, uint32_t position)
+{
+  mp3decoder_memory_t* input = handle;
+  input->position = (position <= input->size) ? position : input->size;
+  return position <= input->size;
+}
+
+uint32_t ringTell(void* handle)
+{
+  return ((mp3decoder_memory_t*)handle)->position;
+}
+
+uint32_t ringSize(void* handle)
+{
+  return ((mp3decoder_memory_t*)handle)->size;
+}
+
+void ringClose(void* handle)
+{
+  (void)handle;
+}
+
+/******************************************************************************/
@@ -0,0 +1,332 @@
+/***************************************************************************//**
+  @file     synthesis_benchmark.c
+  @brief    IMDCT and subband synthesis throughput of the Helix decoder on band-limited and partly silent
+            content (music, low bitrate, speech, silence), with a check that skipping the zero region
+            above the non-zero critical bands and the silent granules is bit-exact, on random coefficients
+            and on a sparse stream of valid Huffman codes
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "coder.h"
+#include "synthetic_stream.h"
+#include "bench_util.h"
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define POOL_GRANULES       64                      // Different granules of coefficients
+#define HASH_GRANULES       4000                    // Granules hashed with and without the zero region skipping
+#define BENCH_GRANULES      40000                   // Granules timed
+#define BENCH_RUNS          20                      // Timed runs, the best one is reported
+#define COEF_SHIFT          10                      // Right shift of the random coefficients, enough guard bits
+#define HUFFMAN_SPILL       36                      // Zero coefficients decoded after the last non-zero band
+#define STREAM_SILENCE      40                      // Percentage of silent granules of the sparse stream, as speech
+
+#define FNV_OFFSET          0xcbf29ce484222325ULL
+#define FNV_PRIME           0x100000001b3ULL
+
+/*******************************************************************************
+ * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
+ ******************************************************************************/
+
+typedef struct
+{
+  const char*   name;
+  int           bandwidth;      // Coefficients of the non-zero critical bands (576 = 22050 Hz at 44100 Hz)
+  uint8_t       silence;        // Percentage of silent granules, in runs like the pauses of speech
+} content_t;
+
+typedef struct
+{
+  const content_t*  content;
+  bool              skip;       // False to hide the non-zero critical bands from the IMDCT (bandBound = nonZeroBound)
+} content_run_t;
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES FOR PRIVATE FUNCTIONS WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+/*
+ * @brief Resets the IMDCT overlap and the subband history of the decoder
+ */
+static void resetState(MP3DecInfo* info);
+
+/*
+ * @brief Loads a granule of the pool into both channels and runs the IMDCT and subband stages on it
+ * @param info      Decoder
+ * @param index     Granule index, picks the coefficients of the pool and whether it is silent
+ * @param run       Content profile and zero region skipping, a content_run_t
+ */
+static void runContent(MP3DecInfo* info, uint32_t index, const void* run);
+
+/*
+ * @brief Runs a content profile with and without the zero region skipping, returns false if the PCM differs
+ */
+static bool checkContent(MP3DecInfo* info, const content_t* content);
+
+/*
+ * @brief Decodes a sparse stream with MP3Decode and with decodeReference, returns false if the PCM differs
+ * @param silentGranules  Pointer to variable that will be updated with the granules of zero PCM
+ */
+static bool checkStream(uint32_t* silentGranules);
+
+/*
+ * @brief Decodes a frame with the same steps as MP3Decode, but runs the IMDCT on the whole Huffman region and
+ * synthesizes every granule (no zero region or silent granule skipping)
+ * @returns False if the frame could not be decoded
+ */
+static bool decodeReference(MP3DecInfo* info, unsigned char** inbuf, int* bytesLeft, short* out);
+
+/*
+ * @brief Subband transform of a stereo granule, block by block as Subband without its silent granule check
+ */
+static void synthesize(MP3DecInfo* info, short* out);
+
+/*******************************************************************************
+ * VARIABLES WITH LOCAL SCOPE
+ ******************************************************************************/
+
+static int pool[POOL_GRANULES][MAX_NSAMP];
+static short pcm[MAX_NCHAN * MAX_NGRAN * MAX_NSAMP];
+
+static const content_t contents[] = {
+  { "Full band",            576,  0   },    // Reference for the last column
+  { "Music, 128 kbps",      418,  0   },    // 16 kHz lowpass
+  { "Low bitrate, 64 kbps", 288,  5   },    // 11 kHz lowpass
+  { "Speech, 32 kbps",      112,  40  },    // 4.3 kHz, pauses between the phrases
+  { "Silence",              0,    100 },
+};
+
+/*******************************************************************************
+ *******************************************************************************
+                        GLOBAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+int main(void)
+{
+  MP3DecInfo* info = (MP3DecInfo*)MP3InitDecoder();
+  FrameHeader* fh = (FrameHeader*)info->FrameHeaderPS;
+  fh->ver = MPEG1;
+  fh->sfBand = &sfBandTable[MPEG1][0];
+  info->nChans = 2;
+
+  for (uint32_t g = 0; g < POOL_GRANULES; g++)
+  {
+    for (uint32_t i = 0; i < MAX_NSAMP; i++)
+    {
+      pool[g][i] = (int32_t)lcg() >> COEF_SHIFT;
+    }
+  }
+
+  // Same PCM with the bound of the non-zero bands and with the bound of the Huffman region
+  bool passed = true;
+  uint8_t contentCount = sizeof(contents) / sizeof(contents[0]);
+  for (uint8_t c = 0; c < contentCount; c++)
+  {
+    passed = checkContent(info, &contents[c]) && passed;
+  }
+  printf("Zero region skip:  %s\n", passed ? "bit-exact" : "MISMATCH");
+
+  // Same PCM from the decoder and from the reference on a stream with narrow spectra and pauses
+  uint32_t silentGranules = 0;
+  bool streamPassed = checkStream(&silentGranules);
+  printf("Sparse stream:     %s (%u frames, %u silent granules)\n", streamPassed ? "bit-exact" : "MISMATCH", STREAM_FRAMES, silentGranules);
+  passed = streamPassed && passed;
+
+  // Skipping disabled only hides the non-zero bands from the IMDCT, silent granules are skipped anyway
+  printf("Content                Skipping   Huffman bound   Of full band\n");
+  double fullBand = 0;
+  for (uint8_t c = 0; c < contentCount; c++)
+  {
+    const content_run_t skipping = { &contents[c], true }, huffmanBound = { &contents[c], false };
+    double skipTime = benchmark(info, runContent, &skipping, BENCH_GRANULES, BENCH_RUNS);
+    double huffmanTime = benchmark(info, runContent, &huffmanBound, BENCH_GRANULES, BENCH_RUNS);
+    fullBand = (c == 0) ? skipTime : fullBand;
+    printf("%-22s %6.0f ns   %6.0f ns       %3.0f%%\n", contents[c].name, skipTime, huffmanTime, 100.0 * skipTime / fullBand);
+  }
+  printf("(per stereo granule, IMDCT and subband stages)\n");
+
+  MP3FreeDecoder(info);
+  return passed ? 0 : 1;
+}
+
+/*******************************************************************************
+ *******************************************************************************
+                        LOCAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+void resetState(MP3DecInfo* info)
+{
+  memset(info->IMDCTInfoPS, 0, sizeof(IMDCTInfo));
+  memset(info->SubbandInfoPS, 0, sizeof(SubbandInfo));
+}
+
+void runContent(MP3DecInfo* info, uint32_t index, const void* run)
+{
+  const content_t* content = ((const content_run_t*)run)->content;
+
+  // Silent granules come in runs of 8 (about 100 ms), a fixed pattern so both runs see the same ones
+  bool silent = ((index / 8) * 37 % 100) < content->silence;
+  int bandwidth = silent ? 0 : content->bandwidth;
+  int nonZeroBound = bandwidth ? MIN(bandwidth + HUFFMAN_SPILL, MAX_NSAMP) : 0;
+
+  // Long blocks, the pool is already shifted down by COEF_SHIFT
+  const bench_granule_t granule = { 0, 0, 0, bandwidth, nonZeroBound, ((const content_run_t*)run)->skip ? bandwidth : nonZeroBound };
+
+  for (int ch = 0; ch < 2; ch++)
+  {
+    runGranule(info, ch, pool[(index + ch) % POOL_GRANULES], &granule);
+  }
+  Subband(info, pcm);
+}
+
+bool checkContent(MP3DecInfo* info, const content_t* content)
+{
+  uint64_t hash[2];
+  for (uint8_t run = 0; run < 2; run++)
+  {
+    resetState(info);
+    hash[run] = FNV_OFFSET;
+    for (uint32_t round = 0; round < HASH_GRANULES; round++)
+    {
+      const content_run_t profile = { content, run == 0 };
+      runContent(info, round, &profile);
+      const uint8_t* bytes = (const uint8_t*)pcm;
+      for (uint32_t i = 0; i < 2 * NBANDS * BLOCK_SIZE * sizeof(short); i++)
+      {
+        hash[run] = (hash[run] ^ bytes[i]) * FNV_PRIME;
+      }
+    }
+  }
+  return hash[0] == hash[1];
+}
+
+bool checkStream(uint32_t* silentGranules)
+{
+  static uint8_t stream[STREAM_BYTES];
+  static uint32_t offsets[STREAM_FRAMES + 1];
+  uint32_t reservoirFrames;
+  uint32_t length = buildStream(stream, offsets, STREAM_SILENCE, &reservoirFrames);
+
+  uint64_t hash[2];
+  uint32_t frames[2];
+  for (uint8_t run = 0; run < 2; run++)
+  {
+    MP3DecInfo* info = (MP3DecInfo*)MP3InitDecoder();
+    unsigned char* inbuf = stream;
+    int bytesLeft = length;
+    hash[run] = FNV_OFFSET;
+    frames[run] = 0;
+    while (bytesLeft > 0)
+    {
+      bool decoded = (run == 0) ? (MP3Decode(info, &inbuf, &bytesLeft, pcm, 0) == ERR_MP3_NONE) : decodeReference(info, &inbuf, &bytesLeft, pcm);
+      if (!decoded)
+      {
+        break;
+      }
+      frames[run]++;
+
+      const uint8_t* bytes = (const uint8_t*)pcm;
+      for (uint32_t i = 0; i < MAX_NCHAN * MAX_NGRAN * MAX_NSAMP * sizeof(short); i++)
+      {
+        hash[run] = (hash[run] ^ bytes[i]) * FNV_PRIME;
+      }
+      for (uint8_t gr = 0; (run == 0) && (gr < MAX_NGRAN); gr++)
+      {
+        bool silent = true;
+        for (uint32_t i = 0; i < MAX_NCHAN * MAX_NSAMP; i++)
+        {
+          silent = silent && (pcm[gr * MAX_NCHAN * MAX_NSAMP + i] == 0);
+        }
+        *silentGranules += silent;
+      }
+    }
+    MP3FreeDecoder(info);
+  }
+  return (frames[0] == STREAM_FRAMES) && (frames[1] == STREAM_FRAMES) && (hash[0] == hash[1]);
+}
+
+bool decodeReference(MP3DecInfo* info, unsigned char** inbuf, int* bytesLeft, short* out)
+{
+  HuffmanInfo* hi = (HuffmanInfo*)info->HuffmanInfoPS;
+
+  int fhBytes = UnpackFrameHeader(info, *inbuf);
+  int siBytes = (fhBytes < 0) ? -1 : UnpackSideInfo(info, *inbuf + fhBytes);
+  if ((siBytes < 0) || (fhBytes + siBytes + info->nSlots > *bytesLeft) || (info->mainDataBytes < info->mainDataBegin))
+  {
+    return false;
+  }
+  *inbuf += fhBytes + siBytes;
+  *bytesLeft -= fhBytes + siBytes;
+
+  // Main data of this frame after the bit reservoir
+  memmove(info->mainBuf, info->mainBuf + info->mainDataBytes - info->mainDataBegin, info->mainDataBegin);
+  memcpy(info->mainBuf + info->mainDataBegin, *inbuf, info->nSlots);
+  info->mainDataBytes = info->mainDataBegin + info->nSlots;
+  *inbuf += info->nSlots;
+  *bytesLeft -= info->nSlots;
+
+  unsigned char* mainPtr = info->mainBuf;
+  int bitOffset = 0;
+  int mainBits = info->mainDataBytes * 8;
+  for (int gr = 0; gr < info->nGrans; gr++)
+  {
+    for (int ch = 0; ch < info->nChans; ch++)
+    {
+      int prevBitOffset = bitOffset;
+      int offset = UnpackScaleFactors(info, mainPtr, &bitOffset, mainBits, gr, ch);
+      int sfBlockBits = 8 * offset - prevBitOffset + bitOffset;
+      mainPtr += offset;
+      mainBits -= sfBlockBits;
+
+      prevBitOffset = bitOffset;
+      offset = DecodeHuffman(info, mainPtr, &bitOffset, info->part23Length[gr][ch] - sfBlockBits, gr, ch);
+      if (offset < 0)
+      {
+        return false;
+      }
+      mainPtr += offset;
+      mainBits -= 8 * offset - prevBitOffset + bitOffset;
+    }
+
+    if (Dequantize(info, gr) < 0)
+    {
+      return false;
+    }
+    for (int ch = 0; ch < info->nChans; ch++)
+    {
+      hi->bandBound[ch] = hi->nonZeroBound[ch];
+      IMDCT(info, gr, ch);
+    }
+    synthesize(info, out + gr * MAX_NCHAN * MAX_NSAMP);
+  }
+  return true;
+}
+
+void synthesize(MP3DecInfo* info, short* out)
+{
+  IMDCTInfo* mi = (IMDCTInfo*)info->IMDCTInfoPS;
+  SubbandInfo* sbi = (SubbandInfo*)info->SubbandInfoPS;
+
+  for (int b = 0; b < BLOCK_SIZE; b++)
+  {
+    FDCT32(mi->outBuf[0][b], sbi->vbuf + 0 * 32, sbi->vindex, (b & 0x01), mi->gb[0]);
+    FDCT32(mi->outBuf[1][b], sbi->vbuf + 1 * 32, sbi->vindex, (b & 0x01), mi->gb[1]);
+    PolyphaseStereo(out, sbi->vbuf + sbi->vindex + VBUF_LENGTH * (b & 0x01), polyCoef);
+    sbi->vindex = (sbi->vindex - (b & 0x01)) & 7;
+    out += 2 * NBANDS;
+  }
+}
+
+/******************************************************************************/
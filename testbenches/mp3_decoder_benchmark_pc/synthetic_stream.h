@@ -0,0 +1,167 @@
+/*******************************************************************************
+  @file     synthetic_stream.h
+  @brief    Builds synthetic MPEG-1 Layer III streams in memory for the host tests: valid frames with real
+            spectra (count1 region only, table B), a bit reservoir and optionally runs of silent granules
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+#ifndef SYNTHETIC_STREAM_H_
+#define SYNTHETIC_STREAM_H_
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define STREAM_FRAMES       600                     // Audio frames of the synthetic streams
+#define STREAM_SAMPLE_RATE  44100
+#define STREAM_CHANNELS     2
+#define SIDE_INFO_BYTES     32                      // Side info of a MPEG-1 stereo frame
+#define MAX_FRAME_BYTES     1441
+#define STREAM_BYTES        (STREAM_FRAMES * MAX_FRAME_BYTES)
+#define MAX_RESERVOIR       511                     // Largest main_data_begin of MPEG-1
+#define MIN_QUADS           4                       // Quadruples of the count1 region of each granule and channel
+#define MAX_QUADS           40                      // Keeps the main data of a frame within the slots of a 64 kbps frame
+#define GLOBAL_GAIN         170                     // Quantizer step of the spectra, well below clipping
+#define SILENCE_RUN         8                       // Silent granules come in runs of 8 (about 100 ms)
+
+/*******************************************************************************
+ * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
+ ******************************************************************************/
+
+typedef struct
+{
+  uint8_t*  data;
+  uint32_t  bits;                                   // Bits written
+} bit_writer_t;
+
+/*******************************************************************************
+ * FUNCTION DEFINITIONS
+ ******************************************************************************/
+
+/*
+ * @brief Linear congruential generator, the streams are the same on every run
+ */
+static uint32_t streamRandom(uint32_t* state)
+{
+  *state = *state * 1664525u + 1013904223u;
+  return *state >> 8;
+}
+
+/*
+ * @brief Writes the n lower bits of value, MSB first, to a zeroed buffer
+ */
+static void putBits(bit_writer_t* writer, uint32_t value, uint8_t n)
+{
+  for (int8_t i = n - 1; i >= 0; i--, writer->bits++)
+  {
+    writer->data[writer->bits / 8] |= ((value >> i) & 1) << (7 - writer->bits % 8);
+  }
+}
+
+/*
+ * @brief Builds the audio frames of a test stream, stereo with a bitrate of 64 or 128 kbps for each frame
+ * @param out               Encoded frames, STREAM_BYTES
+ * @param offsets           Offset of each frame in out, and the length of the stream after the last one
+ * @param silence           Percentage of silent granules (no Huffman data in either channel), in runs like the
+ *                          pauses of speech, 0 for a stream without silence
+ * @param reservoirFrames   Pointer to variable that will be updated with the frames whose main data starts in
+ *                          the previous frames
+ * @returns Bytes written
+ */
+static uint32_t buildStream(uint8_t* out, uint32_t* offsets, uint8_t silence, uint32_t* reservoirFrames)
+{
+  static uint8_t main[STREAM_BYTES];                          // Main data slots of all the frames, in order
+  static uint8_t sideInfo[STREAM_FRAMES][SIDE_INFO_BYTES];
+  static uint8_t bitRateIndex[STREAM_FRAMES];
+  static uint32_t slotStart[STREAM_FRAMES + 1];
+  uint32_t seed = 12345;
+  uint32_t written = 0;                                        // Main data bytes used by the frames so far
+
+  memset(main, 0, sizeof(main));
+  memset(sideInfo, 0, sizeof(sideInfo));
+  slotStart[0] = 0;
+  *reservoirFrames = 0;
+  for (uint32_t f = 0; f < STREAM_FRAMES; f++)
+  {
+    // Spectra of the 2 granules and 2 channels, each one a count1 region of quadruples of 0 and +-1
+    uint8_t data[MAX_FRAME_BYTES] = { 0 };
+    bit_writer_t writer = { data, 0 };
+    uint32_t part23Length[2][STREAM_CHANNELS];
+    for (uint8_t gr = 0; gr < 2; gr++)
+    {
+      // A fixed pattern of runs, so the same granules are silent on every run
+      uint32_t granule = 2 * f + gr;
+      bool silent = ((granule / SILENCE_RUN) * 37 % 100) < silence;
+      for (uint8_t ch = 0; ch < STREAM_CHANNELS; ch++)
+      {
+        uint32_t start = writer.bits;
+        uint32_t quads = silent ? 0 : MIN_QUADS + streamRandom(&seed) % (MAX_QUADS - MIN_QUADS + 1);
+        for (uint32_t q = 0; q < quads; q++)
+        {
+          // Table B codes are the 4 bits vwxy inverted, followed by the sign of each nonzero value
+          uint32_t vwxy = streamRandom(&seed) & 0x0F;
+          putBits(&writer, ~vwxy & 0x0F, 4);
+          for (int8_t bit = 3; bit >= 0; bit--)
+          {
+            if (vwxy & (1 << bit))
+            {
+              putBits(&writer, streamRandom(&seed) & 1, 1);
+            }
+          }
+        }
+        part23Length[gr][ch] = writer.bits - start;
+      }
+    }
+
+    // The main data starts as far back in the reservoir as the previous frames left room for
+    uint32_t bytes = (writer.bits + 7) / 8;
+    bitRateIndex[f] = (streamRandom(&seed) & 1) ? 9 : 5;
+    uint32_t slot = 144 * (bitRateIndex[f] == 9 ? 128000 : 64000) / STREAM_SAMPLE_RATE - 4 - SIDE_INFO_BYTES;
+    uint32_t begin = (slotStart[f] > MAX_RESERVOIR) && (written < slotStart[f] - MAX_RESERVOIR) ? slotStart[f] - MAX_RESERVOIR : written;
+    memcpy(main + begin, data, bytes);
+    *reservoirFrames += (begin < slotStart[f]);
+    written = begin + bytes;
+    slotStart[f + 1] = slotStart[f] + slot;
+
+    // Side info: main_data_begin, private bits and scfsi, then big_values 0, no scalefactors and count1 table B
+    bit_writer_t side = { sideInfo[f], 0 };
+    putBits(&side, slotStart[f] - begin, 9);
+    putBits(&side, 0, 3 + 4 * STREAM_CHANNELS);
+    for (uint8_t gr = 0; gr < 2; gr++)
+    {
+      for (uint8_t ch = 0; ch < STREAM_CHANNELS; ch++)
+      {
+        putBits(&side, part23Length[gr][ch], 12);
+        putBits(&side, 0, 9);
+        putBits(&side, GLOBAL_GAIN, 8);
+        putBits(&side, 0, 4 + 1 + 15 + 4 + 3 + 1 + 1);
+        putBits(&side, 1, 1);
+      }
+    }
+  }
+
+  uint32_t length = 0;
+  for (uint32_t f = 0; f < STREAM_FRAMES; f++)
+  {
+    // Stereo, no CRC, no padding
+    const uint8_t header[4] = { 0xFF, 0xFB, bitRateIndex[f] << 4, 0x04 };
+    uint32_t slot = slotStart[f + 1] - slotStart[f];
+    offsets[f] = length;
+    memcpy(out + length, header, sizeof(header));
+    memcpy(out + length + sizeof(header), sideInfo[f], SIDE_INFO_BYTES);
+    memcpy(out + length + sizeof(header) + SIDE_INFO_BYTES, main + slotStart[f], slot);
+    length += sizeof(header) + SIDE_INFO_BYTES + slot;
+  }
+  offsets[STREAM_FRAMES] = length;
+  return length;
+}
+
+#endif /* SYNTHETIC_STREAM_H_ */
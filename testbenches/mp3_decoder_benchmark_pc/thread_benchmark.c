@@ -0,0 +1,179 @@
+/***************************************************************************//**
+  @file     thread_benchmark.c
+  @brief    Decodes files on one thread and with the channel threads (MP3SetThreads), reports the speed-up
+            and checks that the PCM is the same in every output mode and quality
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include "lib/mp3decoder/mp3decoder.h"
+#include "bench_util.h"
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define TIMING_RUNS         5                       // Decodes of each file timed, the best one is reported
+
+#define FNV_OFFSET          0xcbf29ce484222325ULL
+#define FNV_PRIME           0x100000001b3ULL
+
+/*******************************************************************************
+ * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
+ ******************************************************************************/
+
+typedef struct
+{
+  uint64_t  hash;           // FNV-1a of the PCM
+  uint32_t  samples;        // Samples per channel
+  uint32_t  sampleRate;     // Of the last frame
+  double    seconds;        // Decoding time
+} decode_result_t;
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES FOR PRIVATE FUNCTIONS WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+/*
+ * @brief Decodes a whole file with the default decoder
+ * @param filename  File to decode
+ * @param threads   Threads per stereo frame
+ * @param mode      Output mode
+ * @param quality   Decoding quality
+ * @param result    Pointer to object to be filled with the hash, length and decoding time
+ * @param hashPcm   False to leave the hash out of the timed loop
+ * @returns Threads the decoder used, 0 if the file couldnt be loaded
+ */
+static uint8_t decodeFile(const char* filename, uint8_t threads, mp3decoder_output_mode_t mode, mp3decoder_quality_t quality,
+                          decode_result_t* result, bool hashPcm);
+
+/*
+ * @brief Best decoding time of a few runs
+ */
+static double bestTime(const char* filename, uint8_t threads, decode_result_t* result);
+
+/*******************************************************************************
+ * VARIABLES WITH LOCAL SCOPE
+ ******************************************************************************/
+
+static short pcm[MP3_DECODED_BUFFER_SIZE];
+
+/*******************************************************************************
+ *******************************************************************************
+                        GLOBAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+int main(int argc, char* argv[])
+{
+  if (argc < 2)
+  {
+    printf("Usage: %s file.mp3 [file.mp3 ...]\n", argv[0]);
+    return 1;
+  }
+
+  bool ok = true;
+  double totalSingle = 0, totalThreaded = 0;
+  MP3DecoderInit();
+  printf("Cores online:      %ld\n", sysconf(_SC_NPROCESSORS_ONLN));
+
+  for (int i = 1; i < argc; i++)
+  {
+    decode_result_t single, threaded;
+
+    // Same PCM in every output mode and quality
+    bool match = true;
+    uint8_t threads = 1;
+    for (uint8_t mode = 0; mode < 2; mode++)
+    {
+      for (uint8_t quality = 0; quality < 2; quality++)
+      {
+        mp3decoder_output_mode_t outputMode = mode ? MP3DECODER_OUTPUT_MONO : MP3DECODER_OUTPUT_NATIVE;
+        mp3decoder_quality_t decodeQuality = quality ? MP3DECODER_QUALITY_HALF_RATE : MP3DECODER_QUALITY_FULL;
+        threads = decodeFile(argv[i], 2, outputMode, decodeQuality, &threaded, true);
+        decodeFile(argv[i], 1, outputMode, decodeQuality, &single, true);
+        match = match && (threads > 0) && (single.hash == threaded.hash) && (single.samples == threaded.samples);
+      }
+    }
+    ok = ok && match;
+
+    double singleTime = bestTime(argv[i], 1, &single);
+    double threadedTime = bestTime(argv[i], 2, &threaded);
+    double length = single.sampleRate ? (double)single.samples / single.sampleRate : 0;
+    totalSingle += singleTime;
+    totalThreaded += threadedTime;
+
+    printf("%s\n", argv[i]);
+    printf("  Audio:           %.1f s\n", length);
+    printf("  1 thread:        %.1f ms (%.0fx real time)\n", singleTime * 1e3, length / singleTime);
+    printf("  %u threads:       %.1f ms (%.0fx real time)\n", threads, threadedTime * 1e3, length / threadedTime);
+    printf("  Speed-up:        %.2f\n", singleTime / threadedTime);
+    printf("  Check:           %s\n", match ? "same PCM" : "MISMATCH");
+  }
+  printf("Total speed-up:    %.2f\n", totalSingle / totalThreaded);
+
+  return ok ? 0 : 1;
+}
+
+/*******************************************************************************
+ *******************************************************************************
+                        LOCAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+uint8_t decodeFile(const char* filename, uint8_t threads, mp3decoder_output_mode_t mode, mp3decoder_quality_t quality,
+                   decode_result_t* result, bool hashPcm)
+{
+  uint16_t count;
+  mp3decoder_result_t res;
+  mp3decoder_frame_data_t frameData;
+
+  MP3DecoderInit();
+  MP3SetOutputMode(mode);
+  MP3SetQuality(quality);
+  uint8_t used = MP3SetThreads(threads);
+  if (!MP3LoadFile(filename))
+  {
+    return 0;
+  }
+
+  result->hash = FNV_OFFSET;
+  result->samples = 0;
+  result->sampleRate = 0;
+  double start = now();
+  while ((res = MP3GetDecodedFrame(pcm, MP3_DECODED_BUFFER_SIZE, &count)) != MP3DECODER_FILE_END)
+  {
+    if ((res == MP3DECODER_NO_ERROR) && MP3GetLastFrameData(&frameData))
+    {
+      const uint8_t* bytes = (const uint8_t*)pcm;
+      for (uint32_t i = 0; hashPcm && (i < count * sizeof(short)); i++)
+      {
+        result->hash = (result->hash ^ bytes[i]) * FNV_PRIME;
+      }
+      result->samples += count / frameData.channelCount;
+      result->sampleRate = frameData.sampleRate;
+    }
+  }
+  result->seconds = now() - start;
+  return used;
+}
+
+double bestTime(const char* filename, uint8_t threads, decode_result_t* result)
+{
+  double best = 0;
+  for (uint8_t run = 0; run < TIMING_RUNS; run++)
+  {
+    decodeFile(filename, threads, MP3DECODER_OUTPUT_NATIVE, MP3DECODER_QUALITY_FULL, result, false);
+    best = (run == 0 || result->seconds < best) ? result->seconds : best;
+  }
+  return best;
+}
+
+/******************************************************************************/
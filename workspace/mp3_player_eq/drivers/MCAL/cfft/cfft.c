@@ -1,6 +1,6 @@
 /***************************************************************************//**
-  @file     equaliser.c
-  @brief    ...
+  @file     cfft.c
+  @brief    Complex and real FFT, with CMSIS DSP on the Cortex-M4 and a portable split-radix fallback on the host
   @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
  ******************************************************************************/
 
@@ -9,13 +9,22 @@
  ******************************************************************************/
 
 #include "cfft.h"
-#include "arm_const_structs.h"
 #include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__ARM_FEATURE_DSP)
+#define CFFT_CM4
+#include "arm_const_structs.h"
+#endif
 
 /*******************************************************************************
  * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
  ******************************************************************************/
 
+#define CFFT_PI           3.14159265358979323846
+#define CFFT_TWIDDLES     (CFFT_MAX_SIZE * 3 / 4)     // The split-radix butterflies go up to the 3k twiddle
+
 /*******************************************************************************
  * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
  ******************************************************************************/
@@ -28,8 +37,37 @@
  * FUNCTION PROTOTYPES FOR PRIVATE FUNCTIONS WITH FILE LEVEL SCOPE
  ******************************************************************************/
 
+static uint32_t cfftSizeToLength(cfft_size_t size);
+
+#ifdef CFFT_CM4
 static arm_cfft_instance_f32 * cfftSizeToInstance(cfft_size_t size);
 static uint32_t cfftInstanceToSize(arm_cfft_instance_f32 * instance);
+#else
+/**
+ * @brief Fills the table of twiddles of the largest size, the smaller sizes take every n-th one.
+ */
+static void initTwiddles(void);
+
+/**
+ * @brief Split-radix FFT, out of place and in natural order. Each size n is an n / 2 FFT of the even samples
+ *        and two n / 4 FFTs of the odd ones, joined with the twiddles of k and 3k.
+ * @param input     First complex sample.
+ * @param output    Buffer to store the n complex bins.
+ * @param n         Size of the FFT.
+ * @param stride    Distance between the complex samples of the input.
+ * @param inverse   Whether to use the conjugate twiddles, the output is not scaled.
+ */
+static void splitRadix(const float32_t * input, float32_t * output, uint32_t n, uint32_t stride, bool inverse);
+
+/**
+ * @brief Real FFT: a complex FFT of half the size on the even samples as the real part and the odd ones as the
+ *        imaginary part, split in the spectra of both and joined with the twiddles of the full size.
+ * @param input     Real samples.
+ * @param output    Buffer to store the bins, with the CMSIS packing.
+ * @param size      Amount of real samples.
+ */
+static void realFft(const float32_t * input, float32_t * output, uint32_t size);
+#endif
 
 /*******************************************************************************
  * ROM CONST VARIABLES WITH FILE LEVEL SCOPE
@@ -39,7 +77,19 @@ static uint32_t cfftInstanceToSize(arm_cfft_instance_f32 * instance);
  * STATIC VARIABLES AND CONST VARIABLES WITH FILE LEVEL SCOPE
  ******************************************************************************/
 
+static uint32_t rfftSize;
+
+#ifdef CFFT_CM4
 arm_cfft_instance_f32 * cfftInstance;
+static arm_rfft_fast_instance_f32 rfftInstance;
+static arm_rfft_instance_q15 rfftInstanceQ15;
+#else
+static uint32_t cfftSize;
+static float32_t twiddles[CFFT_TWIDDLES * 2];           // e^(-2 pi i k / CFFT_MAX_SIZE), complex
+static bool twiddlesReady;
+static float32_t scratchInput[CFFT_MAX_SIZE];           // Float copies of the Q15 rfft
+static float32_t scratchOutput[CFFT_MAX_SIZE];
+#endif
 
 /*******************************************************************************
  *******************************************************************************
@@ -49,24 +99,145 @@ arm_cfft_instance_f32 * cfftInstance;
 
 void cfftInit(cfft_size_t size)
 {
+#ifdef CFFT_CM4
   cfftInstance = cfftSizeToInstance(size);
+#else
+  cfftSize = cfftSizeToLength(size);
+  initTwiddles();
+#endif
 }
 
 void cfft(float32_t * inputF32, float32_t * outputF32, bool doBitReverse)
 {
-  memcpy(outputF32, inputF32, cfftInstanceToSize(cfftInstance) * sizeof(float32_t));    // Copying input array to preserve it.
+#ifdef CFFT_CM4
+  memcpy(outputF32, inputF32, cfftInstanceToSize(cfftInstance) * 2 * sizeof(float32_t));    // Copying input array to preserve it.
   arm_cfft_f32(cfftInstance, outputF32, false, doBitReverse);
+#else
+  // The output is always in natural order
+  (void)doBitReverse;
+  splitRadix(inputF32, outputF32, cfftSize, 1, false);
+#endif
 }
 
 void icfft(float32_t * inputF32, float32_t * outputF32, bool doBitReverse)
 {
+#ifdef CFFT_CM4
   memcpy(outputF32, inputF32, cfftInstanceToSize(cfftInstance) * 2 * sizeof(float32_t));    // Copying input array to preserve it.
   arm_cfft_f32(cfftInstance, outputF32, true, doBitReverse);
+#else
+  // Scaled down by the size, as the CMSIS one
+  (void)doBitReverse;
+  splitRadix(inputF32, outputF32, cfftSize, 1, true);
+  for (uint32_t i = 0; i < cfftSize * 2; i++)
+  {
+    outputF32[i] /= cfftSize;
+  }
+#endif
 }
 
 void cfftGetMag(float32_t * inputF32, float32_t * outputF32)
 {
+#ifdef CFFT_CM4
   arm_cmplx_mag_f32(inputF32, outputF32, cfftInstanceToSize(cfftInstance));
+#else
+  for (uint32_t i = 0; i < cfftSize; i++)
+  {
+    outputF32[i] = sqrtf(inputF32[2 * i] * inputF32[2 * i] + inputF32[2 * i + 1] * inputF32[2 * i + 1]);
+  }
+#endif
+}
+
+void rfftInit(cfft_size_t size)
+{
+  rfftSize = cfftSizeToLength(size);
+#ifdef CFFT_CM4
+  arm_rfft_fast_init_f32(&rfftInstance, rfftSize);
+  arm_rfft_init_q15(&rfftInstanceQ15, rfftSize, 0, 1);
+#else
+  initTwiddles();
+#endif
+}
+
+void rfft(float32_t * inputF32, float32_t * outputF32, const float32_t * window)
+{
+#ifdef CFFT_CM4
+  if (window)
+  {
+    arm_mult_f32(inputF32, (float32_t *)window, inputF32, rfftSize);
+  }
+  arm_rfft_fast_f32(&rfftInstance, inputF32, outputF32, 0);
+#else
+  if (window)
+  {
+    for (uint32_t i = 0; i < rfftSize; i++)
+    {
+      inputF32[i] *= window[i];
+    }
+  }
+  realFft(inputF32, outputF32, rfftSize);
+#endif
+}
+
+void rfftGetMagSquared(float32_t * inputF32, float32_t * outputF32)
+{
+  // DC and Nyquist are real and share the first complex bin
+  float32_t dc = inputF32[0];
+  float32_t nyquist = inputF32[1];
+#ifdef CFFT_CM4
+  arm_cmplx_mag_squared_f32(inputF32 + 2, outputF32 + 1, rfftSize / 2 - 1);
+#else
+  for (uint32_t i = 1; i < rfftSize / 2; i++)
+  {
+    outputF32[i] = inputF32[2 * i] * inputF32[2 * i] + inputF32[2 * i + 1] * inputF32[2 * i + 1];
+  }
+#endif
+  outputF32[0] = dc * dc;
+  outputF32[rfftSize / 2] = nyquist * nyquist;
+}
+
+void rfftQ15(q15_t * inputQ15, q15_t * outputQ15, const q15_t * window)
+{
+#ifdef CFFT_CM4
+  if (window)
+  {
+    arm_mult_q15(inputQ15, (q15_t *)window, inputQ15, rfftSize);
+  }
+  arm_rfft_q15(&rfftInstanceQ15, inputQ15, outputQ15);
+#else
+  // Through the float path, with the scaling (down by size / 2) and the layout of the CMSIS one
+  for (uint32_t i = 0; i < rfftSize; i++)
+  {
+    int32_t sample = window ? ((inputQ15[i] * window[i]) >> 15) : inputQ15[i];
+    inputQ15[i] = (q15_t)((sample > INT16_MAX) ? INT16_MAX : sample);
+    scratchInput[i] = inputQ15[i];
+  }
+  realFft(scratchInput, scratchOutput, rfftSize);
+  for (uint32_t bin = 0; bin < rfftSize; bin++)
+  {
+    uint32_t mirror = (bin <= rfftSize / 2) ? bin : (rfftSize - bin);
+    float32_t re = (mirror == 0) ? scratchOutput[0] : ((mirror == rfftSize / 2) ? scratchOutput[1] : scratchOutput[2 * mirror]);
+    float32_t im = ((mirror == 0) || (mirror == rfftSize / 2)) ? 0 : scratchOutput[2 * mirror + 1];
+    im = (bin <= rfftSize / 2) ? im : -im;
+    for (uint32_t part = 0; part < 2; part++)
+    {
+      int32_t value = (int32_t)lrintf((part ? im : re) / (rfftSize / 2));
+      outputQ15[2 * bin + part] = (q15_t)((value > INT16_MAX) ? INT16_MAX : ((value < INT16_MIN) ? INT16_MIN : value));
+    }
+  }
+#endif
+}
+
+void rfftGetMagSquaredQ15(q15_t * inputQ15, q15_t * outputQ15)
+{
+#ifdef CFFT_CM4
+  arm_cmplx_mag_squared_q15(inputQ15, outputQ15, rfftSize / 2 + 1);
+#else
+  for (uint32_t i = 0; i <= rfftSize / 2; i++)
+  {
+    uint32_t power = (uint32_t)(inputQ15[2 * i] * inputQ15[2 * i]) + (uint32_t)(inputQ15[2 * i + 1] * inputQ15[2 * i + 1]);
+    outputQ15[i] = (q15_t)(power >> 17);
+  }
+#endif
 }
 
 /*******************************************************************************
@@ -74,6 +245,12 @@ void cfftGetMag(float32_t * inputF32, float32_t * outputF32)
                         LOCAL FUNCTION DEFINITIONS
  *******************************************************************************
  ******************************************************************************/
+uint32_t cfftSizeToLength(cfft_size_t size)
+{
+  return (size <= CFFT_4096) ? (16u << size) : 1024;
+}
+
+#ifdef CFFT_CM4
 arm_cfft_instance_f32 * cfftSizeToInstance(cfft_size_t size)
 {
   arm_cfft_instance_f32 * instance = &arm_cfft_sR_f32_len1024;
@@ -110,6 +287,102 @@ uint32_t cfftInstanceToSize(arm_cfft_instance_f32 * instance)
 
   return size;
 }
+#else
+void initTwiddles(void)
+{
+  if (!twiddlesReady)
+  {
+    for (uint32_t k = 0; k < CFFT_TWIDDLES; k++)
+    {
+      twiddles[2 * k] = (float32_t)cos(2 * CFFT_PI * k / CFFT_MAX_SIZE);
+      twiddles[2 * k + 1] = (float32_t)-sin(2 * CFFT_PI * k / CFFT_MAX_SIZE);
+    }
+    twiddlesReady = true;
+  }
+}
+
+void splitRadix(const float32_t * input, float32_t * output, uint32_t n, uint32_t stride, bool inverse)
+{
+  if (n == 1)
+  {
+    output[0] = input[0];
+    output[1] = input[1];
+  }
+  else if (n == 2)
+  {
+    const float32_t * second = input + 2 * stride;
+    output[0] = input[0] + second[0];
+    output[1] = input[1] + second[1];
+    output[2] = input[0] - second[0];
+    output[3] = input[1] - second[1];
+  }
+  else
+  {
+    uint32_t quarter = n / 4;
+    splitRadix(input, output, n / 2, stride * 2, inverse);
+    splitRadix(input + 2 * stride, output + n, quarter, stride * 4, inverse);
+    splitRadix(input + 6 * stride, output + 3 * n / 2, quarter, stride * 4, inverse);
+
+    uint32_t step = CFFT_MAX_SIZE / n;
+    float32_t sign = inverse ? -1.0f : 1.0f;
+    for (uint32_t k = 0; k < quarter; k++)
+    {
+      float32_t * u0 = output + 2 * k;
+      float32_t * u1 = u0 + 2 * quarter;
+      float32_t * z0 = u1 + 2 * quarter;
+      float32_t * z1 = z0 + 2 * quarter;
+
+      // Twiddles of k and 3k, conjugated for the inverse
+      float32_t w1r = twiddles[2 * k * step], w1i = sign * twiddles[2 * k * step + 1];
+      float32_t w3r = twiddles[6 * k * step], w3i = sign * twiddles[6 * k * step + 1];
+      float32_t ar = z0[0] * w1r - z0[1] * w1i, ai = z0[0] * w1i + z0[1] * w1r;
+      float32_t br = z1[0] * w3r - z1[1] * w3i, bi = z1[0] * w3i + z1[1] * w3r;
+
+      // Sum and difference of the odd FFTs, the difference turned by -i (or i for the inverse)
+      float32_t sr = ar + br, si = ai + bi;
+      float32_t dr = sign * (ai - bi), di = sign * (br - ar);
+
+      z0[0] = u0[0] - sr; z0[1] = u0[1] - si;
+      u0[0] += sr;        u0[1] += si;
+      z1[0] = u1[0] - dr; z1[1] = u1[1] - di;
+      u1[0] += dr;        u1[1] += di;
+    }
+  }
+}
+
+void realFft(const float32_t * input, float32_t * output, uint32_t size)
+{
+  uint32_t half = size / 2;
+  splitRadix(input, output, half, 1, false);
+
+  // Both bins of each pair are computed from the same two bins of the half size FFT Z:
+  // X[k] = (Z[k] + Z*[half - k]) / 2 - i W^k (Z[k] - Z*[half - k]) / 2
+  uint32_t step = CFFT_MAX_SIZE / size;
+  for (uint32_t k = 1; k <= half / 2; k++)
+  {
+    uint32_t m = half - k;
+    float32_t ar = output[2 * k], ai = output[2 * k + 1];
+    float32_t br = output[2 * m], bi = output[2 * m + 1];
+
+    // Spectra of the even samples and of the odd ones, at bin k
+    float32_t evenRe = (ar + br) / 2, evenIm = (ai - bi) / 2;
+    float32_t oddRe = (ai + bi) / 2, oddIm = (br - ar) / 2;
+    float32_t wr = twiddles[2 * k * step], wi = twiddles[2 * k * step + 1];
+    float32_t tr = oddRe * wr - oddIm * wi, ti = oddRe * wi + oddIm * wr;
+
+    // At bin half - k the even spectrum is conjugated and the twiddle is -conj(W^k)
+    output[2 * k] = evenRe + tr;
+    output[2 * k + 1] = evenIm + ti;
+    output[2 * m] = evenRe - tr;
+    output[2 * m + 1] = ti - evenIm;
+  }
+
+  // DC and Nyquist are real, Nyquist goes in the imaginary part of DC
+  float32_t dc = output[0];
+  output[0] = dc + output[1];
+  output[1] = dc - output[1];
+}
+#endif
 
 /*******************************************************************************
  *******************************************************************************
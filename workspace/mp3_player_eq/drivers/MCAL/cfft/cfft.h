@@ -1,6 +1,6 @@
 /***************************************************************************//**
-  @file     equaliser.h
-  @brief    ...
+  @file     cfft.h
+  @brief    Complex and real FFT, with CMSIS DSP on the Cortex-M4 and a portable split-radix fallback on the host
   @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
  ******************************************************************************/
 
@@ -11,18 +11,27 @@
  * INCLUDE HEADER FILES
  ******************************************************************************/
 
-#include "arm_math.h"
+#include <stdint.h>
 #include <stdbool.h>
 
+#if defined(__ARM_FEATURE_DSP)
+#include "arm_math.h"
+#else
+typedef float     float32_t;
+typedef int16_t   q15_t;
+#endif
+
 /*******************************************************************************
  * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
  ******************************************************************************/
 
+#define CFFT_MAX_SIZE     4096
+
 /*******************************************************************************
  * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
  ******************************************************************************/
 
-typedef enum 
+typedef enum
 {
   CFFT_16,
   CFFT_32,
@@ -53,7 +62,7 @@ void cfftInit(cfft_size_t size);
  * @brief Compute the complex FFT on the data given.
  * @param inputF32      Buffer with input data.
  * @param outputF32     Buffer to store the output data.
- * @param doBitReverse  Determines whether to bit reverse output.
+ * @param doBitReverse  Determines whether to bit reverse output. The host always outputs in natural order.
  */
 void cfft(float32_t * inputF32, float32_t * outputF32, bool doBitReverse);
 
@@ -61,7 +70,7 @@ void cfft(float32_t * inputF32, float32_t * outputF32, bool doBitReverse);
  * @brief Compute the complex inverse FFT on the data given.
  * @param inputF32      Buffer with input data.
  * @param outputF32     Buffer to store the output data.
- * @param doBitReverse  Determines whether to bit reverse output.
+ * @param doBitReverse  Determines whether to bit reverse output. The host always outputs in natural order.
  */
 void icfft(float32_t * inputF32, float32_t * outputF32, bool doBitReverse);
 
@@ -72,6 +81,45 @@ void icfft(float32_t * inputF32, float32_t * outputF32, bool doBitReverse);
  */
 void cfftGetMag(float32_t * inputF32, float32_t * outputF32);
 
+/**
+ * @brief Initialises the real FFT, float and Q15. Sets the rfft instances to the size given, CFFT_32 or larger.
+ * @param size  Amount of real samples of the rfft to compute.
+ */
+void rfftInit(cfft_size_t size);
+
+/**
+ * @brief Compute the FFT of real data, half the work and the memory of a complex FFT of the same size.
+ * @param inputF32    Buffer with the real input data, it is used as scratch and overwritten.
+ * @param outputF32   Buffer to store the size / 2 complex bins from DC, with the real Nyquist bin in the
+ *                    imaginary part of the DC one (the CMSIS packing).
+ * @param window      Window applied to the input data, or NULL for none.
+ */
+void rfft(float32_t * inputF32, float32_t * outputF32, const float32_t * window);
+
+/**
+ * @brief Compute the magnitude squared of the bins of an rfft, from DC to Nyquist.
+ * @param inputF32    Buffer with the rfft output.
+ * @param outputF32   Buffer to store the size / 2 + 1 values, may be the input buffer.
+ */
+void rfftGetMagSquared(float32_t * inputF32, float32_t * outputF32);
+
+/**
+ * @brief Compute the FFT of real Q15 data. Both builds return the CMSIS format, the bins scaled down by size / 2:
+ *        log2(size).(16 - log2(size)) format, e.g. 9.7 for 512 points. A full scale tone fits in its bin, the bins
+ *        saturate for a DC level over half scale.
+ * @param inputQ15    Buffer with the real input data, it is used as scratch and overwritten.
+ * @param outputQ15   Buffer to store the size complex bins, the upper half are the conjugates of the lower one.
+ * @param window      Q15 window applied to the input data, or NULL for none.
+ */
+void rfftQ15(q15_t * inputQ15, q15_t * outputQ15, const q15_t * window);
+
+/**
+ * @brief Compute the magnitude squared of the bins of a Q15 rfft, from DC to Nyquist, in 3.13 format.
+ * @param inputQ15    Buffer with the rfft output.
+ * @param outputQ15   Buffer to store the size / 2 + 1 values, may be the input buffer.
+ */
+void rfftGetMagSquaredQ15(q15_t * inputQ15, q15_t * outputQ15);
+
 /*******************************************************************************
  ******************************************************************************/
 
@@ -38,12 +38,19 @@ typedef enum
   DACDMA_SETUP_READY
 } dacdma_status_t;
 
+// Each slot is one TCD of the scatter gather chain, it outputs a block of the ring or holds the last sample
+typedef struct
+{
+  const uint16_t*           block;              // Block of the ring, NULL while holding
+} dacdma_slot_t;
+
 typedef struct
 {
   dacdma_status_t     		status;
-  uint16_t*           		ppBufferPtr[DMA_SGA_PPBUFFER_COUNT];
-  uint8_t			  		currentBuffer : 1;
-  uint16_t            		bufferSize;
+  pcm_ring_t*               ring;
+  dacdma_slot_t             slots[DAC_DMA_SLOT_COUNT];
+  uint8_t			  		currentSlot : 1;
+  uint16_t                  holdSample;         // Output by a slot without block, when the ring is empty
   uint16_t            		dacFreq;
   dacdma_update_callback_t  updateCallback;
   dma_sga_channel_cfg_t 	dmaConfig;
@@ -59,6 +66,13 @@ typedef struct
 
 static void onMajorLoop(void);
 
+/**
+ * @brief Points the TCD of a slot to the next block of the ring, or to the hold sample if the ring is empty.
+ *        The TCD must not be the one loaded in the DMA channel.
+ * @param slot  Slot to be scheduled
+ */
+static void dacdmaSchedule(uint8_t slot);
+
 /*******************************************************************************
  * ROM CONST VARIABLES WITH FILE LEVEL SCOPE
  ******************************************************************************/
@@ -108,13 +122,11 @@ void dacdmaSetCallback(dacdma_update_callback_t callback)
   dacdmaContext.updateCallback = callback;
 }
 
-void dacdmaSetBuffers(uint16_t *buffer1, uint16_t *buffer2, uint16_t bufferSize)
+void dacdmaSetRing(pcm_ring_t* ring)
 {
-  if ( (bufferSize != 0) && (buffer1 != NULL) && (buffer2 != NULL) )
+  if ( (ring != NULL) && (ring->blockSize != 0) )
   {
-    dacdmaContext.ppBufferPtr[0] = buffer1;
-    dacdmaContext.ppBufferPtr[1] = buffer2;
-    dacdmaContext.bufferSize = bufferSize;
+    dacdmaContext.ring = ring;
 
     // should call "dacdmaSetFreq()" before starting
     dacdmaContext.status = DACDMA_SETUP_READY;
@@ -126,24 +138,20 @@ void dacdmaStart(void)
     if (dacdmaContext.status == DACDMA_SETUP_READY)
     {
         DAC_Type * dacPointers[] = DAC_BASE_PTRS;
+        uint16_t blockSize = dacdmaContext.ring->blockSize;
 
-        dacdmaContext.currentBuffer = 0;
-
-        // Fill both buffers
-        dacdmaContext.updateCallback(dacdmaContext.ppBufferPtr[0]);
-        dacdmaContext.updateCallback(dacdmaContext.ppBufferPtr[1]);
+        // The blocks claimed before a stop are output again from their start
+        pcmRingUnclaim(dacdmaContext.ring);
+        dacdmaContext.currentSlot = 0;
+        dacdmaContext.holdSample = DAC_FULL_SCALE / 2;
 
         // Configure DMA Software TCD fields common to both TCDs
         // Destination address: DAC DAT
         dacdmaContext.dmaConfig.tcds[0].DADDR = (uint32_t)(&(dacPointers[DACDMA_DAC_ID]->DAT[0].DATL));
 
-        // Source and destination offsets
-        dacdmaContext.dmaConfig.tcds[0].SOFF = sizeof(uint16_t);
+        // Destination offset, the source address, offset and last adjustment are set for each slot
         dacdmaContext.dmaConfig.tcds[0].DOFF = 0;
         
-        // Source last address adjustment
-        dacdmaContext.dmaConfig.tcds[0].SLAST = -dacdmaContext.bufferSize * sizeof(uint16_t);
-        
         // Set transfer size to 16bits (DAC DAT size is 12-bit)
         dacdmaContext.dmaConfig.tcds[0].ATTR = DMA_ATTR_SSIZE(1) | DMA_ATTR_DSIZE(1);
         // Write one sample on each trigger
@@ -153,16 +161,20 @@ void dacdmaStart(void)
         dacdmaContext.dmaConfig.tcds[0].CSR = DMA_CSR_INTMAJOR(1) | DMA_CSR_ESG(1);
 
         // Minor Loop Beginning Value
-        dacdmaContext.dmaConfig.tcds[0].BITER_ELINKNO = dacdmaContext.bufferSize;
+        dacdmaContext.dmaConfig.tcds[0].BITER_ELINKNO = blockSize;
         // Minor Loop Current Value must be set to the beginning value the first time
-        dacdmaContext.dmaConfig.tcds[0].CITER_ELINKNO = dacdmaContext.bufferSize;
+        dacdmaContext.dmaConfig.tcds[0].CITER_ELINKNO = blockSize;
 
         // Copy common content from TCD0 to TCD1
         dacdmaContext.dmaConfig.tcds[1] = dacdmaContext.dmaConfig.tcds[0];
 
-        // Set source addresses for DMAs' TCD
-        dacdmaContext.dmaConfig.tcds[0].SADDR = (uint32_t)(dacdmaContext.ppBufferPtr[0]);
-        dacdmaContext.dmaConfig.tcds[1].SADDR = (uint32_t)(dacdmaContext.ppBufferPtr[1]);
+        // First two blocks of the ring, the producer should have filled them before starting
+        dacdmaSchedule(0);
+        if (dacdmaContext.slots[0].block)
+        {
+          dacdmaContext.holdSample = dacdmaContext.slots[0].block[blockSize - 1];
+        }
+        dacdmaSchedule(1);
 
         // Set Scatter Gather register of each TCD pointing to each other.
         dacdmaContext.dmaConfig.tcds[0].DLAST_SGA = (uint32_t) &(dacdmaContext.dmaConfig.tcds[1]);
@@ -209,14 +221,49 @@ uint16_t dacdmaGetFreq(void)
 
 static void onMajorLoop(void)
 {
-	// Ping pong buffer switch
-    dacdmaContext.currentBuffer = !dacdmaContext.currentBuffer;
+    pcm_ring_t* ring = dacdmaContext.ring;
+    uint8_t finished = dacdmaContext.currentSlot;
+
+    // The block of the finished slot was output, the DMA already loaded the TCD of the other slot
+    if (dacdmaContext.slots[finished].block)
+    {
+        pcmRingRelease(ring);
+    }
+    dacdmaContext.currentSlot = !finished;
+    dacdma_slot_t* playing = &dacdmaContext.slots[dacdmaContext.currentSlot];
+
+    // The finished slot goes after the one starting now, an underrun holds the level instead of clicking
+    if (playing->block)
+    {
+        dacdmaContext.holdSample = playing->block[ring->blockSize - 1];
+    }
+    dacdmaSchedule(finished);
 
-    // Ask for frame update
-	if (dacdmaContext.updateCallback)
+    // Ask the producer for more blocks
+	if (dacdmaContext.updateCallback && pcmRingIsLow(ring))
 	{
-		dacdmaContext.updateCallback(dacdmaContext.ppBufferPtr[!dacdmaContext.currentBuffer]);
+		dacdmaContext.updateCallback();
 	}
 }
 
+static void dacdmaSchedule(uint8_t slot)
+{
+    dacdma_slot_t* next = &dacdmaContext.slots[slot];
+    dma_tcd_t* tcd = &dacdmaContext.dmaConfig.tcds[slot];
+
+    next->block = pcmRingClaim(dacdmaContext.ring, NULL);
+    if (next->block)
+    {
+        tcd->SADDR = (uint32_t)(next->block);
+        tcd->SOFF = sizeof(uint16_t);
+        tcd->SLAST = -dacdmaContext.ring->blockSize * sizeof(uint16_t);
+    }
+    else
+    {
+        tcd->SADDR = (uint32_t)(&dacdmaContext.holdSample);
+        tcd->SOFF = 0;
+        tcd->SLAST = 0;
+    }
+}
+
 /******************************************************************************/
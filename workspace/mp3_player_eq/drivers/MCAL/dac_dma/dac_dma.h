@@ -13,19 +13,20 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "lib/pcm_ring/pcm_ring.h"
+
 /*******************************************************************************
  * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
  ******************************************************************************/
 
-#define DAC_DMA_PPBUFFER_COUNT  2
-#define DAC_DMA_PPBUFFER_SIZE   2048
+#define DAC_DMA_SLOT_COUNT      2           // Blocks scheduled in the scatter gather chain, the one being output and the next one
 #define DAC_FULL_SCALE          4096
 
 /*******************************************************************************
  * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
  ******************************************************************************/
 
-typedef void  (*dacdma_update_callback_t) (uint16_t * frameToUpdate);
+typedef void  (*dacdma_update_callback_t) (void);
 
 /*******************************************************************************
  * VARIABLE PROTOTYPES WITH GLOBAL SCOPE
@@ -38,17 +39,17 @@ typedef void  (*dacdma_update_callback_t) (uint16_t * frameToUpdate);
 void dacdmaInit(void);
 
 /*
-*  dacdmaSetBuffers()
-* @brief  sets ping pong buffers
-* @param  buffer1, buffer2 pointers to buffers
-* @param  bufferSize size of buffers
+*  dacdmaSetRing()
+* @brief  sets the ring the samples are output from. The DMA reads the blocks in place, when the ring is empty
+*         the last sample is held until the next block boundary
+* @param  ring pointer to an initialized ring, its block size is the DMA major loop
 */
-void dacdmaSetBuffers(uint16_t *buffer1, uint16_t *buffer2, uint16_t bufferSize);
+void dacdmaSetRing(pcm_ring_t* ring);
 
 
 /**
  * @brief Sets callback for frame updating
- * @param callback   Function to be called when the buffers must be updated
+ * @param callback   Function to be called from the ISR when a block was output and the ring is running low
  */ 
 void dacdmaSetCallback( dacdma_update_callback_t callback);
 
@@ -66,7 +67,7 @@ void dacdmaStop(void);
 
 /*  
 *  dacdmaStart()
-* @brief starts DAC
+* @brief starts DAC, from the oldest block of the ring that was not output
 */
 void dacdmaStart(void);
 
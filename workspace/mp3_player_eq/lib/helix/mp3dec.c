@@ -45,6 +45,67 @@
 #include "pub/mp3common.h"	/* includes mp3dec.h (public API) and internal, platform-independent API */
 //#include "hxthreadyield.h"
 
+#ifdef MP3_PROFILE
+
+#if defined(ARM_TEST)
+/* Cortex-M4 data watchpoint and trace unit, CYCCNT counts core clock cycles */
+#define DEMCR			(*(volatile unsigned int *)0xE000EDFC)
+#define DWT_CTRL		(*(volatile unsigned int *)0xE0001000)
+#define DWT_CYCCNT		(*(volatile unsigned int *)0xE0001004)
+#define DEMCR_TRCENA	(1u << 24)
+#define DWT_CYCCNTENA	(1u << 0)
+
+static void ProfileInit(void)
+{
+	DEMCR |= DEMCR_TRCENA;
+	DWT_CTRL |= DWT_CYCCNTENA;
+}
+
+static __inline unsigned int ProfileTicks(void)
+{
+	return DWT_CYCCNT;
+}
+
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+
+static void ProfileInit(void)
+{
+}
+
+static __inline unsigned int ProfileTicks(void)
+{
+	return (unsigned int)__rdtsc();
+}
+
+#else
+#include <time.h>
+
+static void ProfileInit(void)
+{
+}
+
+static __inline unsigned int ProfileTicks(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned int)(ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+#endif
+
+/* ticks are unsigned 32-bit, so the difference is right across one wrap of the counter */
+#define PROFILE_START(t)					((t) = ProfileTicks())
+#define PROFILE_STOP(mp3DecInfo, stage, t)	((mp3DecInfo)->frameTicks[stage] += ProfileTicks() - (t))
+
+#else
+
+#define PROFILE_START(t)
+#define PROFILE_STOP(mp3DecInfo, stage, t)
+
+#endif	/* MP3_PROFILE */
+
 /**************************************************************************************
  * Function:    MP3InitDecoder
  *
@@ -63,13 +124,263 @@ HMP3Decoder MP3InitDecoder(void)
 
 	mp3DecInfo = AllocateBuffers();
 
+#ifdef MP3_PROFILE
+	ProfileInit();
+#endif
+
 	return (HMP3Decoder)mp3DecInfo;
 }
 
+/**************************************************************************************
+ * Function:    MP3InitDecoderInPlace
+ *
+ * Description: set up a decoder instance in caller provided memory
+ *              clear all the user-accessible fields
+ *
+ * Inputs:      pointer to memory for the decoder state
+ *              size of the memory in bytes, at least MP3_DECODER_STATE_BYTES
+ *
+ * Outputs:     none
+ *
+ * Return:      handle to mp3 decoder instance, 0 if the memory is too small
+ *
+ * Notes:       no heap and no static pool are used, so the state can be placed in a 
+ *                chosen memory region and any number of instances can coexist
+ *              the memory belongs to the caller, MP3FreeDecoder only clears the instance
+ **************************************************************************************/
+HMP3Decoder MP3InitDecoderInPlace(void *mem, size_t size)
+{
+	MP3DecInfo *mp3DecInfo;
+
+	mp3DecInfo = InitBuffers(mem, size);
+
+#ifdef MP3_PROFILE
+	ProfileInit();
+#endif
+
+	return (HMP3Decoder)mp3DecInfo;
+}
+
+/**************************************************************************************
+ * Function:    MP3ResetDecoder
+ *
+ * Description: clear the state of a decoder instance to start a new stream, or the 
+ *                same one at another position
+ *
+ * Inputs:      valid MP3 decoder instance pointer (HMP3Decoder)
+ *
+ * Outputs:     none
+ *
+ * Return:      none
+ *
+ * Notes:       the bit reservoir, the IMDCT overlap and the vbuf are cleared as in a new 
+ *                instance, the output mode, the half rate and the channel threads are kept
+ *              cheaper than MP3FreeDecoder and MP3InitDecoderInPlace, which stop the
+ *                worker thread and would need a new one
+ **************************************************************************************/
+void MP3ResetDecoder(HMP3Decoder hMP3Decoder)
+{
+	MP3DecInfo *mp3DecInfo = (MP3DecInfo *)hMP3Decoder;
+	int downmix, halfRate;
+	void *threadInfo;
+
+	if (!mp3DecInfo)
+		return;
+
+	downmix = mp3DecInfo->downmix;
+	halfRate = mp3DecInfo->halfRate;
+	threadInfo = mp3DecInfo->ThreadInfoPS;
+
+	ClearBuffers(mp3DecInfo);
+
+	mp3DecInfo->downmix = downmix;
+	mp3DecInfo->halfRate = halfRate;
+	mp3DecInfo->ThreadInfoPS = threadInfo;
+}
+
+/**************************************************************************************
+ * Function:    MP3SetDownmix
+ *
+ * Description: select the output of stereo frames
+ *
+ * Inputs:      valid MP3 decoder instance pointer (HMP3Decoder)
+ *              nonzero to output stereo frames as one channel (L+R)/2, 
+ *                zero to output them interleaved LRLRLR
+ *
+ * Outputs:     none
+ *
+ * Return:      none
+ *
+ * Notes:       the mix is done before the synthesis filterbank, so it runs once
+ *                instead of once per channel
+ **************************************************************************************/
+void MP3SetDownmix(HMP3Decoder hMP3Decoder, int downmix)
+{
+	MP3DecInfo *mp3DecInfo = (MP3DecInfo *)hMP3Decoder;
+
+	if (!mp3DecInfo)
+		return;
+
+	mp3DecInfo->downmix = downmix;
+}
+
+/**************************************************************************************
+ * Function:    MP3SetHalfRate
+ *
+ * Description: select the bandwidth and sample rate of the output
+ *
+ * Inputs:      valid MP3 decoder instance pointer (HMP3Decoder)
+ *              nonzero to synthesize only the lower 16 subbands at half the sample rate,
+ *                zero for the full bandwidth
+ *
+ * Outputs:     none
+ *
+ * Return:      none
+ *
+ * Notes:       the IMDCT and the synthesis run on half the subbands, the output
+ *                loses everything above a quarter of the stream sample rate
+ *              takes effect on the next frame, MP3GetLastFrameInfo reports the 
+ *                halved sample rate and output samples
+ **************************************************************************************/
+void MP3SetHalfRate(HMP3Decoder hMP3Decoder, int halfRate)
+{
+	MP3DecInfo *mp3DecInfo = (MP3DecInfo *)hMP3Decoder;
+
+	if (!mp3DecInfo)
+		return;
+
+	mp3DecInfo->halfRate = (halfRate ? 1 : 0);
+}
+
+/**************************************************************************************
+ * Function:    MP3SetChannelThreads
+ *
+ * Description: select how many threads decode a stereo frame
+ *
+ * Inputs:      valid MP3 decoder instance pointer (HMP3Decoder)
+ *              number of threads, 2 (or more) to run the IMDCT and the subband transform
+ *                of each channel on its own thread, 1 to decode on the calling thread
+ *
+ * Outputs:     none
+ *
+ * Return:      number of threads in use, 1 if the decoder was built without MP3_THREADS
+ *                or the worker thread could not be started
+ *
+ * Notes:       for hosts with spare cores, the two channel pipelines are the only 
+ *                independent work within a stream (see threads.c), so more than 2 
+ *                threads gives the same as 2
+ *              the worker thread lives until this is called with 1 or the decoder is freed,
+ *                MP3ResetDecoder keeps it, MP3FreeDecoder joins it
+ *              stereo frames are handed to the worker once per frame, downmixed frames 
+ *                are decoded on the calling thread
+ **************************************************************************************/
+int MP3SetChannelThreads(HMP3Decoder hMP3Decoder, int nThreads)
+{
+	MP3DecInfo *mp3DecInfo = (MP3DecInfo *)hMP3Decoder;
+
+	if (!mp3DecInfo)
+		return 1;
+
+#ifdef MP3_THREADS
+	if (nThreads > 1 && !mp3DecInfo->ThreadInfoPS)
+		InitThreads(mp3DecInfo);
+	else if (nThreads <= 1)
+		FreeThreads(mp3DecInfo);
+
+	return (mp3DecInfo->ThreadInfoPS ? 2 : 1);
+#else
+	(void)nThreads;
+	return 1;
+#endif
+}
+
+/**************************************************************************************
+ * Function:    MP3GetDecodeProfile
+ *
+ * Description: get the time spent in each stage of MP3Decode
+ *
+ * Inputs:      valid MP3 decoder instance pointer (HMP3Decoder)
+ *              pointer to MP3Profile struct
+ *
+ * Outputs:     filled-in MP3Profile struct, all zeros if the decoder was not 
+ *                built with MP3_PROFILE defined
+ *
+ * Return:      none
+ *
+ * Notes:       only frames which are decoded without error are accounted
+ **************************************************************************************/
+void MP3GetDecodeProfile(HMP3Decoder hMP3Decoder, MP3Profile *mp3Profile)
+{
+	MP3DecInfo *mp3DecInfo = (MP3DecInfo *)hMP3Decoder;
+
+	if (!mp3DecInfo)
+		return;
+
+#ifdef MP3_PROFILE
+	*mp3Profile = mp3DecInfo->profile;
+#else
+	memset(mp3Profile, 0, sizeof(MP3Profile));
+#endif
+}
+
+/**************************************************************************************
+ * Function:    MP3ResetDecodeProfile
+ *
+ * Description: clear the time accounted to each stage of MP3Decode
+ *
+ * Inputs:      valid MP3 decoder instance pointer (HMP3Decoder)
+ *
+ * Outputs:     none
+ *
+ * Return:      none
+ **************************************************************************************/
+void MP3ResetDecodeProfile(HMP3Decoder hMP3Decoder)
+{
+	MP3DecInfo *mp3DecInfo = (MP3DecInfo *)hMP3Decoder;
+
+	if (!mp3DecInfo)
+		return;
+
+#ifdef MP3_PROFILE
+	memset(&mp3DecInfo->profile, 0, sizeof(MP3Profile));
+#endif
+}
+
+#ifdef MP3_PROFILE
+/**************************************************************************************
+ * Function:    ProfileFrameDone
+ *
+ * Description: add the ticks of the frame just decoded to the totals
+ *
+ * Inputs:      valid MP3 decoder instance pointer, with frameTicks filled by MP3Decode
+ *
+ * Outputs:     updated total, min and max of every stage
+ *
+ * Return:      none
+ **************************************************************************************/
+static void ProfileFrameDone(MP3DecInfo *mp3DecInfo)
+{
+	MP3Profile *p = &mp3DecInfo->profile;
+	unsigned int t;
+	int i;
+
+	for (i = 0; i < MP3_NUM_STAGES; i++) {
+		t = mp3DecInfo->frameTicks[i];
+		p->total[i] += t;
+		if (p->nFrames == 0 || t < p->min[i])
+			p->min[i] = t;
+		if (t > p->max[i])
+			p->max[i] = t;
+	}
+	p->nFrames++;
+}
+#endif
+
 /**************************************************************************************
  * Function:    MP3FreeDecoder
  *
  * Description: free platform-specific data allocated by InitMP3Decoder
+ *                or MP3InitDecoderInPlace
  *              zero out the contents of MP3DecInfo struct
  *
  * Inputs:      valid MP3 decoder instance pointer (HMP3Decoder)
@@ -85,6 +396,9 @@ void MP3FreeDecoder(HMP3Decoder hMP3Decoder)
 	if (!mp3DecInfo)
 		return;
 
+#ifdef MP3_THREADS
+	FreeThreads(mp3DecInfo);
+#endif
 	FreeBuffers(mp3DecInfo);
 }
 
@@ -195,10 +509,10 @@ void MP3GetLastFrameInfo(HMP3Decoder hMP3Decoder, MP3FrameInfo *mp3FrameInfo)
 		mp3FrameInfo->version = 0;
 	} else {
 		mp3FrameInfo->bitrate = mp3DecInfo->bitrate;
-		mp3FrameInfo->nChans = mp3DecInfo->nChans;
-		mp3FrameInfo->samprate = mp3DecInfo->samprate;
+		mp3FrameInfo->nChans = OUTPUT_CHANS(mp3DecInfo);
+		mp3FrameInfo->samprate = mp3DecInfo->samprate >> mp3DecInfo->halfRate;
 		mp3FrameInfo->bitsPerSample = 16;
-		mp3FrameInfo->outputSamps = mp3DecInfo->nChans * (int)samplesPerFrameTab[mp3DecInfo->version][mp3DecInfo->layer - 1];
+		mp3FrameInfo->outputSamps = OUTPUT_CHANS(mp3DecInfo) * ((int)samplesPerFrameTab[mp3DecInfo->version][mp3DecInfo->layer - 1] >> mp3DecInfo->halfRate);
 		mp3FrameInfo->layer = mp3DecInfo->layer;
 		mp3FrameInfo->version = mp3DecInfo->version;
 	}
@@ -252,7 +566,7 @@ static void MP3ClearBadFrame(MP3DecInfo *mp3DecInfo, short *outbuf)
 	if (!mp3DecInfo)
 		return;
 
-	for (i = 0; i < mp3DecInfo->nGrans * mp3DecInfo->nGranSamps * mp3DecInfo->nChans; i++)
+	for (i = 0; i < mp3DecInfo->nGrans * OUTPUT_GRAN_SAMPS(mp3DecInfo) * OUTPUT_CHANS(mp3DecInfo); i++)
 		outbuf[i] = 0;
 }
 
@@ -283,19 +597,33 @@ int MP3Decode(HMP3Decoder hMP3Decoder, unsigned char **inbuf, int *bytesLeft, sh
 	int prevBitOffset, sfBlockBits, huffBlockBits;
 	unsigned char *mainPtr;
 	MP3DecInfo *mp3DecInfo = (MP3DecInfo *)hMP3Decoder;
+#ifdef MP3_PROFILE
+	unsigned int t;
+#endif
+#ifdef MP3_THREADS
+	int err;
+#endif
 //	ULONG32 ulTime;
 //	StartYield(&ulTime);
 	if (!mp3DecInfo)
 		return ERR_MP3_NULL_POINTER;
 
+#ifdef MP3_PROFILE
+	memset(mp3DecInfo->frameTicks, 0, sizeof(mp3DecInfo->frameTicks));
+#endif
+
 	/* unpack frame header */
+	PROFILE_START(t);
 	fhBytes = UnpackFrameHeader(mp3DecInfo, *inbuf);
+	PROFILE_STOP(mp3DecInfo, MP3_STAGE_FRAMEHEADER, t);
 	if (fhBytes < 0)	
 		return ERR_MP3_INVALID_FRAMEHEADER;		/* don't clear outbuf since we don't know size (failed to parse header) */
 	*inbuf += fhBytes;
 	
 	/* unpack side info */
+	PROFILE_START(t);
 	siBytes = UnpackSideInfo(mp3DecInfo, *inbuf);
+	PROFILE_STOP(mp3DecInfo, MP3_STAGE_SIDEINFO, t);
 	if (siBytes < 0) {
 		MP3ClearBadFrame(mp3DecInfo, outbuf);
 		return ERR_MP3_INVALID_SIDEINFO;
@@ -372,7 +700,9 @@ int MP3Decode(HMP3Decoder hMP3Decoder, unsigned char **inbuf, int *bytesLeft, sh
 		for (ch = 0; ch < mp3DecInfo->nChans; ch++) {
 			/* unpack scale factors and compute size of scale factor block */
 			prevBitOffset = bitOffset;
+			PROFILE_START(t);
 			offset = UnpackScaleFactors(mp3DecInfo, mainPtr, &bitOffset, mainBits, gr, ch);
+			PROFILE_STOP(mp3DecInfo, MP3_STAGE_SCALEFACT, t);
 
 			sfBlockBits = 8*offset - prevBitOffset + bitOffset;
 			huffBlockBits = mp3DecInfo->part23Length[gr][ch] - sfBlockBits;
@@ -386,7 +716,9 @@ int MP3Decode(HMP3Decoder hMP3Decoder, unsigned char **inbuf, int *bytesLeft, sh
 
 			/* decode Huffman code words */
 			prevBitOffset = bitOffset;
+			PROFILE_START(t);
 			offset = DecodeHuffman(mp3DecInfo, mainPtr, &bitOffset, huffBlockBits, gr, ch);
+			PROFILE_STOP(mp3DecInfo, MP3_STAGE_HUFFMAN, t);
 			if (offset < 0) {
 				MP3ClearBadFrame(mp3DecInfo, outbuf);
 				return ERR_MP3_INVALID_HUFFCODES;
@@ -397,23 +729,52 @@ int MP3Decode(HMP3Decoder hMP3Decoder, unsigned char **inbuf, int *bytesLeft, sh
 		}
 //		YieldIfRequired(&ulTime);
 		/* dequantize coefficients, decode stereo, reorder short blocks */
+		PROFILE_START(t);
 		if (Dequantize(mp3DecInfo, gr) < 0) {
 			MP3ClearBadFrame(mp3DecInfo, outbuf);
 			return ERR_MP3_INVALID_DEQUANTIZE;			
 		}
+		PROFILE_STOP(mp3DecInfo, MP3_STAGE_DEQUANTIZE, t);
+
+#ifdef MP3_THREADS
+		/* stereo on two threads, IMDCT and subband transform of each channel (timed as IMDCT)
+		 *   the earlier granules are saved, the whole frame is decoded after the last one
+		 */
+		if (mp3DecInfo->ThreadInfoPS && mp3DecInfo->nChans == 2 && !mp3DecInfo->downmix) {
+			PROFILE_START(t);
+			if (gr < mp3DecInfo->nGrans - 1)
+				err = SaveGranule(mp3DecInfo, gr);
+			else
+				err = ThreadedFrame(mp3DecInfo, outbuf);
+			if (err < 0) {
+				MP3ClearBadFrame(mp3DecInfo, outbuf);
+				return ERR_MP3_INVALID_IMDCT;
+			}
+			PROFILE_STOP(mp3DecInfo, MP3_STAGE_IMDCT, t);
+			continue;
+		}
+#endif
 
 		/* alias reduction, inverse MDCT, overlap-add, frequency inversion */
+		PROFILE_START(t);
 		for (ch = 0; ch < mp3DecInfo->nChans; ch++)
 			if (IMDCT(mp3DecInfo, gr, ch) < 0) {
 				MP3ClearBadFrame(mp3DecInfo, outbuf);
 				return ERR_MP3_INVALID_IMDCT;			
 			}
+		PROFILE_STOP(mp3DecInfo, MP3_STAGE_IMDCT, t);
 
 		/* subband transform - if stereo, interleaves pcm LRLRLR */
-		if (Subband(mp3DecInfo, outbuf + gr*mp3DecInfo->nGranSamps*mp3DecInfo->nChans) < 0) {
+		PROFILE_START(t);
+		if (Subband(mp3DecInfo, outbuf + gr*OUTPUT_GRAN_SAMPS(mp3DecInfo)*OUTPUT_CHANS(mp3DecInfo)) < 0) {
 			MP3ClearBadFrame(mp3DecInfo, outbuf);
 			return ERR_MP3_INVALID_SUBBAND;			
 		}
+		PROFILE_STOP(mp3DecInfo, MP3_STAGE_SUBBAND, t);
 	}
+
+#ifdef MP3_PROFILE
+	ProfileFrameDone(mp3DecInfo);
+#endif
 	return ERR_MP3_NONE;
 }
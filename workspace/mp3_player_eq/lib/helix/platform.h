@@ -10,7 +10,11 @@
 
 #include <stdint.h>
 
+#if defined(__arm__)
 #define ARM_TEST
+#else
+#define HOST_TEST		// portable C build for PC testbenches and benchmarks
+#endif
 
 typedef long long Word64;
 typedef uint32_t ULONG32;
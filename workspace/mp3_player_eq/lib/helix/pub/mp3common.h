@@ -47,6 +47,13 @@
 #include "mp3dec.h"
 #include "statname.h"	/* do name-mangling for static linking */
 
+/* The firmware build compiles the decoder with the rest of the project, at its optimisation level. The decoder
+ * is always optimised as the archive it replaced (-O3), also in debug builds.
+ */
+#if defined(__arm__) && defined(__GNUC__) && !defined(__clang__)
+#pragma GCC optimize ("O3")
+#endif
+
 #define MAX_SCFBD		4		/* max scalefactor bands per channel */
 #define NGRANS_MPEG1	2
 #define NGRANS_MPEG2	1
@@ -69,6 +76,7 @@ typedef struct _MP3DecInfo {
 	void *DequantInfoPS;
 	void *IMDCTInfoPS;
 	void *SubbandInfoPS;
+	void *ThreadInfoPS;		/* worker thread of the channel threads, 0 when decoding on one thread */
 
 	/* buffer which must be large enough to hold largest possible main_data section */
 	unsigned char mainBuf[MAINBUF_SIZE];
@@ -90,10 +98,26 @@ typedef struct _MP3DecInfo {
 	int mainDataBegin;
 	int mainDataBytes;
 
+	/* output mode */
+	int downmix;			/* stereo frames are synthesized as mono (L+R)/2 */
+	int halfRate;			/* only the lower 16 subbands are synthesized, at half the sample rate */
+
 	int part23Length[MAX_NGRAN][MAX_NCHAN];
 
+#ifdef MP3_PROFILE
+	/* per-stage timing, accumulated over the current frame and over all the frames */
+	unsigned int frameTicks[MP3_NUM_STAGES];
+	MP3Profile profile;
+#endif
+
 } MP3DecInfo;
 
+/* channels in the decoded pcm, stereo frames give one channel when downmixing */
+#define OUTPUT_CHANS(mp3DecInfo)	((mp3DecInfo)->downmix ? 1 : (mp3DecInfo)->nChans)
+
+/* pcm samples per granule and channel, halved in half rate mode */
+#define OUTPUT_GRAN_SAMPS(mp3DecInfo)	((mp3DecInfo)->nGranSamps >> (mp3DecInfo)->halfRate)
+
 typedef struct _SFBandTable {
 	short l[23];
 	short s[14];
@@ -101,6 +125,8 @@ typedef struct _SFBandTable {
 
 /* decoder functions which must be implemented for each platform */
 MP3DecInfo *AllocateBuffers(void);
+MP3DecInfo *InitBuffers(void *mem, size_t size);
+void ClearBuffers(MP3DecInfo *mp3DecInfo);
 void FreeBuffers(MP3DecInfo *mp3DecInfo);
 int CheckPadBit(MP3DecInfo *mp3DecInfo);
 int UnpackFrameHeader(MP3DecInfo *mp3DecInfo, unsigned char *buf);
@@ -111,6 +137,14 @@ int IMDCT(MP3DecInfo *mp3DecInfo, int gr, int ch);
 int UnpackScaleFactors(MP3DecInfo *mp3DecInfo, unsigned char *buf, int *bitOffset, int bitsAvail, int gr, int ch);
 int Subband(MP3DecInfo *mp3DecInfo, short *pcmBuf);
 
+#ifdef MP3_THREADS
+/* threads.c - channel threads, host builds with pthreads */
+int InitThreads(MP3DecInfo *mp3DecInfo);
+void FreeThreads(MP3DecInfo *mp3DecInfo);
+int SaveGranule(MP3DecInfo *mp3DecInfo, int gr);
+int ThreadedFrame(MP3DecInfo *mp3DecInfo, short *pcmBuf);
+#endif
+
 /* mp3tabs.c - global ROM tables */
 extern const int samplerateTab[3][3];
 extern const short bitrateTab[3][3][15];
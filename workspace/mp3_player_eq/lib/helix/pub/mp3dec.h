@@ -44,6 +44,7 @@
 #ifndef _MP3DEC_H
 #define _MP3DEC_H
 
+#include <stddef.h>		/* for size_t */
 #include "../platform.h"
 
 #if defined(_WIN32) && !defined(_WIN32_WCE)
@@ -66,6 +67,8 @@
 #
 #elif defined(ARM_TEST)
 #
+#elif defined(HOST_TEST)
+#
 #else
 #error No platform defined. See valid options in mp3dec.h
 #endif
@@ -81,6 +84,13 @@ extern "C" {
  */
 #define MAINBUF_SIZE	1940
 
+/* bytes of memory for the state of one decoder instance, given to MP3InitDecoderInPlace
+ *   (checked against the internal structs when building buffers.c)
+ */
+#ifndef MP3_DECODER_STATE_BYTES
+#define MP3_DECODER_STATE_BYTES	(24 * 1024)
+#endif
+
 #define MAX_NGRAN		2		/* max granules */
 #define MAX_NCHAN		2		/* max channels */
 #define MAX_NSAMP		576		/* max samples per channel, per granule (576 default) */
@@ -122,14 +132,42 @@ typedef struct _MP3FrameInfo {
 	int version;
 } MP3FrameInfo;
 
+/* decoding stages timed by MP3Decode when the decoder is built with MP3_PROFILE defined */
+enum {
+	MP3_STAGE_FRAMEHEADER =  0,
+	MP3_STAGE_SIDEINFO,
+	MP3_STAGE_SCALEFACT,
+	MP3_STAGE_HUFFMAN,
+	MP3_STAGE_DEQUANTIZE,
+	MP3_STAGE_IMDCT,
+	MP3_STAGE_SUBBAND,
+
+	MP3_NUM_STAGES
+};
+
+/* ticks are CPU cycles (DWT CYCCNT on Cortex-M, TSC on x86) or nanoseconds (clock_gettime elsewhere) */
+typedef struct _MP3Profile {
+	unsigned int nFrames;						/* frames decoded since the last reset */
+	unsigned long long total[MP3_NUM_STAGES];	/* ticks spent in each stage over all the frames */
+	unsigned int min[MP3_NUM_STAGES];			/* fewest ticks spent in a stage by one frame */
+	unsigned int max[MP3_NUM_STAGES];			/* most ticks spent in a stage by one frame */
+} MP3Profile;
+
 /* public API */
 HMP3Decoder MP3InitDecoder(void);
+HMP3Decoder MP3InitDecoderInPlace(void *mem, size_t size);
 void MP3FreeDecoder(HMP3Decoder hMP3Decoder);
+void MP3ResetDecoder(HMP3Decoder hMP3Decoder);
 int MP3Decode(HMP3Decoder hMP3Decoder, unsigned char **inbuf, int *bytesLeft, short *outbuf, int useSize);
 
 void MP3GetLastFrameInfo(HMP3Decoder hMP3Decoder, MP3FrameInfo *mp3FrameInfo);
 int MP3GetNextFrameInfo(HMP3Decoder hMP3Decoder, MP3FrameInfo *mp3FrameInfo, unsigned char *buf);
 int MP3FindSyncWord(unsigned char *buf, int nBytes);
+void MP3SetDownmix(HMP3Decoder hMP3Decoder, int downmix);
+void MP3SetHalfRate(HMP3Decoder hMP3Decoder, int halfRate);
+int MP3SetChannelThreads(HMP3Decoder hMP3Decoder, int nThreads);
+void MP3GetDecodeProfile(HMP3Decoder hMP3Decoder, MP3Profile *mp3Profile);
+void MP3ResetDecodeProfile(HMP3Decoder hMP3Decoder);
 
 #ifdef __cplusplus
 }
@@ -64,12 +64,18 @@
 #define	UnpackFrameHeader	STATNAME(UnpackFrameHeader)
 #define	UnpackSideInfo		STATNAME(UnpackSideInfo)
 #define	AllocateBuffers		STATNAME(AllocateBuffers)
+#define	InitBuffers			STATNAME(InitBuffers)
+#define	ClearBuffers		STATNAME(ClearBuffers)
 #define	FreeBuffers			STATNAME(FreeBuffers)
 #define	DecodeHuffman		STATNAME(DecodeHuffman)
 #define	Dequantize			STATNAME(Dequantize)
 #define	IMDCT				STATNAME(IMDCT)
 #define	UnpackScaleFactors	STATNAME(UnpackScaleFactors)
 #define	Subband				STATNAME(Subband)
+#define	InitThreads			STATNAME(InitThreads)
+#define	FreeThreads			STATNAME(FreeThreads)
+#define	SaveGranule			STATNAME(SaveGranule)
+#define	ThreadedFrame		STATNAME(ThreadedFrame)
 
 #define	samplerateTab		STATNAME(samplerateTab)
 #define	bitrateTab			STATNAME(bitrateTab)
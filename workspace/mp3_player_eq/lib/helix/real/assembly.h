@@ -396,6 +396,67 @@ static __inline Word64 SAR64(Word64 x, int n)
 
 }
 
+/* 8 bytes of the bitstream, first byte in the MSB (unaligned loads are fine on Cortex-M3/M4) */
+static __inline unsigned long long LOADBE64(const unsigned char *buf)
+{
+	unsigned long long x;
+
+	__builtin_memcpy(&x, buf, sizeof(x));
+	return __builtin_bswap64(x);
+}
+
+#elif defined(HOST_TEST)
+
+/* portable C versions, used when building the decoder on a PC (testbenches, benchmarks) */
+static __inline int MULSHIFT32(int x, int y)
+{
+	return (int)(((Word64)x * (Word64)y) >> 32);
+}
+
+static __inline int FASTABS(int x)
+{
+	int sign;
+
+	sign = x >> (sizeof(int) * 8 - 1);
+	x ^= sign;
+	x -= sign;
+
+	return x;
+}
+
+static __inline int CLZ(int x)
+{
+	if (!x)
+		return (sizeof(int) * 8);
+
+	return __builtin_clz((unsigned int)x);
+}
+
+static __inline Word64 MADD64(Word64 sum64, int x, int y)
+{
+	return sum64 + ((Word64)x * (Word64)y);
+}
+
+static __inline Word64 SAR64(Word64 x, int n)
+{
+	return x >> n;
+}
+
+static __inline unsigned long long LOADBE64(const unsigned char *buf)
+{
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+	unsigned long long x;
+
+	__builtin_memcpy(&x, buf, sizeof(x));
+	return __builtin_bswap64(x);
+#else
+	return ((unsigned long long)buf[0] << 56) | ((unsigned long long)buf[1] << 48) | 
+		   ((unsigned long long)buf[2] << 40) | ((unsigned long long)buf[3] << 32) | 
+		   ((unsigned long long)buf[4] << 24) | ((unsigned long long)buf[5] << 16) | 
+		   ((unsigned long long)buf[6] <<  8) |  (unsigned long long)buf[7];
+#endif
+}
+
 #else
 
 #error Unsupported platform in assembly.h
@@ -61,11 +61,82 @@ void SetBitstreamPointer(BitStreamInfo *bsi, int nBytes, unsigned char *buf)
 {
 	/* init bitstream */
 	bsi->bytePtr = buf;
-	bsi->iCache = 0;		/* 4-byte unsigned int */
+	bsi->iCache = 0;		/* 4-byte unsigned int (8 bytes with BITSTREAM_CACHE64) */
 	bsi->cachedBits = 0;	/* i.e. zero bits in cache */
 	bsi->nBytes = nBytes;
 }
 
+#ifdef BITSTREAM_CACHE64
+
+/**************************************************************************************
+ * Function:    RefillBitstreamCache
+ *
+ * Description: read new data from bitstream buffer into bsi cache (64-bit version)
+ *
+ * Inputs:      pointer to initialized BitStreamInfo struct
+ *
+ * Outputs:     updated bitstream info struct
+ *
+ * Return:      none
+ *
+ * Notes:       tops the cache up to at least 57 bits (fewer at the end of the buffer)
+ *              one 8-byte load while >= 8 bytes are left, the bits past the counted bytes
+ *                are the next bytes of the buffer, so ORing them in again later is harmless
+ *              bits past the end of the buffer read as 0, as in the 32-bit version
+ **************************************************************************************/
+static __inline void RefillBitstreamCache(BitStreamInfo *bsi)
+{
+	int nBytes;
+
+	if (bsi->nBytes >= 8) {
+		nBytes = (63 - bsi->cachedBits) >> 3;
+		bsi->iCache |= LOADBE64(bsi->bytePtr) >> bsi->cachedBits;
+		bsi->bytePtr += nBytes;
+		bsi->nBytes -= nBytes;
+		bsi->cachedBits += nBytes << 3;
+	} else {
+		while (bsi->nBytes > 0 && bsi->cachedBits <= 56) {
+			bsi->iCache |= (unsigned long long)(*bsi->bytePtr++) << (56 - bsi->cachedBits);
+			bsi->cachedBits += 8;
+			bsi->nBytes--;
+		}
+	}
+}
+
+/**************************************************************************************
+ * Function:    GetBits
+ *
+ * Description: get bits from bitstream, advance bitstream pointer (64-bit version)
+ *
+ * Inputs:      pointer to initialized BitStreamInfo struct
+ *              number of bits to get from bitstream
+ *
+ * Outputs:     updated bitstream info struct
+ *
+ * Return:      the next nBits bits of data from bitstream buffer
+ *
+ * Notes:       same behavior as the 32-bit version below
+ *              a refill lasts for several calls, instead of refilling at every int boundary
+ *              after an overrun cachedBits goes negative (no refill, the cache is all 0's),
+ *                so CalcBitsUsed still counts every bit read
+ **************************************************************************************/
+unsigned int GetBits(BitStreamInfo *bsi, int nBits)
+{
+	unsigned int data;
+
+	nBits &= 0x1f;							/* nBits mod 32 to avoid unpredictable results like >> by negative amount */
+	if (bsi->cachedBits < nBits)
+		RefillBitstreamCache(bsi);
+
+	data = (unsigned int)((bsi->iCache >> 1) >> (63 - nBits));	/* >> 1 first so that nBits = 0 works okay (returns 0) */
+	bsi->iCache <<= nBits;					/* left-justify cache */
+	bsi->cachedBits -= nBits;				/* how many bits have we drawn from the cache so far */
+
+	return data;
+}
+
+#else
+
 /**************************************************************************************
  * Function:    RefillBitstreamCache
  *
@@ -149,6 +220,8 @@ unsigned int GetBits(BitStreamInfo *bsi, int nBits)
 	return data;
 }
 
+#endif	/* BITSTREAM_CACHE64 */
+
 /**************************************************************************************
  * Function:    CalcBitsUsed
  *
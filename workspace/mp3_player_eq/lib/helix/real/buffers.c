@@ -46,31 +46,96 @@
  **************************************************************************************/
 
 #include <stdlib.h>		/* for malloc, free */
+#include <string.h>		/* for memset */
 #include "coder.h"
 
+/* number of decoder instances with static storage, can be set from the build 
+ *   the player keeps the state of its decoders in the mp3decoder storage (MP3InitDecoderInPlace),
+ *   so the target build has no static pool and MP3InitDecoder returns 0
+ */
+#ifndef MP3_MAX_DECODERS
+#ifdef HOST_TEST
+#define MP3_MAX_DECODERS	8
+#else
+#define MP3_MAX_DECODERS	0
+#endif
+#endif
+
+/* every struct of the state starts on an 8-byte boundary (Word64 members) */
+#define STATE_ALIGN			8
+#define STATE_SIZE(type)	((sizeof(type) + STATE_ALIGN - 1) & ~(size_t)(STATE_ALIGN - 1))
+#define STATE_BYTES			(STATE_SIZE(MP3DecInfo) + STATE_SIZE(FrameHeader) + STATE_SIZE(SideInfo) + \
+							 STATE_SIZE(ScaleFactorInfo) + STATE_SIZE(HuffmanInfo) + STATE_SIZE(DequantInfo) + \
+							 STATE_SIZE(IMDCTInfo) + STATE_SIZE(SubbandInfo))
+
+/* compile-time check, negative array size if MP3_DECODER_STATE_BYTES cannot hold the state of one instance 
+ *   (the caller memory may need up to STATE_ALIGN - 1 bytes of padding to be aligned)
+ */
+typedef char StateBytesCheck[(STATE_BYTES + STATE_ALIGN - 1 <= MP3_DECODER_STATE_BYTES) ? 1 : -1];
+
 /**************************************************************************************
- * Function:    ClearBuffer
+ * Function:    InitBuffers
  *
- * Description: fill buffer with 0's
+ * Description: lay out all the memory needed for the MP3 decoder in caller provided memory
  *
- * Inputs:      pointer to buffer
- *              number of bytes to fill with 0
+ * Inputs:      pointer to memory
+ *              size of the memory in bytes
  *
- * Outputs:     cleared buffer
+ * Outputs:     cleared memory
  *
- * Return:      none
+ * Return:      pointer to MP3DecInfo structure (initialized with pointers to all 
+ *                the internal buffers needed for decoding, all other members of 
+ *                MP3DecInfo structure set to 0), 0 if the memory is too small
  *
- * Notes:       slow, platform-independent equivalent to memset(buf, 0, nBytes)
+ * Notes:       the structs are laid out one after the other from the first 8-byte
+ *                boundary of the memory, the whole state is cleared with one memset
  **************************************************************************************/
-static void ClearBuffer(void *buf, int nBytes)
+MP3DecInfo *InitBuffers(void *mem, size_t size)
 {
-	int i;
-	unsigned char *cbuf = (unsigned char *)buf;
+	MP3DecInfo *mp3DecInfo;
+	unsigned char *p;
+	size_t pad;
 
-	for (i = 0; i < nBytes; i++)
-		cbuf[i] = 0;
+	if (!mem)
+		return 0;
+
+	pad = (STATE_ALIGN - ((size_t)mem & (STATE_ALIGN - 1))) & (STATE_ALIGN - 1);
+	if (size < pad + STATE_BYTES)
+		return 0;
+
+	/* important to do this - DSP primitives assume a bunch of state variables are 0 on first use */
+	p = (unsigned char *)mem + pad;
+	memset(p, 0, STATE_BYTES);
+
+	mp3DecInfo = (MP3DecInfo *)p;						p += STATE_SIZE(MP3DecInfo);
+	mp3DecInfo->FrameHeaderPS =     (void *)p;			p += STATE_SIZE(FrameHeader);
+	mp3DecInfo->SideInfoPS =        (void *)p;			p += STATE_SIZE(SideInfo);
+	mp3DecInfo->ScaleFactorInfoPS = (void *)p;			p += STATE_SIZE(ScaleFactorInfo);
+	mp3DecInfo->HuffmanInfoPS =     (void *)p;			p += STATE_SIZE(HuffmanInfo);
+	mp3DecInfo->DequantInfoPS =     (void *)p;			p += STATE_SIZE(DequantInfo);
+	mp3DecInfo->IMDCTInfoPS =       (void *)p;			p += STATE_SIZE(IMDCTInfo);
+	mp3DecInfo->SubbandInfoPS =     (void *)p;
+
+	return mp3DecInfo;
+}
 
-	return;
+/**************************************************************************************
+ * Function:    ClearBuffers
+ *
+ * Description: clear all the state of a decoder, in the memory it was laid out in
+ *
+ * Inputs:      pointer to MP3DecInfo structure returned by InitBuffers or AllocateBuffers
+ *
+ * Outputs:     cleared memory, with the pointers to all the internal buffers set again
+ *
+ * Return:      none
+ *
+ * Notes:       the MP3DecInfo structure starts on an 8-byte boundary, so the layout is 
+ *                the same as the first time
+ **************************************************************************************/
+void ClearBuffers(MP3DecInfo *mp3DecInfo)
+{
+	InitBuffers(mp3DecInfo, STATE_BYTES);
 }
 
 /**************************************************************************************
@@ -86,79 +151,30 @@ static void ClearBuffer(void *buf, int nBytes)
  *                the internal buffers needed for decoding, all other members of 
  *                MP3DecInfo structure set to 0)
  *
- * Notes:       if one or more mallocs fail, function frees any buffers already
- *                allocated before returning
+ * Notes:       buffers are taken from a static pool of MP3_MAX_DECODERS instances,
+ *                returns 0 if all of them are in use
+ *              the heap is not used
  **************************************************************************************/
 MP3DecInfo *AllocateBuffers(void)
 {
-	MP3DecInfo *mp3DecInfo;
-	FrameHeader *fh;
-	SideInfo *si;
-	ScaleFactorInfo *sfi;
-	HuffmanInfo *hi;
-	DequantInfo *di;
-	IMDCTInfo *mi;
-	SubbandInfo *sbi;
-
+#if MP3_MAX_DECODERS > 0
 	/*
 	 * Use static buffers to make the RAM usage
 	 * known at compile time.
 	 */
-	static MP3DecInfo s_mp3DecInfo;
-	static FrameHeader s_fh;
-	static SideInfo s_si;
-	static ScaleFactorInfo s_sfi;
-	static HuffmanInfo s_hi;
-	static DequantInfo s_di;
-	static IMDCTInfo s_mi;
-	static SubbandInfo s_sbi;
-	
-	mp3DecInfo = &s_mp3DecInfo;
-	fh = &s_fh;
-	si = &s_si;
-	sfi = &s_sfi;
-	hi = &s_hi;
-	di = &s_di;
-	mi = &s_mi;
-	sbi = &s_sbi;
-
-//	mp3DecInfo = (MP3DecInfo *)malloc(sizeof(MP3DecInfo));
-//	if (!mp3DecInfo) {
-//		return 0;
-//	}
-//	ClearBuffer(mp3DecInfo, sizeof(MP3DecInfo));
-//
-//	fh =  (FrameHeader *)     malloc(sizeof(FrameHeader));
-//	si =  (SideInfo *)        malloc(sizeof(SideInfo));
-//	sfi = (ScaleFactorInfo *) malloc(sizeof(ScaleFactorInfo));
-//	hi =  (HuffmanInfo *)     malloc(sizeof(HuffmanInfo));
-//	di =  (DequantInfo *)     malloc(sizeof(DequantInfo));
-//	mi =  (IMDCTInfo *)       malloc(sizeof(IMDCTInfo));
-//	sbi = (SubbandInfo *)     malloc(sizeof(SubbandInfo));
-
-	mp3DecInfo->FrameHeaderPS =     (void *)fh;
-	mp3DecInfo->SideInfoPS =        (void *)si;
-	mp3DecInfo->ScaleFactorInfoPS = (void *)sfi;
-	mp3DecInfo->HuffmanInfoPS =     (void *)hi;
-	mp3DecInfo->DequantInfoPS =     (void *)di;
-	mp3DecInfo->IMDCTInfoPS =       (void *)mi;
-	mp3DecInfo->SubbandInfoPS =     (void *)sbi;
-
-	if (!fh || !si || !sfi || !hi || !di || !mi || !sbi) {
-		FreeBuffers(mp3DecInfo);	/* safe to call - only frees memory that was successfully allocated */
-		return 0;
-	}
+	static Word64 s_state[MP3_MAX_DECODERS][(STATE_BYTES + sizeof(Word64) - 1) / sizeof(Word64)];
+	int i;
 
-	/* important to do this - DSP primitives assume a bunch of state variables are 0 on first use */
-	ClearBuffer(fh,  sizeof(FrameHeader));
-	ClearBuffer(si,  sizeof(SideInfo));
-	ClearBuffer(sfi, sizeof(ScaleFactorInfo));
-	ClearBuffer(hi,  sizeof(HuffmanInfo));
-	ClearBuffer(di,  sizeof(DequantInfo));
-	ClearBuffer(mi,  sizeof(IMDCTInfo));
-	ClearBuffer(sbi, sizeof(SubbandInfo));
+	/* a free instance has no buffers attached (FreeBuffers clears it) */
+	for (i = 0; i < MP3_MAX_DECODERS && ((MP3DecInfo *)s_state[i])->FrameHeaderPS; i++)
+		;
+	if (i == MP3_MAX_DECODERS)
+		return 0;
 
-	return mp3DecInfo;
+	return InitBuffers(s_state[i], sizeof(s_state[i]));
+#else
+	return 0;
+#endif
 }
 
 #define SAFE_FREE(x)	{if (x)	free(x);	(x) = 0;}	/* helper macro */
@@ -180,7 +196,8 @@ void FreeBuffers(MP3DecInfo *mp3DecInfo)
 {
 	if (!mp3DecInfo)
 		return;
-	// Malloc not used, nothing to do
+	// Malloc not used, release the static or in place instance
+	memset(mp3DecInfo, 0, sizeof(MP3DecInfo));
 //	SAFE_FREE(mp3DecInfo->FrameHeaderPS);
 //	SAFE_FREE(mp3DecInfo->SideInfoPS);
 //	SAFE_FREE(mp3DecInfo->ScaleFactorInfoPS);
@@ -84,6 +84,8 @@
 #define	IMDCT_SCALE				2	/* additional scaling (by sqrt(2)) for fast IMDCT36 */
 
 #define	HUFF_PAIRTABS			32
+#define	HUFF_LOOK_BITS			10	/* bits peeked by the pair lookahead tables (hufftabs.c must be regenerated if changed) */
+#define	HUFF_MAX_CWBITS			19	/* longest pair codeword, without sign bits or linbits */
 #define BLOCK_SIZE				18
 #define	NBANDS					32
 #define MAX_REORDER_SAMPS		((192-126)*3)		/* largest critical band for short blocks (see sfBandTable) */
@@ -99,6 +101,8 @@
 #define	 IntensityProcMPEG2	STATNAME(IntensityProcMPEG2)
 #define PolyphaseMono		STATNAME(PolyphaseMono)
 #define PolyphaseStereo		STATNAME(PolyphaseStereo)
+#define PolyphaseHalf		STATNAME(PolyphaseHalf)
+#define SubbandChannel		STATNAME(SubbandChannel)
 #define FDCT32				STATNAME(FDCT32)
 
 #define	ISFMpeg1			STATNAME(ISFMpeg1)
@@ -116,6 +120,11 @@
 #define	quadTable			STATNAME(quadTable)
 #define	quadTabOffset		STATNAME(quadTabOffset)
 #define	quadTabMaxBits		STATNAME(quadTabMaxBits)
+#define	huffLookTable		STATNAME(huffLookTable)
+#define	huffLookOffset		STATNAME(huffLookOffset)
+#define	quadLookTable		STATNAME(quadLookTable)
+#define	quadLookOffset		STATNAME(quadLookOffset)
+#define	quadLookBits		STATNAME(quadLookBits)
 
 /* map these to the corresponding 2-bit values in the frame header */
 typedef enum {
@@ -125,9 +134,18 @@ typedef enum {
 	Mono = 0x03		/* one channel */
 } StereoMode;
 
+/* 64-bit GetBits cache on hosts with 64-bit registers (one unaligned big-endian load per refill) */
+#if defined(HOST_TEST) && (defined(__x86_64__) || defined(__aarch64__))
+#define BITSTREAM_CACHE64
+#endif
+
 typedef struct _BitStreamInfo {
 	unsigned char *bytePtr;
+#ifdef BITSTREAM_CACHE64
+	unsigned long long iCache;
+#else
 	unsigned int iCache;
+#endif
 	int cachedBits;
 	int nBytes;
 } BitStreamInfo;
@@ -190,6 +208,7 @@ typedef struct _DequantInfo {
 typedef struct _HuffmanInfo {
 	int huffDecBuf[MAX_NCHAN][MAX_NSAMP];		/* used both for decoded Huffman values and dequantized coefficients */
 	int nonZeroBound[MAX_NCHAN];				/* number of coeffs in huffDecBuf[ch] which can be > 0 */
+	int bandBound[MAX_NCHAN];					/* end of the highest non-zero critical band after dequantization (<= nonZeroBound) */
 	int gb[MAX_NCHAN];							/* minimum number of guard bits in huffDecBuf[ch] */
 } HuffmanInfo;
 
@@ -272,6 +291,9 @@ void IntensityProcMPEG2(int x[MAX_NCHAN][MAX_NSAMP], int nSamps, FrameHeader *fh
 /* dct32.c */
 void FDCT32(int *x, int *d, int offset, int oddBlock, int gb);
 
+/* subband.c */
+int SubbandChannel(MP3DecInfo *mp3DecInfo, short *pcmBuf, int ch, int vindex);
+
 /* hufftabs.c */
 extern const HuffTabLookup huffTabLookup[HUFF_PAIRTABS];
 extern const int huffTabOffset[HUFF_PAIRTABS];
@@ -279,6 +301,11 @@ extern const unsigned short huffTable[];
 extern const unsigned char quadTable[64+16];
 extern const int quadTabOffset[2];
 extern const int quadTabMaxBits[2];
+extern const unsigned short huffLookTable[];
+extern const int huffLookOffset[HUFF_PAIRTABS];
+extern const unsigned short quadLookTable[];
+extern const int quadLookOffset[2];
+extern const int quadLookBits[2];
 
 /* polyphase.c (or asmpoly.s)
  * some platforms require a C++ compile of all source files,
@@ -290,6 +317,7 @@ extern "C" {
 #endif
 void PolyphaseMono(short *pcm, int *vbuf, const int *coefBase);
 void PolyphaseStereo(short *pcm, int *vbuf, const int *coefBase);
+void PolyphaseHalf(short *pcm, int *vbuf, const int *coefBase, int nChans);
 #ifdef __cplusplus
 }
 #endif
@@ -59,6 +59,7 @@
  *                (one granule-worth, all channels), format = Q26
  *              operates in-place on huffDecBuf but also needs di->workBuf
  *              updated hi->nonZeroBound index for both channels
+ *              hi->bandBound index for both channels (end of the non-zero critical bands)
  *
  * Return:      0 on success, -1 if null input pointers
  *
@@ -99,6 +100,18 @@ int Dequantize(MP3DecInfo *mp3DecInfo, int gr)
 	for (ch = 0; ch < mp3DecInfo->nChans; ch++) {
 		hi->gb[ch] = DequantChannel(hi->huffDecBuf[ch], di->workBuf, &hi->nonZeroBound[ch], fh,
 			&si->sis[gr][ch], &sfi->sfis[gr][ch], &cbi[ch]);
+
+		/* nonZeroBound covers the whole Huffman region, the critical bands at its top are often
+		 *   all zero after dequantization (and so is the whole granule in silence)
+		 * gb = CLZ(0) - 1 = 31 means no non-zero samples at all
+		 */
+		if (hi->gb[ch] == 31)
+			nSamps = 0;
+		else if (cbi[ch].cbType == 0)
+			nSamps = fh->sfBand->l[cbi[ch].cbEndL + 1];
+		else
+			nSamps = 3 * fh->sfBand->s[cbi[ch].cbEndSMax + 1];
+		hi->bandBound[ch] = MIN(nSamps, hi->nonZeroBound[ch]);
 	}
 
 	/* joint stereo processing assumes one guard bit in input samples
@@ -151,6 +164,9 @@ int Dequantize(MP3DecInfo *mp3DecInfo, int gr)
 		nSamps = MAX(hi->nonZeroBound[0], hi->nonZeroBound[1]);
 		hi->nonZeroBound[0] = nSamps;
 		hi->nonZeroBound[1] = nSamps;
+		nSamps = MAX(hi->bandBound[0], hi->bandBound[1]);
+		hi->bandBound[0] = nSamps;
+		hi->bandBound[1] = nSamps;
 	}
 
 	/* output format Q(DQ_FRACBITS_OUT) */
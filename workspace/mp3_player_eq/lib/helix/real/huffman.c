@@ -42,6 +42,7 @@
  **************************************************************************************/
 
 #include "coder.h"
+#include "assembly.h"
 
 /* helper macros - see comments in hufftabs.c about the format of the huffman tables */
 #define GetMaxbits(x)   ((int)( (((unsigned short)(x)) >>  0) & 0x000f))
@@ -59,6 +60,203 @@
 /* apply sign of s to the positive number x (save in MSB, will do two's complement in dequant) */
 #define ApplySign(x, s)	{ (x) |= ((s) & 0x80000000); }
 
+/* lookahead entries - see comments in hufftabs.c about the format of the lookahead tables */
+#define LookMoreBits(x)	((x) & 0x0008)
+#define LookSignX(x)	((unsigned int)((x) & 0x0001) << 31)
+#define LookSignY(x)	((unsigned int)((x) & 0x0002) << 30)
+
+/* sign in the MSB of quad value 0 (v) to 3 (y) */
+#define LookQuad(x, n)	((int)((((unsigned int)(x) >> (7 - (n))) & 0x01) | (((unsigned int)(x) << (28 + (n))) & 0x80000000)))
+
+/* refill a left-justified 64-bit cache with the whole bytes that fit (buf must hold 8 readable bytes) */
+#define RefillCache64(cache, cachedBits, buf, bitsLeft) { \
+	int nBytes = (63 - (cachedBits)) >> 3; \
+	(cache) |= LOADBE64(buf) >> (cachedBits); \
+	(buf) += nBytes; \
+	(cachedBits) += nBytes << 3; \
+	(bitsLeft) -= nBytes << 3; \
+}
+
+/**************************************************************************************
+ * Function:    DecodePairsLookahead
+ *
+ * Description: decode as many pairs as possible with the lookahead tables, stopping 
+ *                before the last bytes of the bitstream
+ *
+ * Inputs:      pointer to xy buffer to received decoded values
+ *              pointer to number of values to decode
+ *              index of Huffman table to use (not table 0 or an invalid table)
+ *              number of bits remaining in bitstream
+ *              pointer to start of pair-wise codes, bit offset (0-7) into buf[0]
+ *
+ * Outputs:     pairs of decoded coefficients in xy
+ *              nVals updated with the number of values left to decode
+ *
+ * Return:      number of bits used
+ *
+ * Notes:       a pair is only decoded when every bit it could take (longest codeword, 
+ *                sign bits and linbits) is already in the cache, so it never reads 
+ *                past the end of the bitstream and can't run out of bits 
+ *              the last few pairs are left to the 32-bit decoder in DecodeHuffmanPairs, 
+ *                which handles running out of bits exactly as before
+ *              one lookup of HUFF_LOOK_BITS bits gives codeword, values and sign bits for 
+ *                most pairs, longer codewords and escapes fall back to huffTable
+ **************************************************************************************/
+static int DecodePairsLookahead(int *xy, int *nVals, int tabIdx, int bitsLeft, unsigned char *buf, int bitOffset)
+{
+	int n, x, y, cw, len, maxBits, minBits, linBits, cachedBits, startBits;
+	const unsigned short *look, *tBase, *tCurr;
+	unsigned long long cache;
+
+	look = huffLookTable + huffLookOffset[tabIdx];
+	tBase = huffTable + huffTabOffset[tabIdx];
+	linBits = (huffTabLookup[tabIdx].tabType == loopLinbits ? huffTabLookup[tabIdx].linBits : 0);
+
+	/* longest pair: codeword, linbits for x and y, and 2 sign bits */
+	minBits = HUFF_MAX_CWBITS + 2*linBits + 2;
+
+	/* initially fill cache with any partial byte */
+	startBits = bitsLeft;
+	cache = 0;
+	cachedBits = (8 - bitOffset) & 0x07;
+	if (cachedBits)
+		cache = (unsigned long long)(*buf++) << (64 - cachedBits);
+	bitsLeft -= cachedBits;
+
+	n = *nVals;
+	while (n > 0) {
+		if (cachedBits < HUFF_LOOK_BITS) {
+			if (bitsLeft < 64)
+				break;
+			RefillCache64(cache, cachedBits, buf, bitsLeft);
+		}
+
+		cw = look[cache >> (64 - HUFF_LOOK_BITS)];
+		len = GetHLen(cw);
+		if (!LookMoreBits(cw)) {
+			/* codeword and signs in one lookup */
+			cache <<= len;
+			cachedBits -= len;
+			xy[0] = (int)(GetCWX(cw) | LookSignX(cw));
+			xy[1] = (int)(GetCWY(cw) | LookSignY(cw));
+			xy += 2;
+			n -= 2;
+			continue;
+		}
+
+		/* the top of the cache doesn't change, so cw is still valid after refilling */
+		if (cachedBits < minBits) {
+			if (bitsLeft < 64)
+				break;
+			RefillCache64(cache, cachedBits, buf, bitsLeft);
+		}
+
+		if (!len) {
+			/* long codeword, walk the Huffman tables */
+			tCurr = tBase;
+			do {
+				maxBits = GetMaxbits(tCurr[0]);
+				cw = tCurr[(int)(cache >> (64 - maxBits)) + 1];
+				len = GetHLen(cw);
+				if (!len) {
+					cache <<= maxBits;
+					cachedBits -= maxBits;
+					tCurr += cw;
+				}
+			} while (!len);
+		}
+		cache <<= len;
+		cachedBits -= len;
+
+		x = GetCWX(cw);
+		y = GetCWY(cw);
+		if (x == 15 && linBits) {
+			x += (int)(cache >> (64 - linBits));
+			cache <<= linBits;
+			cachedBits -= linBits;
+		}
+		if (x)	{ x |= (int)(cache >> 32) & 0x80000000; cache <<= 1; cachedBits--; }
+		if (y == 15 && linBits) {
+			y += (int)(cache >> (64 - linBits));
+			cache <<= linBits;
+			cachedBits -= linBits;
+		}
+		if (y)	{ y |= (int)(cache >> 32) & 0x80000000; cache <<= 1; cachedBits--; }
+
+		xy[0] = x;
+		xy[1] = y;
+		xy += 2;
+		n -= 2;
+	}
+
+	*nVals = n;
+	return startBits - (bitsLeft + cachedBits);
+}
+
+/**************************************************************************************
+ * Function:    DecodeQuadsLookahead
+ *
+ * Description: decode as many quads as possible with the lookahead tables, stopping 
+ *                before the last bytes of the bitstream
+ *
+ * Inputs:      pointer to vwxy buffer to received decoded values
+ *              pointer to number of values decoded so far (0)
+ *              maximum number of values to decode
+ *              index of quadword table (0 = table A, 1 = table B)
+ *              number of bits remaining in bitstream
+ *              pointer to start of quadword codes, bit offset (0-7) into buf[0]
+ *
+ * Outputs:     quadruples of decoded coefficients in vwxy
+ *              i updated with the number of values decoded
+ *
+ * Return:      number of bits used
+ *
+ * Notes:       codeword and sign bits always fit in one lookup (at most 10 bits)
+ *              same as DecodePairsLookahead, the last few quads are left to the 
+ *                32-bit decoder in DecodeHuffmanQuads
+ **************************************************************************************/
+static int DecodeQuadsLookahead(int *vwxy, int *i, int nVals, int tabIdx, int bitsLeft, unsigned char *buf, int bitOffset)
+{
+	int n, cw, len, lookBits, cachedBits, startBits;
+	const unsigned short *look;
+	unsigned long long cache;
+
+	look = quadLookTable + quadLookOffset[tabIdx];
+	lookBits = quadLookBits[tabIdx];
+
+	/* initially fill cache with any partial byte */
+	startBits = bitsLeft;
+	cache = 0;
+	cachedBits = (8 - bitOffset) & 0x07;
+	if (cachedBits)
+		cache = (unsigned long long)(*buf++) << (64 - cachedBits);
+	bitsLeft -= cachedBits;
+
+	n = *i;
+	while (n < (nVals - 3)) {
+		if (cachedBits < lookBits) {
+			if (bitsLeft < 64)
+				break;
+			RefillCache64(cache, cachedBits, buf, bitsLeft);
+		}
+
+		cw = look[cache >> (64 - lookBits)];
+		len = GetHLen(cw);
+		cache <<= len;
+		cachedBits -= len;
+
+		vwxy[0] = LookQuad(cw, 0);
+		vwxy[1] = LookQuad(cw, 1);
+		vwxy[2] = LookQuad(cw, 2);
+		vwxy[3] = LookQuad(cw, 3);
+		vwxy += 4;
+		n += 4;
+	}
+
+	*i = n;
+	return startBits - (bitsLeft + cachedBits);
+}
+
 /**************************************************************************************
  * Function:    DecodeHuffmanPairs
  *
@@ -76,12 +274,14 @@
  * Return:      number of bits used, or -1 if out of bits
  *
  * Notes:       assumes that nVals is an even number
+ *              most pairs are decoded by DecodePairsLookahead, the loops below only 
+ *                see the last bytes of the bitstream (where running out of bits is checked)
  *              si_huff.bit tests every Huffman codeword in every table (though not
  *                necessarily all linBits outputs for x,y > 15)
  **************************************************************************************/
 static int DecodeHuffmanPairs(int *xy, int nVals, int tabIdx, int bitsLeft, unsigned char *buf, int bitOffset)
 {
-	int i, x, y;
+	int i, x, y, nLeft, bitsUsed;
 	int cachedBits, padBits, len, startBits, linBits, maxBits, minBits;
 	HuffTabType tabType;
 	unsigned short cw, *tBase, *tCurr;
@@ -103,6 +303,17 @@ static int DecodeHuffmanPairs(int *xy, int nVals, int tabIdx, int bitsLeft, unsi
 	ASSERT(tabIdx >= 0);
 	ASSERT(tabType != invalidTab);
 
+	if (tabType == oneShot || tabType == loopLinbits || tabType == loopNoLinbits) {
+		/* bulk of the pairs, the code below only drains the last bytes */
+		nLeft = nVals;
+		bitsUsed = DecodePairsLookahead(xy, &nLeft, tabIdx, bitsLeft, buf, bitOffset);
+		xy += nVals - nLeft;
+		nVals = nLeft;
+		buf += (bitsUsed + bitOffset) >> 3;
+		bitOffset = (bitsUsed + bitOffset) & 0x07;
+		bitsLeft -= bitsUsed;
+	}
+
 	/* initially fill cache with any partial byte */
 	cache = 0;
 	cachedBits = (8 - bitOffset) & 0x07;
@@ -280,12 +491,14 @@ static int DecodeHuffmanPairs(int *xy, int nVals, int tabIdx, int bitsLeft, unsi
  * Return:      index of the first "zero_part" value (index of the first sample 
  *                of the quad word after which all samples are 0)
  * 
- * Notes:        si_huff.bit tests every vwxy output in both quad tables
+ * Notes:        most quads are decoded by DecodeQuadsLookahead, the loop below only 
+ *                 sees the last bytes of the bitstream
+ *               si_huff.bit tests every vwxy output in both quad tables
  **************************************************************************************/
 static int DecodeHuffmanQuads(int *vwxy, int nVals, int tabIdx, int bitsLeft, unsigned char *buf, int bitOffset)
 {
 	int i, v, w, x, y;
-	int len, maxBits, cachedBits, padBits;
+	int len, maxBits, cachedBits, padBits, bitsUsed;
 	unsigned int cache;
 	unsigned char cw, *tBase;
 
@@ -295,6 +508,14 @@ static int DecodeHuffmanQuads(int *vwxy, int nVals, int tabIdx, int bitsLeft, un
 	tBase = (unsigned char *)quadTable + quadTabOffset[tabIdx];
 	maxBits = quadTabMaxBits[tabIdx];
 
+	/* bulk of the quads, the code below only drains the last bytes */
+	i = 0;
+	bitsUsed = DecodeQuadsLookahead(vwxy, &i, nVals, tabIdx, bitsLeft, buf, bitOffset);
+	vwxy += i;
+	buf += (bitsUsed + bitOffset) >> 3;
+	bitOffset = (bitsUsed + bitOffset) & 0x07;
+	bitsLeft -= bitsUsed;
+
 	/* initially fill cache with any partial byte */
 	cache = 0;
 	cachedBits = (8 - bitOffset) & 0x07;
@@ -302,7 +523,7 @@ static int DecodeHuffmanQuads(int *vwxy, int nVals, int tabIdx, int bitsLeft, un
 		cache = (unsigned int)(*buf++) << (32 - cachedBits);
 	bitsLeft -= cachedBits;
 
-	i = padBits = 0;
+	padBits = 0;
 	while (i < (nVals - 3)) {
 		/* refill cache - assumes cachedBits <= 16 */
 		if (bitsLeft >= 16) {
@@ -383,7 +604,6 @@ int DecodeHuffman(MP3DecInfo *mp3DecInfo, unsigned char *buf, int *bitOffset, in
 	FrameHeader *fh;
 	SideInfo *si;
 	SideInfoSub *sis;
-	ScaleFactorInfo *sfi;
 	HuffmanInfo *hi;
 
 	/* validate pointers */
@@ -393,7 +613,6 @@ int DecodeHuffman(MP3DecInfo *mp3DecInfo, unsigned char *buf, int *bitOffset, in
 	fh = ((FrameHeader *)(mp3DecInfo->FrameHeaderPS));
 	si = ((SideInfo *)(mp3DecInfo->SideInfoPS));
 	sis = &si->sis[gr][ch];
-	sfi = ((ScaleFactorInfo *)(mp3DecInfo->ScaleFactorInfoPS));
 	hi = (HuffmanInfo*)(mp3DecInfo->HuffmanInfoPS);
 
 	if (huffBlockBits < 0)
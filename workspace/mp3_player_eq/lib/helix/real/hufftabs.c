@@ -0,0 +1,2944 @@
+/* ***** BEGIN LICENSE BLOCK ***** 
+ * Version: RCSL 1.0/RPSL 1.0 
+ *  
+ * Portions Copyright (c) 1995-2002 RealNetworks, Inc. All Rights Reserved. 
+ *      
+ * The contents of this file, and the files included with this file, are 
+ * subject to the current version of the RealNetworks Public Source License 
+ * Version 1.0 (the "RPSL") available at 
+ * http://www.helixcommunity.org/content/rpsl unless you have licensed 
+ * the file under the RealNetworks Community Source License Version 1.0 
+ * (the "RCSL") available at http://www.helixcommunity.org/content/rcsl, 
+ * in which case the RCSL will apply. You may also obtain the license terms 
+ * directly from RealNetworks.  You may not use this file except in 
+ * compliance with the RPSL or, if you have a valid RCSL with RealNetworks 
+ * applicable to this file, the RCSL.  Please see the applicable RPSL or 
+ * RCSL for the rights, obligations and limitations governing use of the 
+ * contents of the file.  
+ *  
+ * This file is part of the Helix DNA Technology. RealNetworks is the 
+ * developer of the Original Code and owns the copyrights in the portions 
+ * it created. 
+ *  
+ * This file, and the files included with this file, is distributed and made 
+ * available on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER 
+ * EXPRESS OR IMPLIED, AND REALNETWORKS HEREBY DISCLAIMS ALL SUCH WARRANTIES, 
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY, FITNESS 
+ * FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT. 
+ * 
+ * Technology Compatibility Kit Test Suite(s) Location: 
+ *    http://www.helixcommunity.org/content/tck 
+ * 
+ * Contributor(s): 
+ *  
+ * ***** END LICENSE BLOCK ***** */ 
+
+/**************************************************************************************
+ * Fixed-point MP3 decoder
+ * Jon Recker (jrecker@real.com), Ken Cooke (kenc@real.com)
+ * June 2003
+ *
+ * hufftabs.c - compressed Huffman code tables
+ **************************************************************************************/
+
+#include "coder.h"
+
+/* NOTE - regenerated tables to use shorts instead of ints 
+ *        (all needed data can fit in 16 bits - see below)
+ *
+ * format 0xABCD
+ *  A = length of codeword
+ *  B = y value
+ *  C = x value
+ *  D = number of sign bits (0, 1, or 2)
+ *
+ * to read a CW, the code reads maxbits from the stream (dep. on 
+ *   table index), but doesn't remove them from the bitstream reader
+ * then it gets the correct CW by direct lookup into the table
+ *   of length (2^maxbits) (more complicated for non-oneShot...)
+ * for CW's with hlen < maxbits, there are multiple entries in the 
+ *   table (extra bits are don't cares)
+ * the bitstream reader then "purges" (or removes) only the correct
+ *   number of bits for the chosen CW
+ *
+ * entries starting with F are special: D (signbits) is maxbits,
+ *   so the decoder always checks huffTableXX[0] first, gets the 
+ *   signbits, and reads that many bits from the bitstream
+ *   (sometimes it takes > 1 read to get the value, so maxbits is
+ *    can get updated by jumping to another value starting with 0xF)
+ * entries starting with 0 are also special: A = hlen = 0, rest of 
+ *   value is an offset to jump higher in the table (for tables of 
+ *   type loopNoLinbits or loopLinbits)
+ */
+
+/* store Huffman codes as one big table plus table of offsets, since some platforms
+ *   don't properly support table-of-tables (table of pointers to other const tables)
+ */
+const unsigned short huffTable[] = {
+	/* huffTable01[9] */
+	0xf003, 0x3112, 0x3101, 0x2011, 0x2011, 0x1000, 0x1000, 0x1000, 
+	0x1000, 
+
+	/* huffTable02[65] */
+	0xf006, 0x6222, 0x6201, 0x5212, 0x5212, 0x5122, 0x5122, 0x5021, 
+	0x5021, 0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 
+	0x3112, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 
+	0x3101, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 
+	0x3011, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 
+
+	/* huffTable03[65] */
+	0xf006, 0x6222, 0x6201, 0x5212, 0x5212, 0x5122, 0x5122, 0x5021, 
+	0x5021, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 
+	0x3011, 0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 
+	0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 
+	0x2112, 0x2101, 0x2101, 0x2101, 0x2101, 0x2101, 0x2101, 0x2101, 
+	0x2101, 0x2101, 0x2101, 0x2101, 0x2101, 0x2101, 0x2101, 0x2101, 
+	0x2101, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 
+	
+	/* huffTable05[257] */
+	0xf008, 0x8332, 0x8322, 0x7232, 0x7232, 0x6132, 0x6132, 0x6132, 
+	0x6132, 0x7312, 0x7312, 0x7301, 0x7301, 0x7031, 0x7031, 0x7222, 
+	0x7222, 0x6212, 0x6212, 0x6212, 0x6212, 0x6122, 0x6122, 0x6122, 
+	0x6122, 0x6201, 0x6201, 0x6201, 0x6201, 0x6021, 0x6021, 0x6021, 
+	0x6021, 0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 
+	0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 
+	0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 
+	0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 
+	0x3112, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 
+	0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 
+	0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 
+	0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 
+	0x3101, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 
+	0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 
+	0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 
+	0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 
+	0x3011, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 
+
+	/* huffTable06[129] */
+	0xf007, 0x7332, 0x7301, 0x6322, 0x6322, 0x6232, 0x6232, 0x6031, 
+	0x6031, 0x5312, 0x5312, 0x5312, 0x5312, 0x5132, 0x5132, 0x5132, 
+	0x5132, 0x5222, 0x5222, 0x5222, 0x5222, 0x5201, 0x5201, 0x5201, 
+	0x5201, 0x4212, 0x4212, 0x4212, 0x4212, 0x4212, 0x4212, 0x4212, 
+	0x4212, 0x4122, 0x4122, 0x4122, 0x4122, 0x4122, 0x4122, 0x4122, 
+	0x4122, 0x4021, 0x4021, 0x4021, 0x4021, 0x4021, 0x4021, 0x4021, 
+	0x4021, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 
+	0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 
+	0x3101, 0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 
+	0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 
+	0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 
+	0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 
+	0x2112, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 
+	0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 
+	0x3011, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 
+
+	/* huffTable07[110] */
+	0xf006, 0x0041, 0x0052, 0x005b, 0x0060, 0x0063, 0x0068, 0x006b, 
+	0x6212, 0x5122, 0x5122, 0x6201, 0x6021, 0x4112, 0x4112, 0x4112, 
+	0x4112, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 
+	0x3101, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 
+	0x3011, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0xf004, 0x4552, 0x4542, 0x4452, 0x4352, 0x3532, 0x3532, 
+	0x3442, 0x3442, 0x3522, 0x3522, 0x3252, 0x3252, 0x2512, 0x2512, 
+	0x2512, 0x2512, 0xf003, 0x2152, 0x2152, 0x3501, 0x3432, 0x2051, 
+	0x2051, 0x3342, 0x3332, 0xf002, 0x2422, 0x2242, 0x1412, 0x1412, 
+	0xf001, 0x1142, 0x1041, 0xf002, 0x2401, 0x2322, 0x2232, 0x2301, 
+	0xf001, 0x1312, 0x1132, 0xf001, 0x1031, 0x1222, 
+
+	/* huffTable08[280] */
+	0xf008, 0x0101, 0x010a, 0x010f, 0x8512, 0x8152, 0x0112, 0x0115, 
+	0x8422, 0x8242, 0x8412, 0x7142, 0x7142, 0x8401, 0x8041, 0x8322, 
+	0x8232, 0x8312, 0x8132, 0x8301, 0x8031, 0x6222, 0x6222, 0x6222, 
+	0x6222, 0x6201, 0x6201, 0x6201, 0x6201, 0x6021, 0x6021, 0x6021, 
+	0x6021, 0x4212, 0x4212, 0x4212, 0x4212, 0x4212, 0x4212, 0x4212, 
+	0x4212, 0x4212, 0x4212, 0x4212, 0x4212, 0x4212, 0x4212, 0x4212, 
+	0x4212, 0x4122, 0x4122, 0x4122, 0x4122, 0x4122, 0x4122, 0x4122, 
+	0x4122, 0x4122, 0x4122, 0x4122, 0x4122, 0x4122, 0x4122, 0x4122, 
+	0x4122, 0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 
+	0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 
+	0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 
+	0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 
+	0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 
+	0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 
+	0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 
+	0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 0x2112, 
+	0x2112, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 
+	0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 
+	0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 
+	0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 
+	0x3101, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 
+	0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 
+	0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 
+	0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 
+	0x3011, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0xf003, 0x3552, 0x3452, 0x2542, 0x2542, 0x1352, 0x1352, 
+	0x1352, 0x1352, 0xf002, 0x2532, 0x2442, 0x1522, 0x1522, 0xf001, 
+	0x1252, 0x1501, 0xf001, 0x1432, 0x1342, 0xf001, 0x1051, 0x1332, 
+
+	/* huffTable09[93] */
+	0xf006, 0x0041, 0x004a, 0x004f, 0x0052, 0x0057, 0x005a, 0x6412, 
+	0x6142, 0x6322, 0x6232, 0x5312, 0x5312, 0x5132, 0x5132, 0x6301, 
+	0x6031, 0x5222, 0x5222, 0x5201, 0x5201, 0x4212, 0x4212, 0x4212, 
+	0x4212, 0x4122, 0x4122, 0x4122, 0x4122, 0x4021, 0x4021, 0x4021, 
+	0x4021, 0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 
+	0x3112, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 
+	0x3101, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 
+	0x3011, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0xf003, 0x3552, 0x3542, 0x2532, 0x2532, 0x2352, 0x2352, 
+	0x3452, 0x3501, 0xf002, 0x2442, 0x2522, 0x2252, 0x2512, 0xf001, 
+	0x1152, 0x1432, 0xf002, 0x1342, 0x1342, 0x2051, 0x2401, 0xf001, 
+	0x1422, 0x1242, 0xf001, 0x1332, 0x1041, 
+
+	/* huffTable10[320] */
+	0xf008, 0x0101, 0x010a, 0x010f, 0x0118, 0x011b, 0x0120, 0x0125, 
+	0x8712, 0x8172, 0x012a, 0x012d, 0x0132, 0x8612, 0x8162, 0x8061, 
+	0x0137, 0x013a, 0x013d, 0x8412, 0x8142, 0x8041, 0x8322, 0x8232, 
+	0x8301, 0x7312, 0x7312, 0x7132, 0x7132, 0x7031, 0x7031, 0x7222, 
+	0x7222, 0x6212, 0x6212, 0x6212, 0x6212, 0x6122, 0x6122, 0x6122, 
+	0x6122, 0x6201, 0x6201, 0x6201, 0x6201, 0x6021, 0x6021, 0x6021, 
+	0x6021, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 
+	0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 
+	0x4112, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 
+	0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 
+	0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 
+	0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 
+	0x3101, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 
+	0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 
+	0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 
+	0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 
+	0x3011, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0xf003, 0x3772, 0x3762, 0x3672, 0x3752, 0x3572, 0x3662, 
+	0x2742, 0x2742, 0xf002, 0x2472, 0x2652, 0x2562, 0x2732, 0xf003, 
+	0x2372, 0x2372, 0x2642, 0x2642, 0x3552, 0x3452, 0x2362, 0x2362, 
+	0xf001, 0x1722, 0x1272, 0xf002, 0x2462, 0x2701, 0x1071, 0x1071, 
+	0xf002, 0x1262, 0x1262, 0x2542, 0x2532, 0xf002, 0x1601, 0x1601, 
+	0x2352, 0x2442, 0xf001, 0x1632, 0x1622, 0xf002, 0x2522, 0x2252, 
+	0x1512, 0x1512, 0xf002, 0x1152, 0x1152, 0x2432, 0x2342, 0xf001, 
+	0x1501, 0x1051, 0xf001, 0x1422, 0x1242, 0xf001, 0x1332, 0x1401, 
+
+	/* huffTable11[296] */
+	0xf008, 0x0101, 0x0106, 0x010f, 0x0114, 0x0117, 0x8722, 0x8272, 
+	0x011c, 0x7172, 0x7172, 0x8712, 0x8071, 0x8632, 0x8362, 0x8061, 
+	0x011f, 0x0122, 0x8512, 0x7262, 0x7262, 0x8622, 0x8601, 0x7612, 
+	0x7612, 0x7162, 0x7162, 0x8152, 0x8432, 0x8051, 0x0125, 0x8422, 
+	0x8242, 0x8412, 0x8142, 0x8401, 0x8041, 0x7322, 0x7322, 0x7232, 
+	0x7232, 0x6312, 0x6312, 0x6312, 0x6312, 0x6132, 0x6132, 0x6132, 
+	0x6132, 0x7301, 0x7301, 0x7031, 0x7031, 0x6222, 0x6222, 0x6222, 
+	0x6222, 0x5122, 0x5122, 0x5122, 0x5122, 0x5122, 0x5122, 0x5122, 
+	0x5122, 0x4212, 0x4212, 0x4212, 0x4212, 0x4212, 0x4212, 0x4212, 
+	0x4212, 0x4212, 0x4212, 0x4212, 0x4212, 0x4212, 0x4212, 0x4212, 
+	0x4212, 0x5201, 0x5201, 0x5201, 0x5201, 0x5201, 0x5201, 0x5201, 
+	0x5201, 0x5021, 0x5021, 0x5021, 0x5021, 0x5021, 0x5021, 0x5021, 
+	0x5021, 0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 
+	0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 
+	0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 
+	0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 
+	0x3112, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 
+	0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 
+	0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 
+	0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 
+	0x3101, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 
+	0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 
+	0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 
+	0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 
+	0x3011, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0xf002, 0x2772, 0x2762, 0x2672, 0x2572, 0xf003, 0x2662, 
+	0x2662, 0x2742, 0x2742, 0x2472, 0x2472, 0x3752, 0x3552, 0xf002, 
+	0x2652, 0x2562, 0x1732, 0x1732, 0xf001, 0x1372, 0x1642, 0xf002, 
+	0x2542, 0x2452, 0x2532, 0x2352, 0xf001, 0x1462, 0x1701, 0xf001, 
+	0x1442, 0x1522, 0xf001, 0x1252, 0x1501, 0xf001, 0x1342, 0x1332, 
+
+	/* huffTable12[185] */
+	0xf007, 0x0081, 0x008a, 0x008f, 0x0092, 0x0097, 0x009a, 0x009d, 
+	0x00a2, 0x00a5, 0x00a8, 0x7622, 0x7262, 0x7162, 0x00ad, 0x00b0, 
+	0x00b3, 0x7512, 0x7152, 0x7432, 0x7342, 0x00b6, 0x7422, 0x7242, 
+	0x7412, 0x6332, 0x6332, 0x6142, 0x6142, 0x6322, 0x6322, 0x6232, 
+	0x6232, 0x7041, 0x7301, 0x6031, 0x6031, 0x5312, 0x5312, 0x5312, 
+	0x5312, 0x5132, 0x5132, 0x5132, 0x5132, 0x5222, 0x5222, 0x5222, 
+	0x5222, 0x4212, 0x4212, 0x4212, 0x4212, 0x4212, 0x4212, 0x4212, 
+	0x4212, 0x4122, 0x4122, 0x4122, 0x4122, 0x4122, 0x4122, 0x4122, 
+	0x4122, 0x5201, 0x5201, 0x5201, 0x5201, 0x5021, 0x5021, 0x5021, 
+	0x5021, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 
+	0x4000, 0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 
+	0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 
+	0x3112, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 
+	0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 0x3101, 
+	0x3101, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 
+	0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 
+	0x3011, 0xf003, 0x3772, 0x3762, 0x2672, 0x2672, 0x2752, 0x2752, 
+	0x2572, 0x2572, 0xf002, 0x2662, 0x2742, 0x2472, 0x2562, 0xf001, 
+	0x1652, 0x1732, 0xf002, 0x2372, 0x2552, 0x1722, 0x1722, 0xf001, 
+	0x1272, 0x1642, 0xf001, 0x1462, 0x1712, 0xf002, 0x1172, 0x1172, 
+	0x2701, 0x2071, 0xf001, 0x1632, 0x1362, 0xf001, 0x1542, 0x1452, 
+	0xf002, 0x1442, 0x1442, 0x2601, 0x2501, 0xf001, 0x1612, 0x1061, 
+	0xf001, 0x1532, 0x1352, 0xf001, 0x1522, 0x1252, 0xf001, 0x1051, 
+	0x1401, 
+
+	/* huffTable13[497] */
+	0xf006, 0x0041, 0x0082, 0x00c3, 0x00e4, 0x0105, 0x0116, 0x011f, 
+	0x0130, 0x0139, 0x013e, 0x0143, 0x0146, 0x6212, 0x6122, 0x6201, 
+	0x6021, 0x4112, 0x4112, 0x4112, 0x4112, 0x4101, 0x4101, 0x4101, 
+	0x4101, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 
+	0x3011, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0xf006, 0x0108, 0x0111, 0x011a, 0x0123, 0x012c, 0x0131, 
+	0x0136, 0x013f, 0x0144, 0x0147, 0x014c, 0x0151, 0x0156, 0x015b, 
+	0x6f12, 0x61f2, 0x60f1, 0x0160, 0x0163, 0x0166, 0x62e2, 0x0169, 
+	0x6e12, 0x61e2, 0x016c, 0x016f, 0x0172, 0x0175, 0x0178, 0x017b, 
+	0x66c2, 0x6d32, 0x017e, 0x6d22, 0x62d2, 0x6d12, 0x67b2, 0x0181, 
+	0x0184, 0x63c2, 0x0187, 0x6b42, 0x51d2, 0x51d2, 0x6d01, 0x60d1, 
+	0x6a82, 0x68a2, 0x6c42, 0x64c2, 0x6b62, 0x66b2, 0x5c32, 0x5c32, 
+	0x5c22, 0x5c22, 0x52c2, 0x52c2, 0x5b52, 0x5b52, 0x65b2, 0x6982, 
+	0x5c12, 0x5c12, 0xf006, 0x51c2, 0x51c2, 0x6892, 0x6c01, 0x50c1, 
+	0x50c1, 0x64b2, 0x6a62, 0x66a2, 0x6972, 0x5b32, 0x5b32, 0x53b2, 
+	0x53b2, 0x6882, 0x6a52, 0x5b22, 0x5b22, 0x65a2, 0x6962, 0x54a2, 
+	0x54a2, 0x6872, 0x6782, 0x5492, 0x5492, 0x6772, 0x6672, 0x42b2, 
+	0x42b2, 0x42b2, 0x42b2, 0x4b12, 0x4b12, 0x4b12, 0x4b12, 0x41b2, 
+	0x41b2, 0x41b2, 0x41b2, 0x5b01, 0x5b01, 0x50b1, 0x50b1, 0x5692, 
+	0x5692, 0x5a42, 0x5a42, 0x5a32, 0x5a32, 0x53a2, 0x53a2, 0x5952, 
+	0x5952, 0x5592, 0x5592, 0x4a22, 0x4a22, 0x4a22, 0x4a22, 0x42a2, 
+	0x42a2, 0x42a2, 0x42a2, 0xf005, 0x4a12, 0x4a12, 0x41a2, 0x41a2, 
+	0x5a01, 0x5862, 0x40a1, 0x40a1, 0x5682, 0x5942, 0x4392, 0x4392, 
+	0x5932, 0x5852, 0x5582, 0x5762, 0x4922, 0x4922, 0x4292, 0x4292, 
+	0x5752, 0x5572, 0x4832, 0x4832, 0x4382, 0x4382, 0x5662, 0x5742, 
+	0x5472, 0x5652, 0x5562, 0x5372, 0xf005, 0x3912, 0x3912, 0x3912, 
+	0x3912, 0x3192, 0x3192, 0x3192, 0x3192, 0x4901, 0x4901, 0x4091, 
+	0x4091, 0x4842, 0x4842, 0x4482, 0x4482, 0x4272, 0x4272, 0x5642, 
+	0x5462, 0x3822, 0x3822, 0x3822, 0x3822, 0x3282, 0x3282, 0x3282, 
+	0x3282, 0x3812, 0x3812, 0x3812, 0x3812, 0xf004, 0x4732, 0x4722, 
+	0x3712, 0x3712, 0x3172, 0x3172, 0x4552, 0x4701, 0x4071, 0x4632, 
+	0x4362, 0x4542, 0x4452, 0x4622, 0x4262, 0x4532, 0xf003, 0x2182, 
+	0x2182, 0x3801, 0x3081, 0x3612, 0x3162, 0x3601, 0x3061, 0xf004, 
+	0x4352, 0x4442, 0x3522, 0x3522, 0x3252, 0x3252, 0x3501, 0x3501, 
+	0x2512, 0x2512, 0x2512, 0x2512, 0x2152, 0x2152, 0x2152, 0x2152, 
+	0xf003, 0x3432, 0x3342, 0x3051, 0x3422, 0x3242, 0x3332, 0x2412, 
+	0x2412, 0xf002, 0x1142, 0x1142, 0x2401, 0x2041, 0xf002, 0x2322, 
+	0x2232, 0x1312, 0x1312, 0xf001, 0x1132, 0x1301, 0xf001, 0x1031, 
+	0x1222, 0xf003, 0x0082, 0x008b, 0x008e, 0x0091, 0x0094, 0x0097, 
+	0x3ce2, 0x3dd2, 0xf003, 0x0093, 0x3eb2, 0x3be2, 0x3f92, 0x39f2, 
+	0x3ae2, 0x3db2, 0x3bd2, 0xf003, 0x3f82, 0x38f2, 0x3cc2, 0x008d, 
+	0x3e82, 0x0090, 0x27f2, 0x27f2, 0xf003, 0x2ad2, 0x2ad2, 0x3da2, 
+	0x3cb2, 0x3bc2, 0x36f2, 0x2f62, 0x2f62, 0xf002, 0x28e2, 0x2f52, 
+	0x2d92, 0x29d2, 0xf002, 0x25f2, 0x27e2, 0x2ca2, 0x2bb2, 0xf003, 
+	0x2f42, 0x2f42, 0x24f2, 0x24f2, 0x3ac2, 0x36e2, 0x23f2, 0x23f2, 
+	0xf002, 0x1f32, 0x1f32, 0x2d82, 0x28d2, 0xf001, 0x1f22, 0x12f2, 
+	0xf002, 0x2e62, 0x2c92, 0x1f01, 0x1f01, 0xf002, 0x29c2, 0x2e52, 
+	0x1ba2, 0x1ba2, 0xf002, 0x2d72, 0x27d2, 0x1e42, 0x1e42, 0xf002, 
+	0x28c2, 0x26d2, 0x1e32, 0x1e32, 0xf002, 0x19b2, 0x19b2, 0x2b92, 
+	0x2aa2, 0xf001, 0x1ab2, 0x15e2, 0xf001, 0x14e2, 0x1c82, 0xf001, 
+	0x1d62, 0x13e2, 0xf001, 0x1e22, 0x1e01, 0xf001, 0x10e1, 0x1d52, 
+	0xf001, 0x15d2, 0x1c72, 0xf001, 0x17c2, 0x1d42, 0xf001, 0x1b82, 
+	0x18b2, 0xf001, 0x14d2, 0x1a92, 0xf001, 0x19a2, 0x1c62, 0xf001, 
+	0x13d2, 0x1b72, 0xf001, 0x1c52, 0x15c2, 0xf001, 0x1992, 0x1a72, 
+	0xf001, 0x17a2, 0x1792, 0xf003, 0x0023, 0x3df2, 0x2de2, 0x2de2, 
+	0x1ff2, 0x1ff2, 0x1ff2, 0x1ff2, 0xf001, 0x1fe2, 0x1fd2, 0xf001, 
+	0x1ee2, 0x1fc2, 0xf001, 0x1ed2, 0x1fb2, 0xf001, 0x1bf2, 0x1ec2, 
+	0xf002, 0x1cd2, 0x1cd2, 0x2fa2, 0x29e2, 0xf001, 0x1af2, 0x1dc2, 
+	0xf001, 0x1ea2, 0x1e92, 0xf001, 0x1f72, 0x1e72, 0xf001, 0x1ef2, 
+	0x1cf2, 
+
+	/* huffTable15[580] */
+	0xf008, 0x0101, 0x0122, 0x0143, 0x0154, 0x0165, 0x0176, 0x017f, 
+	0x0188, 0x0199, 0x01a2, 0x01ab, 0x01b4, 0x01bd, 0x01c2, 0x01cb, 
+	0x01d4, 0x01d9, 0x01de, 0x01e3, 0x01e8, 0x01ed, 0x01f2, 0x01f7, 
+	0x01fc, 0x0201, 0x0204, 0x0207, 0x020a, 0x020f, 0x0212, 0x0215, 
+	0x021a, 0x021d, 0x0220, 0x8192, 0x0223, 0x0226, 0x0229, 0x022c, 
+	0x022f, 0x8822, 0x8282, 0x8812, 0x8182, 0x0232, 0x0235, 0x0238, 
+	0x023b, 0x8722, 0x8272, 0x8462, 0x8712, 0x8552, 0x8172, 0x023e, 
+	0x8632, 0x8362, 0x8542, 0x8452, 0x8622, 0x8262, 0x8612, 0x0241, 
+	0x8532, 0x7162, 0x7162, 0x8352, 0x8442, 0x7522, 0x7522, 0x7252, 
+	0x7252, 0x7512, 0x7512, 0x7152, 0x7152, 0x8501, 0x8051, 0x7432, 
+	0x7432, 0x7342, 0x7342, 0x7422, 0x7422, 0x7242, 0x7242, 0x7332, 
+	0x7332, 0x6142, 0x6142, 0x6142, 0x6142, 0x7412, 0x7412, 0x7401, 
+	0x7401, 0x6322, 0x6322, 0x6322, 0x6322, 0x6232, 0x6232, 0x6232, 
+	0x6232, 0x7041, 0x7041, 0x7301, 0x7301, 0x6312, 0x6312, 0x6312, 
+	0x6312, 0x6132, 0x6132, 0x6132, 0x6132, 0x6031, 0x6031, 0x6031, 
+	0x6031, 0x5222, 0x5222, 0x5222, 0x5222, 0x5222, 0x5222, 0x5222, 
+	0x5222, 0x5212, 0x5212, 0x5212, 0x5212, 0x5212, 0x5212, 0x5212, 
+	0x5212, 0x5122, 0x5122, 0x5122, 0x5122, 0x5122, 0x5122, 0x5122, 
+	0x5122, 0x5201, 0x5201, 0x5201, 0x5201, 0x5201, 0x5201, 0x5201, 
+	0x5201, 0x5021, 0x5021, 0x5021, 0x5021, 0x5021, 0x5021, 0x5021, 
+	0x5021, 0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 
+	0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 
+	0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 
+	0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 0x3112, 
+	0x3112, 0x4101, 0x4101, 0x4101, 0x4101, 0x4101, 0x4101, 0x4101, 
+	0x4101, 0x4101, 0x4101, 0x4101, 0x4101, 0x4101, 0x4101, 0x4101, 
+	0x4101, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0xf005, 0x5ff2, 0x5fe2, 0x5ef2, 0x5fd2, 0x4ee2, 0x4ee2, 
+	0x5df2, 0x5fc2, 0x5cf2, 0x5ed2, 0x5de2, 0x5fb2, 0x4bf2, 0x4bf2, 
+	0x5ec2, 0x5ce2, 0x4dd2, 0x4dd2, 0x4fa2, 0x4fa2, 0x4af2, 0x4af2, 
+	0x4eb2, 0x4eb2, 0x4be2, 0x4be2, 0x4dc2, 0x4dc2, 0x4cd2, 0x4cd2, 
+	0x4f92, 0x4f92, 0xf005, 0x49f2, 0x49f2, 0x4ae2, 0x4ae2, 0x4db2, 
+	0x4db2, 0x4bd2, 0x4bd2, 0x4f82, 0x4f82, 0x48f2, 0x48f2, 0x4cc2, 
+	0x4cc2, 0x4e92, 0x4e92, 0x49e2, 0x49e2, 0x4f72, 0x4f72, 0x47f2, 
+	0x47f2, 0x4da2, 0x4da2, 0x4ad2, 0x4ad2, 0x4cb2, 0x4cb2, 0x4f62, 
+	0x4f62, 0x5ea2, 0x5f01, 0xf004, 0x3bc2, 0x3bc2, 0x36f2, 0x36f2, 
+	0x4e82, 0x48e2, 0x4f52, 0x4d92, 0x35f2, 0x35f2, 0x3e72, 0x3e72, 
+	0x37e2, 0x37e2, 0x3ca2, 0x3ca2, 0xf004, 0x3ac2, 0x3ac2, 0x3bb2, 
+	0x3bb2, 0x49d2, 0x4d82, 0x3f42, 0x3f42, 0x34f2, 0x34f2, 0x3f32, 
+	0x3f32, 0x33f2, 0x33f2, 0x38d2, 0x38d2, 0xf004, 0x36e2, 0x36e2, 
+	0x3f22, 0x3f22, 0x32f2, 0x32f2, 0x4e62, 0x40f1, 0x3f12, 0x3f12, 
+	0x31f2, 0x31f2, 0x3c92, 0x3c92, 0x39c2, 0x39c2, 0xf003, 0x3e52, 
+	0x3ba2, 0x3ab2, 0x35e2, 0x3d72, 0x37d2, 0x3e42, 0x34e2, 0xf003, 
+	0x3c82, 0x38c2, 0x3e32, 0x3d62, 0x36d2, 0x33e2, 0x3b92, 0x39b2, 
+	0xf004, 0x3e22, 0x3e22, 0x3aa2, 0x3aa2, 0x32e2, 0x32e2, 0x3e12, 
+	0x3e12, 0x31e2, 0x31e2, 0x4e01, 0x40e1, 0x3d52, 0x3d52, 0x35d2, 
+	0x35d2, 0xf003, 0x3c72, 0x37c2, 0x3d42, 0x3b82, 0x24d2, 0x24d2, 
+	0x38b2, 0x3a92, 0xf003, 0x39a2, 0x3c62, 0x36c2, 0x3d32, 0x23d2, 
+	0x23d2, 0x22d2, 0x22d2, 0xf003, 0x3d22, 0x3d01, 0x2d12, 0x2d12, 
+	0x2b72, 0x2b72, 0x27b2, 0x27b2, 0xf003, 0x21d2, 0x21d2, 0x3c52, 
+	0x30d1, 0x25c2, 0x25c2, 0x2a82, 0x2a82, 0xf002, 0x28a2, 0x2c42, 
+	0x24c2, 0x2b62, 0xf003, 0x26b2, 0x26b2, 0x3992, 0x3c01, 0x2c32, 
+	0x2c32, 0x23c2, 0x23c2, 0xf003, 0x2a72, 0x2a72, 0x27a2, 0x27a2, 
+	0x26a2, 0x26a2, 0x30c1, 0x3b01, 0xf002, 0x12c2, 0x12c2, 0x2c22, 
+	0x2b52, 0xf002, 0x25b2, 0x2c12, 0x2982, 0x2892, 0xf002, 0x21c2, 
+	0x2b42, 0x24b2, 0x2a62, 0xf002, 0x2b32, 0x2972, 0x13b2, 0x13b2, 
+	0xf002, 0x2792, 0x2882, 0x2b22, 0x2a52, 0xf002, 0x12b2, 0x12b2, 
+	0x25a2, 0x2b12, 0xf002, 0x11b2, 0x11b2, 0x20b1, 0x2962, 0xf002, 
+	0x2692, 0x2a42, 0x24a2, 0x2872, 0xf002, 0x2782, 0x2a32, 0x13a2, 
+	0x13a2, 0xf001, 0x1952, 0x1592, 0xf001, 0x1a22, 0x12a2, 0xf001, 
+	0x1a12, 0x11a2, 0xf002, 0x2a01, 0x20a1, 0x1862, 0x1862, 0xf001, 
+	0x1682, 0x1942, 0xf001, 0x1492, 0x1932, 0xf002, 0x1392, 0x1392, 
+	0x2772, 0x2901, 0xf001, 0x1852, 0x1582, 0xf001, 0x1922, 0x1762, 
+	0xf001, 0x1672, 0x1292, 0xf001, 0x1912, 0x1091, 0xf001, 0x1842, 
+	0x1482, 0xf001, 0x1752, 0x1572, 0xf001, 0x1832, 0x1382, 0xf001, 
+	0x1662, 0x1742, 0xf001, 0x1472, 0x1801, 0xf001, 0x1081, 0x1652, 
+	0xf001, 0x1562, 0x1732, 0xf001, 0x1372, 0x1642, 0xf001, 0x1701, 
+	0x1071, 0xf001, 0x1601, 0x1061, 
+
+	/* huffTable16[651] */
+	0xf008, 0x0101, 0x010a, 0x0113, 0x8ff2, 0x0118, 0x011d, 0x0120, 
+	0x82f2, 0x0131, 0x8f12, 0x81f2, 0x0134, 0x0145, 0x0156, 0x0167, 
+	0x0178, 0x0189, 0x019a, 0x01a3, 0x01ac, 0x01b5, 0x01be, 0x01c7, 
+	0x01d0, 0x01d9, 0x01de, 0x01e3, 0x01e6, 0x01eb, 0x01f0, 0x8152, 
+	0x01f3, 0x01f6, 0x01f9, 0x01fc, 0x8412, 0x8142, 0x01ff, 0x8322, 
+	0x8232, 0x7312, 0x7312, 0x7132, 0x7132, 0x8301, 0x8031, 0x7222, 
+	0x7222, 0x6212, 0x6212, 0x6212, 0x6212, 0x6122, 0x6122, 0x6122, 
+	0x6122, 0x6201, 0x6201, 0x6201, 0x6201, 0x6021, 0x6021, 0x6021, 
+	0x6021, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 
+	0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 
+	0x4112, 0x4101, 0x4101, 0x4101, 0x4101, 0x4101, 0x4101, 0x4101, 
+	0x4101, 0x4101, 0x4101, 0x4101, 0x4101, 0x4101, 0x4101, 0x4101, 
+	0x4101, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 
+	0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 
+	0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 
+	0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 
+	0x3011, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0xf003, 0x3fe2, 0x3ef2, 0x3fd2, 0x3df2, 0x3fc2, 0x3cf2, 
+	0x3fb2, 0x3bf2, 0xf003, 0x2fa2, 0x2fa2, 0x3af2, 0x3f92, 0x39f2, 
+	0x38f2, 0x2f82, 0x2f82, 0xf002, 0x2f72, 0x27f2, 0x2f62, 0x26f2, 
+	0xf002, 0x2f52, 0x25f2, 0x1f42, 0x1f42, 0xf001, 0x14f2, 0x13f2, 
+	0xf004, 0x10f1, 0x10f1, 0x10f1, 0x10f1, 0x10f1, 0x10f1, 0x10f1, 
+	0x10f1, 0x2f32, 0x2f32, 0x2f32, 0x2f32, 0x00e2, 0x00f3, 0x00fc, 
+	0x0105, 0xf001, 0x1f22, 0x1f01, 0xf004, 0x00fa, 0x00ff, 0x0104, 
+	0x0109, 0x010c, 0x0111, 0x0116, 0x0119, 0x011e, 0x0123, 0x0128, 
+	0x43e2, 0x012d, 0x0130, 0x0133, 0x0136, 0xf004, 0x0128, 0x012b, 
+	0x012e, 0x4d01, 0x0131, 0x0134, 0x0137, 0x4c32, 0x013a, 0x4c12, 
+	0x40c1, 0x013d, 0x32e2, 0x32e2, 0x4e22, 0x4e12, 0xf004, 0x43d2, 
+	0x4d22, 0x42d2, 0x41d2, 0x4b32, 0x012f, 0x3d12, 0x3d12, 0x44c2, 
+	0x4b62, 0x43c2, 0x47a2, 0x3c22, 0x3c22, 0x42c2, 0x45b2, 0xf004, 
+	0x41c2, 0x4c01, 0x4b42, 0x44b2, 0x4a62, 0x46a2, 0x33b2, 0x33b2, 
+	0x4a52, 0x45a2, 0x3b22, 0x3b22, 0x32b2, 0x32b2, 0x3b12, 0x3b12, 
+	0xf004, 0x31b2, 0x31b2, 0x4b01, 0x40b1, 0x4962, 0x4692, 0x4a42, 
+	0x44a2, 0x4872, 0x4782, 0x33a2, 0x33a2, 0x4a32, 0x4952, 0x3a22, 
+	0x3a22, 0xf004, 0x4592, 0x4862, 0x31a2, 0x31a2, 0x4682, 0x4772, 
+	0x3492, 0x3492, 0x4942, 0x4752, 0x3762, 0x3762, 0x22a2, 0x22a2, 
+	0x22a2, 0x22a2, 0xf003, 0x2a12, 0x2a12, 0x3a01, 0x30a1, 0x3932, 
+	0x3392, 0x3852, 0x3582, 0xf003, 0x2922, 0x2922, 0x2292, 0x2292, 
+	0x3672, 0x3901, 0x2912, 0x2912, 0xf003, 0x2192, 0x2192, 0x3091, 
+	0x3842, 0x3482, 0x3572, 0x3832, 0x3382, 0xf003, 0x3662, 0x3822, 
+	0x2282, 0x2282, 0x3742, 0x3472, 0x2812, 0x2812, 0xf003, 0x2182, 
+	0x2182, 0x2081, 0x2081, 0x3801, 0x3652, 0x2732, 0x2732, 0xf003, 
+	0x2372, 0x2372, 0x3562, 0x3642, 0x2722, 0x2722, 0x2272, 0x2272, 
+	0xf003, 0x3462, 0x3552, 0x2701, 0x2701, 0x1712, 0x1712, 0x1712, 
+	0x1712, 0xf002, 0x1172, 0x1172, 0x2071, 0x2632, 0xf002, 0x2362, 
+	0x2542, 0x2452, 0x2622, 0xf001, 0x1262, 0x1612, 0xf002, 0x1162, 
+	0x1162, 0x2601, 0x2061, 0xf002, 0x1352, 0x1352, 0x2532, 0x2442, 
+	0xf001, 0x1522, 0x1252, 0xf001, 0x1512, 0x1501, 0xf001, 0x1432, 
+	0x1342, 0xf001, 0x1051, 0x1422, 0xf001, 0x1242, 0x1332, 0xf001, 
+	0x1401, 0x1041, 0xf004, 0x4ec2, 0x0086, 0x3ed2, 0x3ed2, 0x39e2, 
+	0x39e2, 0x4ae2, 0x49d2, 0x2ee2, 0x2ee2, 0x2ee2, 0x2ee2, 0x3de2, 
+	0x3de2, 0x3be2, 0x3be2, 0xf003, 0x2eb2, 0x2eb2, 0x2dc2, 0x2dc2, 
+	0x3cd2, 0x3bd2, 0x2ea2, 0x2ea2, 0xf003, 0x2cc2, 0x2cc2, 0x3da2, 
+	0x3ad2, 0x3e72, 0x3ca2, 0x2ac2, 0x2ac2, 0xf003, 0x39c2, 0x3d72, 
+	0x2e52, 0x2e52, 0x1db2, 0x1db2, 0x1db2, 0x1db2, 0xf002, 0x1e92, 
+	0x1e92, 0x2cb2, 0x2bc2, 0xf002, 0x2e82, 0x28e2, 0x2d92, 0x27e2, 
+	0xf002, 0x2bb2, 0x2d82, 0x28d2, 0x2e62, 0xf001, 0x16e2, 0x1c92, 
+	0xf002, 0x2ba2, 0x2ab2, 0x25e2, 0x27d2, 0xf002, 0x1e42, 0x1e42, 
+	0x24e2, 0x2c82, 0xf001, 0x18c2, 0x1e32, 0xf002, 0x1d62, 0x1d62, 
+	0x26d2, 0x2b92, 0xf002, 0x29b2, 0x2aa2, 0x11e2, 0x11e2, 0xf002, 
+	0x14d2, 0x14d2, 0x28b2, 0x29a2, 0xf002, 0x1b72, 0x1b72, 0x27b2, 
+	0x20d1, 0xf001, 0x1e01, 0x10e1, 0xf001, 0x1d52, 0x15d2, 0xf001, 
+	0x1c72, 0x17c2, 0xf001, 0x1d42, 0x1b82, 0xf001, 0x1a92, 0x1c62, 
+	0xf001, 0x16c2, 0x1d32, 0xf001, 0x1c52, 0x15c2, 0xf001, 0x1a82, 
+	0x18a2, 0xf001, 0x1992, 0x1c42, 0xf001, 0x16b2, 0x1a72, 0xf001, 
+	0x1b52, 0x1982, 0xf001, 0x1892, 0x1972, 0xf001, 0x1792, 0x1882, 
+	0xf001, 0x1ce2, 0x1dd2, 
+
+	/* huffTable24[705] */
+	0xf009, 0x8fe2, 0x8fe2, 0x8ef2, 0x8ef2, 0x8fd2, 0x8fd2, 0x8df2, 
+	0x8df2, 0x8fc2, 0x8fc2, 0x8cf2, 0x8cf2, 0x8fb2, 0x8fb2, 0x8bf2, 
+	0x8bf2, 0x7af2, 0x7af2, 0x7af2, 0x7af2, 0x8fa2, 0x8fa2, 0x8f92, 
+	0x8f92, 0x79f2, 0x79f2, 0x79f2, 0x79f2, 0x78f2, 0x78f2, 0x78f2, 
+	0x78f2, 0x8f82, 0x8f82, 0x8f72, 0x8f72, 0x77f2, 0x77f2, 0x77f2, 
+	0x77f2, 0x7f62, 0x7f62, 0x7f62, 0x7f62, 0x76f2, 0x76f2, 0x76f2, 
+	0x76f2, 0x7f52, 0x7f52, 0x7f52, 0x7f52, 0x75f2, 0x75f2, 0x75f2, 
+	0x75f2, 0x7f42, 0x7f42, 0x7f42, 0x7f42, 0x74f2, 0x74f2, 0x74f2, 
+	0x74f2, 0x7f32, 0x7f32, 0x7f32, 0x7f32, 0x73f2, 0x73f2, 0x73f2, 
+	0x73f2, 0x7f22, 0x7f22, 0x7f22, 0x7f22, 0x72f2, 0x72f2, 0x72f2, 
+	0x72f2, 0x71f2, 0x71f2, 0x71f2, 0x71f2, 0x8f12, 0x8f12, 0x80f1, 
+	0x80f1, 0x9f01, 0x0201, 0x0206, 0x020b, 0x0210, 0x0215, 0x021a, 
+	0x021f, 0x4ff2, 0x4ff2, 0x4ff2, 0x4ff2, 0x4ff2, 0x4ff2, 0x4ff2, 
+	0x4ff2, 0x4ff2, 0x4ff2, 0x4ff2, 0x4ff2, 0x4ff2, 0x4ff2, 0x4ff2, 
+	0x4ff2, 0x4ff2, 0x4ff2, 0x4ff2, 0x4ff2, 0x4ff2, 0x4ff2, 0x4ff2, 
+	0x4ff2, 0x4ff2, 0x4ff2, 0x4ff2, 0x4ff2, 0x4ff2, 0x4ff2, 0x4ff2, 
+	0x4ff2, 0x0224, 0x0229, 0x0232, 0x0237, 0x023a, 0x023f, 0x0242, 
+	0x0245, 0x024a, 0x024d, 0x0250, 0x0253, 0x0256, 0x0259, 0x025c, 
+	0x025f, 0x0262, 0x0265, 0x0268, 0x026b, 0x026e, 0x0271, 0x0274, 
+	0x0277, 0x027a, 0x027d, 0x0280, 0x0283, 0x0288, 0x028b, 0x028e, 
+	0x0291, 0x0294, 0x0297, 0x029a, 0x029f, 0x94b2, 0x02a4, 0x02a7, 
+	0x02aa, 0x93b2, 0x9882, 0x02af, 0x92b2, 0x02b2, 0x02b5, 0x9692, 
+	0x94a2, 0x02b8, 0x9782, 0x9a32, 0x93a2, 0x9952, 0x9592, 0x9a22, 
+	0x92a2, 0x91a2, 0x9862, 0x9682, 0x9772, 0x9942, 0x9492, 0x9932, 
+	0x9392, 0x9852, 0x9582, 0x9922, 0x9762, 0x9672, 0x9292, 0x9912, 
+	0x9192, 0x9842, 0x9482, 0x9752, 0x9572, 0x9832, 0x9382, 0x9662, 
+	0x9822, 0x9282, 0x9812, 0x9742, 0x9472, 0x9182, 0x02bb, 0x9652, 
+	0x9562, 0x9712, 0x02be, 0x8372, 0x8372, 0x9732, 0x9722, 0x8272, 
+	0x8272, 0x8642, 0x8642, 0x8462, 0x8462, 0x8552, 0x8552, 0x8172, 
+	0x8172, 0x8632, 0x8632, 0x8362, 0x8362, 0x8542, 0x8542, 0x8452, 
+	0x8452, 0x8622, 0x8622, 0x8262, 0x8262, 0x8612, 0x8612, 0x8162, 
+	0x8162, 0x9601, 0x9061, 0x8532, 0x8532, 0x8352, 0x8352, 0x8442, 
+	0x8442, 0x8522, 0x8522, 0x8252, 0x8252, 0x8512, 0x8512, 0x9501, 
+	0x9051, 0x7152, 0x7152, 0x7152, 0x7152, 0x8432, 0x8432, 0x8342, 
+	0x8342, 0x7422, 0x7422, 0x7422, 0x7422, 0x7242, 0x7242, 0x7242, 
+	0x7242, 0x7332, 0x7332, 0x7332, 0x7332, 0x7412, 0x7412, 0x7412, 
+	0x7412, 0x7142, 0x7142, 0x7142, 0x7142, 0x8401, 0x8401, 0x8041, 
+	0x8041, 0x7322, 0x7322, 0x7322, 0x7322, 0x7232, 0x7232, 0x7232, 
+	0x7232, 0x6312, 0x6312, 0x6312, 0x6312, 0x6312, 0x6312, 0x6312, 
+	0x6312, 0x6132, 0x6132, 0x6132, 0x6132, 0x6132, 0x6132, 0x6132, 
+	0x6132, 0x7301, 0x7301, 0x7301, 0x7301, 0x7031, 0x7031, 0x7031, 
+	0x7031, 0x6222, 0x6222, 0x6222, 0x6222, 0x6222, 0x6222, 0x6222, 
+	0x6222, 0x5212, 0x5212, 0x5212, 0x5212, 0x5212, 0x5212, 0x5212, 
+	0x5212, 0x5212, 0x5212, 0x5212, 0x5212, 0x5212, 0x5212, 0x5212, 
+	0x5212, 0x5122, 0x5122, 0x5122, 0x5122, 0x5122, 0x5122, 0x5122, 
+	0x5122, 0x5122, 0x5122, 0x5122, 0x5122, 0x5122, 0x5122, 0x5122, 
+	0x5122, 0x6201, 0x6201, 0x6201, 0x6201, 0x6201, 0x6201, 0x6201, 
+	0x6201, 0x6021, 0x6021, 0x6021, 0x6021, 0x6021, 0x6021, 0x6021, 
+	0x6021, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 
+	0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 
+	0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 
+	0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 
+	0x4112, 0x4101, 0x4101, 0x4101, 0x4101, 0x4101, 0x4101, 0x4101, 
+	0x4101, 0x4101, 0x4101, 0x4101, 0x4101, 0x4101, 0x4101, 0x4101, 
+	0x4101, 0x4101, 0x4101, 0x4101, 0x4101, 0x4101, 0x4101, 0x4101, 
+	0x4101, 0x4101, 0x4101, 0x4101, 0x4101, 0x4101, 0x4101, 0x4101, 
+	0x4101, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 
+	0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 
+	0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 
+	0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 
+	0x4000, 0xf002, 0x2ee2, 0x2ed2, 0x2de2, 0x2ec2, 0xf002, 0x2ce2, 
+	0x2dd2, 0x2eb2, 0x2be2, 0xf002, 0x2dc2, 0x2cd2, 0x2ea2, 0x2ae2, 
+	0xf002, 0x2db2, 0x2bd2, 0x2cc2, 0x2e92, 0xf002, 0x29e2, 0x2da2, 
+	0x2ad2, 0x2cb2, 0xf002, 0x2bc2, 0x2e82, 0x28e2, 0x2d92, 0xf002, 
+	0x29d2, 0x2e72, 0x27e2, 0x2ca2, 0xf002, 0x2ac2, 0x2bb2, 0x2d82, 
+	0x28d2, 0xf003, 0x3e01, 0x30e1, 0x2d01, 0x2d01, 0x16e2, 0x16e2, 
+	0x16e2, 0x16e2, 0xf002, 0x2e62, 0x2c92, 0x19c2, 0x19c2, 0xf001, 
+	0x1e52, 0x1ab2, 0xf002, 0x15e2, 0x15e2, 0x2ba2, 0x2d72, 0xf001, 
+	0x17d2, 0x14e2, 0xf001, 0x1c82, 0x18c2, 0xf002, 0x2e42, 0x2e22, 
+	0x1e32, 0x1e32, 0xf001, 0x1d62, 0x16d2, 0xf001, 0x13e2, 0x1b92, 
+	0xf001, 0x19b2, 0x1aa2, 0xf001, 0x12e2, 0x1e12, 0xf001, 0x11e2, 
+	0x1d52, 0xf001, 0x15d2, 0x1c72, 0xf001, 0x17c2, 0x1d42, 0xf001, 
+	0x1b82, 0x18b2, 0xf001, 0x14d2, 0x1a92, 0xf001, 0x19a2, 0x1c62, 
+	0xf001, 0x16c2, 0x1d32, 0xf001, 0x13d2, 0x1d22, 0xf001, 0x12d2, 
+	0x1d12, 0xf001, 0x1b72, 0x17b2, 0xf001, 0x11d2, 0x1c52, 0xf001, 
+	0x15c2, 0x1a82, 0xf001, 0x18a2, 0x1992, 0xf001, 0x1c42, 0x14c2, 
+	0xf001, 0x1b62, 0x16b2, 0xf002, 0x20d1, 0x2c01, 0x1c32, 0x1c32, 
+	0xf001, 0x13c2, 0x1a72, 0xf001, 0x17a2, 0x1c22, 0xf001, 0x12c2, 
+	0x1b52, 0xf001, 0x15b2, 0x1c12, 0xf001, 0x1982, 0x1892, 0xf001, 
+	0x11c2, 0x1b42, 0xf002, 0x20c1, 0x2b01, 0x1b32, 0x1b32, 0xf002, 
+	0x20b1, 0x2a01, 0x1a12, 0x1a12, 0xf001, 0x1a62, 0x16a2, 0xf001, 
+	0x1972, 0x1792, 0xf002, 0x20a1, 0x2901, 0x1091, 0x1091, 0xf001, 
+	0x1b22, 0x1a52, 0xf001, 0x15a2, 0x1b12, 0xf001, 0x11b2, 0x1962, 
+	0xf001, 0x1a42, 0x1872, 0xf001, 0x1801, 0x1081, 0xf001, 0x1701, 
+	0x1071, 
+};
+
+#define HUFF_OFFSET_01	 0
+#define HUFF_OFFSET_02	(  9 + HUFF_OFFSET_01)
+#define HUFF_OFFSET_03	( 65 + HUFF_OFFSET_02)
+#define HUFF_OFFSET_05	( 65 + HUFF_OFFSET_03)
+#define HUFF_OFFSET_06	(257 + HUFF_OFFSET_05)
+#define HUFF_OFFSET_07	(129 + HUFF_OFFSET_06)
+#define HUFF_OFFSET_08	(110 + HUFF_OFFSET_07)
+#define HUFF_OFFSET_09	(280 + HUFF_OFFSET_08)
+#define HUFF_OFFSET_10	( 93 + HUFF_OFFSET_09)
+#define HUFF_OFFSET_11	(320 + HUFF_OFFSET_10)
+#define HUFF_OFFSET_12	(296 + HUFF_OFFSET_11)
+#define HUFF_OFFSET_13	(185 + HUFF_OFFSET_12)
+#define HUFF_OFFSET_15	(497 + HUFF_OFFSET_13)
+#define HUFF_OFFSET_16	(580 + HUFF_OFFSET_15)
+#define HUFF_OFFSET_24	(651 + HUFF_OFFSET_16)
+
+const int huffTabOffset[HUFF_PAIRTABS] = {
+	0,          
+	HUFF_OFFSET_01,
+	HUFF_OFFSET_02,
+	HUFF_OFFSET_03,
+	0,          
+	HUFF_OFFSET_05,
+	HUFF_OFFSET_06,
+	HUFF_OFFSET_07,
+	HUFF_OFFSET_08,
+	HUFF_OFFSET_09,
+	HUFF_OFFSET_10,
+	HUFF_OFFSET_11,
+	HUFF_OFFSET_12,
+	HUFF_OFFSET_13,
+	0,          
+	HUFF_OFFSET_15,
+	HUFF_OFFSET_16,
+	HUFF_OFFSET_16,
+	HUFF_OFFSET_16,
+	HUFF_OFFSET_16,
+	HUFF_OFFSET_16,
+	HUFF_OFFSET_16,
+	HUFF_OFFSET_16,
+	HUFF_OFFSET_16,
+	HUFF_OFFSET_24,
+	HUFF_OFFSET_24,
+	HUFF_OFFSET_24,
+	HUFF_OFFSET_24,
+	HUFF_OFFSET_24,
+	HUFF_OFFSET_24,
+	HUFF_OFFSET_24,
+	HUFF_OFFSET_24,
+};
+
+const HuffTabLookup huffTabLookup[HUFF_PAIRTABS] = {
+	{ 0,  noBits },
+	{ 0,  oneShot },
+	{ 0,  oneShot },
+	{ 0,  oneShot },
+	{ 0,  invalidTab },
+	{ 0,  oneShot },
+	{ 0,  oneShot },
+	{ 0,  loopNoLinbits },
+	{ 0,  loopNoLinbits },
+	{ 0,  loopNoLinbits },
+	{ 0,  loopNoLinbits },
+	{ 0,  loopNoLinbits },
+	{ 0,  loopNoLinbits },
+	{ 0,  loopNoLinbits },
+	{ 0,  invalidTab },
+	{ 0,  loopNoLinbits },
+	{ 1,  loopLinbits },
+	{ 2,  loopLinbits },
+	{ 3,  loopLinbits },
+	{ 4,  loopLinbits },
+	{ 6,  loopLinbits },
+	{ 8,  loopLinbits },
+	{ 10, loopLinbits },
+	{ 13, loopLinbits },
+	{ 4,  loopLinbits },
+	{ 5,  loopLinbits },
+	{ 6,  loopLinbits },
+	{ 7,  loopLinbits },
+	{ 8,  loopLinbits },
+	{ 9,  loopLinbits },
+	{ 11, loopLinbits },
+	{ 13, loopLinbits },
+};
+
+/* tables for quadruples
+ * format 0xAB
+ *  A = length of codeword
+ *  B = codeword
+ */
+const unsigned char quadTable[64+16] = {
+	/* table A */
+	0x6b, 0x6f, 0x6d, 0x6e, 0x67, 0x65, 0x59, 0x59, 
+	0x56, 0x56, 0x53, 0x53, 0x5a, 0x5a, 0x5c, 0x5c, 
+	0x42, 0x42, 0x42, 0x42, 0x41, 0x41, 0x41, 0x41, 
+	0x44, 0x44, 0x44, 0x44, 0x48, 0x48, 0x48, 0x48, 
+	0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 
+	0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 
+	0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 
+	0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 
+	/* table B */
+	0x4f, 0x4e, 0x4d, 0x4c, 0x4b, 0x4a, 0x49, 0x48, 
+	0x47, 0x46, 0x45, 0x44, 0x43, 0x42, 0x41, 0x40, 
+};
+
+const int quadTabOffset[2] = {0, 64};
+const int quadTabMaxBits[2] = {6, 4};
+
+/* lookahead tables, derived from the tables above (one per pair code tree, and one per quad table)
+ * the decoder peeks HUFF_LOOK_BITS bits (quadLookBits for quads) and does a single lookup
+ *
+ * pair format 0xABCD
+ *  A = number of bits to remove from the bitstream
+ *  B = y value
+ *  C = x value
+ *  D = 0x8 clear: A includes the sign bits, bit 1 = sign of y, bit 0 = sign of x
+ *      0x8 set:   A is the codeword length only, sign bits (and linbits if x or y = 15 in 
+ *                 tables 16-31) follow in the bitstream
+ *                 A = 0 means the codeword is longer than HUFF_LOOK_BITS (walk huffTable instead)
+ */
+const unsigned short huffLookTable[] = {
+	/* huffLook01[1024] */
+	0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 
+	0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 
+	0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 
+	0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 
+	0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 
+	0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 
+	0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 
+	0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 
+	0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 
+	0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 
+	0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 
+	0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 
+	0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 
+	0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 
+	0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 
+	0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 
+	0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 
+	0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 
+	0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 
+	0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 
+	0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 
+	0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 
+	0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 
+	0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 
+	0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 
+	0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 
+	0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 
+	0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 
+	0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 
+	0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 
+	0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 0x3010, 
+	0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 
+	0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 
+	0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 
+	0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 
+	0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 
+	0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 
+	0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 
+	0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 
+	0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 
+	0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 
+	0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 
+	0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 
+	0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 
+	0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 
+	0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 
+	0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 0x3011, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+
+	/* huffLook02[1024] */
+	0x8220, 0x8220, 0x8220, 0x8220, 0x8222, 0x8222, 0x8222, 0x8222, 
+	0x8221, 0x8221, 0x8221, 0x8221, 0x8223, 0x8223, 0x8223, 0x8223, 
+	0x7200, 0x7200, 0x7200, 0x7200, 0x7200, 0x7200, 0x7200, 0x7200, 
+	0x7202, 0x7202, 0x7202, 0x7202, 0x7202, 0x7202, 0x7202, 0x7202, 
+	0x7210, 0x7210, 0x7210, 0x7210, 0x7210, 0x7210, 0x7210, 0x7210, 
+	0x7212, 0x7212, 0x7212, 0x7212, 0x7212, 0x7212, 0x7212, 0x7212, 
+	0x7211, 0x7211, 0x7211, 0x7211, 0x7211, 0x7211, 0x7211, 0x7211, 
+	0x7213, 0x7213, 0x7213, 0x7213, 0x7213, 0x7213, 0x7213, 0x7213, 
+	0x7120, 0x7120, 0x7120, 0x7120, 0x7120, 0x7120, 0x7120, 0x7120, 
+	0x7122, 0x7122, 0x7122, 0x7122, 0x7122, 0x7122, 0x7122, 0x7122, 
+	0x7121, 0x7121, 0x7121, 0x7121, 0x7121, 0x7121, 0x7121, 0x7121, 
+	0x7123, 0x7123, 0x7123, 0x7123, 0x7123, 0x7123, 0x7123, 0x7123, 
+	0x6020, 0x6020, 0x6020, 0x6020, 0x6020, 0x6020, 0x6020, 0x6020, 
+	0x6020, 0x6020, 0x6020, 0x6020, 0x6020, 0x6020, 0x6020, 0x6020, 
+	0x6021, 0x6021, 0x6021, 0x6021, 0x6021, 0x6021, 0x6021, 0x6021, 
+	0x6021, 0x6021, 0x6021, 0x6021, 0x6021, 0x6021, 0x6021, 0x6021, 
+	0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 
+	0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 
+	0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 
+	0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 
+	0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 
+	0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 
+	0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 
+	0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 
+	0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 
+	0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 
+	0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 
+	0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 
+	0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 
+	0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 
+	0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 
+	0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+
+	/* huffLook03[1024] */
+	0x8220, 0x8220, 0x8220, 0x8220, 0x8222, 0x8222, 0x8222, 0x8222, 
+	0x8221, 0x8221, 0x8221, 0x8221, 0x8223, 0x8223, 0x8223, 0x8223, 
+	0x7200, 0x7200, 0x7200, 0x7200, 0x7200, 0x7200, 0x7200, 0x7200, 
+	0x7202, 0x7202, 0x7202, 0x7202, 0x7202, 0x7202, 0x7202, 0x7202, 
+	0x7210, 0x7210, 0x7210, 0x7210, 0x7210, 0x7210, 0x7210, 0x7210, 
+	0x7212, 0x7212, 0x7212, 0x7212, 0x7212, 0x7212, 0x7212, 0x7212, 
+	0x7211, 0x7211, 0x7211, 0x7211, 0x7211, 0x7211, 0x7211, 0x7211, 
+	0x7213, 0x7213, 0x7213, 0x7213, 0x7213, 0x7213, 0x7213, 0x7213, 
+	0x7120, 0x7120, 0x7120, 0x7120, 0x7120, 0x7120, 0x7120, 0x7120, 
+	0x7122, 0x7122, 0x7122, 0x7122, 0x7122, 0x7122, 0x7122, 0x7122, 
+	0x7121, 0x7121, 0x7121, 0x7121, 0x7121, 0x7121, 0x7121, 0x7121, 
+	0x7123, 0x7123, 0x7123, 0x7123, 0x7123, 0x7123, 0x7123, 0x7123, 
+	0x6020, 0x6020, 0x6020, 0x6020, 0x6020, 0x6020, 0x6020, 0x6020, 
+	0x6020, 0x6020, 0x6020, 0x6020, 0x6020, 0x6020, 0x6020, 0x6020, 
+	0x6021, 0x6021, 0x6021, 0x6021, 0x6021, 0x6021, 0x6021, 0x6021, 
+	0x6021, 0x6021, 0x6021, 0x6021, 0x6021, 0x6021, 0x6021, 0x6021, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 
+	0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 
+	0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 
+	0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 
+	0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 
+	0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 
+	0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 
+	0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 
+	0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 
+	0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 
+	0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 
+	0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 
+	0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 
+	0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 
+	0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 
+	0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 
+	0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 
+	0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 
+	0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 
+	0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 
+	0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 
+	0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 
+	0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 
+	0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 
+	0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 
+	0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 
+	0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 
+	0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 
+	0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 
+	0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 
+	0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 
+	0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 
+	0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 
+	0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 
+	0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 
+	0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 
+	0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 
+	0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 
+	0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 
+	0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 
+	0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 
+	0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 
+	0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 
+	0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 
+	0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 
+	0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 
+	0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 
+	0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 0x3100, 
+	0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 
+	0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 
+	0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 
+	0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 
+	0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 
+	0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 
+	0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 
+	0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 
+	0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 
+	0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 
+	0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 
+	0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 
+	0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 
+	0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 
+	0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 
+	0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 0x3102, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+
+	/* huffLook05[1024] */
+	0xa330, 0xa332, 0xa331, 0xa333, 0xa320, 0xa322, 0xa321, 0xa323, 
+	0x9230, 0x9230, 0x9232, 0x9232, 0x9231, 0x9231, 0x9233, 0x9233, 
+	0x8130, 0x8130, 0x8130, 0x8130, 0x8132, 0x8132, 0x8132, 0x8132, 
+	0x8131, 0x8131, 0x8131, 0x8131, 0x8133, 0x8133, 0x8133, 0x8133, 
+	0x9310, 0x9310, 0x9312, 0x9312, 0x9311, 0x9311, 0x9313, 0x9313, 
+	0x8300, 0x8300, 0x8300, 0x8300, 0x8302, 0x8302, 0x8302, 0x8302, 
+	0x8030, 0x8030, 0x8030, 0x8030, 0x8031, 0x8031, 0x8031, 0x8031, 
+	0x9220, 0x9220, 0x9222, 0x9222, 0x9221, 0x9221, 0x9223, 0x9223, 
+	0x8210, 0x8210, 0x8210, 0x8210, 0x8212, 0x8212, 0x8212, 0x8212, 
+	0x8211, 0x8211, 0x8211, 0x8211, 0x8213, 0x8213, 0x8213, 0x8213, 
+	0x8120, 0x8120, 0x8120, 0x8120, 0x8122, 0x8122, 0x8122, 0x8122, 
+	0x8121, 0x8121, 0x8121, 0x8121, 0x8123, 0x8123, 0x8123, 0x8123, 
+	0x7200, 0x7200, 0x7200, 0x7200, 0x7200, 0x7200, 0x7200, 0x7200, 
+	0x7202, 0x7202, 0x7202, 0x7202, 0x7202, 0x7202, 0x7202, 0x7202, 
+	0x7020, 0x7020, 0x7020, 0x7020, 0x7020, 0x7020, 0x7020, 0x7020, 
+	0x7021, 0x7021, 0x7021, 0x7021, 0x7021, 0x7021, 0x7021, 0x7021, 
+	0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 
+	0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 
+	0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 
+	0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 
+	0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 
+	0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 
+	0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 
+	0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 
+	0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 
+	0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 
+	0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 
+	0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 
+	0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 
+	0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 
+	0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 
+	0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+
+	/* huffLook06[1024] */
+	0x9330, 0x9330, 0x9332, 0x9332, 0x9331, 0x9331, 0x9333, 0x9333, 
+	0x8300, 0x8300, 0x8300, 0x8300, 0x8302, 0x8302, 0x8302, 0x8302, 
+	0x8320, 0x8320, 0x8320, 0x8320, 0x8322, 0x8322, 0x8322, 0x8322, 
+	0x8321, 0x8321, 0x8321, 0x8321, 0x8323, 0x8323, 0x8323, 0x8323, 
+	0x8230, 0x8230, 0x8230, 0x8230, 0x8232, 0x8232, 0x8232, 0x8232, 
+	0x8231, 0x8231, 0x8231, 0x8231, 0x8233, 0x8233, 0x8233, 0x8233, 
+	0x7030, 0x7030, 0x7030, 0x7030, 0x7030, 0x7030, 0x7030, 0x7030, 
+	0x7031, 0x7031, 0x7031, 0x7031, 0x7031, 0x7031, 0x7031, 0x7031, 
+	0x7310, 0x7310, 0x7310, 0x7310, 0x7310, 0x7310, 0x7310, 0x7310, 
+	0x7312, 0x7312, 0x7312, 0x7312, 0x7312, 0x7312, 0x7312, 0x7312, 
+	0x7311, 0x7311, 0x7311, 0x7311, 0x7311, 0x7311, 0x7311, 0x7311, 
+	0x7313, 0x7313, 0x7313, 0x7313, 0x7313, 0x7313, 0x7313, 0x7313, 
+	0x7130, 0x7130, 0x7130, 0x7130, 0x7130, 0x7130, 0x7130, 0x7130, 
+	0x7132, 0x7132, 0x7132, 0x7132, 0x7132, 0x7132, 0x7132, 0x7132, 
+	0x7131, 0x7131, 0x7131, 0x7131, 0x7131, 0x7131, 0x7131, 0x7131, 
+	0x7133, 0x7133, 0x7133, 0x7133, 0x7133, 0x7133, 0x7133, 0x7133, 
+	0x7220, 0x7220, 0x7220, 0x7220, 0x7220, 0x7220, 0x7220, 0x7220, 
+	0x7222, 0x7222, 0x7222, 0x7222, 0x7222, 0x7222, 0x7222, 0x7222, 
+	0x7221, 0x7221, 0x7221, 0x7221, 0x7221, 0x7221, 0x7221, 0x7221, 
+	0x7223, 0x7223, 0x7223, 0x7223, 0x7223, 0x7223, 0x7223, 0x7223, 
+	0x6200, 0x6200, 0x6200, 0x6200, 0x6200, 0x6200, 0x6200, 0x6200, 
+	0x6200, 0x6200, 0x6200, 0x6200, 0x6200, 0x6200, 0x6200, 0x6200, 
+	0x6202, 0x6202, 0x6202, 0x6202, 0x6202, 0x6202, 0x6202, 0x6202, 
+	0x6202, 0x6202, 0x6202, 0x6202, 0x6202, 0x6202, 0x6202, 0x6202, 
+	0x6210, 0x6210, 0x6210, 0x6210, 0x6210, 0x6210, 0x6210, 0x6210, 
+	0x6210, 0x6210, 0x6210, 0x6210, 0x6210, 0x6210, 0x6210, 0x6210, 
+	0x6212, 0x6212, 0x6212, 0x6212, 0x6212, 0x6212, 0x6212, 0x6212, 
+	0x6212, 0x6212, 0x6212, 0x6212, 0x6212, 0x6212, 0x6212, 0x6212, 
+	0x6211, 0x6211, 0x6211, 0x6211, 0x6211, 0x6211, 0x6211, 0x6211, 
+	0x6211, 0x6211, 0x6211, 0x6211, 0x6211, 0x6211, 0x6211, 0x6211, 
+	0x6213, 0x6213, 0x6213, 0x6213, 0x6213, 0x6213, 0x6213, 0x6213, 
+	0x6213, 0x6213, 0x6213, 0x6213, 0x6213, 0x6213, 0x6213, 0x6213, 
+	0x6120, 0x6120, 0x6120, 0x6120, 0x6120, 0x6120, 0x6120, 0x6120, 
+	0x6120, 0x6120, 0x6120, 0x6120, 0x6120, 0x6120, 0x6120, 0x6120, 
+	0x6122, 0x6122, 0x6122, 0x6122, 0x6122, 0x6122, 0x6122, 0x6122, 
+	0x6122, 0x6122, 0x6122, 0x6122, 0x6122, 0x6122, 0x6122, 0x6122, 
+	0x6121, 0x6121, 0x6121, 0x6121, 0x6121, 0x6121, 0x6121, 0x6121, 
+	0x6121, 0x6121, 0x6121, 0x6121, 0x6121, 0x6121, 0x6121, 0x6121, 
+	0x6123, 0x6123, 0x6123, 0x6123, 0x6123, 0x6123, 0x6123, 0x6123, 
+	0x6123, 0x6123, 0x6123, 0x6123, 0x6123, 0x6123, 0x6123, 0x6123, 
+	0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 
+	0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 
+	0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 
+	0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 
+	0x5021, 0x5021, 0x5021, 0x5021, 0x5021, 0x5021, 0x5021, 0x5021, 
+	0x5021, 0x5021, 0x5021, 0x5021, 0x5021, 0x5021, 0x5021, 0x5021, 
+	0x5021, 0x5021, 0x5021, 0x5021, 0x5021, 0x5021, 0x5021, 0x5021, 
+	0x5021, 0x5021, 0x5021, 0x5021, 0x5021, 0x5021, 0x5021, 0x5021, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 
+	0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 
+	0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 
+	0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 
+	0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 
+	0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 
+	0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 
+	0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 
+	0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 
+	0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 
+	0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 
+	0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 
+	0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 
+	0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 
+	0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 
+	0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 
+	0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 
+	0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 
+	0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 
+	0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 
+	0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 
+	0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 
+	0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 
+	0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 
+	0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 
+	0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 
+	0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 
+	0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 
+	0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 
+	0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 
+	0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 
+	0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+
+	/* huffLook07[1024] */
+	0xa558, 0xa548, 0xa458, 0xa358, 0x9538, 0x9538, 0x9448, 0x9448, 
+	0x9528, 0x9528, 0x9258, 0x9258, 0xa510, 0xa512, 0xa511, 0xa513, 
+	0xa150, 0xa152, 0xa151, 0xa153, 0xa500, 0xa502, 0x9438, 0x9438, 
+	0x9050, 0x9050, 0x9051, 0x9051, 0x9348, 0x9348, 0x9338, 0x9338, 
+	0xa420, 0xa422, 0xa421, 0xa423, 0xa240, 0xa242, 0xa241, 0xa243, 
+	0x9410, 0x9410, 0x9412, 0x9412, 0x9411, 0x9411, 0x9413, 0x9413, 
+	0x9140, 0x9140, 0x9142, 0x9142, 0x9141, 0x9141, 0x9143, 0x9143, 
+	0x8040, 0x8040, 0x8040, 0x8040, 0x8041, 0x8041, 0x8041, 0x8041, 
+	0x9400, 0x9400, 0x9402, 0x9402, 0xa320, 0xa322, 0xa321, 0xa323, 
+	0xa230, 0xa232, 0xa231, 0xa233, 0x9300, 0x9300, 0x9302, 0x9302, 
+	0x9310, 0x9310, 0x9312, 0x9312, 0x9311, 0x9311, 0x9313, 0x9313, 
+	0x9130, 0x9130, 0x9132, 0x9132, 0x9131, 0x9131, 0x9133, 0x9133, 
+	0x8030, 0x8030, 0x8030, 0x8030, 0x8031, 0x8031, 0x8031, 0x8031, 
+	0x9220, 0x9220, 0x9222, 0x9222, 0x9221, 0x9221, 0x9223, 0x9223, 
+	0x8210, 0x8210, 0x8210, 0x8210, 0x8212, 0x8212, 0x8212, 0x8212, 
+	0x8211, 0x8211, 0x8211, 0x8211, 0x8213, 0x8213, 0x8213, 0x8213, 
+	0x7120, 0x7120, 0x7120, 0x7120, 0x7120, 0x7120, 0x7120, 0x7120, 
+	0x7122, 0x7122, 0x7122, 0x7122, 0x7122, 0x7122, 0x7122, 0x7122, 
+	0x7121, 0x7121, 0x7121, 0x7121, 0x7121, 0x7121, 0x7121, 0x7121, 
+	0x7123, 0x7123, 0x7123, 0x7123, 0x7123, 0x7123, 0x7123, 0x7123, 
+	0x7200, 0x7200, 0x7200, 0x7200, 0x7200, 0x7200, 0x7200, 0x7200, 
+	0x7202, 0x7202, 0x7202, 0x7202, 0x7202, 0x7202, 0x7202, 0x7202, 
+	0x7020, 0x7020, 0x7020, 0x7020, 0x7020, 0x7020, 0x7020, 0x7020, 
+	0x7021, 0x7021, 0x7021, 0x7021, 0x7021, 0x7021, 0x7021, 0x7021, 
+	0x6110, 0x6110, 0x6110, 0x6110, 0x6110, 0x6110, 0x6110, 0x6110, 
+	0x6110, 0x6110, 0x6110, 0x6110, 0x6110, 0x6110, 0x6110, 0x6110, 
+	0x6112, 0x6112, 0x6112, 0x6112, 0x6112, 0x6112, 0x6112, 0x6112, 
+	0x6112, 0x6112, 0x6112, 0x6112, 0x6112, 0x6112, 0x6112, 0x6112, 
+	0x6111, 0x6111, 0x6111, 0x6111, 0x6111, 0x6111, 0x6111, 0x6111, 
+	0x6111, 0x6111, 0x6111, 0x6111, 0x6111, 0x6111, 0x6111, 0x6111, 
+	0x6113, 0x6113, 0x6113, 0x6113, 0x6113, 0x6113, 0x6113, 0x6113, 
+	0x6113, 0x6113, 0x6113, 0x6113, 0x6113, 0x6113, 0x6113, 0x6113, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+
+	/* huffLook08[1024] */
+	0x0008, 0xa548, 0x9358, 0x9358, 0xa538, 0xa448, 0x9528, 0x9528, 
+	0x9258, 0x9258, 0xa500, 0xa502, 0xa510, 0xa512, 0xa511, 0xa513, 
+	0xa150, 0xa152, 0xa151, 0xa153, 0x9438, 0x9438, 0x9348, 0x9348, 
+	0xa050, 0xa051, 0x9338, 0x9338, 0xa420, 0xa422, 0xa421, 0xa423, 
+	0xa240, 0xa242, 0xa241, 0xa243, 0xa410, 0xa412, 0xa411, 0xa413, 
+	0x9140, 0x9140, 0x9142, 0x9142, 0x9141, 0x9141, 0x9143, 0x9143, 
+	0x9400, 0x9400, 0x9402, 0x9402, 0x9040, 0x9040, 0x9041, 0x9041, 
+	0xa320, 0xa322, 0xa321, 0xa323, 0xa230, 0xa232, 0xa231, 0xa233, 
+	0xa310, 0xa312, 0xa311, 0xa313, 0xa130, 0xa132, 0xa131, 0xa133, 
+	0x9300, 0x9300, 0x9302, 0x9302, 0x9030, 0x9030, 0x9031, 0x9031, 
+	0x8220, 0x8220, 0x8220, 0x8220, 0x8222, 0x8222, 0x8222, 0x8222, 
+	0x8221, 0x8221, 0x8221, 0x8221, 0x8223, 0x8223, 0x8223, 0x8223, 
+	0x7200, 0x7200, 0x7200, 0x7200, 0x7200, 0x7200, 0x7200, 0x7200, 
+	0x7202, 0x7202, 0x7202, 0x7202, 0x7202, 0x7202, 0x7202, 0x7202, 
+	0x7020, 0x7020, 0x7020, 0x7020, 0x7020, 0x7020, 0x7020, 0x7020, 
+	0x7021, 0x7021, 0x7021, 0x7021, 0x7021, 0x7021, 0x7021, 0x7021, 
+	0x6210, 0x6210, 0x6210, 0x6210, 0x6210, 0x6210, 0x6210, 0x6210, 
+	0x6210, 0x6210, 0x6210, 0x6210, 0x6210, 0x6210, 0x6210, 0x6210, 
+	0x6212, 0x6212, 0x6212, 0x6212, 0x6212, 0x6212, 0x6212, 0x6212, 
+	0x6212, 0x6212, 0x6212, 0x6212, 0x6212, 0x6212, 0x6212, 0x6212, 
+	0x6211, 0x6211, 0x6211, 0x6211, 0x6211, 0x6211, 0x6211, 0x6211, 
+	0x6211, 0x6211, 0x6211, 0x6211, 0x6211, 0x6211, 0x6211, 0x6211, 
+	0x6213, 0x6213, 0x6213, 0x6213, 0x6213, 0x6213, 0x6213, 0x6213, 
+	0x6213, 0x6213, 0x6213, 0x6213, 0x6213, 0x6213, 0x6213, 0x6213, 
+	0x6120, 0x6120, 0x6120, 0x6120, 0x6120, 0x6120, 0x6120, 0x6120, 
+	0x6120, 0x6120, 0x6120, 0x6120, 0x6120, 0x6120, 0x6120, 0x6120, 
+	0x6122, 0x6122, 0x6122, 0x6122, 0x6122, 0x6122, 0x6122, 0x6122, 
+	0x6122, 0x6122, 0x6122, 0x6122, 0x6122, 0x6122, 0x6122, 0x6122, 
+	0x6121, 0x6121, 0x6121, 0x6121, 0x6121, 0x6121, 0x6121, 0x6121, 
+	0x6121, 0x6121, 0x6121, 0x6121, 0x6121, 0x6121, 0x6121, 0x6121, 
+	0x6123, 0x6123, 0x6123, 0x6123, 0x6123, 0x6123, 0x6123, 0x6123, 
+	0x6123, 0x6123, 0x6123, 0x6123, 0x6123, 0x6123, 0x6123, 0x6123, 
+	0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 
+	0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 
+	0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 
+	0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 
+	0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 
+	0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 
+	0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 
+	0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 0x4110, 
+	0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 
+	0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 
+	0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 
+	0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 
+	0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 
+	0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 
+	0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 
+	0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 0x4112, 
+	0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 
+	0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 
+	0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 
+	0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 
+	0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 
+	0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 
+	0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 
+	0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 0x4111, 
+	0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 
+	0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 
+	0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 
+	0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 
+	0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 
+	0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 
+	0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 
+	0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 0x4113, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+
+	/* huffLook09[1024] */
+	0x9558, 0x9558, 0x9548, 0x9548, 0xa530, 0xa532, 0xa531, 0xa533, 
+	0xa350, 0xa352, 0xa351, 0xa353, 0x9458, 0x9458, 0xa500, 0xa502, 
+	0xa440, 0xa442, 0xa441, 0xa443, 0xa520, 0xa522, 0xa521, 0xa523, 
+	0xa250, 0xa252, 0xa251, 0xa253, 0xa510, 0xa512, 0xa511, 0xa513, 
+	0x9150, 0x9150, 0x9152, 0x9152, 0x9151, 0x9151, 0x9153, 0x9153, 
+	0x9430, 0x9430, 0x9432, 0x9432, 0x9431, 0x9431, 0x9433, 0x9433, 
+	0x9340, 0x9340, 0x9342, 0x9342, 0x9341, 0x9341, 0x9343, 0x9343, 
+	0x9050, 0x9050, 0x9051, 0x9051, 0x9400, 0x9400, 0x9402, 0x9402, 
+	0x9420, 0x9420, 0x9422, 0x9422, 0x9421, 0x9421, 0x9423, 0x9423, 
+	0x9240, 0x9240, 0x9242, 0x9242, 0x9241, 0x9241, 0x9243, 0x9243, 
+	0x9330, 0x9330, 0x9332, 0x9332, 0x9331, 0x9331, 0x9333, 0x9333, 
+	0x8040, 0x8040, 0x8040, 0x8040, 0x8041, 0x8041, 0x8041, 0x8041, 
+	0x8410, 0x8410, 0x8410, 0x8410, 0x8412, 0x8412, 0x8412, 0x8412, 
+	0x8411, 0x8411, 0x8411, 0x8411, 0x8413, 0x8413, 0x8413, 0x8413, 
+	0x8140, 0x8140, 0x8140, 0x8140, 0x8142, 0x8142, 0x8142, 0x8142, 
+	0x8141, 0x8141, 0x8141, 0x8141, 0x8143, 0x8143, 0x8143, 0x8143, 
+	0x8320, 0x8320, 0x8320, 0x8320, 0x8322, 0x8322, 0x8322, 0x8322, 
+	0x8321, 0x8321, 0x8321, 0x8321, 0x8323, 0x8323, 0x8323, 0x8323, 
+	0x8230, 0x8230, 0x8230, 0x8230, 0x8232, 0x8232, 0x8232, 0x8232, 
+	0x8231, 0x8231, 0x8231, 0x8231, 0x8233, 0x8233, 0x8233, 0x8233, 
+	0x7310, 0x7310, 0x7310, 0x7310, 0x7310, 0x7310, 0x7310, 0x7310, 
+	0x7312, 0x7312, 0x7312, 0x7312, 0x7312, 0x7312, 0x7312, 0x7312, 
+	0x7311, 0x7311, 0x7311, 0x7311, 0x7311, 0x7311, 0x7311, 0x7311, 
+	0x7313, 0x7313, 0x7313, 0x7313, 0x7313, 0x7313, 0x7313, 0x7313, 
+	0x7130, 0x7130, 0x7130, 0x7130, 0x7130, 0x7130, 0x7130, 0x7130, 
+	0x7132, 0x7132, 0x7132, 0x7132, 0x7132, 0x7132, 0x7132, 0x7132, 
+	0x7131, 0x7131, 0x7131, 0x7131, 0x7131, 0x7131, 0x7131, 0x7131, 
+	0x7133, 0x7133, 0x7133, 0x7133, 0x7133, 0x7133, 0x7133, 0x7133, 
+	0x7300, 0x7300, 0x7300, 0x7300, 0x7300, 0x7300, 0x7300, 0x7300, 
+	0x7302, 0x7302, 0x7302, 0x7302, 0x7302, 0x7302, 0x7302, 0x7302, 
+	0x7030, 0x7030, 0x7030, 0x7030, 0x7030, 0x7030, 0x7030, 0x7030, 
+	0x7031, 0x7031, 0x7031, 0x7031, 0x7031, 0x7031, 0x7031, 0x7031, 
+	0x7220, 0x7220, 0x7220, 0x7220, 0x7220, 0x7220, 0x7220, 0x7220, 
+	0x7222, 0x7222, 0x7222, 0x7222, 0x7222, 0x7222, 0x7222, 0x7222, 
+	0x7221, 0x7221, 0x7221, 0x7221, 0x7221, 0x7221, 0x7221, 0x7221, 
+	0x7223, 0x7223, 0x7223, 0x7223, 0x7223, 0x7223, 0x7223, 0x7223, 
+	0x6200, 0x6200, 0x6200, 0x6200, 0x6200, 0x6200, 0x6200, 0x6200, 
+	0x6200, 0x6200, 0x6200, 0x6200, 0x6200, 0x6200, 0x6200, 0x6200, 
+	0x6202, 0x6202, 0x6202, 0x6202, 0x6202, 0x6202, 0x6202, 0x6202, 
+	0x6202, 0x6202, 0x6202, 0x6202, 0x6202, 0x6202, 0x6202, 0x6202, 
+	0x6210, 0x6210, 0x6210, 0x6210, 0x6210, 0x6210, 0x6210, 0x6210, 
+	0x6210, 0x6210, 0x6210, 0x6210, 0x6210, 0x6210, 0x6210, 0x6210, 
+	0x6212, 0x6212, 0x6212, 0x6212, 0x6212, 0x6212, 0x6212, 0x6212, 
+	0x6212, 0x6212, 0x6212, 0x6212, 0x6212, 0x6212, 0x6212, 0x6212, 
+	0x6211, 0x6211, 0x6211, 0x6211, 0x6211, 0x6211, 0x6211, 0x6211, 
+	0x6211, 0x6211, 0x6211, 0x6211, 0x6211, 0x6211, 0x6211, 0x6211, 
+	0x6213, 0x6213, 0x6213, 0x6213, 0x6213, 0x6213, 0x6213, 0x6213, 
+	0x6213, 0x6213, 0x6213, 0x6213, 0x6213, 0x6213, 0x6213, 0x6213, 
+	0x6120, 0x6120, 0x6120, 0x6120, 0x6120, 0x6120, 0x6120, 0x6120, 
+	0x6120, 0x6120, 0x6120, 0x6120, 0x6120, 0x6120, 0x6120, 0x6120, 
+	0x6122, 0x6122, 0x6122, 0x6122, 0x6122, 0x6122, 0x6122, 0x6122, 
+	0x6122, 0x6122, 0x6122, 0x6122, 0x6122, 0x6122, 0x6122, 0x6122, 
+	0x6121, 0x6121, 0x6121, 0x6121, 0x6121, 0x6121, 0x6121, 0x6121, 
+	0x6121, 0x6121, 0x6121, 0x6121, 0x6121, 0x6121, 0x6121, 0x6121, 
+	0x6123, 0x6123, 0x6123, 0x6123, 0x6123, 0x6123, 0x6123, 0x6123, 
+	0x6123, 0x6123, 0x6123, 0x6123, 0x6123, 0x6123, 0x6123, 0x6123, 
+	0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 
+	0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 
+	0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 
+	0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 
+	0x5021, 0x5021, 0x5021, 0x5021, 0x5021, 0x5021, 0x5021, 0x5021, 
+	0x5021, 0x5021, 0x5021, 0x5021, 0x5021, 0x5021, 0x5021, 0x5021, 
+	0x5021, 0x5021, 0x5021, 0x5021, 0x5021, 0x5021, 0x5021, 0x5021, 
+	0x5021, 0x5021, 0x5021, 0x5021, 0x5021, 0x5021, 0x5021, 0x5021, 
+	0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 
+	0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 
+	0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 
+	0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 
+	0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 
+	0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 
+	0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 
+	0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 
+	0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 
+	0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 
+	0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 
+	0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 
+	0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 
+	0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 
+	0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 
+	0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+
+	/* huffLook10[1024] */
+	0x0008, 0x0008, 0x0008, 0xa748, 0xa478, 0xa658, 0xa568, 0xa738, 
+	0xa378, 0xa648, 0x0008, 0xa368, 0x9728, 0x9728, 0x9278, 0x9278, 
+	0xa468, 0xa708, 0xa070, 0xa071, 0x9268, 0x9268, 0xa548, 0xa538, 
+	0xa600, 0xa602, 0xa358, 0xa448, 0xa710, 0xa712, 0xa711, 0xa713, 
+	0xa170, 0xa172, 0xa171, 0xa173, 0x9638, 0x9638, 0x9628, 0x9628, 
+	0xa528, 0xa258, 0x9518, 0x9518, 0x9158, 0x9158, 0xa438, 0xa348, 
+	0xa610, 0xa612, 0xa611, 0xa613, 0xa160, 0xa162, 0xa161, 0xa163, 
+	0x9060, 0x9060, 0x9061, 0x9061, 0xa500, 0xa502, 0xa050, 0xa051, 
+	0x9428, 0x9428, 0x9248, 0x9248, 0x9338, 0x9338, 0xa400, 0xa402, 
+	0xa410, 0xa412, 0xa411, 0xa413, 0xa140, 0xa142, 0xa141, 0xa143, 
+	0x9040, 0x9040, 0x9041, 0x9041, 0xa320, 0xa322, 0xa321, 0xa323, 
+	0xa230, 0xa232, 0xa231, 0xa233, 0x9300, 0x9300, 0x9302, 0x9302, 
+	0x9310, 0x9310, 0x9312, 0x9312, 0x9311, 0x9311, 0x9313, 0x9313, 
+	0x9130, 0x9130, 0x9132, 0x9132, 0x9131, 0x9131, 0x9133, 0x9133, 
+	0x8030, 0x8030, 0x8030, 0x8030, 0x8031, 0x8031, 0x8031, 0x8031, 
+	0x9220, 0x9220, 0x9222, 0x9222, 0x9221, 0x9221, 0x9223, 0x9223, 
+	0x8210, 0x8210, 0x8210, 0x8210, 0x8212, 0x8212, 0x8212, 0x8212, 
+	0x8211, 0x8211, 0x8211, 0x8211, 0x8213, 0x8213, 0x8213, 0x8213, 
+	0x8120, 0x8120, 0x8120, 0x8120, 0x8122, 0x8122, 0x8122, 0x8122, 
+	0x8121, 0x8121, 0x8121, 0x8121, 0x8123, 0x8123, 0x8123, 0x8123, 
+	0x7200, 0x7200, 0x7200, 0x7200, 0x7200, 0x7200, 0x7200, 0x7200, 
+	0x7202, 0x7202, 0x7202, 0x7202, 0x7202, 0x7202, 0x7202, 0x7202, 
+	0x7020, 0x7020, 0x7020, 0x7020, 0x7020, 0x7020, 0x7020, 0x7020, 
+	0x7021, 0x7021, 0x7021, 0x7021, 0x7021, 0x7021, 0x7021, 0x7021, 
+	0x6110, 0x6110, 0x6110, 0x6110, 0x6110, 0x6110, 0x6110, 0x6110, 
+	0x6110, 0x6110, 0x6110, 0x6110, 0x6110, 0x6110, 0x6110, 0x6110, 
+	0x6112, 0x6112, 0x6112, 0x6112, 0x6112, 0x6112, 0x6112, 0x6112, 
+	0x6112, 0x6112, 0x6112, 0x6112, 0x6112, 0x6112, 0x6112, 0x6112, 
+	0x6111, 0x6111, 0x6111, 0x6111, 0x6111, 0x6111, 0x6111, 0x6111, 
+	0x6111, 0x6111, 0x6111, 0x6111, 0x6111, 0x6111, 0x6111, 0x6111, 
+	0x6113, 0x6113, 0x6113, 0x6113, 0x6113, 0x6113, 0x6113, 0x6113, 
+	0x6113, 0x6113, 0x6113, 0x6113, 0x6113, 0x6113, 0x6113, 0x6113, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+
+	/* huffLook11[1024] */
+	0xa778, 0xa768, 0xa678, 0xa578, 0xa668, 0xa748, 0xa478, 0x0008, 
+	0xa658, 0xa568, 0x9738, 0x9738, 0x9378, 0x9378, 0x9648, 0x9648, 
+	0xa548, 0xa458, 0xa538, 0xa358, 0xa720, 0xa722, 0xa721, 0xa723, 
+	0xa270, 0xa272, 0xa271, 0xa273, 0x9468, 0x9468, 0xa700, 0xa702, 
+	0x9170, 0x9170, 0x9172, 0x9172, 0x9171, 0x9171, 0x9173, 0x9173, 
+	0xa710, 0xa712, 0xa711, 0xa713, 0x9070, 0x9070, 0x9071, 0x9071, 
+	0xa630, 0xa632, 0xa631, 0xa633, 0xa360, 0xa362, 0xa361, 0xa363, 
+	0x9060, 0x9060, 0x9061, 0x9061, 0x9448, 0x9448, 0x9528, 0x9528, 
+	0x9258, 0x9258, 0xa500, 0xa502, 0xa510, 0xa512, 0xa511, 0xa513, 
+	0x9260, 0x9260, 0x9262, 0x9262, 0x9261, 0x9261, 0x9263, 0x9263, 
+	0xa620, 0xa622, 0xa621, 0xa623, 0x9600, 0x9600, 0x9602, 0x9602, 
+	0x9610, 0x9610, 0x9612, 0x9612, 0x9611, 0x9611, 0x9613, 0x9613, 
+	0x9160, 0x9160, 0x9162, 0x9162, 0x9161, 0x9161, 0x9163, 0x9163, 
+	0xa150, 0xa152, 0xa151, 0xa153, 0xa430, 0xa432, 0xa431, 0xa433, 
+	0x9050, 0x9050, 0x9051, 0x9051, 0x9348, 0x9348, 0x9338, 0x9338, 
+	0xa420, 0xa422, 0xa421, 0xa423, 0xa240, 0xa242, 0xa241, 0xa243, 
+	0xa410, 0xa412, 0xa411, 0xa413, 0xa140, 0xa142, 0xa141, 0xa143, 
+	0x9400, 0x9400, 0x9402, 0x9402, 0x9040, 0x9040, 0x9041, 0x9041, 
+	0x9320, 0x9320, 0x9322, 0x9322, 0x9321, 0x9321, 0x9323, 0x9323, 
+	0x9230, 0x9230, 0x9232, 0x9232, 0x9231, 0x9231, 0x9233, 0x9233, 
+	0x8310, 0x8310, 0x8310, 0x8310, 0x8312, 0x8312, 0x8312, 0x8312, 
+	0x8311, 0x8311, 0x8311, 0x8311, 0x8313, 0x8313, 0x8313, 0x8313, 
+	0x8130, 0x8130, 0x8130, 0x8130, 0x8132, 0x8132, 0x8132, 0x8132, 
+	0x8131, 0x8131, 0x8131, 0x8131, 0x8133, 0x8133, 0x8133, 0x8133, 
+	0x8300, 0x8300, 0x8300, 0x8300, 0x8302, 0x8302, 0x8302, 0x8302, 
+	0x8030, 0x8030, 0x8030, 0x8030, 0x8031, 0x8031, 0x8031, 0x8031, 
+	0x8220, 0x8220, 0x8220, 0x8220, 0x8222, 0x8222, 0x8222, 0x8222, 
+	0x8221, 0x8221, 0x8221, 0x8221, 0x8223, 0x8223, 0x8223, 0x8223, 
+	0x7120, 0x7120, 0x7120, 0x7120, 0x7120, 0x7120, 0x7120, 0x7120, 
+	0x7122, 0x7122, 0x7122, 0x7122, 0x7122, 0x7122, 0x7122, 0x7122, 
+	0x7121, 0x7121, 0x7121, 0x7121, 0x7121, 0x7121, 0x7121, 0x7121, 
+	0x7123, 0x7123, 0x7123, 0x7123, 0x7123, 0x7123, 0x7123, 0x7123, 
+	0x6210, 0x6210, 0x6210, 0x6210, 0x6210, 0x6210, 0x6210, 0x6210, 
+	0x6210, 0x6210, 0x6210, 0x6210, 0x6210, 0x6210, 0x6210, 0x6210, 
+	0x6212, 0x6212, 0x6212, 0x6212, 0x6212, 0x6212, 0x6212, 0x6212, 
+	0x6212, 0x6212, 0x6212, 0x6212, 0x6212, 0x6212, 0x6212, 0x6212, 
+	0x6211, 0x6211, 0x6211, 0x6211, 0x6211, 0x6211, 0x6211, 0x6211, 
+	0x6211, 0x6211, 0x6211, 0x6211, 0x6211, 0x6211, 0x6211, 0x6211, 
+	0x6213, 0x6213, 0x6213, 0x6213, 0x6213, 0x6213, 0x6213, 0x6213, 
+	0x6213, 0x6213, 0x6213, 0x6213, 0x6213, 0x6213, 0x6213, 0x6213, 
+	0x6200, 0x6200, 0x6200, 0x6200, 0x6200, 0x6200, 0x6200, 0x6200, 
+	0x6200, 0x6200, 0x6200, 0x6200, 0x6200, 0x6200, 0x6200, 0x6200, 
+	0x6202, 0x6202, 0x6202, 0x6202, 0x6202, 0x6202, 0x6202, 0x6202, 
+	0x6202, 0x6202, 0x6202, 0x6202, 0x6202, 0x6202, 0x6202, 0x6202, 
+	0x6020, 0x6020, 0x6020, 0x6020, 0x6020, 0x6020, 0x6020, 0x6020, 
+	0x6020, 0x6020, 0x6020, 0x6020, 0x6020, 0x6020, 0x6020, 0x6020, 
+	0x6021, 0x6021, 0x6021, 0x6021, 0x6021, 0x6021, 0x6021, 0x6021, 
+	0x6021, 0x6021, 0x6021, 0x6021, 0x6021, 0x6021, 0x6021, 0x6021, 
+	0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 
+	0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 
+	0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 
+	0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 
+	0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 
+	0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 
+	0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 
+	0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 
+	0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 
+	0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 
+	0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 
+	0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 
+	0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 
+	0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 
+	0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 
+	0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+	0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 
+
+	/* huffLook12[1024] */
+	0xa778, 0xa768, 0x9678, 0x9678, 0x9758, 0x9758, 0x9578, 0x9578, 
+	0x9668, 0x9668, 0x9748, 0x9748, 0x9478, 0x9478, 0x9568, 0x9568, 
+	0xa650, 0xa652, 0xa651, 0xa653, 0xa730, 0xa732, 0xa731, 0xa733, 
+	0x9378, 0x9378, 0x9558, 0x9558, 0xa720, 0xa722, 0xa721, 0xa723, 
+	0xa270, 0xa272, 0xa271, 0xa273, 0xa640, 0xa642, 0xa641, 0xa643, 
+	0xa460, 0xa462, 0xa461, 0xa463, 0xa710, 0xa712, 0xa711, 0xa713, 
+	0xa170, 0xa172, 0xa171, 0xa173, 0xa700, 0xa702, 0xa070, 0xa071, 
+	0xa630, 0xa632, 0xa631, 0xa633, 0xa360, 0xa362, 0xa361, 0xa363, 
+	0xa540, 0xa542, 0xa541, 0xa543, 0xa450, 0xa452, 0xa451, 0xa453, 
+	0xa440, 0xa442, 0xa441, 0xa443, 0xa600, 0xa602, 0xa500, 0xa502, 
+	0x9620, 0x9620, 0x9622, 0x9622, 0x9621, 0x9621, 0x9623, 0x9623, 
+	0x9260, 0x9260, 0x9262, 0x9262, 0x9261, 0x9261, 0x9263, 0x9263, 
+	0x9160, 0x9160, 0x9162, 0x9162, 0x9161, 0x9161, 0x9163, 0x9163, 
+	0xa610, 0xa612, 0xa611, 0xa613, 0x9060, 0x9060, 0x9061, 0x9061, 
+	0xa530, 0xa532, 0xa531, 0xa533, 0xa350, 0xa352, 0xa351, 0xa353, 
+	0xa520, 0xa522, 0xa521, 0xa523, 0xa250, 0xa252, 0xa251, 0xa253, 
+	0x9510, 0x9510, 0x9512, 0x9512, 0x9511, 0x9511, 0x9513, 0x9513, 
+	0x9150, 0x9150, 0x9152, 0x9152, 0x9151, 0x9151, 0x9153, 0x9153, 
+	0x9430, 0x9430, 0x9432, 0x9432, 0x9431, 0x9431, 0x9433, 0x9433, 
+	0x9340, 0x9340, 0x9342, 0x9342, 0x9341, 0x9341, 0x9343, 0x9343, 
+	0x9050, 0x9050, 0x9051, 0x9051, 0x9400, 0x9400, 0x9402, 0x9402, 
+	0x9420, 0x9420, 0x9422, 0x9422, 0x9421, 0x9421, 0x9423, 0x9423, 
+	0x9240, 0x9240, 0x9242, 0x9242, 0x9241, 0x9241, 0x9243, 0x9243, 
+	0x9410, 0x9410, 0x9412, 0x9412, 0x9411, 0x9411, 0x9413, 0x9413, 
+	0x8330, 0x8330, 0x8330, 0x8330, 0x8332, 0x8332, 0x8332, 0x8332, 
+	0x8331, 0x8331, 0x8331, 0x8331, 0x8333, 0x8333, 0x8333, 0x8333, 
+	0x8140, 0x8140, 0x8140, 0x8140, 0x8142, 0x8142, 0x8142, 0x8142, 
+	0x8141, 0x8141, 0x8141, 0x8141, 0x8143, 0x8143, 0x8143, 0x8143, 
+	0x8320, 0x8320, 0x8320, 0x8320, 0x8322, 0x8322, 0x8322, 0x8322, 
+	0x8321, 0x8321, 0x8321, 0x8321, 0x8323, 0x8323, 0x8323, 0x8323, 
+	0x8230, 0x8230, 0x8230, 0x8230, 0x8232, 0x8232, 0x8232, 0x8232, 
+	0x8231, 0x8231, 0x8231, 0x8231, 0x8233, 0x8233, 0x8233, 0x8233, 
+	0x8040, 0x8040, 0x8040, 0x8040, 0x8041, 0x8041, 0x8041, 0x8041, 
+	0x8300, 0x8300, 0x8300, 0x8300, 0x8302, 0x8302, 0x8302, 0x8302, 
+	0x7030, 0x7030, 0x7030, 0x7030, 0x7030, 0x7030, 0x7030, 0x7030, 
+	0x7031, 0x7031, 0x7031, 0x7031, 0x7031, 0x7031, 0x7031, 0x7031, 
+	0x7310, 0x7310, 0x7310, 0x7310, 0x7310, 0x7310, 0x7310, 0x7310, 
+	0x7312, 0x7312, 0x7312, 0x7312, 0x7312, 0x7312, 0x7312, 0x7312, 
+	0x7311, 0x7311, 0x7311, 0x7311, 0x7311, 0x7311, 0x7311, 0x7311, 
+	0x7313, 0x7313, 0x7313, 0x7313, 0x7313, 0x7313, 0x7313, 0x7313, 
+	0x7130, 0x7130, 0x7130, 0x7130, 0x7130, 0x7130, 0x7130, 0x7130, 
+	0x7132, 0x7132, 0x7132, 0x7132, 0x7132, 0x7132, 0x7132, 0x7132, 
+	0x7131, 0x7131, 0x7131, 0x7131, 0x7131, 0x7131, 0x7131, 0x7131, 
+	0x7133, 0x7133, 0x7133, 0x7133, 0x7133, 0x7133, 0x7133, 0x7133, 
+	0x7220, 0x7220, 0x7220, 0x7220, 0x7220, 0x7220, 0x7220, 0x7220, 
+	0x7222, 0x7222, 0x7222, 0x7222, 0x7222, 0x7222, 0x7222, 0x7222, 
+	0x7221, 0x7221, 0x7221, 0x7221, 0x7221, 0x7221, 0x7221, 0x7221, 
+	0x7223, 0x7223, 0x7223, 0x7223, 0x7223, 0x7223, 0x7223, 0x7223, 
+	0x6210, 0x6210, 0x6210, 0x6210, 0x6210, 0x6210, 0x6210, 0x6210, 
+	0x6210, 0x6210, 0x6210, 0x6210, 0x6210, 0x6210, 0x6210, 0x6210, 
+	0x6212, 0x6212, 0x6212, 0x6212, 0x6212, 0x6212, 0x6212, 0x6212, 
+	0x6212, 0x6212, 0x6212, 0x6212, 0x6212, 0x6212, 0x6212, 0x6212, 
+	0x6211, 0x6211, 0x6211, 0x6211, 0x6211, 0x6211, 0x6211, 0x6211, 
+	0x6211, 0x6211, 0x6211, 0x6211, 0x6211, 0x6211, 0x6211, 0x6211, 
+	0x6213, 0x6213, 0x6213, 0x6213, 0x6213, 0x6213, 0x6213, 0x6213, 
+	0x6213, 0x6213, 0x6213, 0x6213, 0x6213, 0x6213, 0x6213, 0x6213, 
+	0x6120, 0x6120, 0x6120, 0x6120, 0x6120, 0x6120, 0x6120, 0x6120, 
+	0x6120, 0x6120, 0x6120, 0x6120, 0x6120, 0x6120, 0x6120, 0x6120, 
+	0x6122, 0x6122, 0x6122, 0x6122, 0x6122, 0x6122, 0x6122, 0x6122, 
+	0x6122, 0x6122, 0x6122, 0x6122, 0x6122, 0x6122, 0x6122, 0x6122, 
+	0x6121, 0x6121, 0x6121, 0x6121, 0x6121, 0x6121, 0x6121, 0x6121, 
+	0x6121, 0x6121, 0x6121, 0x6121, 0x6121, 0x6121, 0x6121, 0x6121, 
+	0x6123, 0x6123, 0x6123, 0x6123, 0x6123, 0x6123, 0x6123, 0x6123, 
+	0x6123, 0x6123, 0x6123, 0x6123, 0x6123, 0x6123, 0x6123, 0x6123, 
+	0x6200, 0x6200, 0x6200, 0x6200, 0x6200, 0x6200, 0x6200, 0x6200, 
+	0x6200, 0x6200, 0x6200, 0x6200, 0x6200, 0x6200, 0x6200, 0x6200, 
+	0x6202, 0x6202, 0x6202, 0x6202, 0x6202, 0x6202, 0x6202, 0x6202, 
+	0x6202, 0x6202, 0x6202, 0x6202, 0x6202, 0x6202, 0x6202, 0x6202, 
+	0x6020, 0x6020, 0x6020, 0x6020, 0x6020, 0x6020, 0x6020, 0x6020, 
+	0x6020, 0x6020, 0x6020, 0x6020, 0x6020, 0x6020, 0x6020, 0x6020, 
+	0x6021, 0x6021, 0x6021, 0x6021, 0x6021, 0x6021, 0x6021, 0x6021, 
+	0x6021, 0x6021, 0x6021, 0x6021, 0x6021, 0x6021, 0x6021, 0x6021, 
+	0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 
+	0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 
+	0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 
+	0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 
+	0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 
+	0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 
+	0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 
+	0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 
+	0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 
+	0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 
+	0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 
+	0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 
+	0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 
+	0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 
+	0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 
+	0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 
+	0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 
+	0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 
+	0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 
+	0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 
+	0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 
+	0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 
+	0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 
+	0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 0x4100, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 0x4102, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+
+	/* huffLook13[1024] */
+	0x0008, 0x0008, 0x0008, 0x0008, 0x0008, 0x0008, 0x0008, 0x0008, 
+	0x0008, 0x0008, 0x0008, 0x0008, 0x0008, 0x0008, 0x0008, 0x0008, 
+	0x0008, 0x0008, 0x0008, 0x0008, 0x0008, 0x0008, 0x0008, 0xa2b8, 
+	0xab18, 0xa1b8, 0x0008, 0x0008, 0x0008, 0x0008, 0xaa28, 0xa2a8, 
+	0xaa18, 0xa1a8, 0x0008, 0xa0a8, 0x0008, 0xa398, 0x0008, 0x0008, 
+	0xa928, 0xa298, 0x0008, 0xa838, 0xa388, 0x0008, 0x0008, 0x0008, 
+	0x9918, 0x9918, 0x9198, 0x9198, 0xa908, 0xa098, 0xa848, 0xa488, 
+	0xa278, 0x0008, 0x9828, 0x9828, 0x9288, 0x9288, 0x9818, 0x9818, 
+	0xa738, 0xa728, 0x9718, 0x9718, 0x9178, 0x9178, 0xa558, 0xa708, 
+	0xa078, 0xa638, 0xa368, 0xa548, 0xa458, 0xa628, 0xa268, 0xa538, 
+	0xa180, 0xa182, 0xa181, 0xa183, 0xa800, 0xa802, 0xa080, 0xa081, 
+	0x9618, 0x9618, 0x9168, 0x9168, 0xa600, 0xa602, 0xa060, 0xa061, 
+	0xa358, 0xa448, 0x9528, 0x9528, 0x9258, 0x9258, 0xa500, 0xa502, 
+	0xa510, 0xa512, 0xa511, 0xa513, 0xa150, 0xa152, 0xa151, 0xa153, 
+	0x9438, 0x9438, 0x9348, 0x9348, 0xa050, 0xa051, 0x9428, 0x9428, 
+	0x9248, 0x9248, 0x9338, 0x9338, 0xa410, 0xa412, 0xa411, 0xa413, 
+	0x9140, 0x9140, 0x9142, 0x9142, 0x9141, 0x9141, 0x9143, 0x9143, 
+	0x9400, 0x9400, 0x9402, 0x9402, 0x9040, 0x9040, 0x9041, 0x9041, 
+	0xa320, 0xa322, 0xa321, 0xa323, 0xa230, 0xa232, 0xa231, 0xa233, 
+	0x9310, 0x9310, 0x9312, 0x9312, 0x9311, 0x9311, 0x9313, 0x9313, 
+	0x9130, 0x9130, 0x9132, 0x9132, 0x9131, 0x9131, 0x9133, 0x9133, 
+	0x8300, 0x8300, 0x8300, 0x8300, 0x8302, 0x8302, 0x8302, 0x8302, 
+	0x8030, 0x8030, 0x8030, 0x8030, 0x8031, 0x8031, 0x8031, 0x8031, 
+	0x9220, 0x9220, 0x9222, 0x9222, 0x9221, 0x9221, 0x9223, 0x9223, 
+	0x8210, 0x8210, 0x8210, 0x8210, 0x8212, 0x8212, 0x8212, 0x8212, 
+	0x8211, 0x8211, 0x8211, 0x8211, 0x8213, 0x8213, 0x8213, 0x8213, 
+	0x8120, 0x8120, 0x8120, 0x8120, 0x8122, 0x8122, 0x8122, 0x8122, 
+	0x8121, 0x8121, 0x8121, 0x8121, 0x8123, 0x8123, 0x8123, 0x8123, 
+	0x7200, 0x7200, 0x7200, 0x7200, 0x7200, 0x7200, 0x7200, 0x7200, 
+	0x7202, 0x7202, 0x7202, 0x7202, 0x7202, 0x7202, 0x7202, 0x7202, 
+	0x7020, 0x7020, 0x7020, 0x7020, 0x7020, 0x7020, 0x7020, 0x7020, 
+	0x7021, 0x7021, 0x7021, 0x7021, 0x7021, 0x7021, 0x7021, 0x7021, 
+	0x6110, 0x6110, 0x6110, 0x6110, 0x6110, 0x6110, 0x6110, 0x6110, 
+	0x6110, 0x6110, 0x6110, 0x6110, 0x6110, 0x6110, 0x6110, 0x6110, 
+	0x6112, 0x6112, 0x6112, 0x6112, 0x6112, 0x6112, 0x6112, 0x6112, 
+	0x6112, 0x6112, 0x6112, 0x6112, 0x6112, 0x6112, 0x6112, 0x6112, 
+	0x6111, 0x6111, 0x6111, 0x6111, 0x6111, 0x6111, 0x6111, 0x6111, 
+	0x6111, 0x6111, 0x6111, 0x6111, 0x6111, 0x6111, 0x6111, 0x6111, 
+	0x6113, 0x6113, 0x6113, 0x6113, 0x6113, 0x6113, 0x6113, 0x6113, 
+	0x6113, 0x6113, 0x6113, 0x6113, 0x6113, 0x6113, 0x6113, 0x6113, 
+	0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 
+	0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 
+	0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 
+	0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 
+	0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 
+	0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 
+	0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 
+	0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+
+	/* huffLook15[1024] */
+	0x0008, 0x0008, 0x0008, 0x0008, 0x0008, 0x0008, 0x0008, 0x0008, 
+	0x0008, 0x0008, 0x0008, 0x0008, 0x0008, 0x0008, 0x0008, 0x0008, 
+	0x0008, 0x0008, 0x0008, 0x0008, 0x0008, 0x0008, 0x0008, 0x0008, 
+	0x0008, 0x0008, 0x0008, 0x0008, 0x0008, 0x0008, 0x0008, 0x0008, 
+	0x0008, 0x0008, 0xa4d8, 0x0008, 0x0008, 0x0008, 0xa3d8, 0xa2d8, 
+	0x0008, 0xad18, 0xab78, 0xa7b8, 0xa1d8, 0x0008, 0xa5c8, 0xaa88, 
+	0xa8a8, 0xac48, 0xa4c8, 0xab68, 0xa6b8, 0x0008, 0xac38, 0xa3c8, 
+	0xaa78, 0xa7a8, 0xa6a8, 0x0008, 0x92c8, 0x92c8, 0xac28, 0xab58, 
+	0xa5b8, 0xac18, 0xa988, 0xa898, 0xa1c8, 0xab48, 0xa4b8, 0xaa68, 
+	0xab38, 0xa978, 0x93b8, 0x93b8, 0xa798, 0xa888, 0xab28, 0xaa58, 
+	0x92b8, 0x92b8, 0xa5a8, 0xab18, 0x91b8, 0x91b8, 0xa0b8, 0xa968, 
+	0xa698, 0xaa48, 0xa4a8, 0xa878, 0xa788, 0xaa38, 0x93a8, 0x93a8, 
+	0x9958, 0x9958, 0x9598, 0x9598, 0x9a28, 0x9a28, 0x92a8, 0x92a8, 
+	0x9a18, 0x9a18, 0x91a8, 0x91a8, 0xaa08, 0xa0a8, 0x9868, 0x9868, 
+	0x9688, 0x9688, 0x9948, 0x9948, 0x9498, 0x9498, 0x9938, 0x9938, 
+	0x9398, 0x9398, 0xa778, 0xa908, 0x9858, 0x9858, 0x9588, 0x9588, 
+	0x9928, 0x9928, 0x9768, 0x9768, 0x9678, 0x9678, 0x9298, 0x9298, 
+	0xa190, 0xa192, 0xa191, 0xa193, 0x9918, 0x9918, 0xa090, 0xa091, 
+	0x9848, 0x9848, 0x9488, 0x9488, 0x9758, 0x9758, 0x9578, 0x9578, 
+	0x9838, 0x9838, 0x9388, 0x9388, 0x9668, 0x9668, 0x9748, 0x9748, 
+	0xa820, 0xa822, 0xa821, 0xa823, 0xa280, 0xa282, 0xa281, 0xa283, 
+	0xa810, 0xa812, 0xa811, 0xa813, 0xa180, 0xa182, 0xa181, 0xa183, 
+	0x9478, 0x9478, 0xa800, 0xa802, 0xa080, 0xa081, 0x9658, 0x9658, 
+	0x9568, 0x9568, 0x9738, 0x9738, 0x9378, 0x9378, 0x9648, 0x9648, 
+	0xa720, 0xa722, 0xa721, 0xa723, 0xa270, 0xa272, 0xa271, 0xa273, 
+	0xa460, 0xa462, 0xa461, 0xa463, 0xa710, 0xa712, 0xa711, 0xa713, 
+	0xa550, 0xa552, 0xa551, 0xa553, 0xa170, 0xa172, 0xa171, 0xa173, 
+	0xa700, 0xa702, 0xa070, 0xa071, 0xa630, 0xa632, 0xa631, 0xa633, 
+	0xa360, 0xa362, 0xa361, 0xa363, 0xa540, 0xa542, 0xa541, 0xa543, 
+	0xa450, 0xa452, 0xa451, 0xa453, 0xa620, 0xa622, 0xa621, 0xa623, 
+	0xa260, 0xa262, 0xa261, 0xa263, 0xa610, 0xa612, 0xa611, 0xa613, 
+	0xa600, 0xa602, 0xa060, 0xa061, 0xa530, 0xa532, 0xa531, 0xa533, 
+	0x9160, 0x9160, 0x9162, 0x9162, 0x9161, 0x9161, 0x9163, 0x9163, 
+	0xa350, 0xa352, 0xa351, 0xa353, 0xa440, 0xa442, 0xa441, 0xa443, 
+	0x9520, 0x9520, 0x9522, 0x9522, 0x9521, 0x9521, 0x9523, 0x9523, 
+	0x9250, 0x9250, 0x9252, 0x9252, 0x9251, 0x9251, 0x9253, 0x9253, 
+	0x9510, 0x9510, 0x9512, 0x9512, 0x9511, 0x9511, 0x9513, 0x9513, 
+	0x9150, 0x9150, 0x9152, 0x9152, 0x9151, 0x9151, 0x9153, 0x9153, 
+	0x9500, 0x9500, 0x9502, 0x9502, 0x9050, 0x9050, 0x9051, 0x9051, 
+	0x9430, 0x9430, 0x9432, 0x9432, 0x9431, 0x9431, 0x9433, 0x9433, 
+	0x9340, 0x9340, 0x9342, 0x9342, 0x9341, 0x9341, 0x9343, 0x9343, 
+	0x9420, 0x9420, 0x9422, 0x9422, 0x9421, 0x9421, 0x9423, 0x9423, 
+	0x9240, 0x9240, 0x9242, 0x9242, 0x9241, 0x9241, 0x9243, 0x9243, 
+	0x9330, 0x9330, 0x9332, 0x9332, 0x9331, 0x9331, 0x9333, 0x9333, 
+	0x8140, 0x8140, 0x8140, 0x8140, 0x8142, 0x8142, 0x8142, 0x8142, 
+	0x8141, 0x8141, 0x8141, 0x8141, 0x8143, 0x8143, 0x8143, 0x8143, 
+	0x9410, 0x9410, 0x9412, 0x9412, 0x9411, 0x9411, 0x9413, 0x9413, 
+	0x8400, 0x8400, 0x8400, 0x8400, 0x8402, 0x8402, 0x8402, 0x8402, 
+	0x8320, 0x8320, 0x8320, 0x8320, 0x8322, 0x8322, 0x8322, 0x8322, 
+	0x8321, 0x8321, 0x8321, 0x8321, 0x8323, 0x8323, 0x8323, 0x8323, 
+	0x8230, 0x8230, 0x8230, 0x8230, 0x8232, 0x8232, 0x8232, 0x8232, 
+	0x8231, 0x8231, 0x8231, 0x8231, 0x8233, 0x8233, 0x8233, 0x8233, 
+	0x8040, 0x8040, 0x8040, 0x8040, 0x8041, 0x8041, 0x8041, 0x8041, 
+	0x8300, 0x8300, 0x8300, 0x8300, 0x8302, 0x8302, 0x8302, 0x8302, 
+	0x8310, 0x8310, 0x8310, 0x8310, 0x8312, 0x8312, 0x8312, 0x8312, 
+	0x8311, 0x8311, 0x8311, 0x8311, 0x8313, 0x8313, 0x8313, 0x8313, 
+	0x8130, 0x8130, 0x8130, 0x8130, 0x8132, 0x8132, 0x8132, 0x8132, 
+	0x8131, 0x8131, 0x8131, 0x8131, 0x8133, 0x8133, 0x8133, 0x8133, 
+	0x7030, 0x7030, 0x7030, 0x7030, 0x7030, 0x7030, 0x7030, 0x7030, 
+	0x7031, 0x7031, 0x7031, 0x7031, 0x7031, 0x7031, 0x7031, 0x7031, 
+	0x7220, 0x7220, 0x7220, 0x7220, 0x7220, 0x7220, 0x7220, 0x7220, 
+	0x7222, 0x7222, 0x7222, 0x7222, 0x7222, 0x7222, 0x7222, 0x7222, 
+	0x7221, 0x7221, 0x7221, 0x7221, 0x7221, 0x7221, 0x7221, 0x7221, 
+	0x7223, 0x7223, 0x7223, 0x7223, 0x7223, 0x7223, 0x7223, 0x7223, 
+	0x7210, 0x7210, 0x7210, 0x7210, 0x7210, 0x7210, 0x7210, 0x7210, 
+	0x7212, 0x7212, 0x7212, 0x7212, 0x7212, 0x7212, 0x7212, 0x7212, 
+	0x7211, 0x7211, 0x7211, 0x7211, 0x7211, 0x7211, 0x7211, 0x7211, 
+	0x7213, 0x7213, 0x7213, 0x7213, 0x7213, 0x7213, 0x7213, 0x7213, 
+	0x7120, 0x7120, 0x7120, 0x7120, 0x7120, 0x7120, 0x7120, 0x7120, 
+	0x7122, 0x7122, 0x7122, 0x7122, 0x7122, 0x7122, 0x7122, 0x7122, 
+	0x7121, 0x7121, 0x7121, 0x7121, 0x7121, 0x7121, 0x7121, 0x7121, 
+	0x7123, 0x7123, 0x7123, 0x7123, 0x7123, 0x7123, 0x7123, 0x7123, 
+	0x6200, 0x6200, 0x6200, 0x6200, 0x6200, 0x6200, 0x6200, 0x6200, 
+	0x6200, 0x6200, 0x6200, 0x6200, 0x6200, 0x6200, 0x6200, 0x6200, 
+	0x6202, 0x6202, 0x6202, 0x6202, 0x6202, 0x6202, 0x6202, 0x6202, 
+	0x6202, 0x6202, 0x6202, 0x6202, 0x6202, 0x6202, 0x6202, 0x6202, 
+	0x6020, 0x6020, 0x6020, 0x6020, 0x6020, 0x6020, 0x6020, 0x6020, 
+	0x6020, 0x6020, 0x6020, 0x6020, 0x6020, 0x6020, 0x6020, 0x6020, 
+	0x6021, 0x6021, 0x6021, 0x6021, 0x6021, 0x6021, 0x6021, 0x6021, 
+	0x6021, 0x6021, 0x6021, 0x6021, 0x6021, 0x6021, 0x6021, 0x6021, 
+	0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 
+	0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 
+	0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 
+	0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 0x5110, 
+	0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 
+	0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 
+	0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 
+	0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 0x5112, 
+	0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 
+	0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 
+	0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 
+	0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 0x5111, 
+	0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 
+	0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 
+	0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 
+	0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 0x5113, 
+	0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 
+	0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 
+	0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 
+	0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 
+	0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 
+	0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 
+	0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 
+	0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 
+	0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 
+	0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 
+	0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 
+	0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 
+	0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 
+	0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 
+	0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 
+	0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+	0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 0x3000, 
+
+	/* huffLook16[1024] */
+	0x0008, 0x0008, 0x0008, 0x0008, 0xafa8, 0x0008, 0x0008, 0xaf88, 
+	0xaf78, 0xa7f8, 0xaf68, 0xa6f8, 0x8ff8, 0x8ff8, 0x8ff8, 0x8ff8, 
+	0xaf58, 0xa5f8, 0x9f48, 0x9f48, 0x94f8, 0x94f8, 0x93f8, 0x93f8, 
+	0x90f8, 0x90f8, 0xaf38, 0x0008, 0x82f8, 0x82f8, 0x82f8, 0x82f8, 
+	0x9f28, 0x9f28, 0x9f08, 0x9f08, 0x8f18, 0x8f18, 0x8f18, 0x8f18, 
+	0x81f8, 0x81f8, 0x81f8, 0x81f8, 0x0008, 0x0008, 0x0008, 0x0008, 
+	0x0008, 0x0008, 0x0008, 0x0008, 0x0008, 0x0008, 0x0008, 0x0008, 
+	0x0008, 0x0008, 0x0008, 0x0008, 0x0008, 0x0008, 0x0008, 0x0008, 
+	0x0008, 0x0008, 0x0008, 0xa2a8, 0xaa18, 0x0008, 0x0008, 0x0008, 
+	0xa928, 0xa298, 0x0008, 0xa918, 0xa198, 0x0008, 0x0008, 0x0008, 
+	0x0008, 0xa288, 0x0008, 0xa818, 0xa188, 0xa088, 0x0008, 0xa738, 
+	0xa378, 0x0008, 0xa728, 0xa278, 0x0008, 0xa708, 0x9718, 0x9718, 
+	0x9178, 0x9178, 0xa078, 0xa638, 0xa368, 0xa548, 0xa458, 0xa628, 
+	0x9268, 0x9268, 0x9618, 0x9618, 0x9168, 0x9168, 0xa608, 0xa068, 
+	0x9358, 0x9358, 0xa538, 0xa448, 0x9528, 0x9528, 0x9258, 0x9258, 
+	0xa150, 0xa152, 0xa151, 0xa153, 0x9518, 0x9518, 0xa500, 0xa502, 
+	0x9438, 0x9438, 0x9348, 0x9348, 0xa050, 0xa051, 0x9428, 0x9428, 
+	0x9248, 0x9248, 0x9338, 0x9338, 0xa410, 0xa412, 0xa411, 0xa413, 
+	0xa140, 0xa142, 0xa141, 0xa143, 0xa400, 0xa402, 0xa040, 0xa041, 
+	0xa320, 0xa322, 0xa321, 0xa323, 0xa230, 0xa232, 0xa231, 0xa233, 
+	0x9310, 0x9310, 0x9312, 0x9312, 0x9311, 0x9311, 0x9313, 0x9313, 
+	0x9130, 0x9130, 0x9132, 0x9132, 0x9131, 0x9131, 0x9133, 0x9133, 
+	0x9300, 0x9300, 0x9302, 0x9302, 0x9030, 0x9030, 0x9031, 0x9031, 
+	0x9220, 0x9220, 0x9222, 0x9222, 0x9221, 0x9221, 0x9223, 0x9223, 
+	0x8210, 0x8210, 0x8210, 0x8210, 0x8212, 0x8212, 0x8212, 0x8212, 
+	0x8211, 0x8211, 0x8211, 0x8211, 0x8213, 0x8213, 0x8213, 0x8213, 
+	0x8120, 0x8120, 0x8120, 0x8120, 0x8122, 0x8122, 0x8122, 0x8122, 
+	0x8121, 0x8121, 0x8121, 0x8121, 0x8123, 0x8123, 0x8123, 0x8123, 
+	0x7200, 0x7200, 0x7200, 0x7200, 0x7200, 0x7200, 0x7200, 0x7200, 
+	0x7202, 0x7202, 0x7202, 0x7202, 0x7202, 0x7202, 0x7202, 0x7202, 
+	0x7020, 0x7020, 0x7020, 0x7020, 0x7020, 0x7020, 0x7020, 0x7020, 
+	0x7021, 0x7021, 0x7021, 0x7021, 0x7021, 0x7021, 0x7021, 0x7021, 
+	0x6110, 0x6110, 0x6110, 0x6110, 0x6110, 0x6110, 0x6110, 0x6110, 
+	0x6110, 0x6110, 0x6110, 0x6110, 0x6110, 0x6110, 0x6110, 0x6110, 
+	0x6112, 0x6112, 0x6112, 0x6112, 0x6112, 0x6112, 0x6112, 0x6112, 
+	0x6112, 0x6112, 0x6112, 0x6112, 0x6112, 0x6112, 0x6112, 0x6112, 
+	0x6111, 0x6111, 0x6111, 0x6111, 0x6111, 0x6111, 0x6111, 0x6111, 
+	0x6111, 0x6111, 0x6111, 0x6111, 0x6111, 0x6111, 0x6111, 0x6111, 
+	0x6113, 0x6113, 0x6113, 0x6113, 0x6113, 0x6113, 0x6113, 0x6113, 
+	0x6113, 0x6113, 0x6113, 0x6113, 0x6113, 0x6113, 0x6113, 0x6113, 
+	0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 
+	0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 
+	0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 
+	0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 
+	0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 
+	0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 
+	0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 
+	0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 0x4010, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 0x4011, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+
+	/* huffLook24[1024] */
+	0x8fe8, 0x8fe8, 0x8fe8, 0x8fe8, 0x8ef8, 0x8ef8, 0x8ef8, 0x8ef8, 
+	0x8fd8, 0x8fd8, 0x8fd8, 0x8fd8, 0x8df8, 0x8df8, 0x8df8, 0x8df8, 
+	0x8fc8, 0x8fc8, 0x8fc8, 0x8fc8, 0x8cf8, 0x8cf8, 0x8cf8, 0x8cf8, 
+	0x8fb8, 0x8fb8, 0x8fb8, 0x8fb8, 0x8bf8, 0x8bf8, 0x8bf8, 0x8bf8, 
+	0x7af8, 0x7af8, 0x7af8, 0x7af8, 0x7af8, 0x7af8, 0x7af8, 0x7af8, 
+	0x8fa8, 0x8fa8, 0x8fa8, 0x8fa8, 0x8f98, 0x8f98, 0x8f98, 0x8f98, 
+	0x79f8, 0x79f8, 0x79f8, 0x79f8, 0x79f8, 0x79f8, 0x79f8, 0x79f8, 
+	0x78f8, 0x78f8, 0x78f8, 0x78f8, 0x78f8, 0x78f8, 0x78f8, 0x78f8, 
+	0x8f88, 0x8f88, 0x8f88, 0x8f88, 0x8f78, 0x8f78, 0x8f78, 0x8f78, 
+	0x77f8, 0x77f8, 0x77f8, 0x77f8, 0x77f8, 0x77f8, 0x77f8, 0x77f8, 
+	0x7f68, 0x7f68, 0x7f68, 0x7f68, 0x7f68, 0x7f68, 0x7f68, 0x7f68, 
+	0x76f8, 0x76f8, 0x76f8, 0x76f8, 0x76f8, 0x76f8, 0x76f8, 0x76f8, 
+	0x7f58, 0x7f58, 0x7f58, 0x7f58, 0x7f58, 0x7f58, 0x7f58, 0x7f58, 
+	0x75f8, 0x75f8, 0x75f8, 0x75f8, 0x75f8, 0x75f8, 0x75f8, 0x75f8, 
+	0x7f48, 0x7f48, 0x7f48, 0x7f48, 0x7f48, 0x7f48, 0x7f48, 0x7f48, 
+	0x74f8, 0x74f8, 0x74f8, 0x74f8, 0x74f8, 0x74f8, 0x74f8, 0x74f8, 
+	0x7f38, 0x7f38, 0x7f38, 0x7f38, 0x7f38, 0x7f38, 0x7f38, 0x7f38, 
+	0x73f8, 0x73f8, 0x73f8, 0x73f8, 0x73f8, 0x73f8, 0x73f8, 0x73f8, 
+	0x7f28, 0x7f28, 0x7f28, 0x7f28, 0x7f28, 0x7f28, 0x7f28, 0x7f28, 
+	0x72f8, 0x72f8, 0x72f8, 0x72f8, 0x72f8, 0x72f8, 0x72f8, 0x72f8, 
+	0x71f8, 0x71f8, 0x71f8, 0x71f8, 0x71f8, 0x71f8, 0x71f8, 0x71f8, 
+	0x8f18, 0x8f18, 0x8f18, 0x8f18, 0x80f8, 0x80f8, 0x80f8, 0x80f8, 
+	0x9f08, 0x9f08, 0x0008, 0x0008, 0x0008, 0x0008, 0x0008, 0x0008, 
+	0x0008, 0x0008, 0x0008, 0x0008, 0x0008, 0x0008, 0x0008, 0x0008, 
+	0x4ff8, 0x4ff8, 0x4ff8, 0x4ff8, 0x4ff8, 0x4ff8, 0x4ff8, 0x4ff8, 
+	0x4ff8, 0x4ff8, 0x4ff8, 0x4ff8, 0x4ff8, 0x4ff8, 0x4ff8, 0x4ff8, 
+	0x4ff8, 0x4ff8, 0x4ff8, 0x4ff8, 0x4ff8, 0x4ff8, 0x4ff8, 0x4ff8, 
+	0x4ff8, 0x4ff8, 0x4ff8, 0x4ff8, 0x4ff8, 0x4ff8, 0x4ff8, 0x4ff8, 
+	0x4ff8, 0x4ff8, 0x4ff8, 0x4ff8, 0x4ff8, 0x4ff8, 0x4ff8, 0x4ff8, 
+	0x4ff8, 0x4ff8, 0x4ff8, 0x4ff8, 0x4ff8, 0x4ff8, 0x4ff8, 0x4ff8, 
+	0x4ff8, 0x4ff8, 0x4ff8, 0x4ff8, 0x4ff8, 0x4ff8, 0x4ff8, 0x4ff8, 
+	0x4ff8, 0x4ff8, 0x4ff8, 0x4ff8, 0x4ff8, 0x4ff8, 0x4ff8, 0x4ff8, 
+	0x0008, 0x0008, 0x0008, 0xa6e8, 0x0008, 0xa9c8, 0xae58, 0xaab8, 
+	0xa5e8, 0x0008, 0xa7d8, 0xa4e8, 0xac88, 0xa8c8, 0x0008, 0xae38, 
+	0xad68, 0xa6d8, 0xa3e8, 0xab98, 0xa9b8, 0xaaa8, 0xa2e8, 0xae18, 
+	0xa1e8, 0xad58, 0xa5d8, 0xac78, 0xa7c8, 0xad48, 0xab88, 0xa8b8, 
+	0xa4d8, 0xaa98, 0xa9a8, 0xac68, 0xa6c8, 0xad38, 0xa3d8, 0xad28, 
+	0xa2d8, 0xad18, 0xab78, 0xa7b8, 0xa1d8, 0xac58, 0xa5c8, 0xaa88, 
+	0xa8a8, 0xa998, 0xac48, 0xa4c8, 0xab68, 0xa6b8, 0x0008, 0xac38, 
+	0xa3c8, 0xaa78, 0xa7a8, 0xac28, 0xa2c8, 0xab58, 0xa5b8, 0xac18, 
+	0xa988, 0xa898, 0xa1c8, 0xab48, 0x0008, 0xab38, 0x0008, 0xaa18, 
+	0x94b8, 0x94b8, 0xaa68, 0xa6a8, 0xa978, 0xa798, 0x0008, 0xa098, 
+	0x93b8, 0x93b8, 0x9888, 0x9888, 0xab28, 0xaa58, 0x92b8, 0x92b8, 
+	0xa5a8, 0xab18, 0xa1b8, 0xa968, 0x9698, 0x9698, 0x94a8, 0x94a8, 
+	0xaa48, 0xa878, 0x9788, 0x9788, 0x9a38, 0x9a38, 0x93a8, 0x93a8, 
+	0x9958, 0x9958, 0x9598, 0x9598, 0x9a28, 0x9a28, 0x92a8, 0x92a8, 
+	0x91a8, 0x91a8, 0x9868, 0x9868, 0x9688, 0x9688, 0x9778, 0x9778, 
+	0x9948, 0x9948, 0x9498, 0x9498, 0x9938, 0x9938, 0x9398, 0x9398, 
+	0x9858, 0x9858, 0x9588, 0x9588, 0x9928, 0x9928, 0x9768, 0x9768, 
+	0x9678, 0x9678, 0x9298, 0x9298, 0x9918, 0x9918, 0x9198, 0x9198, 
+	0x9848, 0x9848, 0x9488, 0x9488, 0x9758, 0x9758, 0x9578, 0x9578, 
+	0x9838, 0x9838, 0x9388, 0x9388, 0x9668, 0x9668, 0x9828, 0x9828, 
+	0x9288, 0x9288, 0x9818, 0x9818, 0x9748, 0x9748, 0x9478, 0x9478, 
+	0x9188, 0x9188, 0xa808, 0xa088, 0x9658, 0x9658, 0x9568, 0x9568, 
+	0x9718, 0x9718, 0xa708, 0xa078, 0xa370, 0xa372, 0xa371, 0xa373, 
+	0x9738, 0x9738, 0x9728, 0x9728, 0xa270, 0xa272, 0xa271, 0xa273, 
+	0xa640, 0xa642, 0xa641, 0xa643, 0xa460, 0xa462, 0xa461, 0xa463, 
+	0xa550, 0xa552, 0xa551, 0xa553, 0xa170, 0xa172, 0xa171, 0xa173, 
+	0xa630, 0xa632, 0xa631, 0xa633, 0xa360, 0xa362, 0xa361, 0xa363, 
+	0xa540, 0xa542, 0xa541, 0xa543, 0xa450, 0xa452, 0xa451, 0xa453, 
+	0xa620, 0xa622, 0xa621, 0xa623, 0xa260, 0xa262, 0xa261, 0xa263, 
+	0xa610, 0xa612, 0xa611, 0xa613, 0xa160, 0xa162, 0xa161, 0xa163, 
+	0xa600, 0xa602, 0xa060, 0xa061, 0xa530, 0xa532, 0xa531, 0xa533, 
+	0xa350, 0xa352, 0xa351, 0xa353, 0xa440, 0xa442, 0xa441, 0xa443, 
+	0xa520, 0xa522, 0xa521, 0xa523, 0xa250, 0xa252, 0xa251, 0xa253, 
+	0xa510, 0xa512, 0xa511, 0xa513, 0xa500, 0xa502, 0xa050, 0xa051, 
+	0x9150, 0x9150, 0x9152, 0x9152, 0x9151, 0x9151, 0x9153, 0x9153, 
+	0xa430, 0xa432, 0xa431, 0xa433, 0xa340, 0xa342, 0xa341, 0xa343, 
+	0x9420, 0x9420, 0x9422, 0x9422, 0x9421, 0x9421, 0x9423, 0x9423, 
+	0x9240, 0x9240, 0x9242, 0x9242, 0x9241, 0x9241, 0x9243, 0x9243, 
+	0x9330, 0x9330, 0x9332, 0x9332, 0x9331, 0x9331, 0x9333, 0x9333, 
+	0x9410, 0x9410, 0x9412, 0x9412, 0x9411, 0x9411, 0x9413, 0x9413, 
+	0x9140, 0x9140, 0x9142, 0x9142, 0x9141, 0x9141, 0x9143, 0x9143, 
+	0x9400, 0x9400, 0x9402, 0x9402, 0x9040, 0x9040, 0x9041, 0x9041, 
+	0x9320, 0x9320, 0x9322, 0x9322, 0x9321, 0x9321, 0x9323, 0x9323, 
+	0x9230, 0x9230, 0x9232, 0x9232, 0x9231, 0x9231, 0x9233, 0x9233, 
+	0x8310, 0x8310, 0x8310, 0x8310, 0x8312, 0x8312, 0x8312, 0x8312, 
+	0x8311, 0x8311, 0x8311, 0x8311, 0x8313, 0x8313, 0x8313, 0x8313, 
+	0x8130, 0x8130, 0x8130, 0x8130, 0x8132, 0x8132, 0x8132, 0x8132, 
+	0x8131, 0x8131, 0x8131, 0x8131, 0x8133, 0x8133, 0x8133, 0x8133, 
+	0x8300, 0x8300, 0x8300, 0x8300, 0x8302, 0x8302, 0x8302, 0x8302, 
+	0x8030, 0x8030, 0x8030, 0x8030, 0x8031, 0x8031, 0x8031, 0x8031, 
+	0x8220, 0x8220, 0x8220, 0x8220, 0x8222, 0x8222, 0x8222, 0x8222, 
+	0x8221, 0x8221, 0x8221, 0x8221, 0x8223, 0x8223, 0x8223, 0x8223, 
+	0x7210, 0x7210, 0x7210, 0x7210, 0x7210, 0x7210, 0x7210, 0x7210, 
+	0x7212, 0x7212, 0x7212, 0x7212, 0x7212, 0x7212, 0x7212, 0x7212, 
+	0x7211, 0x7211, 0x7211, 0x7211, 0x7211, 0x7211, 0x7211, 0x7211, 
+	0x7213, 0x7213, 0x7213, 0x7213, 0x7213, 0x7213, 0x7213, 0x7213, 
+	0x7120, 0x7120, 0x7120, 0x7120, 0x7120, 0x7120, 0x7120, 0x7120, 
+	0x7122, 0x7122, 0x7122, 0x7122, 0x7122, 0x7122, 0x7122, 0x7122, 
+	0x7121, 0x7121, 0x7121, 0x7121, 0x7121, 0x7121, 0x7121, 0x7121, 
+	0x7123, 0x7123, 0x7123, 0x7123, 0x7123, 0x7123, 0x7123, 0x7123, 
+	0x7200, 0x7200, 0x7200, 0x7200, 0x7200, 0x7200, 0x7200, 0x7200, 
+	0x7202, 0x7202, 0x7202, 0x7202, 0x7202, 0x7202, 0x7202, 0x7202, 
+	0x7020, 0x7020, 0x7020, 0x7020, 0x7020, 0x7020, 0x7020, 0x7020, 
+	0x7021, 0x7021, 0x7021, 0x7021, 0x7021, 0x7021, 0x7021, 0x7021, 
+	0x6110, 0x6110, 0x6110, 0x6110, 0x6110, 0x6110, 0x6110, 0x6110, 
+	0x6110, 0x6110, 0x6110, 0x6110, 0x6110, 0x6110, 0x6110, 0x6110, 
+	0x6112, 0x6112, 0x6112, 0x6112, 0x6112, 0x6112, 0x6112, 0x6112, 
+	0x6112, 0x6112, 0x6112, 0x6112, 0x6112, 0x6112, 0x6112, 0x6112, 
+	0x6111, 0x6111, 0x6111, 0x6111, 0x6111, 0x6111, 0x6111, 0x6111, 
+	0x6111, 0x6111, 0x6111, 0x6111, 0x6111, 0x6111, 0x6111, 0x6111, 
+	0x6113, 0x6113, 0x6113, 0x6113, 0x6113, 0x6113, 0x6113, 0x6113, 
+	0x6113, 0x6113, 0x6113, 0x6113, 0x6113, 0x6113, 0x6113, 0x6113, 
+	0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 
+	0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 
+	0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 
+	0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 0x5100, 
+	0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 
+	0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 
+	0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 
+	0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 0x5102, 
+	0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 
+	0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 
+	0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 
+	0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 
+	0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 
+	0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 
+	0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 
+	0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 
+	0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 
+	0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 
+	0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 
+	0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 
+	0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 
+	0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 
+	0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 
+	0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 
+};
+
+#define HUFF_LOOK_01	 0
+#define HUFF_LOOK_02	(1*(1 << HUFF_LOOK_BITS))
+#define HUFF_LOOK_03	(2*(1 << HUFF_LOOK_BITS))
+#define HUFF_LOOK_05	(3*(1 << HUFF_LOOK_BITS))
+#define HUFF_LOOK_06	(4*(1 << HUFF_LOOK_BITS))
+#define HUFF_LOOK_07	(5*(1 << HUFF_LOOK_BITS))
+#define HUFF_LOOK_08	(6*(1 << HUFF_LOOK_BITS))
+#define HUFF_LOOK_09	(7*(1 << HUFF_LOOK_BITS))
+#define HUFF_LOOK_10	(8*(1 << HUFF_LOOK_BITS))
+#define HUFF_LOOK_11	(9*(1 << HUFF_LOOK_BITS))
+#define HUFF_LOOK_12	(10*(1 << HUFF_LOOK_BITS))
+#define HUFF_LOOK_13	(11*(1 << HUFF_LOOK_BITS))
+#define HUFF_LOOK_15	(12*(1 << HUFF_LOOK_BITS))
+#define HUFF_LOOK_16	(13*(1 << HUFF_LOOK_BITS))
+#define HUFF_LOOK_24	(14*(1 << HUFF_LOOK_BITS))
+
+const int huffLookOffset[HUFF_PAIRTABS] = {
+	0,
+	HUFF_LOOK_01,
+	HUFF_LOOK_02,
+	HUFF_LOOK_03,
+	0,
+	HUFF_LOOK_05,
+	HUFF_LOOK_06,
+	HUFF_LOOK_07,
+	HUFF_LOOK_08,
+	HUFF_LOOK_09,
+	HUFF_LOOK_10,
+	HUFF_LOOK_11,
+	HUFF_LOOK_12,
+	HUFF_LOOK_13,
+	0,
+	HUFF_LOOK_15,
+	HUFF_LOOK_16,
+	HUFF_LOOK_16,
+	HUFF_LOOK_16,
+	HUFF_LOOK_16,
+	HUFF_LOOK_16,
+	HUFF_LOOK_16,
+	HUFF_LOOK_16,
+	HUFF_LOOK_16,
+	HUFF_LOOK_24,
+	HUFF_LOOK_24,
+	HUFF_LOOK_24,
+	HUFF_LOOK_24,
+	HUFF_LOOK_24,
+	HUFF_LOOK_24,
+	HUFF_LOOK_24,
+	HUFF_LOOK_24
+};
+
+/* quad format 0xA0BC
+ *  A = number of bits to remove from the bitstream (codeword and sign bits)
+ *  B = vwxy values (one bit each, v = MSB)
+ *  C = signs of vwxy (same order)
+ */
+const unsigned short quadLookTable[] = {
+	/* quadLookA[1024] */
+	0x90b0, 0x90b0, 0x90b1, 0x90b1, 0x90b2, 0x90b2, 0x90b3, 0x90b3, 
+	0x90b8, 0x90b8, 0x90b9, 0x90b9, 0x90ba, 0x90ba, 0x90bb, 0x90bb, 
+	0xa0f0, 0xa0f1, 0xa0f2, 0xa0f3, 0xa0f4, 0xa0f5, 0xa0f6, 0xa0f7, 
+	0xa0f8, 0xa0f9, 0xa0fa, 0xa0fb, 0xa0fc, 0xa0fd, 0xa0fe, 0xa0ff, 
+	0x90d0, 0x90d0, 0x90d1, 0x90d1, 0x90d4, 0x90d4, 0x90d5, 0x90d5, 
+	0x90d8, 0x90d8, 0x90d9, 0x90d9, 0x90dc, 0x90dc, 0x90dd, 0x90dd, 
+	0x90e0, 0x90e0, 0x90e2, 0x90e2, 0x90e4, 0x90e4, 0x90e6, 0x90e6, 
+	0x90e8, 0x90e8, 0x90ea, 0x90ea, 0x90ec, 0x90ec, 0x90ee, 0x90ee, 
+	0x9070, 0x9070, 0x9071, 0x9071, 0x9072, 0x9072, 0x9073, 0x9073, 
+	0x9074, 0x9074, 0x9075, 0x9075, 0x9076, 0x9076, 0x9077, 0x9077, 
+	0x8050, 0x8050, 0x8050, 0x8050, 0x8051, 0x8051, 0x8051, 0x8051, 
+	0x8054, 0x8054, 0x8054, 0x8054, 0x8055, 0x8055, 0x8055, 0x8055, 
+	0x7090, 0x7090, 0x7090, 0x7090, 0x7090, 0x7090, 0x7090, 0x7090, 
+	0x7091, 0x7091, 0x7091, 0x7091, 0x7091, 0x7091, 0x7091, 0x7091, 
+	0x7098, 0x7098, 0x7098, 0x7098, 0x7098, 0x7098, 0x7098, 0x7098, 
+	0x7099, 0x7099, 0x7099, 0x7099, 0x7099, 0x7099, 0x7099, 0x7099, 
+	0x7060, 0x7060, 0x7060, 0x7060, 0x7060, 0x7060, 0x7060, 0x7060, 
+	0x7062, 0x7062, 0x7062, 0x7062, 0x7062, 0x7062, 0x7062, 0x7062, 
+	0x7064, 0x7064, 0x7064, 0x7064, 0x7064, 0x7064, 0x7064, 0x7064, 
+	0x7066, 0x7066, 0x7066, 0x7066, 0x7066, 0x7066, 0x7066, 0x7066, 
+	0x7030, 0x7030, 0x7030, 0x7030, 0x7030, 0x7030, 0x7030, 0x7030, 
+	0x7031, 0x7031, 0x7031, 0x7031, 0x7031, 0x7031, 0x7031, 0x7031, 
+	0x7032, 0x7032, 0x7032, 0x7032, 0x7032, 0x7032, 0x7032, 0x7032, 
+	0x7033, 0x7033, 0x7033, 0x7033, 0x7033, 0x7033, 0x7033, 0x7033, 
+	0x70a0, 0x70a0, 0x70a0, 0x70a0, 0x70a0, 0x70a0, 0x70a0, 0x70a0, 
+	0x70a2, 0x70a2, 0x70a2, 0x70a2, 0x70a2, 0x70a2, 0x70a2, 0x70a2, 
+	0x70a8, 0x70a8, 0x70a8, 0x70a8, 0x70a8, 0x70a8, 0x70a8, 0x70a8, 
+	0x70aa, 0x70aa, 0x70aa, 0x70aa, 0x70aa, 0x70aa, 0x70aa, 0x70aa, 
+	0x70c0, 0x70c0, 0x70c0, 0x70c0, 0x70c0, 0x70c0, 0x70c0, 0x70c0, 
+	0x70c4, 0x70c4, 0x70c4, 0x70c4, 0x70c4, 0x70c4, 0x70c4, 0x70c4, 
+	0x70c8, 0x70c8, 0x70c8, 0x70c8, 0x70c8, 0x70c8, 0x70c8, 0x70c8, 
+	0x70cc, 0x70cc, 0x70cc, 0x70cc, 0x70cc, 0x70cc, 0x70cc, 0x70cc, 
+	0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 
+	0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 
+	0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 
+	0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 
+	0x5022, 0x5022, 0x5022, 0x5022, 0x5022, 0x5022, 0x5022, 0x5022, 
+	0x5022, 0x5022, 0x5022, 0x5022, 0x5022, 0x5022, 0x5022, 0x5022, 
+	0x5022, 0x5022, 0x5022, 0x5022, 0x5022, 0x5022, 0x5022, 0x5022, 
+	0x5022, 0x5022, 0x5022, 0x5022, 0x5022, 0x5022, 0x5022, 0x5022, 
+	0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 
+	0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 
+	0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 
+	0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 
+	0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 
+	0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 
+	0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 
+	0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 
+	0x5040, 0x5040, 0x5040, 0x5040, 0x5040, 0x5040, 0x5040, 0x5040, 
+	0x5040, 0x5040, 0x5040, 0x5040, 0x5040, 0x5040, 0x5040, 0x5040, 
+	0x5040, 0x5040, 0x5040, 0x5040, 0x5040, 0x5040, 0x5040, 0x5040, 
+	0x5040, 0x5040, 0x5040, 0x5040, 0x5040, 0x5040, 0x5040, 0x5040, 
+	0x5044, 0x5044, 0x5044, 0x5044, 0x5044, 0x5044, 0x5044, 0x5044, 
+	0x5044, 0x5044, 0x5044, 0x5044, 0x5044, 0x5044, 0x5044, 0x5044, 
+	0x5044, 0x5044, 0x5044, 0x5044, 0x5044, 0x5044, 0x5044, 0x5044, 
+	0x5044, 0x5044, 0x5044, 0x5044, 0x5044, 0x5044, 0x5044, 0x5044, 
+	0x5080, 0x5080, 0x5080, 0x5080, 0x5080, 0x5080, 0x5080, 0x5080, 
+	0x5080, 0x5080, 0x5080, 0x5080, 0x5080, 0x5080, 0x5080, 0x5080, 
+	0x5080, 0x5080, 0x5080, 0x5080, 0x5080, 0x5080, 0x5080, 0x5080, 
+	0x5080, 0x5080, 0x5080, 0x5080, 0x5080, 0x5080, 0x5080, 0x5080, 
+	0x5088, 0x5088, 0x5088, 0x5088, 0x5088, 0x5088, 0x5088, 0x5088, 
+	0x5088, 0x5088, 0x5088, 0x5088, 0x5088, 0x5088, 0x5088, 0x5088, 
+	0x5088, 0x5088, 0x5088, 0x5088, 0x5088, 0x5088, 0x5088, 0x5088, 
+	0x5088, 0x5088, 0x5088, 0x5088, 0x5088, 0x5088, 0x5088, 0x5088, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+	0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 
+
+	/* quadLookB[256] */
+	0x80f0, 0x80f1, 0x80f2, 0x80f3, 0x80f4, 0x80f5, 0x80f6, 0x80f7, 
+	0x80f8, 0x80f9, 0x80fa, 0x80fb, 0x80fc, 0x80fd, 0x80fe, 0x80ff, 
+	0x70e0, 0x70e0, 0x70e2, 0x70e2, 0x70e4, 0x70e4, 0x70e6, 0x70e6, 
+	0x70e8, 0x70e8, 0x70ea, 0x70ea, 0x70ec, 0x70ec, 0x70ee, 0x70ee, 
+	0x70d0, 0x70d0, 0x70d1, 0x70d1, 0x70d4, 0x70d4, 0x70d5, 0x70d5, 
+	0x70d8, 0x70d8, 0x70d9, 0x70d9, 0x70dc, 0x70dc, 0x70dd, 0x70dd, 
+	0x60c0, 0x60c0, 0x60c0, 0x60c0, 0x60c4, 0x60c4, 0x60c4, 0x60c4, 
+	0x60c8, 0x60c8, 0x60c8, 0x60c8, 0x60cc, 0x60cc, 0x60cc, 0x60cc, 
+	0x70b0, 0x70b0, 0x70b1, 0x70b1, 0x70b2, 0x70b2, 0x70b3, 0x70b3, 
+	0x70b8, 0x70b8, 0x70b9, 0x70b9, 0x70ba, 0x70ba, 0x70bb, 0x70bb, 
+	0x60a0, 0x60a0, 0x60a0, 0x60a0, 0x60a2, 0x60a2, 0x60a2, 0x60a2, 
+	0x60a8, 0x60a8, 0x60a8, 0x60a8, 0x60aa, 0x60aa, 0x60aa, 0x60aa, 
+	0x6090, 0x6090, 0x6090, 0x6090, 0x6091, 0x6091, 0x6091, 0x6091, 
+	0x6098, 0x6098, 0x6098, 0x6098, 0x6099, 0x6099, 0x6099, 0x6099, 
+	0x5080, 0x5080, 0x5080, 0x5080, 0x5080, 0x5080, 0x5080, 0x5080, 
+	0x5088, 0x5088, 0x5088, 0x5088, 0x5088, 0x5088, 0x5088, 0x5088, 
+	0x7070, 0x7070, 0x7071, 0x7071, 0x7072, 0x7072, 0x7073, 0x7073, 
+	0x7074, 0x7074, 0x7075, 0x7075, 0x7076, 0x7076, 0x7077, 0x7077, 
+	0x6060, 0x6060, 0x6060, 0x6060, 0x6062, 0x6062, 0x6062, 0x6062, 
+	0x6064, 0x6064, 0x6064, 0x6064, 0x6066, 0x6066, 0x6066, 0x6066, 
+	0x6050, 0x6050, 0x6050, 0x6050, 0x6051, 0x6051, 0x6051, 0x6051, 
+	0x6054, 0x6054, 0x6054, 0x6054, 0x6055, 0x6055, 0x6055, 0x6055, 
+	0x5040, 0x5040, 0x5040, 0x5040, 0x5040, 0x5040, 0x5040, 0x5040, 
+	0x5044, 0x5044, 0x5044, 0x5044, 0x5044, 0x5044, 0x5044, 0x5044, 
+	0x6030, 0x6030, 0x6030, 0x6030, 0x6031, 0x6031, 0x6031, 0x6031, 
+	0x6032, 0x6032, 0x6032, 0x6032, 0x6033, 0x6033, 0x6033, 0x6033, 
+	0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 0x5020, 
+	0x5022, 0x5022, 0x5022, 0x5022, 0x5022, 0x5022, 0x5022, 0x5022, 
+	0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 0x5010, 
+	0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 0x5011, 
+	0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 
+	0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 
+};
+
+const int quadLookOffset[2] = {0, 1024};
+const int quadLookBits[2] = {10, 8};
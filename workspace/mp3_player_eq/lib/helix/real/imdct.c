@@ -45,6 +45,87 @@
 #include "coder.h"
 #include "assembly.h"
 
+/* batched path, picked at build time: IMDCT_VLEN subbands per pass (one per 32-bit lane)
+ *   AVX2 (x86-64)    - 8 subbands
+ *   SSE4.1 (x86-64)  - 4 subbands
+ *   otherwise        - scalar only (the M4 packed DSP ops are 16-bit, which would not be bit-exact)
+ */
+#if defined(__x86_64__) && defined(__AVX2__)
+#define IMDCT_SIMD
+#define IMDCT_VLEN	8
+#include <immintrin.h>
+
+typedef __m256i IVec;
+
+#define VLOAD(p)		_mm256_loadu_si256((const __m256i *)(p))
+#define VSTORE(p, v)	_mm256_storeu_si256((__m256i *)(p), (v))
+#define VSET1(c)		_mm256_set1_epi32(c)
+#define VADD(a, b)		_mm256_add_epi32(a, b)
+#define VSUB(a, b)		_mm256_sub_epi32(a, b)
+#define VSRA(a, n)		_mm256_srai_epi32(a, n)
+#define VSLL(a, n)		_mm256_slli_epi32(a, n)
+#define VOR(a, b)		_mm256_or_si256(a, b)
+#define VXOR(a, b)		_mm256_xor_si256(a, b)
+#define VABS(a)			_mm256_abs_epi32(a)		/* abs(0x80000000) = 0x80000000, same as FASTABS */
+#define VREV(a)			_mm256_permutevar8x32_epi32(a, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0))
+#define VODDLANES()		_mm256_setr_epi32(0, -1, 0, -1, 0, -1, 0, -1)
+
+/* MULSHIFT32 on every lane: even lanes from the low words, odd lanes from the high words */
+static __inline IVec VMULSHIFT32(IVec a, IVec b)
+{
+	IVec even = _mm256_srli_epi64(_mm256_mul_epi32(a, b), 32);
+	IVec odd = _mm256_mul_epi32(_mm256_srli_epi64(a, 32), _mm256_srli_epi64(b, 32));
+
+	return _mm256_blend_epi32(even, odd, 0xaa);
+}
+
+static __inline int VORLANES(IVec v)
+{
+	__m128i s = _mm_or_si128(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+
+	s = _mm_or_si128(s, _mm_shuffle_epi32(s, 0x4e));
+	s = _mm_or_si128(s, _mm_shuffle_epi32(s, 0xb1));
+	return _mm_cvtsi128_si32(s);
+}
+
+#elif defined(__x86_64__) && defined(__SSE4_1__)
+#define IMDCT_SIMD
+#define IMDCT_VLEN	4
+#include <smmintrin.h>
+
+typedef __m128i IVec;
+
+#define VLOAD(p)		_mm_loadu_si128((const __m128i *)(p))
+#define VSTORE(p, v)	_mm_storeu_si128((__m128i *)(p), (v))
+#define VSET1(c)		_mm_set1_epi32(c)
+#define VADD(a, b)		_mm_add_epi32(a, b)
+#define VSUB(a, b)		_mm_sub_epi32(a, b)
+#define VSRA(a, n)		_mm_srai_epi32(a, n)
+#define VSLL(a, n)		_mm_slli_epi32(a, n)
+#define VOR(a, b)		_mm_or_si128(a, b)
+#define VXOR(a, b)		_mm_xor_si128(a, b)
+#define VABS(a)			_mm_abs_epi32(a)		/* abs(0x80000000) = 0x80000000, same as FASTABS */
+#define VREV(a)			_mm_shuffle_epi32(a, 0x1b)
+#define VODDLANES()		_mm_setr_epi32(0, -1, 0, -1)
+
+/* MULSHIFT32 on every lane: even lanes from the low words, odd lanes from the high words */
+static __inline IVec VMULSHIFT32(IVec a, IVec b)
+{
+	IVec even = _mm_srli_epi64(_mm_mul_epi32(a, b), 32);
+	IVec odd = _mm_mul_epi32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+
+	return _mm_blend_epi16(even, odd, 0xcc);
+}
+
+static __inline int VORLANES(IVec v)
+{
+	v = _mm_or_si128(v, _mm_shuffle_epi32(v, 0x4e));
+	v = _mm_or_si128(v, _mm_shuffle_epi32(v, 0xb1));
+	return _mm_cvtsi128_si32(v);
+}
+
+#endif
+
 /**************************************************************************************
  * Function:    AntiAlias
  *
@@ -69,6 +150,32 @@
  *                (should be guaranteed from dequant, and max gain from stproc * max 
  *                 gain from AntiAlias < 2.0)
  **************************************************************************************/
+#ifdef IMDCT_SIMD
+static void AntiAlias(int *x, int nBfly)
+{
+	int j, k, c0[8], c1[8];
+	IVec a0, b0, vc0, vc1;
+
+	/* csa = Q31, split into the cos and sin coefficients of the 8 butterflies */
+	for (j = 0; j < 8; j++) {
+		c0[j] = csa[j][0];
+		c1[j] = csa[j][1];
+	}
+
+	/* the 8 butterflies of a boundary are independent, lane j does x[-1-j] and x[j] */
+	for (k = nBfly; k > 0; k--) {
+		x += 18;
+		for (j = 0; j < 8; j += IMDCT_VLEN) {
+			a0 = VREV(VLOAD(x - j - IMDCT_VLEN));
+			b0 = VLOAD(x + j);
+			vc0 = VLOAD(c0 + j);
+			vc1 = VLOAD(c1 + j);
+			VSTORE(x - j - IMDCT_VLEN, VREV(VSLL(VSUB(VMULSHIFT32(vc0, a0), VMULSHIFT32(vc1, b0)), 1)));
+			VSTORE(x + j, VSLL(VADD(VMULSHIFT32(vc0, b0), VMULSHIFT32(vc1, a0)), 1));
+		}
+	}
+}
+#else
 static void AntiAlias(int *x, int nBfly)
 {
 	int k, a0, b0, c0, c1;
@@ -112,6 +219,7 @@ static void AntiAlias(int *x, int nBfly)
 		x[7] =  (MULSHIFT32(c0, b0) + MULSHIFT32(c1, a0)) << 1;
 	}
 }
+#endif	/* IMDCT_SIMD */
 
 /**************************************************************************************
  * Function:    WinPrevious
@@ -462,6 +570,160 @@ static int IMDCT36(int *xCurr, int *xPrev, int *y, int btCurr, int btPrev, int b
 	return mOut;
 }
 
+#ifdef IMDCT_SIMD
+/**************************************************************************************
+ * Function:    idct9V
+ *
+ * Description: idct9 on IMDCT_VLEN subbands at once, same operations lane by lane
+ **************************************************************************************/
+static __inline void idct9V(IVec *x)
+{
+	IVec a1, a2, a3, a4, a5, a6, a7, a8, a9;
+	IVec a10, a11, a12, a13, a14, a15, a16, a17, a18;
+	IVec a19, a20, a21, a22, a23, a24, a25, a26, a27;
+	IVec m1, m3, m5, m6, m7, m8, m9, m10, m11, m12;
+	IVec x0, x1, x2, x3, x4, x5, x6, x7, x8;
+
+	x0 = x[0]; x1 = x[1]; x2 = x[2]; x3 = x[3]; x4 = x[4];
+	x5 = x[5]; x6 = x[6]; x7 = x[7]; x8 = x[8];
+
+	a1 = VSUB(x0, x6);
+	a2 = VSUB(x1, x5);
+	a3 = VADD(x1, x5);
+	a4 = VSUB(x2, x4);
+	a5 = VADD(x2, x4);
+	a6 = VADD(x2, x8);
+	a7 = VADD(x1, x7);
+
+	a8 = VSUB(a6, a5);
+	a9 = VSUB(a3, a7);
+	a10 = VSUB(a2, x7);
+	a11 = VSUB(a4, x8);
+
+	m1 =  VMULSHIFT32(VSET1(c9_0), x3);
+	m3 =  VMULSHIFT32(VSET1(c9_0), a10);
+	m5 =  VMULSHIFT32(VSET1(c9_1), a5);
+	m6 =  VMULSHIFT32(VSET1(c9_2), a6);
+	m7 =  VMULSHIFT32(VSET1(c9_1), a8);
+	m8 =  VMULSHIFT32(VSET1(c9_2), a5);
+	m9 =  VMULSHIFT32(VSET1(c9_3), a9);
+	m10 = VMULSHIFT32(VSET1(c9_4), a7);
+	m11 = VMULSHIFT32(VSET1(c9_3), a3);
+	m12 = VMULSHIFT32(VSET1(c9_4), a9);
+
+	a12 = VADD(x0, VSRA(x6, 1));
+	a13 = VADD(a12, VSLL(m1, 1));
+	a14 = VSUB(a12, VSLL(m1, 1));
+	a15 = VADD(a1, VSRA(a11, 1));
+	a16 = VADD(VSLL(m5, 1), VSLL(m6, 1));
+	a17 = VSUB(VSLL(m7, 1), VSLL(m8, 1));
+	a18 = VADD(a16, a17);
+	a19 = VADD(VSLL(m9, 1), VSLL(m10, 1));
+	a20 = VSUB(VSLL(m11, 1), VSLL(m12, 1));
+
+	a21 = VSUB(a20, a19);
+	a22 = VADD(a13, a16);
+	a23 = VADD(a14, a16);
+	a24 = VADD(a14, a17);
+	a25 = VADD(a13, a17);
+	a26 = VSUB(a14, a18);
+	a27 = VSUB(a13, a18);
+
+	x[0] = VADD(a22, a19);
+	x[1] = VADD(a15, VSLL(m3, 1));
+	x[2] = VADD(a24, a20);
+	x[3] = VSUB(a26, a21);
+	x[4] = VSUB(a1, a11);
+	x[5] = VADD(a27, a21);
+	x[6] = VSUB(a25, a20);
+	x[7] = VSUB(a15, VSLL(m3, 1));
+	x[8] = VSUB(a23, a19);
+}
+
+/**************************************************************************************
+ * Function:    IMDCT36xN
+ *
+ * Description: IMDCT36 on IMDCT_VLEN consecutive subbands, one per lane
+ *
+ * Inputs:      vector of IMDCT_VLEN * 18 coefficients
+ *              overlap part of last IMDCT (IMDCT_VLEN * 9 samples)
+ *              output of the first subband (row stride NBANDS, as in IMDCT36)
+ *              index of the first subband
+ *
+ * Outputs:     same as IMDCT36 for each subband
+ *
+ * Return:      mOut (OR of abs(y) for all y calculated here)
+ *
+ * Notes:       only the fast path: window type 0 for current and previous block, and
+ *                at least 7 guard bits in the input (es = 0, no rescaling)
+ *              subbands are transposed so lane b holds subband blockIdx + b, the 
+ *                outputs y[i][blockIdx...] are contiguous so they are stored directly
+ *              same operations as IMDCT36, so the output is bit-exact
+ **************************************************************************************/
+static int IMDCT36xN(int *xCurr, int *xPrev, int *y, int blockIdx)
+{
+	int i, b, xt[18][IMDCT_VLEN], pt[9][IMDCT_VLEN];
+	IVec x[18], acc1, acc2, xo, xe, s, d, t, yLo, yHi, mOut, inv;
+
+	for (b = 0; b < IMDCT_VLEN; b++) {
+		for (i = 0; i < 18; i++)
+			xt[i][b] = xCurr[18*b + i];
+		for (i = 0; i < 9; i++)
+			pt[i][b] = xPrev[9*b + i];
+	}
+
+	/* max gain = 18, assume adequate guard bits */
+	acc1 = acc2 = VSET1(0);
+	for (i = 8; i >= 0; i--) {
+		acc1 = VSUB(VLOAD(xt[2*i+1]), acc1);
+		acc2 = VSUB(acc1, acc2);
+		acc1 = VSUB(VLOAD(xt[2*i+0]), acc1);
+		x[i+9] = acc2;	/* odd */
+		x[i+0] = acc1;	/* even */
+	}
+	/* xEven[0] and xOdd[0] scaled by 0.5 */
+	x[9] = VSRA(x[9], 1);
+	x[0] = VSRA(x[0], 1);
+
+	idct9V(x+0);	/* even */
+	idct9V(x+9);	/* odd */
+
+	/* frequency inversion of odd samples in odd subbands, negate as (y ^ -1) - (-1) */
+	inv = VODDLANES();
+	if (blockIdx & 0x01)
+		inv = VXOR(inv, VSET1(-1));
+
+	mOut = VSET1(0);
+	for (i = 0; i < 9; i++) {
+		xo = VMULSHIFT32(VSET1(c18[8-i]), x[17-i]);
+		xe = VSRA(x[8-i], 2);
+
+		s = VSUB(VSET1(0), VLOAD(pt[i]));
+		d = VSUB(xo, xe);
+		VSTORE(pt[i], VADD(xe, xo));
+		t = VSUB(s, d);
+
+		yLo = VADD(d, VSLL(VMULSHIFT32(t, VSET1(fastWin36[2*i+0])), 2));
+		yHi = VADD(s, VSLL(VMULSHIFT32(t, VSET1(fastWin36[2*i+1])), 2));
+		if (i & 0x01)
+			yLo = VSUB(VXOR(yLo, inv), inv);
+		else
+			yHi = VSUB(VXOR(yHi, inv), inv);
+
+		VSTORE(y + (i)*NBANDS, yLo);
+		VSTORE(y + (17-i)*NBANDS, yHi);
+		mOut = VOR(mOut, VOR(VABS(yLo), VABS(yHi)));
+	}
+
+	for (b = 0; b < IMDCT_VLEN; b++) {
+		for (i = 0; i < 9; i++)
+			xPrev[9*b + i] = pt[i][b];
+	}
+
+	return VORLANES(mOut);
+}
+#endif	/* IMDCT_SIMD */
+
 static const int c3_0 = 0x6ed9eba1;	/* format = Q31, cos(pi/6) */
 static const int c6[3] = { 0x7ba3751d, 0x5a82799a, 0x2120fb83 };	/* format = Q31, cos(((0:2) + 0.5) * (pi/6)) */
 
@@ -626,9 +888,21 @@ static int HybridTransform(int *xCurr, int *xPrev, int y[BLOCK_SIZE][NBANDS], Si
 	ASSERT(bc->nBlocksPrev  <= NBANDS);
 
 	mOut = 0;
+	i = 0;
+
+#ifdef IMDCT_SIMD
+	/* window type 0 on both sides and no rescaling (the usual case), IMDCT_VLEN subbands per pass */
+	if (sis->blockType == 0 && bc->prevType == 0 && bc->gbIn >= 7) {
+		for (   ; i + IMDCT_VLEN <= bc->nBlocksLong; i += IMDCT_VLEN) {
+			mOut |= IMDCT36xN(xCurr, xPrev, &(y[0][i]), i);
+			xCurr += 18*IMDCT_VLEN;
+			xPrev += 9*IMDCT_VLEN;
+		}
+	}
+#endif
 
 	/* do long blocks, if any */
-	for(i = 0; i < bc->nBlocksLong; i++) {
+	for(   ; i < bc->nBlocksLong; i++) {
 		/* currWinIdx picks the right window for long blocks (if mixed, long blocks use window type 0) */
 		currWinIdx = sis->blockType;
 		if (sis->mixedBlock && i < bc->currWinSwitch) 
@@ -716,7 +990,7 @@ static int HybridTransform(int *xCurr, int *xPrev, int y[BLOCK_SIZE][NBANDS], Si
  **************************************************************************************/
 int IMDCT(MP3DecInfo *mp3DecInfo, int gr, int ch)
 {
-	int nBfly, blockCutoff;
+	int nBfly, blockCutoff, nBlocksBand;
 	FrameHeader *fh;
 	SideInfo *si;
 	HuffmanInfo *hi;
@@ -754,13 +1028,32 @@ int IMDCT(MP3DecInfo *mp3DecInfo, int gr, int ch)
 		nBfly = 0;
 	}
  
+	/* half rate, the subbands above 16 are not synthesized so they are not transformed either,
+	 *   (the butterfly between subbands 15 and 16 is kept, it corrects subband 15)
+	 *   HybridTransform flushes their overlap and zeroes their output
+	 */
+	if (mp3DecInfo->halfRate)
+		nBfly = MIN(nBfly, NBANDS/2);
+
 	AntiAlias(hi->huffDecBuf[ch], nBfly);
 	hi->nonZeroBound[ch] = MAX(hi->nonZeroBound[ch], (nBfly * 18) + 8);
+	if (mp3DecInfo->halfRate)
+		hi->nonZeroBound[ch] = MIN(hi->nonZeroBound[ch], (NBANDS/2) * 18);
 
 	ASSERT(hi->nonZeroBound[ch] <= MAX_NSAMP);
 
 	/* for readability, use a struct instead of passing a million parameters to HybridTransform() */
 	bc.nBlocksTotal = (hi->nonZeroBound[ch] + 17) / 18;
+
+	/* the blocks above the non-zero critical bands (plus the spill of the last butterfly) which have 
+	 *   no overlap left from the previous granule are zero in and out, so they are cleared instead 
+	 *   of transformed (a silent granule transforms nothing once its overlap is played out)
+	 * the zero blocks with overlap are still transformed, their overlap played out by IMDCT36()
+	 *   rounds differently than through WinPrevious()
+	 */
+	nBlocksBand = (hi->bandBound[ch] ? MIN((hi->bandBound[ch] + 7) / 18 + 1, NBANDS) : 0);
+	bc.nBlocksTotal = MIN(bc.nBlocksTotal, MAX(nBlocksBand, mi->numPrevIMDCT[ch]));
+	bc.nBlocksLong = MIN(bc.nBlocksLong, bc.nBlocksTotal);
 	bc.nBlocksPrev = mi->numPrevIMDCT[ch];
 	bc.prevType = mi->prevType[ch];
 	bc.prevWinSwitch = mi->prevWinSwitch[ch];
@@ -768,6 +1061,7 @@ int IMDCT(MP3DecInfo *mp3DecInfo, int gr, int ch)
 	bc.gbIn = hi->gb[ch];
 
 	mi->numPrevIMDCT[ch] = HybridTransform(hi->huffDecBuf[ch], mi->overBuf[ch], mi->outBuf[ch], &si->sis[gr][ch], &bc);
+	mi->numPrevIMDCT[ch] = MIN(mi->numPrevIMDCT[ch], nBlocksBand);	/* the overlap of zero blocks is zero */
 	mi->prevType[ch] = si->sis[gr][ch].blockType;
 	mi->prevWinSwitch[ch] = bc.currWinSwitch;		/* 0 means not a mixed block (either all short or all long) */
 	mi->gb[ch] = bc.gbOut;
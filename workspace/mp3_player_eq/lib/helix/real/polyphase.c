@@ -0,0 +1,660 @@
+/* ***** BEGIN LICENSE BLOCK ***** 
+ * Version: RCSL 1.0/RPSL 1.0 
+ *  
+ * Portions Copyright (c) 1995-2002 RealNetworks, Inc. All Rights Reserved. 
+ *      
+ * The contents of this file, and the files included with this file, are 
+ * subject to the current version of the RealNetworks Public Source License 
+ * Version 1.0 (the "RPSL") available at 
+ * http://www.helixcommunity.org/content/rpsl unless you have licensed 
+ * the file under the RealNetworks Community Source License Version 1.0 
+ * (the "RCSL") available at http://www.helixcommunity.org/content/rcsl, 
+ * in which case the RCSL will apply. You may also obtain the license terms 
+ * directly from RealNetworks.  You may not use this file except in 
+ * compliance with the RPSL or, if you have a valid RCSL with RealNetworks 
+ * applicable to this file, the RCSL.  Please see the applicable RPSL or 
+ * RCSL for the rights, obligations and limitations governing use of the 
+ * contents of the file.  
+ *  
+ * This file is part of the Helix DNA Technology. RealNetworks is the 
+ * developer of the Original Code and owns the copyrights in the portions 
+ * it created. 
+ *  
+ * This file, and the files included with this file, is distributed and made 
+ * available on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER 
+ * EXPRESS OR IMPLIED, AND REALNETWORKS HEREBY DISCLAIMS ALL SUCH WARRANTIES, 
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY, FITNESS 
+ * FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT. 
+ * 
+ * Technology Compatibility Kit Test Suite(s) Location: 
+ *    http://www.helixcommunity.org/content/tck 
+ * 
+ * Contributor(s): 
+ *  
+ * ***** END LICENSE BLOCK ***** */ 
+
+/**************************************************************************************
+ * Fixed-point MP3 decoder
+ * Jon Recker (jrecker@real.com), Ken Cooke (kenc@real.com)
+ * June 2003
+ *
+ * polyphase.c - final stage of subband transform (polyphase synthesis filter)
+ *
+ * This is the C reference version using __int64
+ * Look in the appropriate subdirectories for optimized asm implementations 
+ *   (e.g. arm/asmpoly.s)
+ *
+ * The kernel is picked at build time:
+ *   AVX2 (x86-64)    - 4 taps per 256-bit multiply
+ *   SSE4.1 (x86-64)  - 2 taps per 128-bit multiply
+ *   Cortex-M4 DSP    - SMLAL chain, stereo filtered one channel per pass
+ *   otherwise        - C reference
+ * all of them accumulate the same 64-bit products, so the output is bit-exact
+ **************************************************************************************/
+
+#include "coder.h"
+#include "assembly.h"
+
+#if defined(__x86_64__) && defined(__AVX2__)
+#define POLY_SIMD
+#define POLY_AVX2
+#include <immintrin.h>
+#elif defined(__x86_64__) && defined(__SSE4_1__)
+#define POLY_SIMD
+#define POLY_SSE4		/* pmuldq is SSE4.1, SSE2 only has the unsigned 32x32 -> 64 multiply */
+#include <smmintrin.h>
+#elif defined(ARM_TEST) && defined(__ARM_FEATURE_DSP)
+#define POLY_CM4
+#endif
+
+/* input to Polyphase = Q(DQ_FRACBITS_OUT-2), gain 2 bits in convolution
+ *  we also have the implicit bias of 2^15 to add back, so net fraction bits = 
+ *    DQ_FRACBITS_OUT - 2 - 2 - 15
+ *  (see comment on Dequantize() for more info)
+ */
+#define DEF_NFRACBITS	(DQ_FRACBITS_OUT - 2 - 2 - 15)	
+#define CSHIFT	12	/* coefficients have 12 leading sign bits for early-terminating mulitplies */
+
+static __inline short ClipToShort(int x, int fracBits)
+{
+	int sign;
+	
+	/* assumes you've already rounded (x += (1 << (fracBits-1))) */
+	x >>= fracBits;
+	
+	/* Ken's trick: clips to [-32768, 32767] */
+	sign = x >> 31;
+	if (sign != (x >> 15))
+		x = sign ^ ((1 << 15) - 1);
+
+	return (short)x;
+}
+
+#ifndef POLY_SIMD
+
+#define MC0M(x)	{ \
+	c1 = *coef;		coef++;		c2 = *coef;		coef++; \
+	vLo = *(vb1+(x));			vHi = *(vb1+(23-(x))); \
+	sum1L = MADD64(sum1L, vLo,  c1);	sum1L = MADD64(sum1L, vHi, -c2); \
+}
+
+#define MC1M(x)	{ \
+	c1 = *coef;		coef++; \
+	vLo = *(vb1+(x)); \
+	sum1L = MADD64(sum1L, vLo,  c1); \
+}
+
+#define MC2M(x)	{ \
+		c1 = *coef;		coef++;		c2 = *coef;		coef++; \
+		vLo = *(vb1+(x));	vHi = *(vb1+(23-(x))); \
+		sum1L = MADD64(sum1L, vLo,  c1);	sum2L = MADD64(sum2L, vLo,  c2); \
+		sum1L = MADD64(sum1L, vHi, -c2);	sum2L = MADD64(sum2L, vHi,  c1); \
+}
+
+/**************************************************************************************
+ * Function:    PolyphaseChannel
+ *
+ * Description: filter one subband and produce 32 output PCM samples for one channel
+ *
+ * Inputs:      pointer to PCM output buffer
+ *              pointer to start of vbuf of the channel (preserved from last call)
+ *              start of filter coefficient table (in proper, shuffled order)
+ *              number of interleaved channels in the PCM output buffer
+ *
+ * Outputs:     32 samples of one channel, every nChans samples of pcm
+ *
+ * Return:      none
+ *
+ * Notes:       only two 64-bit accumulators, so they stay in registers on 32-bit cores
+ **************************************************************************************/
+static __inline void PolyphaseChannel(short *pcm, int *vbuf, const int *coefBase, int nChans)
+{
+	int i;
+	const int *coef;
+	int *vb1;
+	int vLo, vHi, c1, c2;
+	Word64 sum1L, sum2L, rndVal;
+
+	rndVal = (Word64)( 1 << (DEF_NFRACBITS - 1 + (32 - CSHIFT)) );
+
+	/* special case, output sample 0 */
+	coef = coefBase;
+	vb1 = vbuf;
+	sum1L = rndVal;
+
+	MC0M(0)
+	MC0M(1)
+	MC0M(2)
+	MC0M(3)
+	MC0M(4)
+	MC0M(5)
+	MC0M(6)
+	MC0M(7)
+
+	*(pcm + 0) = ClipToShort((int)SAR64(sum1L, (32-CSHIFT)), DEF_NFRACBITS);
+
+	/* special case, output sample 16 */
+	coef = coefBase + 256;
+	vb1 = vbuf + 64*16;
+	sum1L = rndVal;
+
+	MC1M(0)
+	MC1M(1)
+	MC1M(2)
+	MC1M(3)
+	MC1M(4)
+	MC1M(5)
+	MC1M(6)
+	MC1M(7)
+
+	*(pcm + 16*nChans) = ClipToShort((int)SAR64(sum1L, (32-CSHIFT)), DEF_NFRACBITS);
+
+	/* main convolution loop: sum1L = samples 1, 2, 3, ... 15   sum2L = samples 31, 30, ... 17 */
+	coef = coefBase + 16;
+	vb1 = vbuf + 64;
+	pcm += nChans;
+
+	/* right now, the compiler creates bad asm from this... */
+	for (i = 15; i > 0; i--) {
+		sum1L = sum2L = rndVal;
+
+		MC2M(0)
+		MC2M(1)
+		MC2M(2)
+		MC2M(3)
+		MC2M(4)
+		MC2M(5)
+		MC2M(6)
+		MC2M(7)
+
+		vb1 += 64;
+		*(pcm)              = ClipToShort((int)SAR64(sum1L, (32-CSHIFT)), DEF_NFRACBITS);
+		*(pcm + 2*i*nChans) = ClipToShort((int)SAR64(sum2L, (32-CSHIFT)), DEF_NFRACBITS);
+		pcm += nChans;
+	}
+}
+
+/**************************************************************************************
+ * Function:    PolyphaseMono
+ *
+ * Description: filter one subband and produce 32 output PCM samples for one channel
+ *
+ * Inputs:      pointer to PCM output buffer
+ *              number of "extra shifts" (vbuf format = Q(DQ_FRACBITS_OUT-2))
+ *              pointer to start of vbuf (preserved from last call)
+ *              start of filter coefficient table (in proper, shuffled order)
+ *              no minimum number of guard bits is required for input vbuf 
+ *                (see additional scaling comments below)
+ *
+ * Outputs:     32 samples of one channel of decoded PCM data, (i.e. Q16.0)
+ *
+ * Return:      none
+ *
+ * TODO:        add 32-bit version for platforms where 64-bit mul-acc is not supported
+ *                (note max filter gain - see polyCoef[] comments)
+ **************************************************************************************/
+void PolyphaseMono(short *pcm, int *vbuf, const int *coefBase)
+{
+	PolyphaseChannel(pcm, vbuf, coefBase, 1);
+}
+
+#endif	/* !POLY_SIMD */
+
+#if !defined(POLY_SIMD) && !defined(POLY_CM4)
+
+#define MC0S(x)	{ \
+	c1 = *coef;		coef++;		c2 = *coef;		coef++; \
+	vLo = *(vb1+(x));		vHi = *(vb1+(23-(x))); \
+	sum1L = MADD64(sum1L, vLo,  c1);	sum1L = MADD64(sum1L, vHi, -c2); \
+	vLo = *(vb1+32+(x));	vHi = *(vb1+32+(23-(x))); \
+	sum1R = MADD64(sum1R, vLo,  c1);	sum1R = MADD64(sum1R, vHi, -c2); \
+}
+
+#define MC1S(x)	{ \
+	c1 = *coef;		coef++; \
+	vLo = *(vb1+(x)); \
+	sum1L = MADD64(sum1L, vLo,  c1); \
+	vLo = *(vb1+32+(x)); \
+	sum1R = MADD64(sum1R, vLo,  c1); \
+}
+
+#define MC2S(x)	{ \
+		c1 = *coef;		coef++;		c2 = *coef;		coef++; \
+		vLo = *(vb1+(x));	vHi = *(vb1+(23-(x))); \
+		sum1L = MADD64(sum1L, vLo,  c1);	sum2L = MADD64(sum2L, vLo,  c2); \
+		sum1L = MADD64(sum1L, vHi, -c2);	sum2L = MADD64(sum2L, vHi,  c1); \
+		vLo = *(vb1+32+(x));	vHi = *(vb1+32+(23-(x))); \
+		sum1R = MADD64(sum1R, vLo,  c1);	sum2R = MADD64(sum2R, vLo,  c2); \
+		sum1R = MADD64(sum1R, vHi, -c2);	sum2R = MADD64(sum2R, vHi,  c1); \
+}
+
+/**************************************************************************************
+ * Function:    PolyphaseStereo
+ *
+ * Description: filter one subband and produce 32 output PCM samples for each channel
+ *
+ * Inputs:      pointer to PCM output buffer
+ *              number of "extra shifts" (vbuf format = Q(DQ_FRACBITS_OUT-2))
+ *              pointer to start of vbuf (preserved from last call)
+ *              start of filter coefficient table (in proper, shuffled order)
+ *              no minimum number of guard bits is required for input vbuf 
+ *                (see additional scaling comments below)
+ *
+ * Outputs:     32 samples of two channels of decoded PCM data, (i.e. Q16.0)
+ *
+ * Return:      none
+ *
+ * Notes:       interleaves PCM samples LRLRLR...
+ *
+ * TODO:        add 32-bit version for platforms where 64-bit mul-acc is not supported
+ **************************************************************************************/
+void PolyphaseStereo(short *pcm, int *vbuf, const int *coefBase)
+{
+	int i;
+	const int *coef;
+	int *vb1;
+	int vLo, vHi, c1, c2;
+	Word64 sum1L, sum2L, sum1R, sum2R, rndVal;
+
+	rndVal = (Word64)( 1 << (DEF_NFRACBITS - 1 + (32 - CSHIFT)) );
+
+	/* special case, output sample 0 */
+	coef = coefBase;
+	vb1 = vbuf;
+	sum1L = sum1R = rndVal;
+
+	MC0S(0)
+	MC0S(1)
+	MC0S(2)
+	MC0S(3)
+	MC0S(4)
+	MC0S(5)
+	MC0S(6)
+	MC0S(7)
+
+	*(pcm + 0) = ClipToShort((int)SAR64(sum1L, (32-CSHIFT)), DEF_NFRACBITS);
+	*(pcm + 1) = ClipToShort((int)SAR64(sum1R, (32-CSHIFT)), DEF_NFRACBITS);
+
+	/* special case, output sample 16 */
+	coef = coefBase + 256;
+	vb1 = vbuf + 64*16;
+	sum1L = sum1R = rndVal;
+
+	MC1S(0)
+	MC1S(1)
+	MC1S(2)
+	MC1S(3)
+	MC1S(4)
+	MC1S(5)
+	MC1S(6)
+	MC1S(7)
+
+	*(pcm + 2*16 + 0) = ClipToShort((int)SAR64(sum1L, (32-CSHIFT)), DEF_NFRACBITS);
+	*(pcm + 2*16 + 1) = ClipToShort((int)SAR64(sum1R, (32-CSHIFT)), DEF_NFRACBITS);
+
+	/* main convolution loop: sum1L = samples 1, 2, 3, ... 15   sum2L = samples 31, 30, ... 17 */
+	coef = coefBase + 16;
+	vb1 = vbuf + 64;
+	pcm += 2;
+
+	/* right now, the compiler creates bad asm from this... */
+	for (i = 15; i > 0; i--) {
+		sum1L = sum2L = rndVal;
+		sum1R = sum2R = rndVal;
+
+		MC2S(0)
+		MC2S(1)
+		MC2S(2)
+		MC2S(3)
+		MC2S(4)
+		MC2S(5)
+		MC2S(6)
+		MC2S(7)
+
+		vb1 += 64;
+		*(pcm + 0)         = ClipToShort((int)SAR64(sum1L, (32-CSHIFT)), DEF_NFRACBITS);
+		*(pcm + 1)         = ClipToShort((int)SAR64(sum1R, (32-CSHIFT)), DEF_NFRACBITS);
+		*(pcm + 2*2*i + 0) = ClipToShort((int)SAR64(sum2L, (32-CSHIFT)), DEF_NFRACBITS);
+		*(pcm + 2*2*i + 1) = ClipToShort((int)SAR64(sum2R, (32-CSHIFT)), DEF_NFRACBITS);
+		pcm += 2;
+	}
+}
+
+#endif	/* !POLY_SIMD && !POLY_CM4 */
+
+#ifdef POLY_CM4
+/**************************************************************************************
+ * Function:    PolyphaseStereo
+ *
+ * Description: filter one subband and produce 32 output PCM samples for each channel
+ *
+ * Inputs:      pointer to PCM output buffer
+ *              pointer to start of vbuf (preserved from last call)
+ *              start of filter coefficient table (in proper, shuffled order)
+ *
+ * Outputs:     32 samples of two channels of decoded PCM data, (i.e. Q16.0)
+ *
+ * Return:      none
+ *
+ * Notes:       interleaves PCM samples LRLRLR...
+ *              the M4 has no 32x32 dual MAC (SMLALD is 16x16, SMMLA drops the low word),
+ *                so the products stay on SMLAL; filtering one channel per pass keeps 
+ *                the accumulators in registers instead of spilling four of them
+ **************************************************************************************/
+void PolyphaseStereo(short *pcm, int *vbuf, const int *coefBase)
+{
+	PolyphaseChannel(pcm + 0, vbuf +  0, coefBase, 2);
+	PolyphaseChannel(pcm + 1, vbuf + 32, coefBase, 2);
+}
+#endif	/* POLY_CM4 */
+
+#ifdef POLY_SIMD
+
+#define POLY_OUT(sum)	ClipToShort((int)SAR64((sum), (32-CSHIFT)), DEF_NFRACBITS)
+
+#if defined(POLY_AVX2)
+
+typedef __m256i PolyVec;
+
+#define VZERO()					_mm256_setzero_si256()
+#define VLOADCOEF(p)			_mm256_loadu_si256((const __m256i *)(p))
+
+/* vb[x] for x = i..i+3, sign-extended to 64-bit lanes */
+#define VLOADLO(vb, i)			_mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i *)((vb) + (i))))
+/* vb[23-x] for x = i..i+3 */
+#define VLOADHI(vb, i)			_mm256_cvtepi32_epi64(_mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)((vb) + 20 - (i))), 0x1b))
+/* coef[x] for x = i..i+3, single coefficients (output sample 16) */
+#define VLOADSINGLE(p, i)		_mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i *)((p) + (i))))
+
+#define VMUL(a, b)				_mm256_mul_epi32(a, b)		/* low word of each 64-bit lane, signed */
+#define VADD(a, b)				_mm256_add_epi64(a, b)
+#define VSUB(a, b)				_mm256_sub_epi64(a, b)
+#define VHIWORD(a)				_mm256_srli_epi64(a, 32)
+
+#define VTAPS	4	/* taps per vector */
+
+static __inline Word64 VSum(PolyVec v)
+{
+	__m128i s = _mm_add_epi64(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+
+	return _mm_cvtsi128_si64(s) + _mm_extract_epi64(s, 1);
+}
+
+#else	/* POLY_SSE4 */
+
+typedef __m128i PolyVec;
+
+#define VZERO()					_mm_setzero_si128()
+#define VLOADCOEF(p)			_mm_loadu_si128((const __m128i *)(p))
+
+/* vb[x] for x = i..i+1, sign-extended to 64-bit lanes */
+#define VLOADLO(vb, i)			_mm_cvtepi32_epi64(_mm_loadl_epi64((const __m128i *)((vb) + (i))))
+/* vb[23-x] for x = i..i+1 */
+#define VLOADHI(vb, i)			_mm_cvtepi32_epi64(_mm_shuffle_epi32(_mm_loadl_epi64((const __m128i *)((vb) + 22 - (i))), 0xe1))
+/* coef[x] for x = i..i+1, single coefficients (output sample 16) */
+#define VLOADSINGLE(p, i)		_mm_cvtepi32_epi64(_mm_loadl_epi64((const __m128i *)((p) + (i))))
+
+#define VMUL(a, b)				_mm_mul_epi32(a, b)			/* low word of each 64-bit lane, signed */
+#define VADD(a, b)				_mm_add_epi64(a, b)
+#define VSUB(a, b)				_mm_sub_epi64(a, b)
+#define VHIWORD(a)				_mm_srli_epi64(a, 32)
+
+#define VTAPS	2	/* taps per vector */
+
+static __inline Word64 VSum(PolyVec v)
+{
+	return _mm_cvtsi128_si64(v) + _mm_extract_epi64(v, 1);
+}
+
+#endif	/* POLY_AVX2 */
+
+/**************************************************************************************
+ * Function:    MC2V
+ *
+ * Description: vector version of the 8 taps of MC2M for one channel
+ *
+ * Inputs:      pointer to vbuf of the channel, for the current output sample
+ *              16 coefficients c1, c2 interleaved (same order as the scalar macros)
+ *
+ * Outputs:     sum1 += vLo*c1 - vHi*c2, sum2 += vLo*c2 + vHi*c1, 
+ *                lane-wise partial sums, to be added with VSum
+ *
+ * Return:      none
+ *
+ * Notes:       a 64-bit lane holds (c1, c2) of one tap, so the multiply by the low word 
+ *                takes c1, and by the high word shifted down takes c2
+ **************************************************************************************/
+static __inline void MC2V(const int *vb, const int *coef, PolyVec *sum1, PolyVec *sum2)
+{
+	int x;
+	PolyVec vLo, vHi, c1, c2;
+
+	for (x = 0; x < 8; x += VTAPS) {
+		c1 = VLOADCOEF(coef + 2*x);
+		c2 = VHIWORD(c1);
+		vLo = VLOADLO(vb, x);
+		vHi = VLOADHI(vb, x);
+		*sum1 = VADD(*sum1, VSUB(VMUL(vLo, c1), VMUL(vHi, c2)));
+		*sum2 = VADD(*sum2, VADD(VMUL(vLo, c2), VMUL(vHi, c1)));
+	}
+}
+
+/**************************************************************************************
+ * Function:    MC1V
+ *
+ * Description: vector version of the 8 taps of MC1M for one channel
+ *
+ * Inputs:      pointer to vbuf of the channel, for output sample 16
+ *              8 single coefficients
+ *
+ * Outputs:     none
+ *
+ * Return:      sum of vb[x]*coef[x]
+ **************************************************************************************/
+static __inline Word64 MC1V(const int *vb, const int *coef)
+{
+	int x;
+	PolyVec sum = VZERO();
+
+	for (x = 0; x < 8; x += VTAPS)
+		sum = VADD(sum, VMUL(VLOADLO(vb, x), VLOADSINGLE(coef, x)));
+
+	return VSum(sum);
+}
+
+/**************************************************************************************
+ * Function:    PolyphaseMono
+ *
+ * Description: filter one subband and produce 32 output PCM samples for one channel
+ *
+ * Inputs:      pointer to PCM output buffer
+ *              pointer to start of vbuf (preserved from last call)
+ *              start of filter coefficient table (in proper, shuffled order)
+ *
+ * Outputs:     32 samples of one channel of decoded PCM data, (i.e. Q16.0)
+ *
+ * Return:      none
+ *
+ * Notes:       SIMD version, same products and rounding as the C reference
+ **************************************************************************************/
+void PolyphaseMono(short *pcm, int *vbuf, const int *coefBase)
+{
+	int i;
+	const int *coef;
+	int *vb1;
+	PolyVec sum1L, sum2L;
+	Word64 rndVal;
+
+	rndVal = (Word64)( 1 << (DEF_NFRACBITS - 1 + (32 - CSHIFT)) );
+
+	/* special case, output sample 0 */
+	sum1L = sum2L = VZERO();
+	MC2V(vbuf, coefBase, &sum1L, &sum2L);
+	*(pcm + 0) = POLY_OUT(rndVal + VSum(sum1L));
+
+	/* special case, output sample 16 */
+	*(pcm + 16) = POLY_OUT(rndVal + MC1V(vbuf + 64*16, coefBase + 256));
+
+	/* main convolution loop: sum1L = samples 1, 2, 3, ... 15   sum2L = samples 31, 30, ... 17 */
+	coef = coefBase + 16;
+	vb1 = vbuf + 64;
+	pcm++;
+
+	for (i = 15; i > 0; i--) {
+		sum1L = sum2L = VZERO();
+		MC2V(vb1, coef, &sum1L, &sum2L);
+		coef += 16;
+		vb1 += 64;
+
+		*(pcm)       = POLY_OUT(rndVal + VSum(sum1L));
+		*(pcm + 2*i) = POLY_OUT(rndVal + VSum(sum2L));
+		pcm++;
+	}
+}
+
+/**************************************************************************************
+ * Function:    PolyphaseStereo
+ *
+ * Description: filter one subband and produce 32 output PCM samples for each channel
+ *
+ * Inputs:      pointer to PCM output buffer
+ *              pointer to start of vbuf (preserved from last call)
+ *              start of filter coefficient table (in proper, shuffled order)
+ *
+ * Outputs:     32 samples of two channels of decoded PCM data, (i.e. Q16.0)
+ *
+ * Return:      none
+ *
+ * Notes:       interleaves PCM samples LRLRLR...
+ *              SIMD version, same products and rounding as the C reference
+ **************************************************************************************/
+void PolyphaseStereo(short *pcm, int *vbuf, const int *coefBase)
+{
+	int i;
+	const int *coef;
+	int *vb1;
+	PolyVec sum1L, sum2L, sum1R, sum2R;
+	Word64 rndVal;
+
+	rndVal = (Word64)( 1 << (DEF_NFRACBITS - 1 + (32 - CSHIFT)) );
+
+	/* special case, output sample 0 */
+	sum1L = sum2L = sum1R = sum2R = VZERO();
+	MC2V(vbuf,      coefBase, &sum1L, &sum2L);
+	MC2V(vbuf + 32, coefBase, &sum1R, &sum2R);
+	*(pcm + 0) = POLY_OUT(rndVal + VSum(sum1L));
+	*(pcm + 1) = POLY_OUT(rndVal + VSum(sum1R));
+
+	/* special case, output sample 16 */
+	*(pcm + 2*16 + 0) = POLY_OUT(rndVal + MC1V(vbuf + 64*16,      coefBase + 256));
+	*(pcm + 2*16 + 1) = POLY_OUT(rndVal + MC1V(vbuf + 64*16 + 32, coefBase + 256));
+
+	/* main convolution loop: sum1L = samples 1, 2, 3, ... 15   sum2L = samples 31, 30, ... 17 */
+	coef = coefBase + 16;
+	vb1 = vbuf + 64;
+	pcm += 2;
+
+	for (i = 15; i > 0; i--) {
+		sum1L = sum2L = sum1R = sum2R = VZERO();
+		MC2V(vb1,      coef, &sum1L, &sum2L);
+		MC2V(vb1 + 32, coef, &sum1R, &sum2R);
+		coef += 16;
+		vb1 += 64;
+
+		*(pcm + 0)         = POLY_OUT(rndVal + VSum(sum1L));
+		*(pcm + 1)         = POLY_OUT(rndVal + VSum(sum1R));
+		*(pcm + 2*2*i + 0) = POLY_OUT(rndVal + VSum(sum2L));
+		*(pcm + 2*2*i + 1) = POLY_OUT(rndVal + VSum(sum2R));
+		pcm += 2;
+	}
+}
+
+#endif	/* POLY_SIMD */
+
+/**************************************************************************************
+ * Function:    PolyphaseHalf
+ *
+ * Description: filter one subband and produce 16 output PCM samples per channel, 
+ *                at half the sample rate
+ *
+ * Inputs:      pointer to PCM output buffer
+ *              pointer to start of vbuf (preserved from last call)
+ *              start of filter coefficient table (in proper, shuffled order)
+ *              number of channels (1 or 2), the vbuf of channel 1 starts at offset 32
+ *
+ * Outputs:     16 samples of each channel, interleaved LRLRLR... if stereo
+ *
+ * Return:      none
+ *
+ * Notes:       output sample k is sample 2k of the full rate synthesis, only the even
+ *                rows of the convolution are computed so it takes half the work
+ *              subbands 16 - 31 must have been zeroed before FDCT32, otherwise the
+ *                upper half of the spectrum aliases when dropping the odd samples
+ *              used in all the builds, the even rows give the same samples as 
+ *                PolyphaseMono/PolyphaseStereo (same 64-bit products)
+ **************************************************************************************/
+void PolyphaseHalf(short *pcm, int *vbuf, const int *coefBase, int nChans)
+{
+	int i, j, ch;
+	const int *coef;
+	int *vb1;
+	int vLo, vHi, c1, c2;
+	Word64 sum1L, sum2L, rndVal;
+
+	rndVal = (Word64)( 1 << (DEF_NFRACBITS - 1 + (32 - CSHIFT)) );
+
+	for (ch = 0; ch < nChans; ch++, vbuf += 32, pcm++) {
+		/* special case, output sample 0 */
+		coef = coefBase;
+		vb1 = vbuf;
+		sum1L = rndVal;
+		for (j = 0; j < 8; j++) {
+			c1 = coef[2*j];		c2 = coef[2*j+1];
+			sum1L = MADD64(sum1L, vb1[j], c1);	sum1L = MADD64(sum1L, vb1[23-j], -c2);
+		}
+		pcm[0] = ClipToShort((int)SAR64(sum1L, (32-CSHIFT)), DEF_NFRACBITS);
+
+		/* special case, full rate sample 16 */
+		coef = coefBase + 256;
+		vb1 = vbuf + 64*16;
+		sum1L = rndVal;
+		for (j = 0; j < 8; j++)
+			sum1L = MADD64(sum1L, vb1[j], coef[j]);
+		pcm[8*nChans] = ClipToShort((int)SAR64(sum1L, (32-CSHIFT)), DEF_NFRACBITS);
+
+		/* even rows only: sum1L = full rate samples 2, 4, ... 14   sum2L = samples 30, 28, ... 18 */
+		for (i = 1; i < 8; i++) {
+			coef = coefBase + 16*2*i;
+			vb1 = vbuf + 64*2*i;
+			sum1L = sum2L = rndVal;
+			for (j = 0; j < 8; j++) {
+				c1 = coef[2*j];		c2 = coef[2*j+1];
+				vLo = vb1[j];		vHi = vb1[23-j];
+				sum1L = MADD64(sum1L, vLo,  c1);	sum2L = MADD64(sum2L, vLo,  c2);
+				sum1L = MADD64(sum1L, vHi, -c2);	sum2L = MADD64(sum2L, vHi,  c1);
+			}
+			pcm[i*nChans]      = ClipToShort((int)SAR64(sum1L, (32-CSHIFT)), DEF_NFRACBITS);
+			pcm[(16-i)*nChans] = ClipToShort((int)SAR64(sum2L, (32-CSHIFT)), DEF_NFRACBITS);
+		}
+	}
+}
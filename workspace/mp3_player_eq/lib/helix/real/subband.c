@@ -0,0 +1,270 @@
+/* ***** BEGIN LICENSE BLOCK ***** 
+ * Version: RCSL 1.0/RPSL 1.0 
+ *  
+ * Portions Copyright (c) 1995-2002 RealNetworks, Inc. All Rights Reserved. 
+ *      
+ * The contents of this file, and the files included with this file, are 
+ * subject to the current version of the RealNetworks Public Source License 
+ * Version 1.0 (the "RPSL") available at 
+ * http://www.helixcommunity.org/content/rpsl unless you have licensed 
+ * the file under the RealNetworks Community Source License Version 1.0 
+ * (the "RCSL") available at http://www.helixcommunity.org/content/rcsl, 
+ * in which case the RCSL will apply. You may also obtain the license terms 
+ * directly from RealNetworks.  You may not use this file except in 
+ * compliance with the RPSL or, if you have a valid RCSL with RealNetworks 
+ * applicable to this file, the RCSL.  Please see the applicable RPSL or 
+ * RCSL for the rights, obligations and limitations governing use of the 
+ * contents of the file.  
+ *  
+ * This file is part of the Helix DNA Technology. RealNetworks is the 
+ * developer of the Original Code and owns the copyrights in the portions 
+ * it created. 
+ *  
+ * This file, and the files included with this file, is distributed and made 
+ * available on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER 
+ * EXPRESS OR IMPLIED, AND REALNETWORKS HEREBY DISCLAIMS ALL SUCH WARRANTIES, 
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY, FITNESS 
+ * FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT. 
+ * 
+ * Technology Compatibility Kit Test Suite(s) Location: 
+ *    http://www.helixcommunity.org/content/tck 
+ * 
+ * Contributor(s): 
+ *  
+ * ***** END LICENSE BLOCK ***** */ 
+
+/**************************************************************************************
+ * Fixed-point MP3 decoder
+ * Jon Recker (jrecker@real.com), Ken Cooke (kenc@real.com)
+ * June 2003
+ *
+ * subband.c - subband transform (synthesis filterbank implemented via 32-point DCT
+ *               followed by polyphase filter)
+ **************************************************************************************/
+
+#include <string.h>		/* for memset */
+#include "coder.h"
+#include "assembly.h"
+
+/**************************************************************************************
+ * Function:    SilentChannel
+ *
+ * Description: check whether the subband transform of one channel outputs only zeros
+ *
+ * Inputs:      IMDCTInfo struct, after calling IMDCT for the channel
+ *              SubbandInfo struct with the vbuf history of the previous granules
+ *              index of the channel
+ *
+ * Outputs:     none
+ *
+ * Return:      1 if the IMDCT output and the vbuf of the channel are zero, 0 otherwise
+ *
+ * Notes:       the vbuf is checked rather than tracked, so switching downmix or half rate
+ *                on the fly can never skip a granule that still plays out its history
+ *              one silent granule synthesized in full zeroes the vbuf (18 blocks > 16 taps)
+ **************************************************************************************/
+static int SilentChannel(IMDCTInfo *mi, SubbandInfo *sbi, int ch)
+{
+	int i, j;
+
+	/* gb = CLZ(0) - 1 = 31 when the IMDCT output is all zero */
+	if (mi->gb[ch] != 31)
+		return 0;
+
+	/* each row of 64 holds 32 entries of each channel */
+	for (i = ch*32; i < MAX_NCHAN * VBUF_LENGTH; i += 64) {
+		for (j = 0; j < 32; j++) {
+			if (sbi->vbuf[i + j])
+				return 0;
+		}
+	}
+
+	return 1;
+}
+
+/**************************************************************************************
+ * Function:    SilentGranule
+ *
+ * Description: check whether the subband transform of this granule outputs only zeros
+ *
+ * Inputs:      filled MP3DecInfo structure, after calling IMDCT for all channels
+ *              SubbandInfo struct with the vbuf history of the previous granules
+ *
+ * Outputs:     none
+ *
+ * Return:      1 if every channel is silent (see SilentChannel), 0 otherwise
+ *
+ * Notes:       the IMDCT output of every channel is checked before any vbuf is scanned,
+ *                so a granule with sound in one channel costs one compare per channel
+ *                (the scan is the part that would not pay off next to the SIMD synthesis)
+ **************************************************************************************/
+static int SilentGranule(MP3DecInfo *mp3DecInfo, IMDCTInfo *mi, SubbandInfo *sbi)
+{
+	int ch;
+
+	for (ch = 0; ch < mp3DecInfo->nChans; ch++) {
+		if (mi->gb[ch] != 31)
+			return 0;
+	}
+
+	for (ch = 0; ch < mp3DecInfo->nChans; ch++) {
+		if (!SilentChannel(mi, sbi, ch))
+			return 0;
+	}
+
+	return 1;
+}
+
+/**************************************************************************************
+ * Function:    Subband
+ *
+ * Description: do subband transform on all the blocks in one granule, all channels
+ *
+ * Inputs:      filled MP3DecInfo structure, after calling IMDCT for all channels
+ *              vbuf[ch] and vindex[ch] must be preserved between calls
+ *
+ * Outputs:     decoded PCM data, interleaved LRLRLR... if stereo, 
+ *                or a single channel (L+R)/2 if stereo and downmix is set
+ *              16 samples per block and channel instead of 32 if halfRate is set
+ *
+ * Return:      0 on success,  -1 if null input pointers
+ **************************************************************************************/
+int Subband(MP3DecInfo *mp3DecInfo, short *pcmBuf)
+{
+	int b, i, ch, gb, nBands, nChans;
+	IMDCTInfo *mi;
+	SubbandInfo *sbi;
+
+	/* validate pointers */
+	if (!mp3DecInfo || !mp3DecInfo->HuffmanInfoPS || !mp3DecInfo->IMDCTInfoPS || !mp3DecInfo->SubbandInfoPS)
+		return -1;
+
+	mi = (IMDCTInfo *)(mp3DecInfo->IMDCTInfoPS);
+	sbi = (SubbandInfo*)(mp3DecInfo->SubbandInfoPS);
+	nBands = NBANDS >> mp3DecInfo->halfRate;
+
+	/* silence in, silence out - only the vbuf index moves (one step every odd block) */
+	if (SilentGranule(mp3DecInfo, mi, sbi)) {
+		nChans = ((mp3DecInfo->nChans == 2 && mp3DecInfo->downmix) ? 1 : mp3DecInfo->nChans);
+		memset(pcmBuf, 0, BLOCK_SIZE * nBands * nChans * sizeof(short));
+		sbi->vindex = (sbi->vindex - BLOCK_SIZE / 2) & 7;
+		return 0;
+	}
+
+	if (mp3DecInfo->halfRate) {
+		/* only the lower half of the subbands is synthesized, the upper half would alias
+		 *   when PolyphaseHalf drops the odd samples
+		 * IMDCT already zeroes them, except the overlap played out when switching to half rate
+		 */
+		for (ch = 0; ch < mp3DecInfo->nChans; ch++) {
+			for (b = 0; b < BLOCK_SIZE; b++) {
+				for (i = NBANDS/2; i < NBANDS; i++)
+					mi->outBuf[ch][b][i] = 0;
+			}
+		}
+	}
+
+	if (mp3DecInfo->nChans == 2 && mp3DecInfo->downmix) {
+		/* stereo downmixed to mono, the filterbank is linear so mixing before it 
+		 * gives the same output as mixing the pcm, with half the synthesis work
+		 */
+		gb = MIN(mi->gb[0], mi->gb[1]);
+		for (b = 0; b < BLOCK_SIZE; b++) {
+			for (i = 0; i < nBands; i++)
+				mi->outBuf[0][b][i] = (mi->outBuf[0][b][i] >> 1) + (mi->outBuf[1][b][i] >> 1);
+			FDCT32(mi->outBuf[0][b], sbi->vbuf + 0*32, sbi->vindex, (b & 0x01), gb);
+			if (mp3DecInfo->halfRate)
+				PolyphaseHalf(pcmBuf, sbi->vbuf + sbi->vindex + VBUF_LENGTH * (b & 0x01), polyCoef, 1);
+			else
+				PolyphaseMono(pcmBuf, sbi->vbuf + sbi->vindex + VBUF_LENGTH * (b & 0x01), polyCoef);
+			sbi->vindex = (sbi->vindex - (b & 0x01)) & 7;
+			pcmBuf += nBands;
+		}
+	} else if (mp3DecInfo->nChans == 2) {
+		/* stereo */
+		for (b = 0; b < BLOCK_SIZE; b++) {
+			FDCT32(mi->outBuf[0][b], sbi->vbuf + 0*32, sbi->vindex, (b & 0x01), mi->gb[0]);
+			FDCT32(mi->outBuf[1][b], sbi->vbuf + 1*32, sbi->vindex, (b & 0x01), mi->gb[1]);
+			if (mp3DecInfo->halfRate)
+				PolyphaseHalf(pcmBuf, sbi->vbuf + sbi->vindex + VBUF_LENGTH * (b & 0x01), polyCoef, 2);
+			else
+				PolyphaseStereo(pcmBuf, sbi->vbuf + sbi->vindex + VBUF_LENGTH * (b & 0x01), polyCoef);
+			sbi->vindex = (sbi->vindex - (b & 0x01)) & 7;
+			pcmBuf += (2 * nBands);
+		}
+	} else {
+		/* mono */
+		for (b = 0; b < BLOCK_SIZE; b++) {
+			FDCT32(mi->outBuf[0][b], sbi->vbuf + 0*32, sbi->vindex, (b & 0x01), mi->gb[0]);
+			if (mp3DecInfo->halfRate)
+				PolyphaseHalf(pcmBuf, sbi->vbuf + sbi->vindex + VBUF_LENGTH * (b & 0x01), polyCoef, 1);
+			else
+				PolyphaseMono(pcmBuf, sbi->vbuf + sbi->vindex + VBUF_LENGTH * (b & 0x01), polyCoef);
+			sbi->vindex = (sbi->vindex - (b & 0x01)) & 7;
+			pcmBuf += nBands;
+		}
+	}
+
+	return 0;
+}
+
+
+/**************************************************************************************
+ * Function:    SubbandChannel
+ *
+ * Description: do subband transform on all the blocks in one granule, one channel
+ *
+ * Inputs:      filled MP3DecInfo structure, after calling IMDCT for the channel
+ *              index of the channel
+ *              vbuf index of the granule
+ *
+ * Outputs:     decoded PCM data of the channel, not interleaved (BLOCK_SIZE blocks of 
+ *                32 samples, 16 if halfRate is set)
+ *
+ * Return:      0 on success,  -1 if null input pointers
+ *
+ * Notes:       the channels of a granule can be transformed in parallel, each one only 
+ *                touches its own half of the vbuf rows
+ *              sbi->vindex is left for the caller to advance once all the channels are done,
+ *                by one step every odd block (BLOCK_SIZE / 2 steps per granule)
+ *              same output as Subband, PolyphaseMono and PolyphaseStereo filter each 
+ *                channel with the same products and rounding
+ **************************************************************************************/
+int SubbandChannel(MP3DecInfo *mp3DecInfo, short *pcmBuf, int ch, int vindex)
+{
+	int b, i, nBands;
+	IMDCTInfo *mi;
+	SubbandInfo *sbi;
+
+	/* validate pointers */
+	if (!mp3DecInfo || !mp3DecInfo->IMDCTInfoPS || !mp3DecInfo->SubbandInfoPS)
+		return -1;
+
+	mi = (IMDCTInfo *)(mp3DecInfo->IMDCTInfoPS);
+	sbi = (SubbandInfo*)(mp3DecInfo->SubbandInfoPS);
+	nBands = NBANDS >> mp3DecInfo->halfRate;
+
+	if (SilentChannel(mi, sbi, ch)) {
+		memset(pcmBuf, 0, BLOCK_SIZE * nBands * sizeof(short));
+		return 0;
+	}
+
+	if (mp3DecInfo->halfRate) {
+		for (b = 0; b < BLOCK_SIZE; b++) {
+			for (i = NBANDS/2; i < NBANDS; i++)
+				mi->outBuf[ch][b][i] = 0;
+		}
+	}
+
+	for (b = 0; b < BLOCK_SIZE; b++) {
+		FDCT32(mi->outBuf[ch][b], sbi->vbuf + ch*32, vindex, (b & 0x01), mi->gb[ch]);
+		if (mp3DecInfo->halfRate)
+			PolyphaseHalf(pcmBuf, sbi->vbuf + ch*32 + vindex + VBUF_LENGTH * (b & 0x01), polyCoef, 1);
+		else
+			PolyphaseMono(pcmBuf, sbi->vbuf + ch*32 + vindex + VBUF_LENGTH * (b & 0x01), polyCoef);
+		vindex = (vindex - (b & 0x01)) & 7;
+		pcmBuf += nBands;
+	}
+
+	return 0;
+}
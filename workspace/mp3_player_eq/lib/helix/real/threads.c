@@ -0,0 +1,353 @@
+/* ***** BEGIN LICENSE BLOCK ***** 
+ * Version: RCSL 1.0/RPSL 1.0 
+ *  
+ * Portions Copyright (c) 1995-2002 RealNetworks, Inc. All Rights Reserved. 
+ *      
+ * The contents of this file, and the files included with this file, are 
+ * subject to the current version of the RealNetworks Public Source License 
+ * Version 1.0 (the "RPSL") available at 
+ * http://www.helixcommunity.org/content/rpsl unless you have licensed 
+ * the file under the RealNetworks Community Source License Version 1.0 
+ * (the "RCSL") available at http://www.helixcommunity.org/content/rcsl, 
+ * in which case the RCSL will apply. You may also obtain the license terms 
+ * directly from RealNetworks.  You may not use this file except in 
+ * compliance with the RPSL or, if you have a valid RCSL with RealNetworks 
+ * applicable to this file, the RCSL.  Please see the applicable RPSL or 
+ * RCSL for the rights, obligations and limitations governing use of the 
+ * contents of the file.  
+ *  
+ * This file is part of the Helix DNA Technology. RealNetworks is the 
+ * developer of the Original Code and owns the copyrights in the portions 
+ * it created. 
+ *  
+ * This file, and the files included with this file, is distributed and made 
+ * available on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER 
+ * EXPRESS OR IMPLIED, AND REALNETWORKS HEREBY DISCLAIMS ALL SUCH WARRANTIES, 
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY, FITNESS 
+ * FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT. 
+ * 
+ * Technology Compatibility Kit Test Suite(s) Location: 
+ *    http://www.helixcommunity.org/content/tck 
+ * 
+ * Contributor(s): 
+ *  
+ * ***** END LICENSE BLOCK ***** */ 
+
+/**************************************************************************************
+ * Fixed-point MP3 decoder
+ *
+ * threads.c - channel threads for stereo decoding on multicore hosts
+ *
+ * Only built with MP3_THREADS defined (needs pthreads and C11 atomics). Once Dequantize
+ *  has done the joint stereo processing, the IMDCT and the subband transform of the 
+ *  two channels are independent: MP3Decode runs channel 0 on its own thread and hands
+ *  channel 1 to a worker thread, one handoff per frame.
+ * The Huffman buffer holds one granule at a time, so the earlier granules of the frame
+ *  are saved (SaveGranule) and both channels of every granule are decoded once the last
+ *  granule is dequantized. The granules of a channel stay sequential, the IMDCT overlap
+ *  and the vbuf of granule 1 come out of granule 0.
+ **************************************************************************************/
+
+#ifdef MP3_THREADS
+
+#include <stdlib.h>		/* for malloc, free */
+#include <pthread.h>
+#include <stdatomic.h>
+#include "coder.h"
+
+/* polls of the handoff before sleeping on the condition variable, a few microseconds,
+ *   about the time the other thread needs for one channel of a frame 
+ */
+#define THREAD_SPIN		4000
+
+typedef struct _ThreadInfo {
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t wake;			/* worker waits for a job */
+	pthread_cond_t done;			/* decoding thread waits for the job to finish */
+	atomic_int posted;				/* sequence number of the last job posted */
+	atomic_int finished;			/* sequence number of the last job finished */
+	int quit;
+
+	/* job: IMDCT and subband transform of channel 1, all the granules of a frame */
+	MP3DecInfo *mp3DecInfo;
+	int nGrans;
+	int vindex;						/* vbuf index at the start of the frame */
+	int err;
+
+	/* the earlier granules of the frame, the decoder with the Huffman output of each one */
+	MP3DecInfo granInfo[MAX_NGRAN - 1];
+	HuffmanInfo granHuff[MAX_NGRAN - 1];
+
+	short pcm[MAX_NCHAN][MAX_NGRAN][BLOCK_SIZE * NBANDS];	/* output of each channel, interleaved when both are done */
+} ThreadInfo;
+
+/**************************************************************************************
+ * Function:    WaitSeq
+ *
+ * Description: wait until a sequence number of the handoff reaches a value
+ *
+ * Inputs:      ThreadInfo struct
+ *              sequence number to watch and the value to wait for
+ *              condition variable signaled when it changes
+ *
+ * Outputs:     none
+ *
+ * Return:      none
+ *
+ * Notes:       polls first, the other thread is usually about to finish and sleeping
+ *                costs a system call on both sides
+ **************************************************************************************/
+static void WaitSeq(ThreadInfo *ti, atomic_int *seq, int value, pthread_cond_t *cond)
+{
+	int i;
+
+	for (i = 0; i < THREAD_SPIN; i++) {
+		if (atomic_load_explicit(seq, memory_order_acquire) == value)
+			return;
+	}
+
+	pthread_mutex_lock(&ti->lock);
+	while (atomic_load_explicit(seq, memory_order_acquire) != value)
+		pthread_cond_wait(cond, &ti->lock);
+	pthread_mutex_unlock(&ti->lock);
+}
+
+/**************************************************************************************
+ * Function:    PostSeq
+ *
+ * Description: set a sequence number of the handoff and wake the thread waiting on it
+ *
+ * Inputs:      ThreadInfo struct
+ *              sequence number to set and its new value
+ *              condition variable to signal
+ *
+ * Outputs:     none
+ *
+ * Return:      none
+ **************************************************************************************/
+static void PostSeq(ThreadInfo *ti, atomic_int *seq, int value, pthread_cond_t *cond)
+{
+	/* under the lock, so the store can't slip between the check and the sleep of WaitSeq */
+	pthread_mutex_lock(&ti->lock);
+	atomic_store_explicit(seq, value, memory_order_release);
+	pthread_cond_signal(cond);
+	pthread_mutex_unlock(&ti->lock);
+}
+
+/**************************************************************************************
+ * Function:    DecodeChannel
+ *
+ * Description: IMDCT and subband transform of one channel of a frame
+ *
+ * Inputs:      ThreadInfo struct, with the earlier granules saved and the last one 
+ *                dequantized in the decoder
+ *              index of the channel
+ *
+ * Outputs:     IMDCT output and PCM of the channel, not interleaved
+ *
+ * Return:      0 on success, -1 on error
+ *
+ * Notes:       the vbuf index of each granule is worked out from the one at the start 
+ *                of the frame, the decoding thread moves it once both channels are done
+ **************************************************************************************/
+static int DecodeChannel(ThreadInfo *ti, int ch)
+{
+	int gr;
+	MP3DecInfo *mp3DecInfo;
+
+	for (gr = 0; gr < ti->nGrans; gr++) {
+		mp3DecInfo = (gr < ti->nGrans - 1 ? &ti->granInfo[gr] : ti->mp3DecInfo);
+		if (IMDCT(mp3DecInfo, gr, ch) < 0)
+			return -1;
+		if (SubbandChannel(mp3DecInfo, ti->pcm[ch][gr], ch, (ti->vindex - gr * BLOCK_SIZE / 2) & 7) < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+/**************************************************************************************
+ * Function:    Worker
+ *
+ * Description: worker thread, decodes channel 1 of each posted frame until told to quit
+ *
+ * Inputs:      ThreadInfo struct
+ *
+ * Outputs:     none
+ *
+ * Return:      NULL
+ **************************************************************************************/
+static void *Worker(void *arg)
+{
+	ThreadInfo *ti = (ThreadInfo *)arg;
+	int seq = 0;
+
+	for (;;) {
+		seq++;
+		WaitSeq(ti, &ti->posted, seq, &ti->wake);
+		if (ti->quit)
+			break;
+
+		ti->err = DecodeChannel(ti, 1);
+		PostSeq(ti, &ti->finished, seq, &ti->done);
+	}
+
+	return NULL;
+}
+
+/**************************************************************************************
+ * Function:    InitThreads
+ *
+ * Description: start the worker thread of a decoder
+ *
+ * Inputs:      MP3DecInfo structure without channel threads
+ *
+ * Outputs:     ThreadInfoPS set on success
+ *
+ * Return:      0 on success, -1 if out of memory or the thread could not be created
+ **************************************************************************************/
+int InitThreads(MP3DecInfo *mp3DecInfo)
+{
+	ThreadInfo *ti;
+
+	if (!mp3DecInfo || mp3DecInfo->ThreadInfoPS)
+		return -1;
+
+	ti = (ThreadInfo *)malloc(sizeof(ThreadInfo));
+	if (!ti)
+		return -1;
+
+	pthread_mutex_init(&ti->lock, NULL);
+	pthread_cond_init(&ti->wake, NULL);
+	pthread_cond_init(&ti->done, NULL);
+	atomic_init(&ti->posted, 0);
+	atomic_init(&ti->finished, 0);
+	ti->quit = 0;
+	ti->mp3DecInfo = mp3DecInfo;
+
+	if (pthread_create(&ti->thread, NULL, Worker, ti) != 0) {
+		pthread_cond_destroy(&ti->done);
+		pthread_cond_destroy(&ti->wake);
+		pthread_mutex_destroy(&ti->lock);
+		free(ti);
+		return -1;
+	}
+	mp3DecInfo->ThreadInfoPS = ti;
+
+	return 0;
+}
+
+/**************************************************************************************
+ * Function:    FreeThreads
+ *
+ * Description: stop the worker thread of a decoder and free its data
+ *
+ * Inputs:      MP3DecInfo structure, with or without channel threads
+ *
+ * Outputs:     ThreadInfoPS cleared
+ *
+ * Return:      none
+ **************************************************************************************/
+void FreeThreads(MP3DecInfo *mp3DecInfo)
+{
+	ThreadInfo *ti;
+
+	if (!mp3DecInfo || !mp3DecInfo->ThreadInfoPS)
+		return;
+
+	ti = (ThreadInfo *)mp3DecInfo->ThreadInfoPS;
+	ti->quit = 1;
+	PostSeq(ti, &ti->posted, atomic_load(&ti->posted) + 1, &ti->wake);
+	pthread_join(ti->thread, NULL);
+
+	pthread_cond_destroy(&ti->done);
+	pthread_cond_destroy(&ti->wake);
+	pthread_mutex_destroy(&ti->lock);
+	free(ti);
+	mp3DecInfo->ThreadInfoPS = 0;
+}
+
+/**************************************************************************************
+ * Function:    SaveGranule
+ *
+ * Description: keep the dequantized coefficients of a granule which is not the last 
+ *                one of the frame
+ *
+ * Inputs:      MP3DecInfo structure with channel threads, after Dequantize for this granule
+ *              index of current granule
+ *
+ * Outputs:     copy of the Huffman buffer, decoded by ThreadedFrame after the last granule
+ *
+ * Return:      0 on success, -1 on error
+ **************************************************************************************/
+int SaveGranule(MP3DecInfo *mp3DecInfo, int gr)
+{
+	ThreadInfo *ti;
+
+	if (!mp3DecInfo || !mp3DecInfo->ThreadInfoPS || !mp3DecInfo->HuffmanInfoPS || gr >= MAX_NGRAN - 1)
+		return -1;
+
+	ti = (ThreadInfo *)mp3DecInfo->ThreadInfoPS;
+	ti->granHuff[gr] = *(HuffmanInfo *)mp3DecInfo->HuffmanInfoPS;
+	ti->granInfo[gr] = *mp3DecInfo;
+	ti->granInfo[gr].HuffmanInfoPS = &ti->granHuff[gr];
+
+	return 0;
+}
+
+/**************************************************************************************
+ * Function:    ThreadedFrame
+ *
+ * Description: IMDCT and subband transform of a stereo frame, one channel per thread
+ *
+ * Inputs:      MP3DecInfo structure with channel threads, after SaveGranule for the 
+ *                earlier granules and Dequantize for the last one
+ *              buffer for the PCM of the frame
+ *
+ * Outputs:     decoded PCM data, interleaved LRLRLR...
+ *                (same as IMDCT on both channels followed by Subband, granule by granule)
+ *
+ * Return:      0 on success, -1 on error
+ *
+ * Notes:       not used when downmixing, the channels are mixed before the subband 
+ *                transform so only the IMDCT could run in parallel
+ **************************************************************************************/
+int ThreadedFrame(MP3DecInfo *mp3DecInfo, short *pcmBuf)
+{
+	int i, gr, err, nSamps, seq;
+	ThreadInfo *ti;
+	SubbandInfo *sbi;
+
+	if (!mp3DecInfo || !mp3DecInfo->ThreadInfoPS || !mp3DecInfo->SubbandInfoPS || mp3DecInfo->nChans != 2 || mp3DecInfo->downmix)
+		return -1;
+
+	ti = (ThreadInfo *)mp3DecInfo->ThreadInfoPS;
+	sbi = (SubbandInfo *)mp3DecInfo->SubbandInfoPS;
+
+	/* channel 1 on the worker, channel 0 here */
+	ti->nGrans = mp3DecInfo->nGrans;
+	ti->vindex = sbi->vindex;
+	seq = atomic_load_explicit(&ti->posted, memory_order_relaxed) + 1;
+	PostSeq(ti, &ti->posted, seq, &ti->wake);
+	err = DecodeChannel(ti, 0);
+	WaitSeq(ti, &ti->finished, seq, &ti->done);
+	if (err < 0 || ti->err < 0)
+		return -1;
+
+	/* both channels have filtered the same blocks, move the vbuf index once */
+	sbi->vindex = (sbi->vindex - ti->nGrans * BLOCK_SIZE / 2) & 7;
+
+	nSamps = BLOCK_SIZE * (NBANDS >> mp3DecInfo->halfRate);
+	for (gr = 0; gr < ti->nGrans; gr++) {
+		for (i = 0; i < nSamps; i++) {
+			pcmBuf[2*i + 0] = ti->pcm[0][gr][i];
+			pcmBuf[2*i + 1] = ti->pcm[1][gr][i];
+		}
+		pcmBuf += 2 * nSamps;
+	}
+
+	return 0;
+}
+
+#endif	/* MP3_THREADS */
@@ -32,7 +32,7 @@
 // now used like this: 
 //    read_ID3_info( TITLE, str, sizeof(str), &fp);
 
-unsigned char read_ID3_info(const unsigned char tag_name,char * output_str, unsigned int res_str_l, FIL *fp)
+unsigned char read_ID3_info(const unsigned char tag_name,char * output_str, unsigned int res_str_l, ID3_FILE *fp)
 {
 	//here we've got macros to define the tagname for each data frame
 	// add new ones if you want. every four characters is a new tag type
@@ -46,7 +46,7 @@ unsigned char read_ID3_info(const unsigned char tag_name,char * output_str, unsi
 	unsigned int bytesRead = 0;
 	file_seek_absolute(fp,0);
 	file_read(fp,common_header,sizeof(common_header),bytesRead);
-	if ((common_header[0]!='I')||(common_header[1]!='D')||(common_header[2]!='3')) return 0;
+	if ((bytesRead<sizeof(common_header))||(common_header[0]!='I')||(common_header[1]!='D')||(common_header[2]!='3')) return 0;
 	
 	if (common_header[3] <= 0x04) {   //recognized id3 v2
 		unsigned int tag_size = (common_header[9]) | (common_header[8] << 7) | (common_header[7] << 14) | (common_header[6] << 28);
@@ -81,7 +81,7 @@ unsigned char read_ID3_info(const unsigned char tag_name,char * output_str, unsi
 					unsigned int convert_read = 0;
 					file_read(fp,output_str,2,convert_read);
 					char start_utf[3] = {0xFF,0xFE};
-					if (0 == strncmp( start_utf, output_str, 2)){  // unicode tags start with 01 FF FE
+					if ((convert_read == 2) && (0 == strncmp( start_utf, output_str, 2))){  // unicode tags start with 01 FF FE
 						//Unicode decode string:
 						l_to_read = min((frame_size-3)/2,res_str_l-1);
 						//printf(" unicode!-> frame_size=%ld, (have%i) reading [%i]\n", frame_size, res_str_l, l_to_read);
@@ -115,26 +115,26 @@ unsigned char read_ID3_info(const unsigned char tag_name,char * output_str, unsi
 	else return 0;
 }
 
-bool has_ID3_tag(FIL* fp)
+bool has_ID3_tag(ID3_FILE* fp)
 {
 	bool ret = true;
 	unsigned char common_header[10];
 	unsigned int bytesRead = 0;
 	file_seek_absolute(fp, 0);
 	file_read(fp, common_header, sizeof(common_header), bytesRead);
-	if ((common_header[0] != 'I') || (common_header[1] != 'D') || (common_header[2] != '3'))
+	if ((bytesRead < sizeof(common_header)) || (common_header[0] != 'I') || (common_header[1] != 'D') || (common_header[2] != '3'))
 		ret = false;
 	return ret;
 }
 
-unsigned int get_ID3_size(FIL* fp)
+unsigned int get_ID3_size(ID3_FILE* fp)
 {
 	unsigned int tag_size = 0;
 	unsigned char common_header[10];
 	unsigned int bytesRead = 0;
 	file_seek_absolute(fp, 0);
 	file_read(fp, common_header, sizeof(common_header), bytesRead);
-	if ((common_header[0] == 'I') || (common_header[1] == 'D') || (common_header[2] == '3'))
+	if ((bytesRead == sizeof(common_header)) && ((common_header[0] == 'I') || (common_header[1] == 'D') || (common_header[2] == '3')))
 	{
 		if (common_header[3] <= 0x04)
 		{
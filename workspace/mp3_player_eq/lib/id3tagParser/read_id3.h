@@ -24,35 +24,24 @@
 
 #include <stdbool.h>
 
-#ifdef __arm__  // for an embedded enviroment, using FatFs from chan
+// Files are read through the input backends of the mp3 decoder (FatFs, stdio, memory, mmap)
+#include "lib/mp3decoder/mp3decoder_io.h"
 
-#include "lib/fatfs/ff.h"				// FAT File System Library
-#include "lib/fatfs/diskio.h" 			// Disk IO Initialize SPI Mutex
-
-#define file_seek_absolute(file,position) f_lseek(file, position)
-#define file_seek_relative(fi,pos) f_lseek(fi,fi->fptr+pos)
-#define file_read(f,str,l,rea) f_read(f,str,(l),&(rea))
-
-#else
-
-#define FIL FILE
-#define rprintf printf
-#include <stdio.h>
-#define file_seek_absolute(file,position) fseek (file , position , SEEK_SET)
-#define file_seek_relative(fi,pos) fseek(fi,pos,SEEK_CUR)
-#define file_read(f,str,l,rea) rea=fread(str,1,l,f)
-
-#endif
+#define ID3_FILE mp3decoder_stream_t
+#define file_seek_absolute(file,position) (file)->io->seek((file)->handle, position)
+#define file_seek_relative(fi,pos) (fi)->io->seek((fi)->handle, (fi)->io->tell((fi)->handle) + (pos))
+#define file_read(f,str,l,rea) rea=(f)->io->read((f)->handle,str,(l))
 
 /* 
  * read_ID3_info - read spesified tag to a string.
  *  example useage: 
- *    FIL file;
- *    f_open(&file, file_name, (FA_READ | FA_OPEN_EXISTING));
+ *    FIL fil;
+ *    mp3decoder_stream_t file;
+ *    MP3IoFatfsOpen(&fil, file_name, &file);
  *    char str[40];
  *    read_ID3_info(TITLE_ID3,str,sizeof(str),&file);
  *    printf("Title: %s\n",str);
- *    f_close(&file);
+ *    file.io->close(file.handle);
  * 
  *  Input: 
  *   -tag type, use one of the macros below like TITLE_ID3
@@ -71,11 +60,11 @@
 #define YEAR_ID3 4
 #define LENGTH_ID3 5
 
-bool has_ID3_tag(FIL *fp);
+bool has_ID3_tag(ID3_FILE *fp);
 
-unsigned char read_ID3_info(const unsigned char tag_name, char* output_str, unsigned int res_str_l, FIL* fp);
+unsigned char read_ID3_info(const unsigned char tag_name, char* output_str, unsigned int res_str_l, ID3_FILE* fp);
 
-unsigned int get_ID3_size(FIL* fp);
+unsigned int get_ID3_size(ID3_FILE* fp);
 
 
 
@@ -14,11 +14,9 @@
 #include  "lib/helix/pub/mp3dec.h"
 #include "lib/id3tagParser/read_id3.h"
 
+#ifdef __arm__
 #include "board.h"
 #include "drivers/MCAL/gpio/gpio.h"
-
-#ifdef __arm__
-#include "lib/fatfs/ff.h"
 #endif
 
 /*******************************************************************************
@@ -26,9 +24,33 @@
  ******************************************************************************/
 
 #define MP3DECODER_MODE_NORMAL  0
-#define MP3_FRAME_BUFFER_BYTES  6913            // MP3 buffer size (in bytes)
-#define DEFAULT_ID3_FIELD       0
-#define MP3_REC_MAX_DEPTH       5
+#define MP3_FRAME_BUFFER_BYTES  6913            // MP3 ring buffer size (in bytes)
+#define MP3_MAX_FRAME_BYTES     1441            // Longest Layer III frame (320kbps @ 32kHz + padding), mirrored after the ring end
+#define MP3_REFILL_THRESHOLD    (MP3_FRAME_BUFFER_BYTES / 2)    // Free bytes in the ring needed before reading the file again
+#define DEFAULT_ID3_FIELD       ""
+
+#define MP3_HEADER_BYTES        4
+#define MP3_HEADER_SYNC_MASK    0xFFFE0C00      // Header fields that cannot change along the stream: sync, version, layer and sample rate
+#define MP3_SYNC_FRAMES         3               // Consecutive matching headers needed to accept a sync on a new stream
+#define MP3_RESYNC_FRAMES       2               // Consecutive matching headers needed to accept a sync on the stream that was lost
+#define MP3_RESYNC_MAX_BYTES    MP3_FRAME_BUFFER_BYTES  // Max bytes scanned looking for sync in one call to MP3GetDecodedFrame
+#define MP3_MAX_DROPPED_FRAMES  4               // Max frames dropped in one call to MP3GetDecodedFrame
+
+#define MP3_SEEK_INDEX_ENTRIES  128             // Entries of the sparse frame index
+#define MP3_SEEK_INDEX_STEP     16              // Initial frames between index entries, doubled every time the index gets full
+#define MP3_SEEK_HISTORY        8               // Frames remembered while walking headers, to find where the bit reservoir starts
+#define MP3_SEEK_PREROLL_FRAMES 1               // Frames before the target decoded whole (with their bit reservoir), to fill the IMDCT overlap
+#define MP3_SEEK_WALK_FRAMES    256             // Max frames walked past the index before using the Xing TOC instead
+#define MP3_SEEK_BACKOFF_BYTES  2048            // Bytes before a Xing TOC position where the header walk starts
+#define MP3_XING_TOC_ENTRIES    100
+#define MP3_VBRI_OFFSET         36              // Position of the VBRI header in the first frame
+#define MP3_LAME_TAG_BYTES      24              // LAME tag bytes up to the encoder delay and padding fields
+#define MP3_DECODER_DELAY       529             // Samples of delay added by the decoder synthesis filterbank
+
+#define MP3_FRAME_MAX_SAMPLES   (2 * 1152)      // Interleaved samples of the longest decoded frame
+#define MP3_DECODE_RETRIES      10              // Failed calls to MP3GetDecodedFrame tolerated by MP3DecodeSamples
+
+#define MP3_MIN(a, b)           ((a) < (b) ? (a) : (b))
 
 #ifndef __arm__
 // #define MP3_PC_TESTBENCH
@@ -37,34 +59,90 @@
 /*******************************************************************************
  * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
  ******************************************************************************/
-typedef struct
+typedef enum
+{
+  MP3_SYNC_SEARCHING,       // Looking for consecutive valid headers
+  MP3_SYNC_LOCKED           // Next frame starts at the read position of the buffer
+} mp3decoder_sync_state_t;
+
+struct mp3decoder
 {
   // Helix structures
   HMP3Decoder   helixDecoder;                                   // Helix MP3 decoder instance 
+  uint64_t      helixState[MP3_DECODER_STATE_BYTES / sizeof(uint64_t)];   // Memory of the Helix instance
   MP3FrameInfo  lastFrameInfo;                                  // current MP3 frame info
+  mp3decoder_output_mode_t outputMode;                          // Channels of the decoded samples
+  mp3decoder_quality_t quality;                                 // Bandwidth and sample rate of the decoded samples
+  uint8_t       threads;                                        // Threads decoding each stereo frame
   
   // MP3 file
+  mp3decoder_stream_t stream;                                   // Input backend and handle of the loaded file
   #ifdef __arm__
-  FIL			file;
-  FIL*          mp3File;
+  FIL           file;                                           // Handle of the files opened by MP3LoadFile
   #else
-  FILE*         mp3File;                                        // MP3 file object
+  mp3decoder_stdio_t file;
   #endif
+  const uint8_t* mapped;                                        // Whole file if the backend maps it, decoded without the ring buffer
   uint32_t      fileSize;                                       // file size
   uint32_t      bytesRemaining;                                 // Encoded MP3 bytes remaining to be processed by either offset or decodeMP3
   bool          fileOpened;                                     // true if there is a loaded file
   uint16_t      lastFrameLength;                                // Last frame length
   
-  // MP3-encoded buffer
-  uint8_t       mp3FrameBuffer[MP3_FRAME_BUFFER_BYTES];         // buffer for MP3-encoded frames
-  uint32_t      top;                                            // current position in frame buffer (points to top)
-  uint32_t      bottom;                                         // current position at info end in frame buffer
+  // MP3-encoded ring buffer
+  // The first MP3_MAX_FRAME_BYTES of the ring are mirrored after its end, so there are always at least 
+  // MP3_MAX_FRAME_BYTES contiguous bytes starting at top, and a whole frame can be handed to MP3Decode 
+  // without moving the data in the buffer.
+  uint8_t       mp3FrameBuffer[MP3_FRAME_BUFFER_BYTES + MP3_MAX_FRAME_BYTES];
+  uint32_t      top;                                            // read position in the ring (next byte to be decoded)
+  uint32_t      bottom;                                         // write position in the ring (next byte to be read from file)
+  uint32_t      count;                                          // amount of encoded bytes stored in the ring
+
+  // Stream synchronization
+  mp3decoder_sync_state_t syncState;                            // Current state of the resync engine
+  uint32_t      syncHeader;                                     // Fixed header fields of the stream (MP3_HEADER_SYNC_MASK), 0 if unknown
+
+  // Stream position and seeking
+  bool          streamStarted;                                  // True once the first audio frame was found
+  uint32_t      audioStart;                                     // File offset of the first audio frame
+  uint32_t      frameNumber;                                    // Number of the next frame to be decoded
+  bool          frameNumberExact;                               // False after a resync or a seek with the Xing TOC
+  uint32_t      prerollEnd;                                     // Frames before this file offset are decoded only to prime the bit reservoir
+  uint32_t      totalFrames;                                    // Audio frames in the file from the Xing/VBRI header, 0 if unknown
+  uint32_t      xingStart;                                      // File offset of the Xing frame, TOC positions are relative to it
+  uint32_t      xingBytes;                                      // Stream bytes from the Xing header
+  bool          hasXingToc;                                     // True if xingToc is valid
+  uint8_t       xingToc[MP3_XING_TOC_ENTRIES];                  // Xing TOC, position of each percent of the song in 1/256 of xingBytes
+  uint32_t      index[MP3_SEEK_INDEX_ENTRIES];                  // File offsets of frames 0, indexStep, 2*indexStep...
+  uint32_t      indexCount;                                     // Valid entries in the index
+  uint32_t      indexStep;                                      // Frames between index entries
+  bool          indexComplete;                                  // True if the index covers the whole file (VBRI table)
+
+  // Gapless playback
+  uint32_t      gaplessStart;                                   // First valid sample (per channel) of the stream, from the LAME tag
+  uint32_t      gaplessEnd;                                     // Last valid sample (per channel) plus one, UINT32_MAX if unknown
+  uint16_t      encoderPadding;                                 // Samples added by the encoder after the end of the song, from the LAME tag
+
+  // Decoded samples not yet returned by MP3DecodeSamples
+  short         pcm[MP3_FRAME_MAX_SAMPLES];                     // Last frame decoded when it did not fit in the caller buffer
+  uint16_t      pcmStart;                                       // First pending sample in pcm
+  uint16_t      pcmCount;                                       // Pending samples in pcm (interleaved)
+  uint8_t       pcmChannels;                                    // Channels of the pending samples
+
+  // Upcoming frame info cache
+  uint32_t      nextHeader;                                     // Header of the cached frame info, 0 if none
+  mp3decoder_frame_data_t nextFrameData;                        // Frame info parsed by Helix for nextHeader
+
+  // Statistics
+  mp3decoder_stats_t    stats;                                  // Decoding statistics of the current file
 
   // ID3 tag
   bool                  hasID3Tag;                              // True if the file has valid ID3 tag
   mp3decoder_tag_data_t ID3Data;                                // Parsed data from ID3 tag
 
-} mp3decoder_context_t;
+};
+
+_Static_assert(sizeof(struct mp3decoder) <= sizeof(mp3decoder_storage_t), "MP3DECODER_CONTEXT_BYTES is too small");
+_Static_assert((int)MP3DECODER_STAGE_COUNT == (int)MP3_NUM_STAGES, "mp3decoder_stage_t does not match the Helix stages");
 
 
 
@@ -78,9 +156,158 @@ typedef struct
 
 /*
  * @brief Copies next file data available to the available size on internal buffer
- * Increments bottom index to keep pointing to the end of the data
+ * Increments bottom index to keep pointing to the end of the data, wrapping around the ring
+ */
+static void flushFileToBuffer(mp3decoder_t* decoder);
+
+/*
+ * @brief Returns the contiguous window of encoded data starting at the read position of the ring
+ * @param length  Pointer to variable that will be updated with the amount of contiguous bytes
+ * @returns Pointer to the first encoded byte
+ */
+static uint8_t* bufferWindow(mp3decoder_t* decoder, uint32_t* length);
+
+/*
+ * @brief Discards encoded bytes from the read position of the ring
+ * @param bytes   Amount of bytes consumed
+ */
+static void bufferConsume(mp3decoder_t* decoder, uint32_t bytes);
+
+/*
+ * @brief Empties the ring buffer
+ */
+static void bufferReset(mp3decoder_t* decoder);
+
+/*
+ * @brief Returns the 32 bit header at an offset from the read position of the ring
+ * @param offset  Offset from the read position, can cross the end of the ring
+ */
+static uint32_t headerAt(mp3decoder_t* decoder, uint32_t offset);
+
+/*
+ * @brief Returns the length of a Layer III frame from its header
+ * @param header  Frame header
+ * @returns Frame length in bytes, 0 if the header is not valid (free format is not supported)
+ */
+static uint32_t headerFrameLength(uint32_t header);
+
+/*
+ * @brief Returns the bitrate of a valid frame header in kbps
+ */
+static uint16_t headerBitRate(uint32_t header);
+
+/*
+ * @brief Scans the buffered data in one pass for consecutive matching headers (MP3_SYNC_FRAMES, or MP3_RESYNC_FRAMES 
+ * if they match the stream that was lost), discarding the bytes before them. Locks the decoder to the stream 
+ * when they are found.
+ * @param maxBytes  Max amount of bytes to be scanned
+ * @returns Amount of bytes scanned
+ */
+static uint32_t syncSearch(mp3decoder_t* decoder, uint32_t maxBytes);
+
+/*
+ * @brief Returns the file offset of the read position of the ring
+ */
+static uint32_t fileOffset(mp3decoder_t* decoder);
+
+/*
+ * @brief Returns the sample rate of a frame header
+ */
+static uint32_t headerSampleRate(uint32_t header);
+
+/*
+ * @brief Returns the samples per channel of a frame header
+ */
+static uint32_t headerFrameSamples(uint32_t header);
+
+/*
+ * @brief Returns the channels decoded from a frame header, mono when the decoder downmixes
+ */
+static uint8_t headerOutputChannels(mp3decoder_t* decoder, uint32_t header);
+
+/*
+ * @brief Returns the main data bytes carried by a frame (frame length without header, CRC and side info)
+ */
+static uint32_t headerMainDataBytes(uint32_t header, uint32_t length);
+
+/*
+ * @brief Returns main_data_begin of a frame, the bytes of its main data held by the previous frames
+ * @param frame   Header and the first bytes of the side info (CRC included)
+ */
+static uint32_t frameMainDataBegin(const uint8_t* frame);
+
+/*
+ * @brief Called with the first frame of the stream at the read position. Parses the Xing/Info or VBRI header 
+ * (skipping its frame, which has no audio) and starts the frame numbering and the sparse index.
+ */
+static void streamStart(mp3decoder_t* decoder);
+
+/*
+ * @brief Parses the Xing/Info or VBRI header in the first frame of the stream
+ * @param frame   First frame
+ * @param length  Frame length
+ * @returns True if the frame holds a VBR header instead of audio
+ */
+static bool parseVbrHeader(mp3decoder_t* decoder, const uint8_t* frame, uint32_t length);
+
+/*
+ * @brief Removes the encoder delay and padding from a decoded frame
+ * @param decoder   Decoder instance
+ * @param frame     Number of the decoded frame
+ * @param outBuffer Interleaved samples of the frame, moved to the start of the buffer if the beginning is trimmed
+ * @returns Amount of samples left in the buffer
+ */
+static uint16_t gaplessTrim(mp3decoder_t* decoder, uint32_t frame, short* outBuffer);
+
+/*
+ * @brief Adds a frame to the sparse index if it is the next entry, halving the index resolution when it is full
+ * @param frame   Frame number
+ * @param offset  File offset of the frame
+ */
+static void indexAdd(mp3decoder_t* decoder, uint32_t frame, uint32_t offset);
+
+/*
+ * @brief Adds a frame to a table with the offset of one frame every step frames, if it is the next entry. 
+ * When the table is full every other entry is dropped and the step is doubled.
+ * @param table   Offset table
+ * @param size    Entries of the table
+ * @param count   Valid entries in the table, updated
+ * @param step    Frames between entries, updated
+ * @param frame   Frame number
+ * @param offset  File offset of the frame
+ */
+static void sparseIndexAdd(uint32_t* table, uint32_t size, uint32_t* count, uint32_t* step, uint32_t frame, uint32_t offset);
+
+/*
+ * @brief Walks the frame headers of the file without decoding, until the target frame or the first frame at or 
+ * after the target offset. Finds where decoding has to start so that main_data_begin of the target frame 
+ * points to data already in the bit reservoir.
+ * @param frame     Number of the starting frame, updated with the target frame number
+ * @param offset    File offset of the starting frame, updated with the target frame offset
+ * @param targetFrame   Frame to be reached
+ * @param targetOffset  File offset to be reached
+ * @param prerollOffset Pointer to variable that will be updated with the offset where decoding must start
+ * @returns True if the target was reached
+ */
+static bool walkFrames(mp3decoder_t* decoder, uint32_t* frame, uint32_t* offset, uint32_t targetFrame, uint32_t targetOffset, uint32_t* prerollOffset);
+
+/*
+ * @brief Restarts decoding at a frame of the file, with a fresh Helix instance
+ * @param prerollOffset File offset of the first frame to be decoded
+ * @param targetOffset  File offset of the first frame to be output
+ */
+static void restartAt(mp3decoder_t* decoder, uint32_t prerollOffset, uint32_t targetOffset);
+
+/*
+ * @brief Replaces the Helix instance with a fresh one, with the settings of the decoder
+ */
+static void helixReset(mp3decoder_t* decoder);
+
+/*
+ * @brief Resets a decoder context and creates its Helix instance
+ * @returns True if the Helix instance could be created
  */
-static void flushFileToBuffer();
+static bool decoderInit(mp3decoder_t* decoder);
 
 /*
  * @brief Copies from Helix data structure to own structure
@@ -90,48 +317,42 @@ static void copyFrameInfo(mp3decoder_frame_data_t* mp3Data, MP3FrameInfo* helixD
 /*
  * @brief Reads ID3 tag from MP3 file and updates file pointer after tag info
  */
-static void readID3Tag(void);
-
-/*
-* @brief  Recursively decodes one mp3 frame (if available) to WAV format
-* 
-* @param  *outbuffer      pointer to output buffer (should have space for at least one frame samples)
-* @param  buffersize      number of available bytes in output buffer
-* @param  *samplesDecoded pointer to variable that will be updated with number of samples decoded (if process is successful)
-* 
-* @returns  result code (MP3DECODER_ERROR, MP3DECODER_NOERROR, MP3DECODER_FILE_END, MP3DECODER_NO_FILE, MP3DECODER_BUFFER_OVERFLOW)
-*/
-static mp3decoder_result_t MP3GetDecodedFrameRec(short* outBuffer, uint16_t bufferSize, uint16_t* samplesDecoded, uint8_t depth);
+static void readID3Tag(mp3decoder_t* decoder);
 
 /* FILE HANDLING FUNCTIONS */
 
 /**
  * @brief Closes current file 
  */
-static void closeFile(void);
+static void closeFile(mp3decoder_t* decoder);
 
 /**
  * @brief Opens the given file
  * @param filename  File to be opened
  * @retval True if successfull
  */ 
-static bool openFile(const char * filename);
+static bool openFile(mp3decoder_t* decoder, const char * filename);
+
+/**
+ * @brief Prepares the decoder for the stream just opened: reads the tags and looks for the first frame
+ */
+static void streamLoad(mp3decoder_t* decoder);
 
 /**
  * @brief Returns current file size
  */ 
-static size_t currentFileSize();
+static size_t currentFileSize(mp3decoder_t* decoder);
 
 /**
  * @brief Sets file cursor position to zero
  */ 
-static void fileRewind();
+static void fileRewind(mp3decoder_t* decoder);
 
 /**
  * @brief Sets cursor position to pos
  * @param pos
  */ 
-static void fileSeek(size_t pos);
+static void fileSeek(mp3decoder_t* decoder, size_t pos);
 
 /**
  * @brief Reads the requested amount of bytes from the file
@@ -139,18 +360,27 @@ static void fileSeek(size_t pos);
  * @param count Amount of elements
  * @retval Amount of bytes read
  */ 
-static size_t readFile(void * buf, size_t count);
+static size_t readFile(mp3decoder_t* decoder, void * buf, size_t count);
 
 /*******************************************************************************
  * ROM CONST VARIABLES WITH FILE LEVEL SCOPE
  ******************************************************************************/
 
+static const uint16_t bitrates[2][MP3DECODER_BITRATE_COUNT] = {
+    { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 },    // MPEG-1
+    { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 }          // MPEG-2 and MPEG-2.5
+};
+
 
 /*******************************************************************************
  * STATIC VARIABLES AND CONST VARIABLES WITH FILE LEVEL SCOPE
  ******************************************************************************/
 
-static mp3decoder_context_t dec;
+#if MP3DECODER_MAX_INSTANCES > 0
+static struct mp3decoder    decoderPool[MP3DECODER_MAX_INSTANCES];    // Storage for decoders created without caller storage
+static bool                 decoderPoolUsed[MP3DECODER_MAX_INSTANCES];
+static mp3decoder_t*        defaultDecoder;                           // Instance used by the single decoder API
+#endif
 
 /*******************************************************************************
  *******************************************************************************
@@ -158,88 +388,169 @@ static mp3decoder_context_t dec;
  *******************************************************************************
  ******************************************************************************/
 
-void MP3DecoderInit(void)
+#if MP3DECODER_MAX_INSTANCES > 0
+mp3decoder_t* MP3DecoderCreate(void)
 {
-  dec.helixDecoder = MP3InitDecoder();
-  dec.mp3File = NULL;
-  dec.fileOpened = false;
-  dec.bottom = 0;
-  dec.top = 0;
-  dec.fileSize = 0;
-  dec.bytesRemaining = 0;
-  dec.hasID3Tag = false;
-  #ifdef MP3_PC_TESTBENCH
-  printf("Decoder initialized. Buffer size is %d bytes\n", MP3_FRAME_BUFFER_BYTES);
-  #endif
+  mp3decoder_t* decoder = NULL;
+
+  for (uint8_t i = 0; (i < MP3DECODER_MAX_INSTANCES) && (decoder == NULL); i++)
+  {
+    if (!decoderPoolUsed[i] && decoderInit(&decoderPool[i]))
+    {
+      decoderPoolUsed[i] = true;
+      decoder = &decoderPool[i];
+    }
+  }
+  return decoder;
 }
+#endif
 
-bool MP3LoadFile(const char* filename)
+mp3decoder_t* MP3DecoderCreateStatic(mp3decoder_storage_t* storage)
 {
-  bool ret = false;
+  mp3decoder_t* decoder = (mp3decoder_t*)storage;
+  memset(storage, 0, sizeof(mp3decoder_storage_t));   // No Helix instance yet, decoderInit has nothing to stop
+  return decoderInit(decoder) ? decoder : NULL;
+}
 
-  if (dec.fileOpened)
+void MP3DecoderDestroy(mp3decoder_t* decoder)
+{
+  closeFile(decoder);
+  MP3FreeDecoder(decoder->helixDecoder);
+  decoder->helixDecoder = NULL;
+
+#if MP3DECODER_MAX_INSTANCES > 0
+  for (uint8_t i = 0; i < MP3DECODER_MAX_INSTANCES; i++)
   {
-    // Close previous file and context if necessary
-    closeFile();
-
-    // Reset context pointers and vars 
-    dec.fileOpened = false;
-    dec.bottom = 0;
-    dec.top = 0;
-    dec.fileSize = 0;
-    dec.bytesRemaining = 0;
-    dec.hasID3Tag = false;
+    if (decoder == &decoderPool[i])
+    {
+      decoderPoolUsed[i] = false;
+    }
   }
+#endif
+}
+
+bool MP3DecoderLoadFile(mp3decoder_t* decoder, const char* filename)
+{
+  bool ret = false;
+
+  // Close previous file and context if necessary
+  closeFile(decoder);
+  decoder->fileSize = 0;
+  decoder->bytesRemaining = 0;
+  decoder->hasID3Tag = false;
 
   // Open new file, if successfully opened
-  if (openFile(filename))
+  if (openFile(decoder, filename))
   {
-    dec.fileOpened = true;
-    dec.fileSize = currentFileSize();
-    dec.bytesRemaining = dec.fileSize;
+    streamLoad(decoder);
+    ret = true;
+  }
+  return ret;
+}
+
+void MP3DecoderLoadStream(mp3decoder_t* decoder, const mp3decoder_stream_t* stream)
+{
+  closeFile(decoder);
+  decoder->stream = *stream;
+  streamLoad(decoder);
+}
+
+void streamLoad(mp3decoder_t* decoder)
+{
+    uint32_t mappedLength = 0;
+
+    decoder->fileOpened = true;
+    decoder->fileSize = currentFileSize(decoder);
+    decoder->mapped = decoder->stream.io->map ? decoder->stream.io->map(decoder->stream.handle, &mappedLength) : NULL;
+    if (mappedLength < decoder->fileSize)
+    {
+        decoder->mapped = NULL;
+    }
+    decoder->bytesRemaining = decoder->fileSize;
+    decoder->hasID3Tag = false;
+    decoder->syncState = MP3_SYNC_SEARCHING;
+    decoder->syncHeader = 0;
+    decoder->streamStarted = false;
+    decoder->prerollEnd = 0;
+    decoder->totalFrames = 0;
+    decoder->hasXingToc = false;
+    decoder->gaplessStart = 0;
+    decoder->gaplessEnd = UINT32_MAX;
+    decoder->encoderPadding = 0;
+    decoder->pcmCount = 0;
+    decoder->nextHeader = 0;
+    decoder->indexCount = 0;
+    decoder->indexStep = MP3_SEEK_INDEX_STEP;
+    decoder->indexComplete = false;
+    memset(&decoder->stats, 0, sizeof(mp3decoder_stats_t));
+    bufferReset(decoder);
+
+    // The overlap and the subband history of the previous stream would leak into the first granule
+    helixReset(decoder);
 
     // read ID3 tag and update pointers
-    readID3Tag();
+    readID3Tag(decoder);
     
-    // flush file to buffer
-    flushFileToBuffer();
+    // flush file to buffer and look for the first frame, so the file can be seeked right away
+    flushFileToBuffer(decoder);
+    syncSearch(decoder, MP3_RESYNC_MAX_BYTES);
+    if (decoder->syncState == MP3_SYNC_LOCKED)
+    {
+        streamStart(decoder);
+    }
 
     #ifdef MP3_PC_TESTBENCH
     printf("File opened successfully!\n");
-    printf("File size is %d bytes\n", dec.fileSize);
+    printf("File size is %d bytes\n", decoder->fileSize);
     #endif
-    
-    ret = true;
-  }
-  return ret;
 }
 
-bool MP3GetLastFrameData(mp3decoder_frame_data_t* data)
+bool MP3DecoderGetLastFrameData(mp3decoder_t* decoder, mp3decoder_frame_data_t* data)
 {
     bool ret = false;
-    if (dec.bytesRemaining < dec.fileSize)
+    if (decoder->bytesRemaining < decoder->fileSize)
     {
-        copyFrameInfo(data, &dec.lastFrameInfo);
+        copyFrameInfo(data, &decoder->lastFrameInfo);
         ret = true;
     }
 
     return ret;
 }
 
-bool MP3GetNextFrameData(mp3decoder_frame_data_t* data)
+bool MP3DecoderGetNextFrameData(mp3decoder_t* decoder, mp3decoder_frame_data_t* data)
 {
     bool ret = false;
 
-    if(dec.bytesRemaining != 0)
+    if(decoder->bytesRemaining != 0)
     {
         MP3FrameInfo nextFrame;
-        int offset = MP3FindSyncWord(dec.mp3FrameBuffer + dec.top, dec.bottom - dec.top);
-        if (offset >= 0)
+        uint32_t length;
+        uint8_t* window = bufferWindow(decoder, &length);
+
+        // When locked the next frame starts at the read position, no need to look for the sync word
+        int offset = (decoder->syncState == MP3_SYNC_LOCKED) && (length >= MP3_HEADER_BYTES) ? 0 : MP3FindSyncWord(window, length);
+
+        // The sync word can be found in the last bytes of the window, the header is then completed from the file
+        if ((offset >= 0) && ((uint32_t)offset + MP3_HEADER_BYTES > length))
         {
-            int res = MP3GetNextFrameInfo(dec.helixDecoder, &nextFrame, dec.mp3FrameBuffer + dec.top + offset);
-            if (res == 0)
+            flushFileToBuffer(decoder);
+            window = bufferWindow(decoder, &length);
+        }
+
+        if ((offset >= 0) && ((uint32_t)offset + MP3_HEADER_BYTES <= length))
+        {
+            // Consecutive frames usually share the whole header, so Helix only parses it when it changes
+            uint32_t header = ((uint32_t)window[offset] << 24) | (window[offset + 1] << 16) | (window[offset + 2] << 8) | window[offset + 3];
+            if ((header != 0) && (header == decoder->nextHeader))
+            {
+                *data = decoder->nextFrameData;
+                ret = true;
+            }
+            else if (MP3GetNextFrameInfo(decoder->helixDecoder, &nextFrame, window + offset) == 0)
             {
-                copyFrameInfo(data, &nextFrame);
+                copyFrameInfo(&decoder->nextFrameData, &nextFrame);
+                decoder->nextHeader = header;
+                *data = decoder->nextFrameData;
                 ret = true;
             }
         }
@@ -248,372 +559,1269 @@ bool MP3GetNextFrameData(mp3decoder_frame_data_t* data)
     return ret;
 }
 
-mp3decoder_result_t MP3GetDecodedFrame(short* outBuffer, uint16_t bufferSize, uint16_t* samplesDecoded)
+mp3decoder_result_t MP3DecoderGetDecodedFrame(mp3decoder_t* decoder, short* outBuffer, uint16_t bufferSize, uint16_t* samplesDecoded)
 {
-    return MP3GetDecodedFrameRec(outBuffer, bufferSize, samplesDecoded, 0);
-}
+  mp3decoder_result_t ret = MP3DECODER_ERROR;       // Return value of the function
+  uint32_t scanned = 0;                             // Bytes scanned looking for sync in this call
+  uint8_t dropped = 0;                              // Frames dropped in this call
+  bool done = false;
 
-mp3decoder_result_t MP3GetDecodedFrameRec(short* outBuffer, uint16_t bufferSize, uint16_t* samplesDecoded, uint8_t depth)
-{
-  mp3decoder_result_t ret = MP3DECODER_NO_ERROR;    // Return value of the function
-  
   #ifdef MP3_PC_TESTBENCH
-  printf("Entered decoding. File has %d bytes to decode\n", dec.fileSize);
-  printf("Buffer has %d bytes to decode\n", dec.bottom - dec.top);
+  printf("Entered decoding. File has %d bytes to decode\n", decoder->fileSize);
+  printf("Buffer has %d bytes to decode\n", decoder->count);
   #endif
-  
-  if (depth < MP3_REC_MAX_DEPTH)
+
+  if (!decoder->fileOpened)
   {
-      if (!dec.fileOpened)
+      return MP3DECODER_NO_FILE;
+  }
+
+  // Every iteration either decodes a frame, consumes encoded bytes or reads the file, and both the bytes scanned 
+  // and the frames dropped in one call are bounded, so the time spent in one call is bounded too
+  while (!done)
+  {
+      if (decoder->bytesRemaining == 0)
       {
-          ret = MP3DECODER_NO_FILE;
+          // no remaining info in file/buffer, the file stays open until the next load so it can still be seeked
+          ret = MP3DECODER_FILE_END;
+          done = true;
       }
-      else if (dec.bytesRemaining) // check if there is remaining info to be decoded
+      else if (decoder->syncState == MP3_SYNC_SEARCHING)
       {
-          #ifdef MP3_PC_TESTBENCH
-          printf("Current pointers are Head = %d - Bottom = %d\n", dec.top, dec.bottom);
-          #endif
-
-          // scroll encoded info up in array if necessary (TESTED-WORKING)
-          if ((dec.top > 0) && ((dec.bottom - dec.top) > 0) && (dec.bottom - dec.top < MP3_FRAME_BUFFER_BYTES))
+          if (scanned >= MP3_RESYNC_MAX_BYTES)
           {
-              //memcpy(dec.mp3FrameBuffer , dec.mp3FrameBuffer + dec.top, dec.bottom - dec.top);
-              memmove(dec.mp3FrameBuffer, dec.mp3FrameBuffer + dec.top, dec.bottom - dec.top);
-              dec.bottom = dec.bottom - dec.top;
-              dec.top = 0;
-
-              #ifdef MP3_PC_TESTBENCH
-              printf("Copied %d bytes from %d to %d\n", (dec.bottom - dec.top), dec.top, 0);
-              #endif
+              // Give the caller the chance to do something else, the search goes on in the next call
+              ret = MP3DECODER_ERROR;
+              done = true;
           }
-          else if (dec.bottom == dec.top)
+          else
           {
-              // If arrived here, there is nothing else to do
-              #ifdef MP3_PC_TESTBENCH
-              printf("Empty buffer.\n");
-              #endif
-
+              scanned += syncSearch(decoder, MP3_RESYNC_MAX_BYTES - scanned);
           }
-          else if (dec.bottom == MP3_DECODED_BUFFER_SIZE)
+      }
+      else if (!decoder->streamStarted)
+      {
+          streamStart(decoder);
+      }
+      else if (dropped >= MP3_MAX_DROPPED_FRAMES)
+      {
+          ret = MP3DECODER_ERROR;
+          done = true;
+      }
+      else
+      {
+          // Read encoded data from file, only when there is room for a big read or a frame may not fit
+          if ((MP3_FRAME_BUFFER_BYTES - decoder->count >= MP3_REFILL_THRESHOLD) || (decoder->count < MP3_MAX_FRAME_BYTES))
           {
-              #ifdef MP3_PC_TESTBENCH
-              printf("Full buffer.\n");
-              #endif
+              flushFileToBuffer(decoder);
           }
 
-          // Read encoded data from file
-          flushFileToBuffer();
+          // Locked to the stream, the next frame must start right at the read position
+          uint32_t header = headerAt(decoder, 0);
+          uint32_t frameLength = headerFrameLength(header);
 
-          // seek mp3 header beginning 
-          int offset = MP3FindSyncWord(dec.mp3FrameBuffer + dec.top, dec.bottom);
-
-          if (offset >= 0)
+          if ((decoder->count < MP3_HEADER_BYTES) || (frameLength == 0) || ((header & MP3_HEADER_SYNC_MASK) != decoder->syncHeader))
           {
-              //! check errors in searching for sync words (there shouldnt be)
-              dec.top += offset; // updating top pointer
-              dec.bytesRemaining -= offset;  // subtract garbage info to file size
-
               #ifdef MP3_PC_TESTBENCH
-              printf("Sync word found @ %d offset\n", offset);
+              printf("Sync lost at %d bytes from file end\n", decoder->bytesRemaining);
               #endif
+              decoder->syncState = MP3_SYNC_SEARCHING;
+              decoder->stats.resyncs++;
+              decoder->frameNumberExact = false;
           }
-
-          //check samples in next frame (to avoid segmentation fault)
-          MP3FrameInfo nextFrameInfo;
-
-          int err = MP3GetNextFrameInfo(dec.helixDecoder, &nextFrameInfo, dec.mp3FrameBuffer + dec.top);
-
-          if (err == 0)
+          else if (frameLength > decoder->count)
           {
-              #ifdef MP3_PC_TESTBENCH
-              printf("Frame to decode has %d samples\n", nextFrameInfo.outputSamps);
-              #endif
-              if (nextFrameInfo.outputSamps > bufferSize)
+              // Truncated frame at the end of the file
+              decoder->stats.droppedFrames++;
+              bufferConsume(decoder, decoder->count);
+          }
+          else
+          {
+              //check samples in next frame (to avoid segmentation fault), the header was already read so Helix does not parse it again
+              uint32_t windowLength;
+              uint8_t* window = bufferWindow(decoder, &windowLength);
+              uint32_t outputSamples = headerFrameSamples(header) * headerOutputChannels(decoder, header);
+
+              if (outputSamples > bufferSize)
               {
                   #ifdef MP3_PC_TESTBENCH
                   printf("Out buffer isnt big enough to hold samples.\n");
                   #endif
                   return MP3DECODER_BUFFER_OVERFLOW;
               }
-          }
-
-          // with array organized, lets decode a frame
-          uint8_t* decPointer = dec.mp3FrameBuffer + dec.top;
-          int bytesLeft = dec.bottom - dec.top;
-
-          int res = MP3Decode(dec.helixDecoder, &decPointer, &(bytesLeft), outBuffer, MP3DECODER_MODE_NORMAL); //! autodecrements fileSize with bytes decoded. updated inbuf pointer, updated bytesLeft
-
-          if (res == ERR_MP3_NONE) // if decoding successful
-          {
-              uint16_t decodedBytes = dec.bottom - dec.top - bytesLeft;
-              dec.lastFrameLength = decodedBytes;
-
-              #ifdef MP3_PC_TESTBENCH
-              printf("Frame decoded!. MP3 frame size was %d bytes\n", decodedBytes);
-              #endif
-
-              // update header pointer and file size
-              dec.top += decodedBytes;
-              dec.bytesRemaining -= decodedBytes;
 
-              // update last frame decoded info
-              MP3GetLastFrameInfo(dec.helixDecoder, &(dec.lastFrameInfo));
+              // the window is contiguous, lets decode a frame
+              uint8_t* decPointer = window;
+              int bytesLeft = windowLength;
+              uint32_t offset = fileOffset(decoder);
+              int res = MP3Decode(decoder->helixDecoder, &decPointer, &(bytesLeft), outBuffer, MP3DECODER_MODE_NORMAL);
 
-              // update samples decoded
-              *samplesDecoded = dec.lastFrameInfo.outputSamps;
-
-              // return success code
-              ret = MP3DECODER_NO_ERROR;
-          }
-          else if (res == ERR_MP3_INDATA_UNDERFLOW || res == ERR_MP3_MAINDATA_UNDERFLOW)
-          {
-              if (dec.bytesRemaining == 0)
+              if (offset < decoder->prerollEnd)
               {
-                  #ifdef MP3_PC_TESTBENCH
-                  printf("[Error] Buffer underflow and file empty\n");
-                  #endif
-
-                  // close  file
-                  closeFile();  
-                  return MP3DECODER_FILE_END;
+                  // Frame before a seek target, only fills the bit reservoir and the overlap buffers
+                  bufferConsume(decoder, frameLength);
               }
-              #ifdef MP3_PC_TESTBENCH
-              printf("Underflow error (code %d)\n", res);
-              #endif
-
-              // If there weren't enough bytes on the buffer, try again
-              return MP3GetDecodedFrameRec(outBuffer, bufferSize, samplesDecoded, depth + 1); //! H-quearlo
-          }
-          else
-          {
-              if (dec.bytesRemaining <= dec.lastFrameLength)
+              else if (res == ERR_MP3_NONE) // if decoding successful
               {
+                  decoder->lastFrameLength = frameLength;
+
                   #ifdef MP3_PC_TESTBENCH
-                  printf("Dropped frame\n");
+                  printf("Frame decoded!. MP3 frame size was %d bytes\n", frameLength);
                   #endif
-                  closeFile();
-                  return MP3DECODER_FILE_END;
+
+                  // update header pointer and file size
+                  bufferConsume(decoder, frameLength);
+                  decoder->stats.framesDecoded++;
+                  uint32_t frame = decoder->frameNumber++;
+                  indexAdd(decoder, frame, offset);
+
+                  // update last frame decoded info
+                  MP3GetLastFrameInfo(decoder->helixDecoder, &(decoder->lastFrameInfo));
+
+                  // update samples decoded, without the encoder delay and padding
+                  *samplesDecoded = gaplessTrim(decoder, frame, outBuffer);
+
+                  // return success code, unless the whole frame was trimmed
+                  if (*samplesDecoded)
+                  {
+                      ret = MP3DECODER_NO_ERROR;
+                      done = true;
+                  }
               }
               else
               {
-                  dec.top++;
-                  dec.bytesRemaining--;
                   #ifdef MP3_PC_TESTBENCH
-                  printf("Error: %d\n", res);
+                  printf("Dropped frame (error %d)\n", res);
                   #endif
 
-                  // If invalid header, try with next frame
-                  return MP3GetDecodedFrameRec(outBuffer, bufferSize, samplesDecoded, depth + 1); //! H-quearlo
+                  // The header was validated, so skip the whole frame instead of a single byte. On main data underflow
+                  // Helix has already stored the frame in the bit reservoir, so the next frame can be decoded.
+                  bufferConsume(decoder, frameLength);
+                  decoder->stats.droppedFrames++;
+                  indexAdd(decoder, decoder->frameNumber++, offset);
+                  dropped++;
               }
           }
       }
-      else // no remaining info in file/buffer => close file
-      {
-          closeFile();
-          ret = MP3DECODER_FILE_END;
-      }
   }
-  else
-  {
-    ret = MP3DECODER_ERROR;
-  }
-  return ret;
 
+  return ret;
 }
 
-bool MP3GetTagData(mp3decoder_tag_data_t* data)
+bool MP3DecoderGetTagData(mp3decoder_t* decoder, mp3decoder_tag_data_t* data)
 {
     bool ret = false;
-    if (dec.hasID3Tag)
+    if (decoder->hasID3Tag)
     {
-        strcpy(data->album, dec.ID3Data.album);
-        strcpy(data->artist, dec.ID3Data.artist);
-        strcpy(data->title, dec.ID3Data.title);
-        strcpy(data->trackNum, dec.ID3Data.trackNum);
-        strcpy(data->year, dec.ID3Data.year);     
+        strcpy((char*)data->album, (const char*)decoder->ID3Data.album);
+        strcpy((char*)data->artist, (const char*)decoder->ID3Data.artist);
+        strcpy((char*)data->title, (const char*)decoder->ID3Data.title);
+        strcpy((char*)data->trackNum, (const char*)decoder->ID3Data.trackNum);
+        strcpy((char*)data->year, (const char*)decoder->ID3Data.year);     
         ret = true;
     }
 
     return ret;
 }
-/*******************************************************************************
- *******************************************************************************
-                        LOCAL FUNCTION DEFINITIONS
- *******************************************************************************
- ******************************************************************************/
 
-void flushFileToBuffer()
+void MP3DecoderSetOutputMode(mp3decoder_t* decoder, mp3decoder_output_mode_t mode)
+{
+    decoder->outputMode = mode;
+    decoder->nextHeader = 0;
+    MP3SetDownmix(decoder->helixDecoder, mode == MP3DECODER_OUTPUT_MONO);
+}
+
+void MP3DecoderSetQuality(mp3decoder_t* decoder, mp3decoder_quality_t quality)
+{
+    decoder->quality = quality;
+    decoder->nextHeader = 0;
+    MP3SetHalfRate(decoder->helixDecoder, quality == MP3DECODER_QUALITY_HALF_RATE);
+}
+
+uint8_t MP3DecoderSetThreads(mp3decoder_t* decoder, uint8_t threads)
+{
+    decoder->threads = MP3SetChannelThreads(decoder->helixDecoder, threads);
+    return decoder->threads;
+}
+
+mp3decoder_result_t MP3DecoderDecodeSamples(mp3decoder_t* decoder, short* outBuffer, uint16_t nSamples, uint16_t* samplesDecoded, uint16_t* channels)
 {
-    uint16_t bytesRead;
+    mp3decoder_result_t ret = MP3DECODER_NO_ERROR;
+    uint8_t retries = MP3_DECODE_RETRIES;
+    uint16_t filled = 0;                            // Samples (per channel) written to outBuffer
+    uint16_t count;
+    bool buffered = false;                          // A frame did not fit in the caller buffer, decode in pcm
 
-    // Fill buffer with info in mp3 file
-    uint8_t* dest = dec.mp3FrameBuffer + dec.bottom;
-    if (MP3_FRAME_BUFFER_BYTES - dec.bottom > 0)
+    *channels = decoder->pcmCount ? decoder->pcmChannels : 0;
+
+    // Only decode the next frame in advance
+    if ((nSamples == 0) && (decoder->pcmCount == 0))
     {
-        bytesRead = readFile(dest, (MP3_FRAME_BUFFER_BYTES - dec.bottom));
-        // Update bottom pointer
-        dec.bottom += bytesRead;
+        ret = MP3DecoderGetDecodedFrame(decoder, decoder->pcm, MP3_FRAME_MAX_SAMPLES, &count);
+        if (ret == MP3DECODER_NO_ERROR)
+        {
+            decoder->pcmStart = 0;
+            decoder->pcmCount = count;
+            decoder->pcmChannels = decoder->lastFrameInfo.nChans;
+            *channels = decoder->pcmChannels;
+        }
     }
 
-    #ifdef MP3_PC_TESTBENCH
-    if (bytesRead == 0)
+    while ((filled < nSamples) && (ret == MP3DECODER_NO_ERROR))
     {
-        printf("File was read completely.\n");
+        if (decoder->pcmCount)
+        {
+            // Samples left from the last frame go first, unless the channel layout changed
+            if (decoder->pcmChannels != *channels)
+            {
+                break;
+            }
+            uint16_t samples = MP3_MIN(decoder->pcmCount / *channels, nSamples - filled);
+            memcpy(outBuffer + filled * *channels, decoder->pcm + decoder->pcmStart, samples * *channels * sizeof(short));
+            decoder->pcmStart += samples * *channels;
+            decoder->pcmCount -= samples * *channels;
+            filled += samples;
+        }
+        else
+        {
+            // Frames are decoded straight into the caller buffer while the next one fits, sized from its header
+            // with the real channels, the last one goes through the internal buffer and its remaining samples are
+            // kept for the next call
+            bool locked = (decoder->syncState == MP3_SYNC_LOCKED) && decoder->streamStarted && (decoder->count >= MP3_HEADER_BYTES);
+            uint32_t header = locked ? headerAt(decoder, 0) : 0;
+            uint8_t nextChannels = (locked && ((header & MP3_HEADER_SYNC_MASK) == decoder->syncHeader)) ? headerOutputChannels(decoder, header) : 0;
+            uint32_t space = MP3_MIN((uint32_t)(nSamples - filled) * nextChannels, UINT16_MAX);
+            bool direct = !buffered && nextChannels && ((*channels == 0) || (*channels == nextChannels)) &&
+                          (headerFrameSamples(header) * nextChannels <= space);
+            short* dest = direct ? outBuffer + filled * nextChannels : decoder->pcm;
+            mp3decoder_result_t res = MP3DecoderGetDecodedFrame(decoder, dest, direct ? space : MP3_FRAME_MAX_SAMPLES, &count);
+
+            if (res == MP3DECODER_NO_ERROR)
+            {
+                uint8_t frameChannels = decoder->lastFrameInfo.nChans;
+                if (*channels == 0)
+                {
+                    *channels = frameChannels;
+                }
+                if (direct && (frameChannels == *channels))
+                {
+                    filled += count / frameChannels;
+                }
+                else
+                {
+                    if (direct)
+                    {
+                        // The layout changed, keep the frame for the next call
+                        memcpy(decoder->pcm, dest, count * sizeof(short));
+                    }
+                    decoder->pcmStart = 0;
+                    decoder->pcmCount = count;
+                    decoder->pcmChannels = frameChannels;
+                }
+            }
+            else if ((res == MP3DECODER_BUFFER_OVERFLOW) && direct)
+            {
+                // Another frame than the one peeked was decoded (after a preroll or a resync) and did not fit
+                buffered = true;
+            }
+            else if ((res == MP3DECODER_ERROR) && retries)
+            {
+                retries--;
+            }
+            else
+            {
+                ret = res;
+            }
+        }
     }
-    printf("[?] Read %d bytes from file. Head = %d - Bottom = %d\n", bytesRead, dec.top, dec.bottom);
-    #endif
+
+    // Samples already written are valid even if the file ended or failed afterwards
+    *samplesDecoded = filled;
+    return ret;
 }
 
+uint16_t MP3DecoderGetPendingSamples(mp3decoder_t* decoder)
+{
+    return decoder->pcmCount ? decoder->pcmCount / decoder->pcmChannels : 0;
+}
 
-void copyFrameInfo(mp3decoder_frame_data_t* mp3Data, MP3FrameInfo* helixData)
+void MP3DecoderGetStats(mp3decoder_t* decoder, mp3decoder_stats_t* stats)
 {
-    mp3Data->bitRate = helixData->bitrate;
-    mp3Data->binitsPerSample = helixData->bitsPerSample;
-    mp3Data->channelCount = helixData->nChans;
-    mp3Data->sampleRate = helixData->samprate;
-    mp3Data->sampleCount = helixData->outputSamps;
+    *stats = decoder->stats;
 }
 
-void readID3Tag(void)
+void MP3DecoderGetProfile(mp3decoder_t* decoder, mp3decoder_profile_t* profile)
 {
+    MP3Profile helixProfile;
+    MP3GetDecodeProfile(decoder->helixDecoder, &helixProfile);
 
-    if (has_ID3_tag(dec.mp3File))
+    profile->frames = helixProfile.nFrames;
+    for (uint8_t i = 0; i < MP3DECODER_STAGE_COUNT; i++)
     {
-        dec.hasID3Tag = true;
-
-        if (!read_ID3_info(TITLE_ID3, dec.ID3Data.title, ID3_MAX_FIELD_SIZE, dec.mp3File))
-            strcpy(dec.ID3Data.title, DEFAULT_ID3_FIELD);
-
-        if (!read_ID3_info(ALBUM_ID3, dec.ID3Data.album, ID3_MAX_FIELD_SIZE, dec.mp3File))
-            strcpy(dec.ID3Data.album, DEFAULT_ID3_FIELD);
+        profile->total[i] = helixProfile.total[i];
+        profile->min[i] = helixProfile.min[i];
+        profile->max[i] = helixProfile.max[i];
+    }
+}
 
-        if (!read_ID3_info(ARTIST_ID3, dec.ID3Data.artist, ID3_MAX_FIELD_SIZE, dec.mp3File))
-            strcpy(dec.ID3Data.artist, DEFAULT_ID3_FIELD);
+void MP3DecoderResetProfile(mp3decoder_t* decoder)
+{
+    MP3ResetDecodeProfile(decoder->helixDecoder);
+}
 
-        if (!read_ID3_info(YEAR_ID3, dec.ID3Data.year, 10, dec.mp3File))
-            strcpy(dec.ID3Data.year, DEFAULT_ID3_FIELD);
+bool MP3DecoderSeek(mp3decoder_t* decoder, uint32_t milliseconds)
+{
+    bool ret = false;
 
-        if (!read_ID3_info(TRACK_NUM_ID3, dec.ID3Data.trackNum, 10, dec.mp3File))
-            strcpy(dec.ID3Data.trackNum, DEFAULT_ID3_FIELD);
+    // The position is counted in the samples left after the encoder delay, like MP3GetPosition and MP3GetDuration
+    uint32_t targetFrame = decoder->streamStarted ? ((uint64_t)milliseconds * headerSampleRate(decoder->syncHeader) / 1000 + decoder->gaplessStart) / headerFrameSamples(decoder->syncHeader) : 0;
 
+    // A target past the frame count of the Xing/VBRI header fails like one past the end of a file walked frame by frame
+    if (decoder->fileOpened && decoder->streamStarted && (!decoder->totalFrames || (targetFrame < decoder->totalFrames)))
+    {
+        uint32_t targetOffset = UINT32_MAX;
+        uint32_t frame, offset, prerollOffset;
+        uint32_t estimatedFrame = targetFrame;
+        bool exact = true;
+        bool found = true;
+        bool moved = false;
+
+        // Where the decoding resumes if the seek fails
+        uint32_t resumeOffset = fileOffset(decoder);
+        uint32_t resumeFrame = decoder->frameNumber;
+        bool resumeExact = decoder->frameNumberExact;
+        uint32_t resumeHeader = decoder->syncHeader;
+        mp3decoder_sync_state_t resumeState = decoder->syncState;
+
+        // Start from the last indexed frame that leaves room for the bit reservoir frames before the target
+        uint32_t entry = (targetFrame > MP3_SEEK_HISTORY ? targetFrame - MP3_SEEK_HISTORY : 0) / decoder->indexStep;
+        if (entry >= decoder->indexCount)
+        {
+            entry = decoder->indexCount - 1;
+        }
+        frame = entry * decoder->indexStep;
+        offset = decoder->index[entry];
+
+        if (decoder->hasXingToc && (targetFrame - frame > MP3_SEEK_WALK_FRAMES))
+        {
+            // Too far from the indexed part of the file, jump to the position given by the Xing TOC (interpolated)
+            uint32_t position = (uint32_t)(((uint64_t)targetFrame * MP3_XING_TOC_ENTRIES * 256) / decoder->totalFrames);
+            uint32_t percent = position >> 8;
+            uint32_t a = decoder->xingToc[percent];
+            uint32_t b = (percent + 1 < MP3_XING_TOC_ENTRIES) ? decoder->xingToc[percent + 1] : 256;
+            targetOffset = decoder->xingStart + (uint32_t)(((uint64_t)(a * 256 + (b - a) * (position & 0xFF)) * decoder->xingBytes) >> 16);
+
+            // Find a frame some bytes before it, to walk up to the target from there
+            uint32_t start = (targetOffset > decoder->audioStart + MP3_SEEK_BACKOFF_BYTES) ? targetOffset - MP3_SEEK_BACKOFF_BYTES : decoder->audioStart;
+            bufferReset(decoder);
+            moved = true;
+            fileSeek(decoder, start);
+            decoder->bytesRemaining = decoder->fileSize - start;
+            decoder->syncState = MP3_SYNC_SEARCHING;
+            syncSearch(decoder, MP3_RESYNC_MAX_BYTES);
+            found = (decoder->syncState == MP3_SYNC_LOCKED);
+            offset = fileOffset(decoder);
+            frame = targetFrame;
+            targetFrame = UINT32_MAX;
+            exact = false;
+        }
+
+        if (found && walkFrames(decoder, &frame, &offset, targetFrame, targetOffset, &prerollOffset))
+        {
+            restartAt(decoder, prerollOffset, offset);
+            decoder->frameNumber = exact ? frame : estimatedFrame;
+            decoder->frameNumberExact = exact;
+            ret = true;
+        }
+        else if (moved)
+        {
+            // The ring was already refilled from the Xing TOC position, decoding restarts where it was
+            decoder->syncHeader = resumeHeader;
+            restartAt(decoder, resumeOffset, resumeOffset);
+            decoder->syncState = resumeState;
+            decoder->frameNumber = resumeFrame;
+            decoder->frameNumberExact = resumeExact;
+        }
+        else
+        {
+            // Target out of the file, the ring was not touched, keep decoding from where it was
+            fileSeek(decoder, fileOffset(decoder) + decoder->count);
+        }
+    }
+
+    return ret;
+}
+
+uint32_t MP3DecoderGetPosition(mp3decoder_t* decoder)
+{
+    uint32_t position = 0;
+    if (decoder->streamStarted)
+    {
+        // Next sample to be returned, at the stream sample rate and without the encoder delay and padding
+        uint8_t shift = (decoder->quality == MP3DECODER_QUALITY_HALF_RATE) ? 1 : 0;
+        uint64_t sample = (uint64_t)decoder->frameNumber * headerFrameSamples(decoder->syncHeader);
+        sample = MP3_MIN(sample, decoder->gaplessEnd);
+        uint64_t skipped = decoder->gaplessStart + ((uint64_t)MP3DecoderGetPendingSamples(decoder) << shift);
+        position = (sample > skipped) ? ((sample - skipped) * 1000) / headerSampleRate(decoder->syncHeader) : 0;
+    }
+    return position;
+}
+
+uint32_t MP3DecoderGetDuration(mp3decoder_t* decoder)
+{
+    uint32_t duration = 0;
+    if (decoder->streamStarted)
+    {
+        uint32_t sampleRate = headerSampleRate(decoder->syncHeader);
+        if (decoder->gaplessEnd != UINT32_MAX)
+        {
+            duration = ((uint64_t)(decoder->gaplessEnd - decoder->gaplessStart) * 1000) / sampleRate;
+        }
+        else if (decoder->totalFrames)
+        {
+            duration = ((uint64_t)decoder->totalFrames * headerFrameSamples(decoder->syncHeader) * 1000) / sampleRate;
+        }
+        else if (decoder->lastFrameInfo.bitrate)
+        {
+            duration = ((uint64_t)(decoder->fileSize - decoder->audioStart) * 8 * 1000) / decoder->lastFrameInfo.bitrate;
+        }
+    }
+    return duration;
+}
+
+bool MP3DecoderScan(mp3decoder_t* decoder, mp3decoder_scan_t* scan, uint32_t* offsets, uint32_t maxOffsets)
+{
+    if (!decoder->fileOpened || !decoder->streamStarted)
+    {
+        return false;
+    }
+
+    // The decoding state is restored afterwards, from the read position of the ring
+    uint32_t position = fileOffset(decoder);
+    mp3decoder_sync_state_t syncState = decoder->syncState;
+    uint32_t syncHeader = decoder->syncHeader;
+    mp3decoder_stats_t stats = decoder->stats;
+
+    memset(scan, 0, sizeof(mp3decoder_scan_t));
+    scan->offsetStep = 1;
+    scan->sampleRate = headerSampleRate(syncHeader);
+    for (uint8_t i = 0; i < MP3DECODER_BITRATE_COUNT; i++)
+    {
+        scan->bitRates[i] = headerBitRate(syncHeader | (i << 12));
+    }
+    decoder->indexCount = 0;
+    decoder->indexStep = 1;
+
+    // Same walk as MP3GetDecodedFrame without MP3Decode, frames are read in big blocks (or in place if mapped) and
+    // only their headers are parsed
+    bufferReset(decoder);
+    fileSeek(decoder, decoder->audioStart);
+    decoder->bytesRemaining = decoder->fileSize - decoder->audioStart;
+    decoder->syncState = MP3_SYNC_LOCKED;
+    decoder->stats.skippedBytes = 0;
+    while (decoder->bytesRemaining)
+    {
+        if (decoder->syncState == MP3_SYNC_SEARCHING)
+        {
+            syncSearch(decoder, MP3_RESYNC_MAX_BYTES);
+            continue;
+        }
+
+        if ((MP3_FRAME_BUFFER_BYTES - decoder->count >= MP3_REFILL_THRESHOLD) || (decoder->count < MP3_MAX_FRAME_BYTES))
+        {
+            flushFileToBuffer(decoder);
+        }
+
+        uint32_t header = (decoder->count >= MP3_HEADER_BYTES) ? headerAt(decoder, 0) : 0;
+        uint32_t length = headerFrameLength(header);
+        if ((length == 0) || ((header & MP3_HEADER_SYNC_MASK) != decoder->syncHeader))
+        {
+            decoder->syncState = MP3_SYNC_SEARCHING;
+        }
+        else if (length > decoder->count)
+        {
+            // Truncated frame at the end of the file, the decoder drops it too
+            bufferConsume(decoder, decoder->count);
+        }
+        else
+        {
+            uint32_t offset = fileOffset(decoder);
+            if (offsets && maxOffsets)
+            {
+                sparseIndexAdd(offsets, maxOffsets, &scan->offsetCount, &scan->offsetStep, scan->frames, offset);
+            }
+            sparseIndexAdd(decoder->index, MP3_SEEK_INDEX_ENTRIES, &decoder->indexCount, &decoder->indexStep, scan->frames, offset);
+            scan->bitRateFrames[(header >> 12) & 0x0F]++;
+            scan->audioBytes += length;
+            scan->frames++;
+            bufferConsume(decoder, length);
+        }
+    }
+    scan->skippedBytes = decoder->stats.skippedBytes;
 
-        unsigned int tagSize = get_ID3_size(dec.mp3File);
+    // Samples output by the decoder, the LAME tag gives the delay and padding added by the encoder
+    uint32_t samples = scan->frames * headerFrameSamples(syncHeader);
+    if (decoder->gaplessStart)
+    {
+        uint32_t trimmed = decoder->gaplessStart - MP3_DECODER_DELAY + decoder->encoderPadding;
+        scan->samples = (samples > trimmed) ? samples - trimmed : 0;
+        decoder->gaplessEnd = decoder->gaplessStart + scan->samples;
+    }
+    else
+    {
+        scan->samples = samples;
+    }
+    scan->duration = ((uint64_t)scan->samples * 1000) / scan->sampleRate;
+    scan->bitRate = samples ? ((uint64_t)scan->audioBytes * 8 * scan->sampleRate) / samples : 0;
+
+    // The seek index now covers the whole file, the Xing TOC is not needed anymore
+    if (decoder->indexCount == 0)
+    {
+        decoder->index[decoder->indexCount++] = decoder->audioStart;
+    }
+    decoder->indexComplete = true;
+    decoder->hasXingToc = false;
+    decoder->totalFrames = scan->frames;
+
+    // Back to the decoding position
+    decoder->stats = stats;
+    decoder->syncState = syncState;
+    decoder->syncHeader = syncHeader;
+    bufferReset(decoder);
+    fileSeek(decoder, position);
+    decoder->bytesRemaining = decoder->fileSize - position;
+    flushFileToBuffer(decoder);
+
+    return (scan->frames != 0);
+}
+
+#if MP3DECODER_MAX_INSTANCES > 0
+/* SINGLE DECODER API, WORKS ON THE DEFAULT INSTANCE */
+
+void MP3DecoderInit(void)
+{
+  if (defaultDecoder == NULL)
+  {
+    defaultDecoder = MP3DecoderCreate();
+  }
+  else
+  {
+    closeFile(defaultDecoder);
+    decoderInit(defaultDecoder);
+  }
+}
+
+bool MP3LoadFile(const char* filename)
+{
+  return MP3DecoderLoadFile(defaultDecoder, filename);
+}
+
+void MP3LoadStream(const mp3decoder_stream_t* stream)
+{
+  MP3DecoderLoadStream(defaultDecoder, stream);
+}
+
+bool MP3GetTagData(mp3decoder_tag_data_t* data)
+{
+  return MP3DecoderGetTagData(defaultDecoder, data);
+}
+
+bool MP3GetLastFrameData(mp3decoder_frame_data_t* data)
+{
+  return MP3DecoderGetLastFrameData(defaultDecoder, data);
+}
+
+bool MP3GetNextFrameData(mp3decoder_frame_data_t* data)
+{
+  return MP3DecoderGetNextFrameData(defaultDecoder, data);
+}
+
+mp3decoder_result_t MP3GetDecodedFrame(short* outBuffer, uint16_t bufferSize, uint16_t* samplesDecoded)
+{
+  return MP3DecoderGetDecodedFrame(defaultDecoder, outBuffer, bufferSize, samplesDecoded);
+}
+
+void MP3GetStats(mp3decoder_stats_t* stats)
+{
+  MP3DecoderGetStats(defaultDecoder, stats);
+}
+
+void MP3GetProfile(mp3decoder_profile_t* profile)
+{
+  MP3DecoderGetProfile(defaultDecoder, profile);
+}
+
+void MP3ResetProfile(void)
+{
+  MP3DecoderResetProfile(defaultDecoder);
+}
+
+bool MP3Seek(uint32_t milliseconds)
+{
+  return MP3DecoderSeek(defaultDecoder, milliseconds);
+}
+
+void MP3SetOutputMode(mp3decoder_output_mode_t mode)
+{
+  MP3DecoderSetOutputMode(defaultDecoder, mode);
+}
+
+void MP3SetQuality(mp3decoder_quality_t quality)
+{
+  MP3DecoderSetQuality(defaultDecoder, quality);
+}
+
+uint8_t MP3SetThreads(uint8_t threads)
+{
+  return MP3DecoderSetThreads(defaultDecoder, threads);
+}
+
+mp3decoder_result_t MP3DecodeSamples(short* outBuffer, uint16_t nSamples, uint16_t* samplesDecoded, uint16_t* channels)
+{
+  return MP3DecoderDecodeSamples(defaultDecoder, outBuffer, nSamples, samplesDecoded, channels);
+}
+
+uint32_t MP3GetPosition(void)
+{
+  return MP3DecoderGetPosition(defaultDecoder);
+}
+
+uint32_t MP3GetDuration(void)
+{
+  return MP3DecoderGetDuration(defaultDecoder);
+}
+
+bool MP3Scan(mp3decoder_scan_t* scan, uint32_t* offsets, uint32_t maxOffsets)
+{
+  return MP3DecoderScan(defaultDecoder, scan, offsets, maxOffsets);
+}
+#endif /* MP3DECODER_MAX_INSTANCES > 0 */
+
+/*******************************************************************************
+ *******************************************************************************
+                        LOCAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+void flushFileToBuffer(mp3decoder_t* decoder)
+{
+    uint32_t bytesRead = 0;
+    uint32_t freeBytes = MP3_FRAME_BUFFER_BYTES - decoder->count;
+
+    if (decoder->mapped)
+    {
+        // The whole file is already in memory, nothing to copy
+        decoder->count = decoder->bytesRemaining;
+        return;
+    }
+
+    // Fill the free space of the ring with info in mp3 file, at most two contiguous reads (before and after wrapping)
+    while (freeBytes)
+    {
+        uint32_t chunk = MP3_MIN(freeBytes, MP3_FRAME_BUFFER_BYTES - decoder->bottom);
+        uint8_t* dest = decoder->mp3FrameBuffer + decoder->bottom;
+        bytesRead = readFile(decoder, dest, chunk);
+
+        // Bytes written at the beginning of the ring are mirrored after its end, keeping the window contiguous
+        if (decoder->bottom < MP3_MAX_FRAME_BYTES)
+        {
+            uint32_t mirrored = MP3_MIN(bytesRead, MP3_MAX_FRAME_BYTES - decoder->bottom);
+            memcpy(decoder->mp3FrameBuffer + MP3_FRAME_BUFFER_BYTES + decoder->bottom, dest, mirrored);
+            decoder->stats.bytesCopied += mirrored;
+        }
+
+        // Update bottom pointer
+        decoder->bottom = (decoder->bottom + bytesRead) % MP3_FRAME_BUFFER_BYTES;
+        decoder->count += bytesRead;
+        freeBytes -= bytesRead;
+
+        if (bytesRead < chunk)
+        {
+            break;
+        }
+    }
+
+    #ifdef MP3_PC_TESTBENCH
+    if (bytesRead == 0)
+    {
+        printf("File was read completely.\n");
+    }
+    printf("[?] Read %d bytes from file. Head = %d - Bottom = %d\n", bytesRead, decoder->top, decoder->bottom);
+    #endif
+}
+
+uint8_t* bufferWindow(mp3decoder_t* decoder, uint32_t* length)
+{
+    if (decoder->mapped)
+    {
+        *length = decoder->count;
+        return (uint8_t*)decoder->mapped + fileOffset(decoder);
+    }
+    *length = MP3_MIN(decoder->count, MP3_FRAME_BUFFER_BYTES + MP3_MAX_FRAME_BYTES - decoder->top);
+    return decoder->mp3FrameBuffer + decoder->top;
+}
+
+void bufferConsume(mp3decoder_t* decoder, uint32_t bytes)
+{
+    decoder->top = (decoder->top + bytes) % MP3_FRAME_BUFFER_BYTES;
+    decoder->count -= bytes;
+    decoder->bytesRemaining -= bytes;
+}
+
+void bufferReset(mp3decoder_t* decoder)
+{
+    decoder->top = 0;
+    decoder->bottom = 0;
+    decoder->count = 0;
+}
+
+uint32_t headerAt(mp3decoder_t* decoder, uint32_t offset)
+{
+    uint32_t header = 0;
+    if (decoder->mapped)
+    {
+        const uint8_t* p = decoder->mapped + fileOffset(decoder) + offset;
+        header = ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+    }
+    else
+    {
+        for (uint8_t i = 0; i < MP3_HEADER_BYTES; i++)
+        {
+            header = (header << 8) | decoder->mp3FrameBuffer[(decoder->top + offset + i) % MP3_FRAME_BUFFER_BYTES];
+        }
+    }
+    return header;
+}
+
+uint32_t headerFrameLength(uint32_t header)
+{
+    static const uint16_t samplerates[3] = { 44100, 48000, 32000 };
+
+    uint32_t length = 0;
+    uint8_t version = (header >> 19) & 0x03;          // 3 = MPEG-1, 2 = MPEG-2, 0 = MPEG-2.5, 1 = reserved
+    uint8_t layer = (header >> 17) & 0x03;            // 1 = Layer III
+    uint8_t bitrateIndex = (header >> 12) & 0x0F;
+    uint8_t samplerateIndex = (header >> 10) & 0x03;
+    uint8_t padding = (header >> 9) & 0x01;
+
+    if (((header >> 21) == 0x7FF) && (version != 1) && (layer == 1) && (bitrateIndex != 0) && (bitrateIndex != 15) && (samplerateIndex != 3))
+    {
+        uint32_t bitrate = bitrates[version == 3 ? 0 : 1][bitrateIndex] * 1000;
+        uint32_t samplerate = samplerates[samplerateIndex] >> (version == 3 ? 0 : (version == 2 ? 1 : 2));
+        length = (version == 3 ? 144 : 72) * bitrate / samplerate + padding;
+    }
+    return length;
+}
+
+uint16_t headerBitRate(uint32_t header)
+{
+    return bitrates[(((header >> 19) & 0x03) == 3) ? 0 : 1][(header >> 12) & 0x0F];
+}
+
+uint32_t syncSearch(mp3decoder_t* decoder, uint32_t maxBytes)
+{
+    uint32_t offset = 0;
+    bool found = false;
+    bool needData = false;
+
+    // Search on as much data as possible
+    flushFileToBuffer(decoder);
+    bool fileEnded = (decoder->bytesRemaining == decoder->count);
+
+    while (!found && !needData && (offset < maxBytes) && (offset + MP3_HEADER_BYTES <= decoder->count))
+    {
+        uint32_t header = headerAt(decoder, offset);
+        uint32_t length = headerFrameLength(header);
+        if (length)
+        {
+            uint8_t required = ((header & MP3_HEADER_SYNC_MASK) == decoder->syncHeader) ? MP3_RESYNC_FRAMES : MP3_SYNC_FRAMES;
+
+            // Check the headers that follow
+            uint8_t matches = 1;
+            uint32_t next = offset + length;
+            bool mismatch = false;
+            while ((matches < required) && !mismatch && (next + MP3_HEADER_BYTES <= decoder->count))
+            {
+                uint32_t nextHeader = headerAt(decoder, next);
+                uint32_t nextLength = headerFrameLength(nextHeader);
+                if (nextLength && ((nextHeader & MP3_HEADER_SYNC_MASK) == (header & MP3_HEADER_SYNC_MASK)))
+                {
+                    matches++;
+                    next += nextLength;
+                }
+                else
+                {
+                    mismatch = true;
+                }
+            }
+
+            if ((matches == required) || (!mismatch && fileEnded && (next >= decoder->count)))
+            {
+                // Enough consecutive headers, or the file ends right after the last one
+                found = true;
+            }
+            else if (!mismatch && !fileEnded)
+            {
+                // The headers to be checked are not in the buffer yet, read the file and try again from here
+                needData = true;
+            }
+        }
+
+        if (!found && !needData)
+        {
+            offset++;
+        }
+    }
+
+    if (!found && !needData && fileEnded && (offset + MP3_HEADER_BYTES > decoder->count))
+    {
+        // Only garbage until the end of file
+        offset = decoder->count;
+    }
+
+    // Discard the bytes before the sync
+    bufferConsume(decoder, offset);
+    decoder->stats.skippedBytes += offset;
+
+    if (found)
+    {
+        decoder->syncHeader = headerAt(decoder, 0) & MP3_HEADER_SYNC_MASK;
+        decoder->syncState = MP3_SYNC_LOCKED;
+
+        #ifdef MP3_PC_TESTBENCH
+        printf("Sync found after skipping %d bytes\n", offset);
+        #endif
+    }
+
+    // Bytes checked count even when nothing was skipped, so this call cannot loop forever
+    return offset ? offset : MP3_HEADER_BYTES;
+}
+
+uint32_t fileOffset(mp3decoder_t* decoder)
+{
+    return decoder->fileSize - decoder->bytesRemaining;
+}
+
+uint32_t headerSampleRate(uint32_t header)
+{
+    static const uint16_t samplerates[3] = { 44100, 48000, 32000 };
+    uint8_t version = (header >> 19) & 0x03;
+    return samplerates[(header >> 10) & 0x03] >> (version == 3 ? 0 : (version == 2 ? 1 : 2));
+}
+
+uint32_t headerFrameSamples(uint32_t header)
+{
+    return (((header >> 19) & 0x03) == 3) ? 1152 : 576;
+}
+
+uint8_t headerOutputChannels(mp3decoder_t* decoder, uint32_t header)
+{
+    bool mono = (((header >> 6) & 0x03) == 3) || (decoder->outputMode == MP3DECODER_OUTPUT_MONO);
+    return mono ? 1 : 2;
+}
+
+uint32_t headerMainDataBytes(uint32_t header, uint32_t length)
+{
+    bool mpeg1 = (((header >> 19) & 0x03) == 3);
+    bool mono = (((header >> 6) & 0x03) == 3);
+    uint32_t sideInfo = mpeg1 ? (mono ? 17 : 32) : (mono ? 9 : 17);
+    uint32_t overhead = MP3_HEADER_BYTES + ((header & 0x10000) ? 0 : 2) + sideInfo;
+    return (length > overhead) ? length - overhead : 0;
+}
+
+uint32_t frameMainDataBegin(const uint8_t* frame)
+{
+    // main_data_begin follows the header (and CRC), 9 bits on MPEG-1 and 8 bits on MPEG-2
+    uint32_t header = (frame[0] << 24) | (frame[1] << 16) | (frame[2] << 8) | frame[3];
+    const uint8_t* sideInfo = frame + MP3_HEADER_BYTES + ((header & 0x10000) ? 0 : 2);
+    return (((header >> 19) & 0x03) == 3) ? ((sideInfo[0] << 1) | (sideInfo[1] >> 7)) : sideInfo[0];
+}
+
+void streamStart(mp3decoder_t* decoder)
+{
+    uint32_t windowLength;
+    uint8_t* window = bufferWindow(decoder, &windowLength);
+    uint32_t length = headerFrameLength(headerAt(decoder, 0));
+
+    decoder->xingStart = fileOffset(decoder);
+    if ((length <= windowLength) && parseVbrHeader(decoder, window, length))
+    {
+        bufferConsume(decoder, length);
+    }
+
+    decoder->streamStarted = true;
+    decoder->audioStart = fileOffset(decoder);
+    decoder->frameNumber = 0;
+    decoder->frameNumberExact = true;
+    if (decoder->indexCount == 0)
+    {
+        decoder->index[decoder->indexCount++] = decoder->audioStart;
+    }
+}
+
+bool parseVbrHeader(mp3decoder_t* decoder, const uint8_t* frame, uint32_t length)
+{
+    bool ret = false;
+    uint32_t header = (frame[0] << 24) | (frame[1] << 16) | (frame[2] << 8) | frame[3];
+    const uint8_t* xing = frame + length - headerMainDataBytes(header, length);
+    const uint8_t* vbri = frame + MP3_VBRI_OFFSET;
+    const uint8_t* end = frame + length;
+
+    #define READ_BE32(p)    (((uint32_t)(p)[0] << 24) | ((uint32_t)(p)[1] << 16) | ((uint32_t)(p)[2] << 8) | (p)[3])
+    #define READ_BE16(p)    (((uint16_t)(p)[0] << 8) | (p)[1])
+
+    if ((xing + 8 <= end) && (!memcmp(xing, "Xing", 4) || !memcmp(xing, "Info", 4)))
+    {
+        uint32_t flags = READ_BE32(xing + 4);
+        const uint8_t* field = xing + 8;
+        if ((flags & 0x01) && (field + 4 <= end))
+        {
+            decoder->totalFrames = READ_BE32(field);
+            field += 4;
+        }
+        if ((flags & 0x02) && (field + 4 <= end))
+        {
+            decoder->xingBytes = READ_BE32(field);
+            field += 4;
+        }
+        if ((flags & 0x04) && (field + MP3_XING_TOC_ENTRIES <= end))
+        {
+            memcpy(decoder->xingToc, field, MP3_XING_TOC_ENTRIES);
+            decoder->hasXingToc = (decoder->totalFrames != 0) && (decoder->xingBytes != 0);
+            field += MP3_XING_TOC_ENTRIES;
+        }
+        if (flags & 0x08)
+        {
+            field += 4;
+        }
+
+        // LAME tag, encoder delay and padding are 12 bits each after the encoder version, flags and peak/gain fields
+        if ((field + MP3_LAME_TAG_BYTES <= end) && (!memcmp(field, "LAME", 4) || !memcmp(field, "Lavf", 4) || !memcmp(field, "Lavc", 4)))
+        {
+            uint32_t delay = (field[21] << 4) | (field[22] >> 4);
+            uint32_t padding = ((field[22] & 0x0F) << 8) | field[23];
+            uint32_t samples = decoder->totalFrames * headerFrameSamples(header);
+            decoder->gaplessStart = delay + MP3_DECODER_DELAY;
+            decoder->encoderPadding = padding;
+            if (decoder->totalFrames && (samples > delay + padding))
+            {
+                decoder->gaplessEnd = decoder->gaplessStart + samples - delay - padding;
+            }
+        }
+        ret = true;
+    }
+    else if ((vbri + 26 <= end) && !memcmp(vbri, "VBRI", 4))
+    {
+        uint16_t entries = READ_BE16(vbri + 18);
+        uint16_t scale = READ_BE16(vbri + 20);
+        uint16_t entrySize = READ_BE16(vbri + 22);
+        uint16_t framesPerEntry = READ_BE16(vbri + 24);
+        const uint8_t* table = vbri + 26;
+        decoder->totalFrames = READ_BE32(vbri + 14);
+
+        if (entries && framesPerEntry && (entrySize >= 1) && (entrySize <= 4) && (table + entries * entrySize <= end))
+        {
+            // The table gives the size of every segment of framesPerEntry frames, keep as many as fit in the index
+            uint16_t decimation = (entries + MP3_SEEK_INDEX_ENTRIES - 1) / MP3_SEEK_INDEX_ENTRIES;
+            uint32_t offset = decoder->xingStart + length;
+            decoder->indexStep = framesPerEntry * decimation;
+            decoder->indexCount = 0;
+            for (uint16_t i = 0; i < entries; i++)
+            {
+                if ((i % decimation) == 0)
+                {
+                    decoder->index[decoder->indexCount++] = offset;
+                }
+                uint32_t size = 0;
+                for (uint16_t j = 0; j < entrySize; j++)
+                {
+                    size = (size << 8) | table[i * entrySize + j];
+                }
+                offset += size * scale;
+            }
+            decoder->indexComplete = true;
+        }
+        ret = true;
+    }
+
+    #undef READ_BE32
+    #undef READ_BE16
+
+    return ret;
+}
+
+uint16_t gaplessTrim(mp3decoder_t* decoder, uint32_t frame, short* outBuffer)
+{
+    uint16_t channels = decoder->lastFrameInfo.nChans;
+    uint32_t length = decoder->lastFrameInfo.outputSamps / channels;
+    uint32_t first = frame * length;
+    uint32_t start = first;
+    uint32_t end = first + length;
+
+    // The bounds are counted at the stream sample rate, the frames are shorter in half rate
+    uint8_t shift = (decoder->quality == MP3DECODER_QUALITY_HALF_RATE) ? 1 : 0;
+    uint32_t gaplessStart = decoder->gaplessStart >> shift;
+    uint32_t gaplessEnd = (decoder->gaplessEnd == UINT32_MAX) ? UINT32_MAX : (decoder->gaplessEnd >> shift);
+
+    // After a resync or a seek with the Xing TOC the frame number is only estimated, trimming the end from it could
+    // cut the last frames of the song or leave the padding, so the padding is kept until the number is exact again
+    if (!decoder->frameNumberExact)
+    {
+        gaplessEnd = UINT32_MAX;
+    }
+
+    // Keep only the part of the frame inside [gaplessStart, gaplessEnd)
+    if (start < gaplessStart)
+    {
+        start = MP3_MIN(gaplessStart, end);
+    }
+    if (end > gaplessEnd)
+    {
+        end = (gaplessEnd > start) ? gaplessEnd : start;
+    }
+    if ((start > first) && (end > start))
+    {
+        memmove(outBuffer, outBuffer + (start - first) * channels, (end - start) * channels * sizeof(short));
+    }
+    return (end - start) * channels;
+}
+
+void indexAdd(mp3decoder_t* decoder, uint32_t frame, uint32_t offset)
+{
+    if (decoder->frameNumberExact && !decoder->indexComplete)
+    {
+        sparseIndexAdd(decoder->index, MP3_SEEK_INDEX_ENTRIES, &decoder->indexCount, &decoder->indexStep, frame, offset);
+    }
+}
+
+void sparseIndexAdd(uint32_t* table, uint32_t size, uint32_t* count, uint32_t* step, uint32_t frame, uint32_t offset)
+{
+    if (frame == *count * *step)
+    {
+        if (*count == size)
+        {
+            // Full table, keep every other entry
+            for (uint32_t i = 0; 2 * i < size; i++)
+            {
+                table[i] = table[2 * i];
+            }
+            *count = (size + 1) / 2;
+            *step *= 2;
+        }
+        if (frame == *count * *step)
+        {
+            table[(*count)++] = offset;
+        }
+    }
+}
+
+bool walkFrames(mp3decoder_t* decoder, uint32_t* frame, uint32_t* offset, uint32_t targetFrame, uint32_t targetOffset, uint32_t* prerollOffset)
+{
+    uint32_t historyOffset[MP3_SEEK_HISTORY];
+    uint32_t historyBytes[MP3_SEEK_HISTORY];
+    uint32_t historyBegin[MP3_SEEK_HISTORY];
+    uint32_t walked = 0;
+    uint8_t bytes[MP3_HEADER_BYTES + 4];
+    uint32_t header = 0;
+    bool reached = false;
+    bool valid = true;
+
+    while (valid && !reached)
+    {
+        fileSeek(decoder, *offset);
+        uint32_t length = 0;
+        if (readFile(decoder, bytes, sizeof(bytes)) == sizeof(bytes))
+        {
+            header = (bytes[0] << 24) | (bytes[1] << 16) | (bytes[2] << 8) | bytes[3];
+            length = headerFrameLength(header);
+        }
+
+        if ((length == 0) || ((header & MP3_HEADER_SYNC_MASK) != decoder->syncHeader))
+        {
+            valid = false;
+        }
+        else if ((*frame >= targetFrame) || (*offset >= targetOffset))
+        {
+            reached = true;
+        }
+        else
+        {
+            historyOffset[walked % MP3_SEEK_HISTORY] = *offset;
+            historyBytes[walked % MP3_SEEK_HISTORY] = headerMainDataBytes(header, length);
+            historyBegin[walked % MP3_SEEK_HISTORY] = frameMainDataBegin(bytes);
+            walked++;
+            if (targetFrame != UINT32_MAX)
+            {
+                indexAdd(decoder, *frame, *offset);
+            }
+            *offset += length;
+            (*frame)++;
+        }
+    }
+
+    if (reached)
+    {
+        // The target and the frames that fill its IMDCT overlap must decode whole, so decoding starts at the earliest
+        // of the frames that hold the bit reservoir of any of them. Frame k of the loop is k frames before the target.
+        uint32_t available = (walked > MP3_SEEK_HISTORY) ? MP3_SEEK_HISTORY : walked;
+        *prerollOffset = *offset;
+        for (uint32_t k = 0; (k <= MP3_SEEK_PREROLL_FRAMES) && (k <= available); k++)
+        {
+            uint32_t mainDataBegin = k ? historyBegin[(walked - k) % MP3_SEEK_HISTORY] : frameMainDataBegin(bytes);
+            uint32_t reservoir = 0;
+            if (k)
+            {
+                *prerollOffset = MP3_MIN(*prerollOffset, historyOffset[(walked - k) % MP3_SEEK_HISTORY]);
+            }
+            for (uint32_t i = k; (i < available) && (reservoir < mainDataBegin); i++)
+            {
+                uint32_t slot = (walked - 1 - i) % MP3_SEEK_HISTORY;
+                reservoir += historyBytes[slot];
+                *prerollOffset = MP3_MIN(*prerollOffset, historyOffset[slot]);
+            }
+        }
+    }
+
+    return reached;
+}
+
+void restartAt(mp3decoder_t* decoder, uint32_t prerollOffset, uint32_t targetOffset)
+{
+    helixReset(decoder);
+    bufferReset(decoder);
+    fileSeek(decoder, prerollOffset);
+    decoder->bytesRemaining = decoder->fileSize - prerollOffset;
+    decoder->prerollEnd = targetOffset;
+    decoder->syncState = MP3_SYNC_LOCKED;
+    decoder->pcmCount = 0;
+    flushFileToBuffer(decoder);
+}
+
+void helixReset(mp3decoder_t* decoder)
+{
+  // Empty bit reservoir and overlap buffers, the output mode, the quality and the channel thread are kept
+  MP3ResetDecoder(decoder->helixDecoder);
+}
+
+bool decoderInit(mp3decoder_t* decoder)
+{
+  // Stops the channel thread of the previous Helix instance, if the decoder is initialized again
+  MP3FreeDecoder(decoder->helixDecoder);
+  decoder->helixDecoder = MP3InitDecoderInPlace(decoder->helixState, sizeof(decoder->helixState));
+  decoder->outputMode = MP3DECODER_OUTPUT_NATIVE;
+  decoder->quality = MP3DECODER_QUALITY_FULL;
+  decoder->threads = 1;
+  decoder->stream.io = NULL;
+  decoder->mapped = NULL;
+  decoder->fileOpened = false;
+  bufferReset(decoder);
+  decoder->fileSize = 0;
+  decoder->bytesRemaining = 0;
+  decoder->hasID3Tag = false;
+  #ifdef MP3_PC_TESTBENCH
+  printf("Decoder initialized. Buffer size is %d bytes\n", MP3_FRAME_BUFFER_BYTES);
+  #endif
+  return (decoder->helixDecoder != NULL);
+}
+
+void copyFrameInfo(mp3decoder_frame_data_t* mp3Data, MP3FrameInfo* helixData)
+{
+    mp3Data->bitRate = helixData->bitrate;
+    mp3Data->binitsPerSample = helixData->bitsPerSample;
+    mp3Data->channelCount = helixData->nChans;
+    mp3Data->sampleRate = helixData->samprate;
+    mp3Data->sampleCount = helixData->outputSamps;
+}
+
+void readID3Tag(mp3decoder_t* decoder)
+{
+
+    if (has_ID3_tag(&decoder->stream))
+    {
+        decoder->hasID3Tag = true;
+
+        if (!read_ID3_info(TITLE_ID3, (char*)decoder->ID3Data.title, ID3_MAX_FIELD_SIZE, &decoder->stream))
+            strcpy((char*)decoder->ID3Data.title, DEFAULT_ID3_FIELD);
+
+        if (!read_ID3_info(ALBUM_ID3, (char*)decoder->ID3Data.album, ID3_MAX_FIELD_SIZE, &decoder->stream))
+            strcpy((char*)decoder->ID3Data.album, DEFAULT_ID3_FIELD);
+
+        if (!read_ID3_info(ARTIST_ID3, (char*)decoder->ID3Data.artist, ID3_MAX_FIELD_SIZE, &decoder->stream))
+            strcpy((char*)decoder->ID3Data.artist, DEFAULT_ID3_FIELD);
+
+        if (!read_ID3_info(YEAR_ID3, (char*)decoder->ID3Data.year, 10, &decoder->stream))
+            strcpy((char*)decoder->ID3Data.year, DEFAULT_ID3_FIELD);
+
+        if (!read_ID3_info(TRACK_NUM_ID3, (char*)decoder->ID3Data.trackNum, 10, &decoder->stream))
+            strcpy((char*)decoder->ID3Data.trackNum, DEFAULT_ID3_FIELD);
+
+
+        unsigned int tagSize = get_ID3_size(&decoder->stream);
 
         #ifdef MP3_PC_TESTBENCH
         printf("ID3 Track found.\n");
         printf("ID3 Tag is %d bytes long\n", tagSize);
         #endif    
 
-        fileSeek(tagSize);
-        dec.bytesRemaining -= tagSize;
+        fileSeek(decoder, tagSize);
+        decoder->bytesRemaining -= tagSize;
 
     }
     else
     {
-        fileRewind();
+        fileRewind(decoder);
     }
 }
 
 /* FILE HANDLING FUNCTIONS */
 
-bool openFile(const char * filename)
+bool openFile(mp3decoder_t* decoder, const char * filename)
 {
-    bool ret = false;
     #ifdef __arm__
-    FRESULT fr = f_open(&dec.file, filename, FA_READ);
-    if (fr == FR_OK)
-    {
-    	dec.mp3File = &(dec.file);
-    	ret = true;
-    }
+    return MP3IoFatfsOpen(&decoder->file, filename, &decoder->stream);
     #else
-    dec.mp3File = fopen(filename, "rb"); 
-    ret = (dec.mp3File != NULL);
+    return MP3IoStdioOpen(&decoder->file, filename, &decoder->stream);
     #endif
-    return ret;
 }
 
-void closeFile(void)
+void closeFile(mp3decoder_t* decoder)
 {
-    if(dec.fileOpened)
+    if(decoder->fileOpened)
     {
-        
-        #ifdef __arm__
-        f_close(dec.mp3File);
-        #else
-        fclose(dec.mp3File);
-        #endif
-
+        decoder->stream.io->close(decoder->stream.handle);
     }
     
-    dec.fileOpened = false;
+    decoder->fileOpened = false;
+    decoder->mapped = NULL;
 }
 
-size_t currentFileSize()
+size_t currentFileSize(mp3decoder_t* decoder)
 {
   size_t result = 0;
-  if (dec.fileOpened)
+  if (decoder->fileOpened)
   {
-    #ifdef __arm__
-    result = f_size(dec.mp3File);
-    #else
-    fseek(dec.mp3File, 0L, SEEK_END);
-    result = ftell(dec.mp3File);
-    fileRewind();
-    fseek (dec.mp3File, 0, SEEK_SET);
-    #endif
+    result = decoder->stream.io->size(decoder->stream.handle);
   }
   return result;
 }
 
-void fileRewind()
+void fileRewind(mp3decoder_t* decoder)
 {
-    #ifdef __arm__
-    f_rewind(dec.mp3File);
-    #else
-    rewind(dec.mp3File);
-    #endif
+    decoder->stream.io->seek(decoder->stream.handle, 0);
 }
 
-void fileSeek(size_t pos)
+void fileSeek(mp3decoder_t* decoder, size_t pos)
 {
-    #ifdef __arm__
-    f_lseek(dec.mp3File, pos);
-    #else
-    fseek(dec.mp3File, pos, SEEK_SET);
-    #endif
+    decoder->stream.io->seek(decoder->stream.handle, pos);
 }
 
-size_t readFile(void * buf, size_t count)
+size_t readFile(mp3decoder_t* decoder, void * buf, size_t count)
 {
-    size_t ret = 0, read = 0;
-
-
-    if (dec.fileOpened)
+    size_t ret = 0;
+    if (decoder->fileOpened)
     {
-      #ifdef __arm__
-      FRESULT fr;
-      size_t readLen = count > 512 ? 512 : count;
-      do
-      {
-    	  fr = f_read(dec.mp3File, ((uint8_t *)buf) + ret, readLen, &read);
-    	  ret += read;
-    	  readLen = (count - ret) > 512 ? 512 : count - ret;
-      } while ( (fr == FR_OK) && (ret < count) && !f_eof(dec.mp3File));
-	  if (fr == FR_OK)
-	  {
-		// ret = read;
-	  }
-	  else
-	  {
-		  ret = 0;
-	  }
-      #else
-      ret = fread(buf, 1, count, dec.mp3File);
-      #endif
+      ret = decoder->stream.io->read(decoder->stream.handle, buf, count);
     }
-
-
     return ret;
 }
 
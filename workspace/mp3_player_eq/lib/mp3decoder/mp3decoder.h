@@ -13,6 +13,7 @@
 
 #include  <stdbool.h>
 #include  <stdint.h>
+#include  "mp3decoder_io.h"
 
 /*******************************************************************************
  * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
@@ -20,6 +21,18 @@
 
 #define MP3_DECODED_BUFFER_SIZE (4*1152)                                     // maximum frame size if max bitrate is used (in samples)
 #define ID3_MAX_FIELD_SIZE      50
+#define MP3DECODER_CONTEXT_BYTES    (16384 + 24576)                          // bytes needed to hold one decoder with its Helix state (checked at compile time)
+#define MP3DECODER_BITRATE_COUNT    15                                       // Bitrate indexes of the frame header (0 is free format)
+
+// Decoders the library can create in its own storage, for MP3DecoderCreate and the single decoder API. The
+// firmware creates its decoders on caller storage, so it does not reserve a pool.
+#ifndef MP3DECODER_MAX_INSTANCES
+#ifdef __arm__
+#define MP3DECODER_MAX_INSTANCES    0
+#else
+#define MP3DECODER_MAX_INSTANCES    8
+#endif
+#endif
 
 /*******************************************************************************
  * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
@@ -53,6 +66,75 @@ typedef struct
 
 } mp3decoder_tag_data_t;
 
+typedef enum
+{
+  MP3DECODER_OUTPUT_NATIVE,     // Samples with the channels of the stream, interleaved LRLR if stereo
+  MP3DECODER_OUTPUT_MONO        // Stereo streams are downmixed to one channel (L+R)/2
+} mp3decoder_output_mode_t;
+
+typedef enum
+{
+  MP3DECODER_QUALITY_FULL,      // All the subbands, at the sample rate of the stream
+  MP3DECODER_QUALITY_HALF_RATE  // Only the lower 16 subbands (up to a quarter of the stream rate), at half the sample rate
+} mp3decoder_quality_t;
+
+typedef struct
+{
+    uint32_t    framesDecoded;      // Frames successfully decoded since the file was loaded
+    uint32_t    bytesCopied;        // Encoded bytes copied inside the input buffer since the file was loaded
+    uint32_t    skippedBytes;       // Bytes discarded while looking for sync (garbage, tags, damaged data)
+    uint32_t    droppedFrames;      // Frames with valid sync that could not be decoded
+    uint32_t    resyncs;            // Times the sync was lost after being locked
+} mp3decoder_stats_t;
+
+// Stages of the Helix decoder, timed when it is built with MP3_PROFILE defined
+typedef enum
+{
+  MP3DECODER_STAGE_HEADER,        // UnpackFrameHeader
+  MP3DECODER_STAGE_SIDEINFO,      // UnpackSideInfo
+  MP3DECODER_STAGE_SCALEFACTORS,  // UnpackScaleFactors
+  MP3DECODER_STAGE_HUFFMAN,       // DecodeHuffman
+  MP3DECODER_STAGE_DEQUANTIZE,    // Dequantize, stereo processing
+  MP3DECODER_STAGE_IMDCT,         // Antialias, IMDCT, overlap-add
+  MP3DECODER_STAGE_SUBBAND,       // Polyphase synthesis filterbank
+  MP3DECODER_STAGE_COUNT
+} mp3decoder_stage_t;
+
+// Ticks are core cycles on the target (DWT CYCCNT), TSC cycles or nanoseconds on the host
+typedef struct
+{
+    uint32_t    frames;                             // Frames accounted since the last reset
+    uint64_t    total[MP3DECODER_STAGE_COUNT];      // Ticks spent in each stage
+    uint32_t    min[MP3DECODER_STAGE_COUNT];        // Fewest ticks spent in a stage by one frame
+    uint32_t    max[MP3DECODER_STAGE_COUNT];        // Most ticks spent in a stage by one frame
+} mp3decoder_profile_t;
+
+// Result of a scan of the frame headers of a whole file
+typedef struct
+{
+    uint32_t    frames;                                     // Audio frames (the Xing/VBRI frame is not counted)
+    uint32_t    samples;                                    // Samples per channel output by the decoder, without the encoder delay and padding
+    uint32_t    duration;                                   // Exact duration in milliseconds
+    uint32_t    sampleRate;
+    uint32_t    bitRate;                                    // Average bitrate in bits per second
+    uint32_t    audioBytes;                                 // Bytes of the audio frames
+    uint32_t    skippedBytes;                               // Bytes between the audio frames that were skipped (garbage, damaged data, tags)
+    uint32_t    bitRateFrames[MP3DECODER_BITRATE_COUNT];    // Frames of each bitrate index, more than one is used if the file is VBR
+    uint16_t    bitRates[MP3DECODER_BITRATE_COUNT];         // Bitrate of each index in kbps
+    uint32_t    offsetCount;                                // Entries written to the offset table
+    uint32_t    offsetStep;                                 // Frames between consecutive entries of the offset table
+} mp3decoder_scan_t;
+
+// Decoder instance, its content is private to the library
+typedef struct mp3decoder mp3decoder_t;
+
+// Caller provided storage for one decoder instance
+typedef union
+{
+    uint8_t     bytes[MP3DECODER_CONTEXT_BYTES];
+    uint64_t    alignment;
+} mp3decoder_storage_t;
+
 /*******************************************************************************
  * VARIABLE PROTOTYPES WITH GLOBAL SCOPE
  ******************************************************************************/
@@ -61,8 +143,123 @@ typedef struct
  * FUNCTION PROTOTYPES WITH GLOBAL SCOPE
  ******************************************************************************/
 
+#if MP3DECODER_MAX_INSTANCES > 0
+/*
+* @brief Creates a decoder instance, using the storage of the library
+* @returns Decoder instance, NULL if there is no storage or Helix instance available
+*/
+mp3decoder_t* MP3DecoderCreate(void);
+#endif
+
+/*
+* @brief Creates a decoder instance on caller provided storage, the Helix state is kept in it too so the storage
+* can be placed in a chosen memory region (e.g. SRAM_U) and no heap or library pool is used
+* @param storage  Storage for the instance, must remain valid until the decoder is destroyed
+* @returns Decoder instance, NULL if there is no Helix instance available
+*/
+mp3decoder_t* MP3DecoderCreateStatic(mp3decoder_storage_t* storage);
+
+/*
+* @brief Closes the file of a decoder instance and releases it
+* @param decoder  Decoder instance
+*/
+void MP3DecoderDestroy(mp3decoder_t* decoder);
+
+/*
+* @brief Loads a file on a decoder instance, see MP3LoadFile
+*/
+bool MP3DecoderLoadFile(mp3decoder_t* decoder, const char* filename);
+
+/*
+* @brief Loads a stream on a decoder instance, see MP3LoadStream
+*/
+void MP3DecoderLoadStream(mp3decoder_t* decoder, const mp3decoder_stream_t* stream);
+
+/*
+* @brief Gives the song's tag data of a decoder instance, see MP3GetTagData
+*/
+bool MP3DecoderGetTagData(mp3decoder_t* decoder, mp3decoder_tag_data_t* data);
+
+/*
+* @brief Returns the information of last frame decoded by a decoder instance, see MP3GetLastFrameData
+*/
+bool MP3DecoderGetLastFrameData(mp3decoder_t* decoder, mp3decoder_frame_data_t* data);
+
+/*
+* @brief Returns the information of next frame to be decoded by a decoder instance, see MP3GetNextFrameData
+*/
+bool MP3DecoderGetNextFrameData(mp3decoder_t* decoder, mp3decoder_frame_data_t* data);
+
+/*
+* @brief Decodes one mp3 frame with a decoder instance, see MP3GetDecodedFrame
+*/
+mp3decoder_result_t MP3DecoderGetDecodedFrame(mp3decoder_t* decoder, short* outBuffer, uint16_t bufferSize, uint16_t* samplesDecoded);
+
+/*
+* @brief Selects the output mode of a decoder instance, see MP3SetOutputMode
+*/
+void MP3DecoderSetOutputMode(mp3decoder_t* decoder, mp3decoder_output_mode_t mode);
+
+/*
+* @brief Selects the decoding quality of a decoder instance, see MP3SetQuality
+*/
+void MP3DecoderSetQuality(mp3decoder_t* decoder, mp3decoder_quality_t quality);
+
+/*
+* @brief Selects the threads decoding each stereo frame of a decoder instance, see MP3SetThreads
+*/
+uint8_t MP3DecoderSetThreads(mp3decoder_t* decoder, uint8_t threads);
+
+/*
+* @brief Decodes a block of samples with a decoder instance, see MP3DecodeSamples
+*/
+mp3decoder_result_t MP3DecoderDecodeSamples(mp3decoder_t* decoder, short* outBuffer, uint16_t nSamples, uint16_t* samplesDecoded, uint16_t* channels);
+
+/*
+* @brief Returns the samples (per channel) of the last decoded frame not handed to the caller yet, they were decoded
+*        with the quality and the output mode in use when the frame was decoded
+*/
+uint16_t MP3DecoderGetPendingSamples(mp3decoder_t* decoder);
+
+/*
+* @brief Returns the decoding statistics of a decoder instance, see MP3GetStats
+*/
+void MP3DecoderGetStats(mp3decoder_t* decoder, mp3decoder_stats_t* stats);
+
+/*
+* @brief Returns the time spent in each decoding stage by a decoder instance, see MP3GetProfile
+*/
+void MP3DecoderGetProfile(mp3decoder_t* decoder, mp3decoder_profile_t* profile);
+
+/*
+* @brief Clears the time accounted to each decoding stage of a decoder instance, see MP3ResetProfile
+*/
+void MP3DecoderResetProfile(mp3decoder_t* decoder);
+
+/*
+* @brief Moves the decoding position of a decoder instance, see MP3Seek
+*/
+bool MP3DecoderSeek(mp3decoder_t* decoder, uint32_t milliseconds);
+
+/*
+* @brief Returns the decoding position of a decoder instance, see MP3GetPosition
+*/
+uint32_t MP3DecoderGetPosition(mp3decoder_t* decoder);
+
+/*
+* @brief Returns the duration of the song loaded in a decoder instance, see MP3GetDuration
+*/
+uint32_t MP3DecoderGetDuration(mp3decoder_t* decoder);
+
+/*
+* @brief Walks the frame headers of the file loaded in a decoder instance, see MP3Scan
+*/
+bool MP3DecoderScan(mp3decoder_t* decoder, mp3decoder_scan_t* scan, uint32_t* offsets, uint32_t maxOffsets);
+
+#if MP3DECODER_MAX_INSTANCES > 0
 /*
 * @brief Initialices the mp3 decoder driver
+* The functions below work on a default decoder instance created here, from the storage of the library
 */
 void  MP3DecoderInit(void);
 
@@ -72,6 +269,14 @@ void  MP3DecoderInit(void);
 */
 bool  MP3LoadFile(const char* filename);
 
+/*
+* @brief Loads a stream opened with any of the input backends (see mp3decoder_io.h). The decoder closes
+* the stream when the file ends or another one is loaded. If the backend maps the whole stream in memory
+* (memory, mmap), frames are decoded in place and the input ring buffer is not used.
+* @param stream   Open stream, copied by the decoder
+*/
+void MP3LoadStream(const mp3decoder_stream_t* stream);
+
 /*
 * @brief Gives the song's tag data like name, artist, etc
 * @param data Pointer to object to be filled with info
@@ -95,6 +300,9 @@ bool MP3GetNextFrameData(mp3decoder_frame_data_t *data);
 
 /*
 * @brief  Decodes one mp3 frame (if available) to WAV format
+*         If the file has a LAME tag, the encoder delay and padding are removed, so the first and 
+*         last frames may return fewer samples than a whole frame. The file stays loaded after 
+*         MP3DECODER_FILE_END, so it can still be seeked.
 * 
 * @param  *outbuffer      pointer to output buffer (should have space for at least one frame samples)
 * @param  buffersize      number of available bytes in output buffer
@@ -104,7 +312,100 @@ bool MP3GetNextFrameData(mp3decoder_frame_data_t *data);
 */
 mp3decoder_result_t MP3GetDecodedFrame(short* outBuffer, uint16_t bufferSize, uint16_t* samplesDecoded);
 
+/*
+* @brief  Decodes as many frames as needed to fill a block of samples. Frames are decoded straight into the 
+*         output buffer, the samples of the last frame that do not fit are kept for the next call. 
+*         Do not mix with MP3GetDecodedFrame on the same file, the kept samples would be lost.
+* 
+* @param  *outBuffer      pointer to output buffer, with space for nSamples * 2 samples
+* @param  nSamples        samples per channel to decode, 0 only decodes the next frame in advance
+* @param  *samplesDecoded pointer to variable that will be updated with the samples per channel written
+* @param  *channels       pointer to variable that will be updated with the channels of the interleaved output.
+*                         The block ends early if the channel count changes, the next call continues with the new one
+* 
+* @returns  MP3DECODER_NO_ERROR, or the error that stopped the block (the samples written before are valid)
+*/
+mp3decoder_result_t MP3DecodeSamples(short* outBuffer, uint16_t nSamples, uint16_t* samplesDecoded, uint16_t* channels);
+
+/*
+* @brief Selects the channels of the decoded samples. In MP3DECODER_OUTPUT_MONO stereo frames are mixed before
+* the synthesis filterbank, which runs once instead of once per channel, and the frame data reports one channel.
+* @param mode   Output mode, kept until the decoder is initialized again
+*/
+void MP3SetOutputMode(mp3decoder_output_mode_t mode);
+
+/*
+* @brief Selects the decoding quality. MP3DECODER_QUALITY_HALF_RATE runs the IMDCT and the synthesis filterbank on
+* the lower 16 subbands only and outputs at half the sample rate of the stream, about a fifth less decoding time
+* for a bandwidth of a quarter of the stream rate. Takes effect on the next frame, the frame data reports the
+* halved sample rate and sample count, so the DAC must follow it.
+* @param quality   Decoding quality, kept until the decoder is initialized again
+*/
+void MP3SetQuality(mp3decoder_quality_t quality);
+
+/*
+* @brief Selects the threads decoding each stereo frame. With 2, the IMDCT and the synthesis filterbank of each
+* channel run on their own thread, for hosts with spare cores (the decoder must be built with MP3_THREADS, 
+* pthreads). The PCM is the same as with 1.
+* @param threads   Threads per decoder, 1 or 2, kept until the decoder is initialized again
+* @returns Threads in use, 1 if the build has no threads or the worker could not be started
+*/
+uint8_t MP3SetThreads(uint8_t threads);
+
+/*
+* @brief Returns the decoding statistics of the current file
+* @param stats Pointer to object to be filled with info
+*/
+void MP3GetStats(mp3decoder_stats_t* stats);
+
+/*
+* @brief Returns the time spent in each stage of the Helix decoder, over the frames decoded without error since
+* the last MP3ResetProfile. All zeros unless the Helix library was built with MP3_PROFILE defined.
+* @param profile Pointer to object to be filled with the totals, min and max of every stage
+*/
+void MP3GetProfile(mp3decoder_profile_t* profile);
+
+/*
+* @brief Clears the time accounted to each decoding stage, loading a file does not clear it
+*/
+void MP3ResetProfile(void);
+
+/*
+* @brief Moves the decoding position of the current file, without decoding the frames in between. 
+* Uses the frames already indexed, the Xing or VBRI table if the file has one, or walks the frame headers.
+* Decoding restarts a few frames before the target so the bit reservoir (main_data_begin) is filled.
+* @param milliseconds   Position from the beginning of the song, without the encoder delay
+* @returns True if the position was found, false if it is out of the file (or past the frame count of the Xing 
+* or VBRI header), the decoding position is then kept
+*/
+bool MP3Seek(uint32_t milliseconds);
 
+/*
+* @brief Returns the position of the next sample to be returned, in milliseconds from the beginning of the song. 
+* Samples removed by the gapless playback (encoder delay) are not counted, as in MP3Seek and MP3GetDuration.
+*/
+uint32_t MP3GetPosition(void);
+
+/*
+* @brief Returns the duration of the current song in milliseconds. Exact if the file has a Xing or VBRI header
+* or was scanned with MP3Scan, otherwise estimated from the file size and the bitrate of the last frame decoded.
+* @returns Duration in milliseconds, 0 if unknown
+*/
+uint32_t MP3GetDuration(void);
+
+/*
+* @brief Walks the frame headers of the current file without decoding them (no Huffman decoding or synthesis), 
+* following the sync rules of the decoder, and gives the exact frame count and duration, the frames of each 
+* bitrate and a table with the file offset of frame 0, offsetStep, 2*offsetStep... The step starts at one frame 
+* and doubles every time the table gets full. The seek index of the decoder is rebuilt from the scan, so seeking
+* and MP3GetDuration are exact afterwards. The decoding position is not changed.
+* @param scan       Pointer to object to be filled with the results
+* @param offsets    Table to be filled with frame offsets, NULL if not needed
+* @param maxOffsets Entries of the offset table
+* @returns True if audio frames were found
+*/
+bool MP3Scan(mp3decoder_scan_t* scan, uint32_t* offsets, uint32_t maxOffsets);
+#endif /* MP3DECODER_MAX_INSTANCES > 0 */
 
 /*******************************************************************************
  ******************************************************************************/
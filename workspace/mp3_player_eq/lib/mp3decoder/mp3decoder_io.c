@@ -0,0 +1,253 @@
+/***************************************************************************//**
+  @file     mp3decoder_io.c
+  @brief    Input backends of the mp3 decoder (FatFs, stdio, memory, mmap)
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+#include <string.h>
+#include "mp3decoder_io.h"
+
+#ifdef MP3DECODER_IO_MMAP
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES FOR PRIVATE FUNCTIONS WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+#ifdef __arm__
+static size_t fatfsRead(void* handle, void* buffer, size_t count);
+static bool fatfsSeek(void* handle, uint32_t position);
+static uint32_t fatfsTell(void* handle);
+static uint32_t fatfsSize(void* handle);
+static void fatfsClose(void* handle);
+#else
+static size_t stdioRead(void* handle, void* buffer, size_t count);
+static bool stdioSeek(void* handle, uint32_t position);
+static uint32_t stdioTell(void* handle);
+static uint32_t stdioSize(void* handle);
+static void stdioClose(void* handle);
+#endif
+
+static size_t memoryRead(void* handle, void* buffer, size_t count);
+static bool memorySeek(void* handle, uint32_t position);
+static uint32_t memoryTell(void* handle);
+static uint32_t memorySize(void* handle);
+static const uint8_t* memoryMap(void* handle, uint32_t* length);
+static void memoryClose(void* handle);
+
+#ifdef MP3DECODER_IO_MMAP
+static void mmapClose(void* handle);
+#endif
+
+/*******************************************************************************
+ * ROM CONST VARIABLES WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+#ifdef __arm__
+static const mp3decoder_io_t fatfsIo = { fatfsRead, fatfsSeek, fatfsTell, fatfsSize, NULL, fatfsClose };
+#else
+static const mp3decoder_io_t stdioIo = { stdioRead, stdioSeek, stdioTell, stdioSize, NULL, stdioClose };
+#endif
+
+static const mp3decoder_io_t memoryIo = { memoryRead, memorySeek, memoryTell, memorySize, memoryMap, memoryClose };
+
+#ifdef MP3DECODER_IO_MMAP
+static const mp3decoder_io_t mmapIo = { memoryRead, memorySeek, memoryTell, memorySize, memoryMap, mmapClose };
+#endif
+
+/*******************************************************************************
+ *******************************************************************************
+                        GLOBAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+#ifdef __arm__
+bool MP3IoFatfsOpen(FIL* file, const char* filename, mp3decoder_stream_t* stream)
+{
+    bool ret = false;
+    if (f_open(file, filename, FA_READ) == FR_OK)
+    {
+        stream->io = &fatfsIo;
+        stream->handle = file;
+        ret = true;
+    }
+    return ret;
+}
+#else
+bool MP3IoStdioOpen(mp3decoder_stdio_t* file, const char* filename, mp3decoder_stream_t* stream)
+{
+    file->file = fopen(filename, "rb");
+    stream->io = &stdioIo;
+    stream->handle = file;
+    return (file->file != NULL);
+}
+#endif
+
+void MP3IoMemoryOpen(mp3decoder_memory_t* memory, const uint8_t* data, uint32_t size, mp3decoder_stream_t* stream)
+{
+    memory->data = data;
+    memory->size = size;
+    memory->position = 0;
+    stream->io = &memoryIo;
+    stream->handle = memory;
+}
+
+#ifdef MP3DECODER_IO_MMAP
+bool MP3IoMmapOpen(mp3decoder_mmap_t* file, const char* filename, mp3decoder_stream_t* stream)
+{
+    bool ret = false;
+    struct stat info;
+    int fd = open(filename, O_RDONLY);
+    if (fd >= 0)
+    {
+        if ((fstat(fd, &info) == 0) && (info.st_size > 0))
+        {
+            void* data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED)
+            {
+                // The whole file is read front to back
+                madvise(data, info.st_size, MADV_SEQUENTIAL);
+                MP3IoMemoryOpen(&file->memory, data, info.st_size, stream);
+                stream->io = &mmapIo;
+                ret = true;
+            }
+        }
+        // The mapping stays valid after closing the descriptor
+        close(fd);
+    }
+    return ret;
+}
+#endif
+
+/*******************************************************************************
+ *******************************************************************************
+                        LOCAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+/* FATFS BACKEND */
+
+#ifdef __arm__
+size_t fatfsRead(void* handle, void* buffer, size_t count)
+{
+    // One contiguous read, FatFs transfers the whole sectors straight into the buffer
+    UINT read = 0;
+    FRESULT fr = f_read((FIL*)handle, buffer, count, &read);
+    return (fr == FR_OK) ? read : 0;
+}
+
+bool fatfsSeek(void* handle, uint32_t position)
+{
+    return f_lseek((FIL*)handle, position) == FR_OK;
+}
+
+uint32_t fatfsTell(void* handle)
+{
+    return f_tell((FIL*)handle);
+}
+
+uint32_t fatfsSize(void* handle)
+{
+    return f_size((FIL*)handle);
+}
+
+void fatfsClose(void* handle)
+{
+    f_close((FIL*)handle);
+}
+
+/* STDIO BACKEND */
+
+#else
+size_t stdioRead(void* handle, void* buffer, size_t count)
+{
+    return fread(buffer, 1, count, ((mp3decoder_stdio_t*)handle)->file);
+}
+
+bool stdioSeek(void* handle, uint32_t position)
+{
+    return fseek(((mp3decoder_stdio_t*)handle)->file, position, SEEK_SET) == 0;
+}
+
+uint32_t stdioTell(void* handle)
+{
+    return ftell(((mp3decoder_stdio_t*)handle)->file);
+}
+
+uint32_t stdioSize(void* handle)
+{
+    FILE* file = ((mp3decoder_stdio_t*)handle)->file;
+    long position = ftell(file);
+    fseek(file, 0L, SEEK_END);
+    uint32_t size = ftell(file);
+    fseek(file, position, SEEK_SET);
+    return size;
+}
+
+void stdioClose(void* handle)
+{
+    fclose(((mp3decoder_stdio_t*)handle)->file);
+}
+#endif
+
+/* MEMORY BACKEND */
+
+size_t memoryRead(void* handle, void* buffer, size_t count)
+{
+    mp3decoder_memory_t* memory = (mp3decoder_memory_t*)handle;
+    size_t available = memory->size - memory->position;
+    size_t read = (count < available) ? count : available;
+    memcpy(buffer, memory->data + memory->position, read);
+    memory->position += read;
+    return read;
+}
+
+bool memorySeek(void* handle, uint32_t position)
+{
+    mp3decoder_memory_t* memory = (mp3decoder_memory_t*)handle;
+    memory->position = (position < memory->size) ? position : memory->size;
+    return (position <= memory->size);
+}
+
+uint32_t memoryTell(void* handle)
+{
+    return ((mp3decoder_memory_t*)handle)->position;
+}
+
+uint32_t memorySize(void* handle)
+{
+    return ((mp3decoder_memory_t*)handle)->size;
+}
+
+const uint8_t* memoryMap(void* handle, uint32_t* length)
+{
+    mp3decoder_memory_t* memory = (mp3decoder_memory_t*)handle;
+    *length = memory->size;
+    return memory->data;
+}
+
+void memoryClose(void* handle)
+{
+    // The buffer belongs to the caller
+    (void)handle;
+}
+
+/* MMAP BACKEND */
+
+#ifdef MP3DECODER_IO_MMAP
+void mmapClose(void* handle)
+{
+    mp3decoder_mmap_t* file = (mp3decoder_mmap_t*)handle;
+    munmap((void*)file->memory.data, file->memory.size);
+}
+#endif
+
+/******************************************************************************/
@@ -0,0 +1,126 @@
+/***************************************************************************//**
+  @file     mp3decoder_io.h
+  @brief    Input backends of the mp3 decoder (FatFs, stdio, memory, mmap)
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+#ifndef _MP3DECODER_IO_H_
+#define _MP3DECODER_IO_H_
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+#include  <stdbool.h>
+#include  <stdint.h>
+#include  <stddef.h>
+
+#ifdef __arm__
+#include "lib/fatfs/ff.h"
+#else
+#include  <stdio.h>
+#endif
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#if !defined(__arm__) && defined(__linux__)
+#define MP3DECODER_IO_MMAP                                                   // mmap backend is available
+#endif
+
+/*******************************************************************************
+ * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
+ ******************************************************************************/
+
+// Operations of an input backend, all of them receive the handle of the stream
+typedef struct
+{
+    size_t          (*read)(void* handle, void* buffer, size_t count);      // Returns the bytes read, less than count at the end
+    bool            (*seek)(void* handle, uint32_t position);               // Moves to an absolute position
+    uint32_t        (*tell)(void* handle);                                  // Current position
+    uint32_t        (*size)(void* handle);                                  // Total size of the stream
+    const uint8_t*  (*map)(void* handle, uint32_t* length);                 // Optional (NULL), whole stream in memory for zero-copy decoding
+    void            (*close)(void* handle);
+} mp3decoder_io_t;
+
+// Open stream, a backend and its handle
+typedef struct
+{
+    const mp3decoder_io_t*  io;
+    void*                   handle;
+} mp3decoder_stream_t;
+
+typedef struct
+{
+    const uint8_t*  data;
+    uint32_t        size;
+    uint32_t        position;
+} mp3decoder_memory_t;
+
+#ifndef __arm__
+typedef struct
+{
+    FILE*           file;
+} mp3decoder_stdio_t;
+#endif
+
+#ifdef MP3DECODER_IO_MMAP
+typedef struct
+{
+    mp3decoder_memory_t memory;                                             // Mapped file, read as a memory stream
+} mp3decoder_mmap_t;
+#endif
+
+/*******************************************************************************
+ * VARIABLE PROTOTYPES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+#ifdef __arm__
+/*
+* @brief Opens a file of the FatFs volume
+* @param file       File object, must remain valid until the stream is closed
+* @param filename   Path of the file
+* @param stream     Stream to be filled
+* @returns True if the file was opened
+*/
+bool MP3IoFatfsOpen(FIL* file, const char* filename, mp3decoder_stream_t* stream);
+#else
+/*
+* @brief Opens a file with the C standard library
+* @param file       Backend handle, must remain valid until the stream is closed
+* @param filename   Path of the file
+* @param stream     Stream to be filled
+* @returns True if the file was opened
+*/
+bool MP3IoStdioOpen(mp3decoder_stdio_t* file, const char* filename, mp3decoder_stream_t* stream);
+#endif
+
+/*
+* @brief Opens a stream over a buffer in memory, which is decoded without copying it
+* @param memory     Backend handle, must remain valid until the stream is closed
+* @param data       Encoded data, must remain valid until the stream is closed
+* @param size       Bytes of encoded data
+* @param stream     Stream to be filled
+*/
+void MP3IoMemoryOpen(mp3decoder_memory_t* memory, const uint8_t* data, uint32_t size, mp3decoder_stream_t* stream);
+
+#ifdef MP3DECODER_IO_MMAP
+/*
+* @brief Maps a file into memory, so it is decoded without copying it
+* @param file       Backend handle, must remain valid until the stream is closed
+* @param filename   Path of the file
+* @param stream     Stream to be filled
+* @returns True if the file was mapped
+*/
+bool MP3IoMmapOpen(mp3decoder_mmap_t* file, const char* filename, mp3decoder_stream_t* stream);
+#endif
+
+/*******************************************************************************
+ ******************************************************************************/
+
+#endif /* _MP3DECODER_IO_H_ */
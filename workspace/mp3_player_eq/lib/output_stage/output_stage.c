@@ -0,0 +1,299 @@
+/*******************************************************************************
+  @file     output_stage.c
+  @brief    Fixed-point output stage, from signed 16 bit samples to unsigned DAC codes
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+#include <stddef.h>
+
+#include "output_stage.h"
+
+#if defined(__ARM_FEATURE_DSP)
+#define OUTPUT_STAGE_CM4
+#include "arm_math.h"
+#endif
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define OUTPUT_MIN          (-(1 << (OUTPUT_STAGE_BITS - 1)))
+#define OUTPUT_MAX          ((1 << (OUTPUT_STAGE_BITS - 1)) - 1)
+#define OUTPUT_MIDSCALE     (1 << (OUTPUT_STAGE_BITS - 1))
+#define DITHER_SEED         0x2545F491
+#define DITHER_FRACBITS     15
+#define MAX_SHIFT           29          // A full scale sample times a 15 bit gain, the rounding and the dither fit 31 bits
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES FOR PRIVATE FUNCTIONS WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+/**
+ * @brief Converts samples with the steady gain
+ * @param stage   Pointer to the output stage
+ * @param input   Pointer to the signed samples
+ * @param output  Pointer to where the DAC codes are saved
+ * @param count   Amount of samples
+ * @param dither  True to add the dither
+ * @param state   Pointer to the dither generator state
+ */
+static void convertSteady(const output_stage_t* stage, const int16_t* input, uint16_t* output, uint32_t count,
+                          bool dither, uint32_t* state);
+
+/**
+ * @brief Converts samples with the interpolated gain of the ramp
+ * @returns Amount of samples converted, up to the end of the ramp
+ */
+static uint32_t convertRamp(output_stage_t* stage, const int16_t* input, uint16_t* output, uint32_t count,
+                            bool dither, uint32_t* state);
+
+/**
+ * @brief Converts one sample
+ * @param sample    Signed sample
+ * @param gain      Gain, in Q(shift)
+ * @param rounding  Half an output step
+ * @param dither    Dither value, aligned to the shift
+ * @param shift     Fraction bits of the gain
+ */
+static inline uint16_t convertSample(int16_t sample, int32_t gain, int32_t rounding, int32_t dither, uint8_t shift);
+
+/**
+ * @brief Shifts that align the Q15 dither to the output step of a gain with the given fraction bits
+ */
+static void alignDither(uint8_t shift, uint8_t* left, uint8_t* right);
+
+/**
+ * @brief Returns the next TPDF dither value, +-1 output step
+ * @param state   Pointer to the generator state
+ * @param left    Shifts that align the dither to the output step, from alignDither
+ * @param right
+ */
+static inline int32_t nextDither(uint32_t* state, uint8_t left, uint8_t right);
+
+/**
+ * @brief Saturates a signed value to the output range
+ */
+static inline int32_t saturate(int32_t value);
+
+/*******************************************************************************
+ * ROM CONST VARIABLES WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+// Q15 gain of each volume step, OUTPUT_STAGE_VOLUME_STEP_DB apart: 32768 * 10^((volume - 100) * 0.5 / 20)
+static const int16_t volumeTable[OUTPUT_STAGE_MAX_VOLUME + 1] = {
+      0,   110,   116,   123,   130,   138,   146,   155,   164,   174,
+    184,   195,   207,   219,   232,   246,   260,   276,   292,   309,
+    328,   347,   368,   389,   413,   437,   463,   490,   519,   550,
+    583,   617,   654,   693,   734,   777,   823,   872,   924,   978,
+   1036,  1098,  1163,  1232,  1305,  1382,  1464,  1550,  1642,  1740,
+   1843,  1952,  2068,  2190,  2320,  2457,  2603,  2757,  2920,  3093,
+   3277,  3471,  3677,  3894,  4125,  4370,  4629,  4903,  5193,  5501,
+   5827,  6172,  6538,  6925,  7336,  7771,  8231,  8719,  9235,  9783,
+  10362, 10976, 11627, 12315, 13045, 13818, 14637, 15504, 16423, 17396,
+  18427, 19519, 20675, 21900, 23198, 24573, 26029, 27571, 29205, 30935,
+  32767
+};
+
+/*******************************************************************************
+ *******************************************************************************
+                        GLOBAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+void outputStageInit(output_stage_t* stage)
+{
+  stage->gain = 0;
+  stage->shift = 0;
+  stage->dither = false;
+  stage->ditherState = DITHER_SEED;
+  stage->rampLength = 0;
+  stage->rampRemaining = 0;
+  outputStageSetGain(stage, 0, OUTPUT_STAGE_UNITY_GAIN, DITHER_FRACBITS);
+}
+
+void outputStageSetGain(output_stage_t* stage, uint8_t volume, int16_t makeup, uint8_t shift)
+{
+  // The product of both Q15 gains is taken to 15 significant bits, low volumes get more fraction bits
+  int32_t product = (int32_t)outputStageVolumeGain(volume) * makeup;
+  uint8_t extra = 0;
+  shift = (shift > MAX_SHIFT) ? MAX_SHIFT : shift;
+  while ((product != 0) && (extra < 14) && (shift + extra < MAX_SHIFT) && ((product >> (14 - extra)) <= INT16_MAX))
+  {
+    extra++;
+  }
+  int32_t gain = (product + (1 << (14 - extra))) >> (15 - extra);
+  gain = (gain > INT16_MAX) ? INT16_MAX : gain;
+  shift += extra;
+
+  if ((gain != stage->gain) || (shift != stage->shift))
+  {
+    if (stage->rampLength)
+    {
+      // From the gain being output to the new one, both in the fraction bits of the larger of them so they fit 16 bits
+      // (a mute end has no fraction bits of its own)
+      int32_t fromGain = stage->rampRemaining ? (stage->rampGain >> 15) : stage->gain;
+      uint8_t fromShift = stage->rampRemaining ? stage->rampShift : stage->shift;
+      uint8_t rampShift = (fromShift < shift) ? fromShift : shift;
+      rampShift = (fromGain == 0) ? shift : ((gain == 0) ? fromShift : rampShift);
+      int32_t from = fromGain ? (fromGain >> (fromShift - rampShift)) : 0;
+      int32_t to = gain ? (gain >> (shift - rampShift)) : 0;
+      stage->rampShift = rampShift;
+      stage->rampGain = from * (1 << 15);
+      stage->rampStep = ((to - from) * (1 << 15)) / (int32_t)stage->rampLength;
+      stage->rampRemaining = stage->rampLength;
+    }
+    stage->gain = gain;
+    stage->shift = shift;
+    stage->rounding = (int32_t)1 << (shift - 1);
+    alignDither(shift, &stage->ditherLeft, &stage->ditherRight);
+  }
+}
+
+void outputStageSetRamp(output_stage_t* stage, uint16_t ms, uint32_t sampleRate)
+{
+  stage->rampLength = ((uint32_t)ms * sampleRate) / 1000;
+}
+
+bool outputStageIsRamping(const output_stage_t* stage)
+{
+  return stage->rampRemaining != 0;
+}
+
+void outputStageSetDither(output_stage_t* stage, bool enable)
+{
+  stage->dither = enable;
+}
+
+void outputStageWrite(output_stage_t* stage, const int16_t* input, uint16_t* output, uint32_t count)
+{
+  // A muted output is plain midscale, without the dither noise
+  bool dither = stage->dither && ((stage->gain != 0) || (stage->rampRemaining != 0));
+  uint32_t state = stage->ditherState;
+  uint32_t done = 0;
+
+  if (stage->rampRemaining)
+  {
+    done = convertRamp(stage, input, output, count, dither, &state);
+  }
+  convertSteady(stage, input + done, output + done, count - done, dither, &state);
+
+  stage->ditherState = state;
+}
+
+int16_t outputStageVolumeGain(uint8_t volume)
+{
+  return volumeTable[(volume < OUTPUT_STAGE_MAX_VOLUME) ? volume : OUTPUT_STAGE_MAX_VOLUME];
+}
+
+/*******************************************************************************
+ *******************************************************************************
+                        LOCAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+static void convertSteady(const output_stage_t* stage, const int16_t* input, uint16_t* output, uint32_t count,
+                          bool dither, uint32_t* state)
+{
+  uint32_t i = 0;
+
+#ifdef OUTPUT_STAGE_CM4
+  // Two samples per word: each dual multiply-accumulate takes one of them (the gain is only in one half of the
+  // operand) and adds the rounding, both are saturated and packed, and a dual add moves them to midscale
+  if (((((uintptr_t)input ^ (uintptr_t)output) & 3) == 0) && ((((uintptr_t)input) & 1) == 0))
+  {
+    // After a ramp the block may start in the middle of a word
+    if ((((uintptr_t)input) & 2) && (count > 0))
+    {
+      int32_t value = dither ? nextDither(state, stage->ditherLeft, stage->ditherRight) : 0;
+      output[0] = convertSample(input[0], stage->gain, stage->rounding, value, stage->shift);
+      i = 1;
+    }
+
+    const uint32_t* inputPairs = (const uint32_t*)(input + i);
+    uint32_t* outputPairs = (uint32_t*)(output + i);
+    uint32_t gainLow = (uint16_t)stage->gain;
+    uint32_t gainHigh = gainLow << 16;
+    uint32_t midscale = ((uint32_t)OUTPUT_MIDSCALE << 16) | OUTPUT_MIDSCALE;
+    for ( ; i + 1 < count ; i += 2)
+    {
+      uint32_t pair = *inputPairs++;
+      int32_t low = (int32_t)__SMLAD(pair, gainLow, (uint32_t)stage->rounding);
+      int32_t high = (int32_t)__SMLAD(pair, gainHigh, (uint32_t)stage->rounding);
+      if (dither)
+      {
+        low += nextDither(state, stage->ditherLeft, stage->ditherRight);
+        high += nextDither(state, stage->ditherLeft, stage->ditherRight);
+      }
+      low = __SSAT(low >> stage->shift, OUTPUT_STAGE_BITS);
+      high = __SSAT(high >> stage->shift, OUTPUT_STAGE_BITS);
+      *outputPairs++ = __SADD16(__PKHBT(low, high, 16), midscale);
+    }
+  }
+#endif
+
+  for ( ; i < count ; i++)
+  {
+    int32_t value = dither ? nextDither(state, stage->ditherLeft, stage->ditherRight) : 0;
+    output[i] = convertSample(input[i], stage->gain, stage->rounding, value, stage->shift);
+  }
+}
+
+static uint32_t convertRamp(output_stage_t* stage, const int16_t* input, uint16_t* output, uint32_t count,
+                            bool dither, uint32_t* state)
+{
+  uint32_t rampCount = (count < stage->rampRemaining) ? count : stage->rampRemaining;
+  int32_t rampGain = stage->rampGain;
+  uint8_t shift = stage->rampShift;
+  int32_t rounding = (int32_t)1 << (shift - 1);
+  uint8_t ditherLeft, ditherRight;
+  alignDither(shift, &ditherLeft, &ditherRight);
+
+  for (uint32_t i = 0 ; i < rampCount ; i++)
+  {
+    rampGain += stage->rampStep;
+    int32_t value = dither ? nextDither(state, ditherLeft, ditherRight) : 0;
+    output[i] = convertSample(input[i], rampGain >> 15, rounding, value, shift);
+  }
+
+  stage->rampGain = rampGain;
+  stage->rampRemaining -= rampCount;
+  return rampCount;
+}
+
+static inline uint16_t convertSample(int16_t sample, int32_t gain, int32_t rounding, int32_t dither, uint8_t shift)
+{
+  return (uint16_t)(saturate((sample * gain + rounding + dither) >> shift) + OUTPUT_MIDSCALE);
+}
+
+static void alignDither(uint8_t shift, uint8_t* left, uint8_t* right)
+{
+  *left = (shift > DITHER_FRACBITS) ? (shift - DITHER_FRACBITS) : 0;
+  *right = (shift < DITHER_FRACBITS) ? (DITHER_FRACBITS - shift) : 0;
+}
+
+static inline int32_t nextDither(uint32_t* state, uint8_t left, uint8_t right)
+{
+  // Xorshift32, the sum of its two 15 bit halves has a triangular distribution
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  int32_t dither = (int32_t)(x & 0x7FFF) + (int32_t)((x >> 16) & 0x7FFF) - 0x7FFF;
+  return (dither * (1 << left)) >> right;
+}
+
+static inline int32_t saturate(int32_t value)
+{
+#ifdef OUTPUT_STAGE_CM4
+  return __SSAT(value, OUTPUT_STAGE_BITS);
+#else
+  return (value < OUTPUT_MIN) ? OUTPUT_MIN : ((value > OUTPUT_MAX) ? OUTPUT_MAX : value);
+#endif
+}
+
+/******************************************************************************/
@@ -0,0 +1,116 @@
+/*******************************************************************************
+  @file     output_stage.h
+  @brief    Fixed-point output stage, from signed 16 bit samples to unsigned DAC codes
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+#ifndef OUTPUT_STAGE_H_
+#define OUTPUT_STAGE_H_
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define OUTPUT_STAGE_BITS           12                      // Resolution of the DAC codes
+#define OUTPUT_STAGE_MAX_VOLUME     100                     // Volume steps, 0 is mute
+#define OUTPUT_STAGE_VOLUME_STEP_DB 0.5                     // Attenuation of each volume step under the maximum
+#define OUTPUT_STAGE_UNITY_GAIN     32767                   // Makeup gain that leaves the volume gain as it is
+
+/*******************************************************************************
+ * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
+ ******************************************************************************/
+
+// Each sample x is converted to (x * gain + rounding + dither) >> shift, saturated to a signed OUTPUT_STAGE_BITS
+// value and moved to midscale. The gain is a 16 bit signed number, so the product and the accumulator
+// fit the single cycle multiply-accumulate of the Cortex-M4.
+// A gain change moves linearly to the new gain, one step per sample, over the ramp length. Only the samples of the
+// ramp are converted one by one with the interpolated gain, the rest of the block takes the steady gain path.
+typedef struct {
+  int32_t   gain;             // Volume gain times the makeup gain, in Q(shift), 15 significant bits
+  int32_t   rounding;         // Half an output step, added with the product
+  uint8_t   shift;            // Fraction bits of the gain, up to 29
+  bool      dither;           // TPDF dither enabled
+  uint8_t   ditherLeft;       // The dither is generated in Q15 and aligned to the output step with these shifts
+  uint8_t   ditherRight;
+  uint32_t  ditherState;      // State of the dither generator
+
+  // Gain ramp
+  uint32_t  rampLength;       // Samples of a gain change, 0 to change it at once
+  uint32_t  rampRemaining;    // Samples left in the ramp being output
+  int32_t   rampGain;         // Interpolated gain, in Q(rampShift + 15)
+  int32_t   rampStep;         // Added to rampGain every sample
+  uint8_t   rampShift;        // Fraction bits of the interpolated gain, the ones of the larger end of the ramp
+} output_stage_t;
+
+/*******************************************************************************
+ * VARIABLE PROTOTYPES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/**
+ * @brief Initializes an output stage, muted and without dither
+ * @param stage   Pointer to the output stage
+ */
+void outputStageInit(output_stage_t* stage);
+
+/**
+ * @brief Sets the gain of the samples, a change starts a ramp from the gain being output. Setting the same gain
+ *        again leaves the ramp running.
+ * @param stage   Pointer to the output stage
+ * @param volume  Volume step, 0 (mute) to OUTPUT_STAGE_MAX_VOLUME (0 dB)
+ * @param makeup  Positive Q15 gain applied on top of the volume, OUTPUT_STAGE_UNITY_GAIN for none
+ * @param shift   Fraction bits of the makeup gain relative to the output step, 1 to 29. A sample is output as
+ *                sample * volume gain * makeup / 2^shift DAC steps (e.g. 19 to take 16 bit samples to 12 bit codes)
+ */
+void outputStageSetGain(output_stage_t* stage, uint8_t volume, int16_t makeup, uint8_t shift);
+
+/**
+ * @brief Sets the length of the gain ramps, the ramp running keeps its length
+ * @param stage       Pointer to the output stage
+ * @param ms          Ramp length in milliseconds, 0 to change the gain at once
+ * @param sampleRate  Sample rate of the output, in Hz
+ */
+void outputStageSetRamp(output_stage_t* stage, uint16_t ms, uint32_t sampleRate);
+
+/**
+ * @brief Returns whether a gain ramp is being output
+ * @param stage   Pointer to the output stage
+ */
+bool outputStageIsRamping(const output_stage_t* stage);
+
+/**
+ * @brief Enables the triangular PDF dither of +-1 output step, it is not added while muted
+ * @param stage   Pointer to the output stage
+ * @param enable  True to add the dither
+ */
+void outputStageSetDither(output_stage_t* stage, bool enable);
+
+/**
+ * @brief Converts samples to unsigned DAC codes
+ * @param stage   Pointer to the output stage
+ * @param input   Pointer to the signed samples
+ * @param output  Pointer to where the DAC codes are saved, may be the input buffer
+ * @param count   Amount of samples. On the Cortex-M4 they are converted in pairs when both buffers are word aligned.
+ */
+void outputStageWrite(output_stage_t* stage, const int16_t* input, uint16_t* output, uint32_t count);
+
+/**
+ * @brief Returns the Q15 gain of a volume step, from the dB-linear volume table
+ * @param volume  Volume step, 0 (mute) to OUTPUT_STAGE_MAX_VOLUME
+ */
+int16_t outputStageVolumeGain(uint8_t volume);
+
+/*******************************************************************************
+ ******************************************************************************/
+
+#endif /* OUTPUT_STAGE_H_ */
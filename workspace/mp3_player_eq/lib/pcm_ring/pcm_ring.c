@@ -0,0 +1,149 @@
+/*******************************************************************************
+  @file     pcm_ring.c
+  @brief    Lock-free single producer, single consumer ring of PCM blocks
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+#include <stddef.h>
+
+#include "pcm_ring.h"
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+// A counter is published with release semantics after the blocks it covers were written (or read), and loaded
+// with acquire semantics by the other side before touching those blocks. On the Cortex-M4 both are a plain
+// access and a DMB, on the host they keep the compiler and the CPU from reordering the block accesses.
+#define RING_LOAD(counter)          __atomic_load_n(&(counter), __ATOMIC_ACQUIRE)
+#define RING_STORE(counter, value)  __atomic_store_n(&(counter), (value), __ATOMIC_RELEASE)
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES FOR PRIVATE FUNCTIONS WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+/**
+ * @brief Returns the block with the given sequence number
+ */
+static uint16_t* blockAt(pcm_ring_t* ring, uint32_t sequence);
+
+/*******************************************************************************
+ *******************************************************************************
+                        GLOBAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+bool pcmRingInit(pcm_ring_t* ring, uint16_t* buffer, uint16_t blockSize, uint8_t blockCount, uint8_t lowWatermark, uint8_t highWatermark)
+{
+  bool valid = (ring != NULL) && (buffer != NULL) && (blockSize != 0) && (blockCount != 0) && (blockCount <= PCM_RING_MAX_BLOCKS) &&
+               (lowWatermark <= highWatermark) && (highWatermark <= blockCount);
+  if (valid)
+  {
+    ring->buffer = buffer;
+    ring->blockSize = blockSize;
+    ring->blockCount = blockCount;
+    ring->lowWatermark = lowWatermark;
+    ring->highWatermark = highWatermark;
+    pcmRingReset(ring);
+  }
+  return valid;
+}
+
+void pcmRingReset(pcm_ring_t* ring)
+{
+  ring->committed = 0;
+  ring->claimed = 0;
+  ring->released = 0;
+  ring->underruns = 0;
+}
+
+uint16_t* pcmRingAcquire(pcm_ring_t* ring)
+{
+  uint16_t* block = NULL;
+  uint32_t committed = ring->committed;
+  if ((committed - RING_LOAD(ring->released)) < ring->blockCount)
+  {
+    block = blockAt(ring, committed);
+  }
+  return block;
+}
+
+void pcmRingCommit(pcm_ring_t* ring)
+{
+  RING_STORE(ring->committed, ring->committed + 1);
+}
+
+uint32_t pcmRingProducerSequence(pcm_ring_t* ring)
+{
+  return ring->committed;
+}
+
+const uint16_t* pcmRingClaim(pcm_ring_t* ring, uint32_t* sequence)
+{
+  const uint16_t* block = NULL;
+  uint32_t claimed = ring->claimed;
+  if (claimed != RING_LOAD(ring->committed))
+  {
+    block = blockAt(ring, claimed);
+    ring->claimed = claimed + 1;
+    if (sequence)
+    {
+      *sequence = claimed;
+    }
+  }
+  else
+  {
+    ring->underruns++;
+  }
+  return block;
+}
+
+void pcmRingRelease(pcm_ring_t* ring)
+{
+  if (ring->released != ring->claimed)
+  {
+    RING_STORE(ring->released, ring->released + 1);
+  }
+}
+
+void pcmRingUnclaim(pcm_ring_t* ring)
+{
+  ring->claimed = ring->released;
+}
+
+uint8_t pcmRingLevel(pcm_ring_t* ring)
+{
+  return (uint8_t)(RING_LOAD(ring->committed) - RING_LOAD(ring->released));
+}
+
+bool pcmRingIsLow(pcm_ring_t* ring)
+{
+  return pcmRingLevel(ring) <= ring->lowWatermark;
+}
+
+bool pcmRingIsHigh(pcm_ring_t* ring)
+{
+  return pcmRingLevel(ring) >= ring->highWatermark;
+}
+
+uint32_t pcmRingGetUnderruns(pcm_ring_t* ring)
+{
+  return ring->underruns;
+}
+
+/*******************************************************************************
+ *******************************************************************************
+                        LOCAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+static uint16_t* blockAt(pcm_ring_t* ring, uint32_t sequence)
+{
+  return ring->buffer + (sequence % ring->blockCount) * ring->blockSize;
+}
+
+/******************************************************************************/
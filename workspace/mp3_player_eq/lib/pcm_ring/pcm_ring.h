@@ -0,0 +1,136 @@
+/*******************************************************************************
+  @file     pcm_ring.h
+  @brief    Lock-free single producer, single consumer ring of PCM blocks
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+#ifndef PCM_RING_H_
+#define PCM_RING_H_
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define PCM_RING_MAX_BLOCKS     32
+
+/*******************************************************************************
+ * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
+ ******************************************************************************/
+
+// The blocks are filled in place by the producer (the decoder) and read in place by the consumer (the DMA), a block
+// goes through free -> committed -> claimed -> released (free again). The counters run free and only one side writes
+// each of them, so both sides can run at the same time (main loop and ISR, or two threads) without locks.
+// Blocks are identified by a sequence number: the amount of blocks committed before them since the last reset.
+typedef struct {
+  uint16_t*           buffer;           // blockCount * blockSize samples
+  uint16_t            blockSize;        // Samples per block
+  uint8_t             blockCount;       // Depth of the ring
+  uint8_t             lowWatermark;     // The ring is running low at this level or under it
+  uint8_t             highWatermark;    // The ring is well ahead at this level or over it
+  volatile uint32_t   committed;        // Blocks committed, written by the producer
+  volatile uint32_t   claimed;          // Blocks claimed, written by the consumer
+  volatile uint32_t   released;         // Blocks released, written by the consumer
+  volatile uint32_t   underruns;        // Claims that found the ring empty, written by the consumer
+} pcm_ring_t;
+
+/*******************************************************************************
+ * VARIABLE PROTOTYPES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/**
+ * @brief Initializes an empty ring on the buffer specified by user
+ * @param ring            Pointer to the ring
+ * @param buffer          Pointer to blockCount * blockSize samples
+ * @param blockSize       Samples per block
+ * @param blockCount      Depth of the ring, up to PCM_RING_MAX_BLOCKS
+ * @param lowWatermark    Level (blocks committed and not released yet) at or under which the ring is running low
+ * @param highWatermark   Level at or over which the ring is well ahead
+ * @returns False if the parameters are not valid
+ */
+bool pcmRingInit(pcm_ring_t* ring, uint16_t* buffer, uint16_t blockSize, uint8_t blockCount, uint8_t lowWatermark, uint8_t highWatermark);
+
+/**
+ * @brief Empties the ring and restarts the sequence numbers. Neither side may be using it.
+ * @param ring    Pointer to the ring
+ */
+void pcmRingReset(pcm_ring_t* ring);
+
+/**
+ * @brief Producer: returns the next free block to be filled, without taking it
+ * @param ring    Pointer to the ring
+ * @returns Pointer to the block, NULL if the ring is full
+ */
+uint16_t* pcmRingAcquire(pcm_ring_t* ring);
+
+/**
+ * @brief Producer: hands the block returned by pcmRingAcquire to the consumer
+ * @param ring    Pointer to the ring
+ */
+void pcmRingCommit(pcm_ring_t* ring);
+
+/**
+ * @brief Producer: sequence number of the block being filled (the next one to be committed)
+ * @param ring    Pointer to the ring
+ */
+uint32_t pcmRingProducerSequence(pcm_ring_t* ring);
+
+/**
+ * @brief Consumer: takes the oldest committed block that was not claimed yet. Several blocks may be claimed
+ *        at the same time, they keep their contents until they are released.
+ * @param ring      Pointer to the ring
+ * @param sequence  Pointer to variable that will be updated with the sequence number of the block, may be NULL
+ * @returns Pointer to the block, NULL (and counts an underrun) if the ring is empty
+ */
+const uint16_t* pcmRingClaim(pcm_ring_t* ring, uint32_t* sequence);
+
+/**
+ * @brief Consumer: frees the oldest claimed block
+ * @param ring    Pointer to the ring
+ */
+void pcmRingRelease(pcm_ring_t* ring);
+
+/**
+ * @brief Consumer: gives back the blocks claimed and not released, the next claim returns the oldest of them
+ * @param ring    Pointer to the ring
+ */
+void pcmRingUnclaim(pcm_ring_t* ring);
+
+/**
+ * @brief Returns the blocks committed and not released yet
+ * @param ring    Pointer to the ring
+ */
+uint8_t pcmRingLevel(pcm_ring_t* ring);
+
+/**
+ * @brief Returns whether the level is at or under the low watermark
+ * @param ring    Pointer to the ring
+ */
+bool pcmRingIsLow(pcm_ring_t* ring);
+
+/**
+ * @brief Returns whether the level is at or over the high watermark
+ * @param ring    Pointer to the ring
+ */
+bool pcmRingIsHigh(pcm_ring_t* ring);
+
+/**
+ * @brief Returns the claims that found the ring empty since the last reset
+ * @param ring    Pointer to the ring
+ */
+uint32_t pcmRingGetUnderruns(pcm_ring_t* ring);
+
+/*******************************************************************************
+ ******************************************************************************/
+
+#endif /* PCM_RING_H_ */
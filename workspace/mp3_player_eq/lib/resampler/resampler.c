@@ -0,0 +1,330 @@
+/*******************************************************************************
+  @file     resampler.c
+  @brief    Streaming fixed-point polyphase sample rate converter
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+#include <string.h>
+#include <math.h>
+
+#include "resampler.h"
+
+#if defined(__ARM_FEATURE_DSP)
+#define RESAMPLER_CM4
+#include "arm_math.h"
+#endif
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define RESAMPLER_PI          3.14159265358979f
+#define BESSEL_TERMS          24
+
+/*******************************************************************************
+ * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
+ ******************************************************************************/
+
+typedef struct {
+  uint8_t   taps;
+  float     beta;         // Kaiser window shape, sets the stopband attenuation
+  float     passband;     // Cutoff, relative to the lower of both Nyquist frequencies
+} resampler_design_t;
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES FOR PRIVATE FUNCTIONS WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+/**
+ * @brief Designs the coefficients of every phase for a rate: a Kaiser windowed sinc, with unity gain at DC on every
+ *        phase
+ * @param resampler   Pointer to the resampler
+ * @param table       Table to design
+ * @param rate        Higher of the input and output rates
+ */
+static void designFilter(const resampler_t* resampler, resampler_table_t* table, uint32_t rate);
+
+/**
+ * @brief Kaiser window
+ * @param position  Position in the window, from -1 to 1
+ * @param beta      Window shape
+ */
+static float kaiser(float position, float beta);
+
+/**
+ * @brief Modified Bessel function of the first kind and order zero
+ */
+static float besselI0(float x);
+
+/**
+ * @brief Computes one output sample
+ * @param resampler   Pointer to the resampler
+ * @param window      Pointer to the first input sample of the window
+ * @param fraction    Q32 position of the output sample after the input sample at the centre of the window
+ */
+static inline int16_t filterSample(const resampler_t* resampler, const int16_t* window, uint32_t fraction);
+
+/**
+ * @brief Drops the samples before the next window and appends input samples to the buffer
+ * @returns Amount of input samples taken
+ */
+static uint32_t refill(resampler_t* resampler, const int16_t* input, uint32_t inputCount);
+
+/*******************************************************************************
+ * ROM CONST VARIABLES WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+// Rates of MPEG-1, 2 and 2.5, and half of the lowest ones (decoded at half rate)
+static const uint32_t mpegRates[] = {
+  4000, 5512, 6000, 8000, 11025, 12000, 16000, 22050, 24000, 32000, 44100, 48000
+};
+
+static const resampler_design_t designs[RESAMPLER_QUALITY_COUNT] = {
+  [RESAMPLER_QUALITY_LOW]     = { .taps = 8,  .beta = 4.0f, .passband = 0.70f },
+  [RESAMPLER_QUALITY_MEDIUM]  = { .taps = 16, .beta = 6.0f, .passband = 0.82f },
+  [RESAMPLER_QUALITY_HIGH]    = { .taps = 32, .beta = 8.0f, .passband = 0.90f }
+};
+
+/*******************************************************************************
+ *******************************************************************************
+                        GLOBAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+void resamplerInit(resampler_t* resampler, resampler_quality_t quality, uint32_t outputRate)
+{
+  resampler->quality = (quality < RESAMPLER_QUALITY_COUNT) ? quality : RESAMPLER_QUALITY_HIGH;
+  resampler->taps = designs[resampler->quality].taps;
+  resampler->outputRate = outputRate;
+  resampler->inputRate = 0;
+
+  // Designed here, so changing the rate while playing only swaps the table: one for every rate up to the output
+  // rate and one for each MPEG rate over it, the closest ones first
+  memset(resampler->tables, 0, sizeof(resampler->tables));
+  designFilter(resampler, &resampler->tables[0], outputRate);
+  uint8_t count = 1;
+  for (uint8_t i = 0; (i < sizeof(mpegRates) / sizeof(mpegRates[0])) && (count < RESAMPLER_TABLES); i++)
+  {
+    if (mpegRates[i] > outputRate)
+    {
+      designFilter(resampler, &resampler->tables[count++], mpegRates[i]);
+    }
+  }
+
+  resamplerSetInputRate(resampler, outputRate);
+  resamplerReset(resampler);
+}
+
+void resamplerReset(resampler_t* resampler)
+{
+  // Silence before the first sample, the first output sample is at the first input sample
+  uint32_t history = resampler->taps / 2 - 1;
+  memset(resampler->buffer, 0, history * sizeof(int16_t));
+  resampler->count = history;
+  resampler->index = history;
+  resampler->fraction = 0;
+}
+
+void resamplerSetInputRate(resampler_t* resampler, uint32_t inputRate)
+{
+  if (inputRate && (inputRate != resampler->inputRate))
+  {
+    uint64_t step = ((uint64_t)inputRate << 32) / resampler->outputRate;
+    resampler->inputRate = inputRate;
+    resampler->stepInteger = (uint32_t)(step >> 32);
+    resampler->stepFraction = (uint32_t)step;
+    resampler->bypass = (inputRate == resampler->outputRate);
+
+    uint32_t rate = (inputRate > resampler->outputRate) ? inputRate : resampler->outputRate;
+    resampler_table_t* table = NULL;
+    for (uint8_t i = 0; (i < RESAMPLER_TABLES) && (table == NULL); i++)
+    {
+      table = (resampler->tables[i].rate == rate) ? &resampler->tables[i] : NULL;
+    }
+    if (table == NULL)
+    {
+      // Not an MPEG rate, or more rates over the output rate than tables, the last one is designed again
+      table = &resampler->tables[RESAMPLER_TABLES - 1];
+      designFilter(resampler, table, rate);
+    }
+    resampler->coefficients = table->coefficients;
+  }
+}
+
+uint32_t resamplerProcess(resampler_t* resampler, const int16_t* input, uint32_t inputCount,
+                          int16_t* output, uint32_t outputCount, uint32_t* consumed)
+{
+  uint32_t half = resampler->taps / 2;
+  uint32_t produced = 0;
+  uint32_t used = 0;
+  bool running = true;
+
+  while ((produced < outputCount) && running)
+  {
+    if (resampler->index + half < resampler->count)
+    {
+      if (resampler->bypass)
+      {
+        // The samples with a whole window go out as they are
+        uint32_t samples = resampler->count - half - resampler->index;
+        samples = (samples < outputCount - produced) ? samples : (outputCount - produced);
+        memcpy(output + produced, resampler->buffer + resampler->index, samples * sizeof(int16_t));
+        resampler->index += samples;
+        produced += samples;
+      }
+      else
+      {
+        // Output samples while their window is in the buffer
+        uint32_t end = resampler->count - half;
+        uint32_t index = resampler->index;
+        uint32_t fraction = resampler->fraction;
+        while ((index < end) && (produced < outputCount))
+        {
+          output[produced++] = filterSample(resampler, resampler->buffer + index - (half - 1), fraction);
+          uint32_t next = fraction + resampler->stepFraction;
+          index += resampler->stepInteger + (next < fraction);
+          fraction = next;
+        }
+        resampler->index = index;
+        resampler->fraction = fraction;
+      }
+    }
+    else
+    {
+      uint32_t taken = refill(resampler, input + used, inputCount - used);
+      used += taken;
+      running = (taken > 0);
+    }
+  }
+
+  *consumed = used;
+  return produced;
+}
+
+/*******************************************************************************
+ *******************************************************************************
+                        LOCAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+static void designFilter(const resampler_t* resampler, resampler_table_t* table, uint32_t rate)
+{
+  const resampler_design_t* design = &designs[resampler->quality];
+  uint32_t taps = design->taps;
+  int32_t half = taps / 2;
+
+  // Cycles per input sample, downsampling lowers it under the output Nyquist frequency
+  float cutoff = 0.5f * design->passband;
+  if (resampler->outputRate < rate)
+  {
+    cutoff = cutoff * resampler->outputRate / rate;
+  }
+  table->rate = rate;
+
+  for (uint32_t phase = 0; phase <= RESAMPLER_PHASES; phase++)
+  {
+    float row[RESAMPLER_MAX_TAPS];
+    float sum = 0;
+    float offset = (float)phase / RESAMPLER_PHASES;
+    for (uint32_t k = 0; k < taps; k++)
+    {
+      // Distance from the output sample to the input sample of this tap
+      float t = offset - ((int32_t)k - (half - 1));
+      float x = 2 * cutoff * t;
+      float sinc = (x == 0) ? 1.0f : (sinf(RESAMPLER_PI * x) / (RESAMPLER_PI * x));
+      row[k] = sinc * kaiser(t / half, design->beta);
+      sum += row[k];
+    }
+
+    // The rounding error goes to the tap closest to the output sample, so the gain at DC is exactly one
+    int16_t* coefficients = table->coefficients + phase * taps;
+    int32_t total = 0;
+    for (uint32_t k = 0; k < taps; k++)
+    {
+      int32_t coefficient = (int32_t)lrintf(row[k] / sum * 32768);
+      coefficients[k] = (int16_t)((coefficient > INT16_MAX) ? INT16_MAX : coefficient);
+      total += coefficients[k];
+    }
+    uint32_t centre = (phase * 2 < RESAMPLER_PHASES) ? (half - 1) : half;
+    int32_t corrected = coefficients[centre] + (32768 - total);
+    coefficients[centre] = (int16_t)((corrected > INT16_MAX) ? INT16_MAX : corrected);
+  }
+}
+
+static float kaiser(float position, float beta)
+{
+  float window = 0;
+  if ((position >= -1.0f) && (position <= 1.0f))
+  {
+    window = besselI0(beta * sqrtf(1.0f - position * position)) / besselI0(beta);
+  }
+  return window;
+}
+
+static float besselI0(float x)
+{
+  float sum = 1.0f;
+  float term = 1.0f;
+  for (uint32_t k = 1; k < BESSEL_TERMS; k++)
+  {
+    term *= (x / (2.0f * k)) * (x / (2.0f * k));
+    sum += term;
+  }
+  return sum;
+}
+
+static inline int16_t filterSample(const resampler_t* resampler, const int16_t* window, uint32_t fraction)
+{
+  uint32_t phase = fraction >> (32 - RESAMPLER_PHASE_BITS);
+  int32_t weight = (int32_t)((fraction >> (32 - RESAMPLER_PHASE_BITS - 15)) & 0x7FFF);
+  const int16_t* first = resampler->coefficients + phase * resampler->taps;
+  const int16_t* second = first + resampler->taps;
+  int32_t firstSum = 0;
+  int32_t secondSum = 0;
+
+#ifdef RESAMPLER_CM4
+  // Two taps per dual multiply-accumulate, the window is not word aligned but the M4 loads it anyway
+  for (uint32_t k = 0; k < resampler->taps; k += 2)
+  {
+    uint32_t samples, firstPair, secondPair;
+    memcpy(&samples, window + k, sizeof(samples));
+    memcpy(&firstPair, first + k, sizeof(firstPair));
+    memcpy(&secondPair, second + k, sizeof(secondPair));
+    firstSum = (int32_t)__SMLAD(samples, firstPair, (uint32_t)firstSum);
+    secondSum = (int32_t)__SMLAD(samples, secondPair, (uint32_t)secondSum);
+  }
+#else
+  for (uint32_t k = 0; k < resampler->taps; k++)
+  {
+    firstSum += window[k] * first[k];
+    secondSum += window[k] * second[k];
+  }
+#endif
+
+  // Both Q15 results are interpolated with the Q15 fraction between their phases
+  int64_t value = (int64_t)firstSum * (32768 - weight) + (int64_t)secondSum * weight + ((int64_t)1 << 29);
+  int32_t sample = (int32_t)(value >> 30);
+  return (int16_t)((sample > INT16_MAX) ? INT16_MAX : ((sample < INT16_MIN) ? INT16_MIN : sample));
+}
+
+static uint32_t refill(resampler_t* resampler, const int16_t* input, uint32_t inputCount)
+{
+  // Samples before the window of the next output sample are not needed any more
+  uint32_t first = resampler->index - (resampler->taps / 2 - 1);
+  uint32_t dropped = (first < resampler->count) ? first : resampler->count;
+  memmove(resampler->buffer, resampler->buffer + dropped, (resampler->count - dropped) * sizeof(int16_t));
+  resampler->count -= dropped;
+  resampler->index -= dropped;
+
+  uint32_t room = RESAMPLER_MAX_TAPS + RESAMPLER_CHUNK - resampler->count;
+  uint32_t taken = (inputCount < room) ? inputCount : room;
+  memcpy(resampler->buffer + resampler->count, input, taken * sizeof(int16_t));
+  resampler->count += taken;
+  return taken;
+}
+
+/******************************************************************************/
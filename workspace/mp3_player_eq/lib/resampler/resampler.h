@@ -0,0 +1,115 @@
+/*******************************************************************************
+  @file     resampler.h
+  @brief    Streaming fixed-point polyphase sample rate converter
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+#ifndef RESAMPLER_H_
+#define RESAMPLER_H_
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define RESAMPLER_MAX_TAPS          32                      // Taps of the highest quality
+#define RESAMPLER_PHASE_BITS        6
+#define RESAMPLER_PHASES            (1 << RESAMPLER_PHASE_BITS)  // Positions between two input samples with their own
+                                                                 // coefficients, the ones between them are interpolated
+#define RESAMPLER_CHUNK             256                     // Input samples taken into the window buffer at a time
+#define RESAMPLER_TABLES            2                       // Coefficient tables designed by resamplerInit, one for the
+                                                            // rates up to the output rate and one for 48 kHz to 44.1 kHz
+
+/*******************************************************************************
+ * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
+ ******************************************************************************/
+
+typedef enum {
+  RESAMPLER_QUALITY_LOW,      // 8 taps
+  RESAMPLER_QUALITY_MEDIUM,   // 16 taps
+  RESAMPLER_QUALITY_HIGH,     // 32 taps
+
+  RESAMPLER_QUALITY_COUNT
+} resampler_quality_t;
+
+// The coefficients only depend on the cutoff, which is the same for every input rate up to the output rate and
+// lower for each rate over it (the passband is kept under the output Nyquist frequency)
+typedef struct {
+  int16_t               coefficients[(RESAMPLER_PHASES + 1) * RESAMPLER_MAX_TAPS];  // Q15, one row per phase
+  uint32_t              rate;           // Higher of the input and output rates it was designed for, 0 if empty
+} resampler_table_t;
+
+// Each output sample is a dot product of the input window around its position with the coefficients of the two
+// closest phases, both results are interpolated with the fraction left between them. The position runs in input
+// samples, with a Q32 fraction, so any pair of rates is converted. Equal rates take the input as it is.
+typedef struct {
+  resampler_table_t     tables[RESAMPLER_TABLES];
+  const int16_t*        coefficients;   // Table of the current input rate
+  int16_t               buffer[RESAMPLER_MAX_TAPS + RESAMPLER_CHUNK];               // Input window
+  uint32_t              count;          // Samples in the buffer
+  uint32_t              index;          // Buffer index of the input sample at or before the next output sample
+  uint32_t              fraction;       // Q32 position of the next output sample after that input sample
+  uint32_t              stepInteger;    // Input samples per output sample, integer part
+  uint32_t              stepFraction;   // and Q32 fraction
+  uint32_t              inputRate;
+  uint32_t              outputRate;
+  resampler_quality_t   quality;
+  uint8_t               taps;
+  bool                  bypass;         // Same rates, the input goes out as it is
+} resampler_t;
+
+/*******************************************************************************
+ * VARIABLE PROTOTYPES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/**
+ * @brief Initializes a resampler, empty and with equal rates. The coefficients of every MPEG sample rate (and half
+ *        of them) are designed here, as many tables as RESAMPLER_TABLES holds.
+ * @param resampler   Pointer to the resampler
+ * @param quality     Quality, sets the taps and the passband
+ * @param outputRate  Output sample rate, in Hz
+ */
+void resamplerInit(resampler_t* resampler, resampler_quality_t quality, uint32_t outputRate);
+
+/**
+ * @brief Empties the input window, the next input sample is the first one of a new stream
+ * @param resampler   Pointer to the resampler
+ */
+void resamplerReset(resampler_t* resampler);
+
+/**
+ * @brief Changes the input sample rate, the samples in the window are converted at the new ratio. The
+ *        coefficients designed by resamplerInit are taken for it, only a rate without a table is designed here.
+ * @param resampler   Pointer to the resampler
+ * @param inputRate   Input sample rate, in Hz
+ */
+void resamplerSetInputRate(resampler_t* resampler, uint32_t inputRate);
+
+/**
+ * @brief Converts input samples until the output is full or the input runs out. The input samples that were
+ *        not consumed must be given again in the next call.
+ * @param resampler     Pointer to the resampler
+ * @param input         Pointer to the input samples, mono
+ * @param inputCount    Amount of input samples
+ * @param output        Pointer to where the output samples are saved
+ * @param outputCount   Room in the output, in samples
+ * @param consumed      Pointer to variable that will be updated with the input samples consumed
+ * @returns Amount of output samples
+ */
+uint32_t resamplerProcess(resampler_t* resampler, const int16_t* input, uint32_t inputCount,
+                          int16_t* output, uint32_t outputCount, uint32_t* consumed);
+
+/*******************************************************************************
+ ******************************************************************************/
+
+#endif /* RESAMPLER_H_ */
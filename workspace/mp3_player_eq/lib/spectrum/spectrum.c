@@ -0,0 +1,147 @@
+/*******************************************************************************
+  @file     spectrum.c
+  @brief    Rate-limited spectrum analyzer of the decoded audio, in bands for the LED matrix
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+#include <string.h>
+#include <math.h>
+
+#include "spectrum.h"
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define SPECTRUM_PI           3.14159265358979f
+#define SPECTRUM_FULL_SCALE   32768.0f                // Amplitude of a full scale sine
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES FOR PRIVATE FUNCTIONS WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+/**
+ * @brief Returns the first bin at or over a frequency, never the DC bin
+ * @param spectrum    Pointer to the analyzer
+ * @param frequency   Frequency, in Hz
+ */
+static uint32_t frequencyToBin(const spectrum_t* spectrum, float frequency);
+
+/*******************************************************************************
+ *******************************************************************************
+                        GLOBAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+void spectrumInit(spectrum_t* spectrum, uint32_t sampleRate, int16_t* history, uint16_t historySize)
+{
+  spectrum->history = history;
+  spectrum->historySize = historySize;
+  memset(spectrum->history, 0, historySize * sizeof(int16_t));
+  spectrum->writeIndex = 0;
+  spectrum->previous = 0;
+  spectrum->updated = false;
+  spectrum->sampleRate = sampleRate / SPECTRUM_DECIMATION;
+
+  float energy = 0;
+  for (uint32_t i = 0; i < SPECTRUM_FFT_SIZE; i++)
+  {
+    spectrum->window[i] = 0.5f - 0.5f * cosf(2 * SPECTRUM_PI * i / SPECTRUM_FFT_SIZE);
+    energy += spectrum->window[i] * spectrum->window[i];
+  }
+
+  // A sine of amplitude A leaves A^2 / 4 * N * energy in the positive bins
+  spectrum->scale = 4.0f / (SPECTRUM_FFT_SIZE * energy * SPECTRUM_FULL_SCALE * SPECTRUM_FULL_SCALE);
+
+  rfftInit(SPECTRUM_RFFT_SIZE);
+}
+
+void spectrumPush(spectrum_t* spectrum, const int16_t* samples, uint32_t count)
+{
+  // Only the samples that stay in the history are decimated
+  uint32_t first = 0;
+  if (count > spectrum->historySize * SPECTRUM_DECIMATION)
+  {
+    first = count - spectrum->historySize * SPECTRUM_DECIMATION;
+    spectrum->previous = samples[first - 1];
+  }
+
+  // 1 2 1 low-pass around each even sample, it attenuates what folds over the decimated band
+  int16_t previous = spectrum->previous;
+  uint16_t index = spectrum->writeIndex;
+  for (uint32_t i = first; i + 1 < count; i += SPECTRUM_DECIMATION)
+  {
+    spectrum->history[index] = (int16_t)((previous + 2 * samples[i] + samples[i + 1]) >> 2);
+    index = (index + 1 < spectrum->historySize) ? (index + 1) : 0;
+    previous = samples[i + 1];
+  }
+  spectrum->previous = previous;
+  spectrum->writeIndex = index;
+  spectrum->updated = true;
+}
+
+bool spectrumIsUpdated(const spectrum_t* spectrum)
+{
+  return spectrum->updated;
+}
+
+void spectrumCompute(spectrum_t* spectrum, uint32_t delay, const uint16_t* frequencies, float* levels, uint8_t bandCount)
+{
+  // The analysed samples end delay samples before the last pushed one, at most as far back as the history goes
+  uint32_t size = spectrum->historySize;
+  uint32_t behind = delay / SPECTRUM_DECIMATION;
+  behind = (behind < size - SPECTRUM_FFT_SIZE) ? behind : (size - SPECTRUM_FFT_SIZE);
+  uint32_t start = (spectrum->writeIndex + size - SPECTRUM_FFT_SIZE - behind) % size;
+  for (uint32_t i = 0; i < SPECTRUM_FFT_SIZE; i++)
+  {
+    spectrum->input[i] = spectrum->history[(start + i) % size];
+  }
+  spectrum->updated = false;
+
+  rfft(spectrum->input, spectrum->output, spectrum->window);
+  rfftGetMagSquared(spectrum->output, spectrum->output);
+
+  for (uint8_t band = 0; band < bandCount; band++)
+  {
+    // Edges at the geometric means with the neighbours, the outer bands are as wide as the next ones and a
+    // single band is an octave
+    float centre = frequencies[band];
+    float below = (band > 0) ? frequencies[band - 1] : ((bandCount > 1) ? centre * centre / frequencies[1] : centre / 2);
+    float above = (band + 1 < bandCount) ? frequencies[band + 1] : ((bandCount > 1) ? centre * centre / frequencies[band - 1] : centre * 2);
+    uint32_t first = frequencyToBin(spectrum, sqrtf(centre * below));
+    uint32_t last = frequencyToBin(spectrum, sqrtf(centre * above));
+    if (first >= last)
+    {
+      first = frequencyToBin(spectrum, centre);
+      last = first + 1;
+    }
+
+    float power = 0;
+    for (uint32_t bin = first; (bin < last) && (bin <= SPECTRUM_FFT_SIZE / 2); bin++)
+    {
+      power += spectrum->output[bin];
+    }
+
+    power *= spectrum->scale;
+    levels[band] = (power > 0) ? 10 * log10f(power) : SPECTRUM_FLOOR_DB;
+    levels[band] = (levels[band] > SPECTRUM_FLOOR_DB) ? levels[band] : SPECTRUM_FLOOR_DB;
+  }
+}
+
+/*******************************************************************************
+ *******************************************************************************
+                        LOCAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+static uint32_t frequencyToBin(const spectrum_t* spectrum, float frequency)
+{
+  uint32_t bin = (uint32_t)ceilf(frequency * SPECTRUM_FFT_SIZE / spectrum->sampleRate);
+  return (bin > 0) ? bin : 1;
+}
+
+/******************************************************************************/
@@ -0,0 +1,99 @@
+/*******************************************************************************
+  @file     spectrum.h
+  @brief    Rate-limited spectrum analyzer of the decoded audio, in bands for the LED matrix
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+#ifndef SPECTRUM_H_
+#define SPECTRUM_H_
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "drivers/MCAL/cfft/cfft.h"
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define SPECTRUM_FFT_SIZE           512                     // Decimated samples of each analysis
+#define SPECTRUM_RFFT_SIZE          CFFT_512
+#define SPECTRUM_DECIMATION         2                       // Input samples per analysed sample
+#define SPECTRUM_FLOOR_DB           (-96.0f)                // Lowest level of a band, in dBFS
+
+// Decimated samples of a history that can be analysed up to maxDelay input samples behind the last pushed one
+#define SPECTRUM_HISTORY_SIZE(maxDelay)   (SPECTRUM_FFT_SIZE + (maxDelay) / SPECTRUM_DECIMATION)
+
+/*******************************************************************************
+ * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
+ ******************************************************************************/
+
+// The audio path only pushes its blocks, which are low-pass filtered and decimated into a history. The analysis
+// runs apart, at the display rate, on the samples of the history being output at the time, which are behind the
+// pushed ones by the blocks waiting in the output ring: Hann window, real FFT and the power of the bins of each band.
+// A block longer than the history only pushes its last samples.
+typedef struct {
+  int16_t*    history;                              // Decimated samples, circular
+  uint16_t    historySize;
+  uint16_t    writeIndex;                           // Where the next decimated sample is saved
+  int16_t     previous;                             // Last odd input sample, for the decimation filter
+  bool        updated;                              // Samples were pushed since the last analysis
+  uint32_t    sampleRate;                           // Of the decimated samples, in Hz
+  float       window[SPECTRUM_FFT_SIZE];            // Hann window
+  float       scale;                                // Band power to squared amplitude of a full scale sine
+  float       input[SPECTRUM_FFT_SIZE];             // Samples, windowed by the real FFT
+  float       output[SPECTRUM_FFT_SIZE];            // Bins, then their power from DC to Nyquist
+} spectrum_t;
+
+/*******************************************************************************
+ * VARIABLE PROTOTYPES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/**
+ * @brief Initializes an analyzer with an empty (silent) history, on the buffer specified by user
+ * @param spectrum      Pointer to the analyzer
+ * @param sampleRate    Sample rate of the pushed samples, in Hz
+ * @param history       Pointer to the history buffer
+ * @param historySize   Samples of the history, SPECTRUM_HISTORY_SIZE of the longest delay of the analysis
+ */
+void spectrumInit(spectrum_t* spectrum, uint32_t sampleRate, int16_t* history, uint16_t historySize);
+
+/**
+ * @brief Decimates samples into the history, it is cheap enough to be called on every block of the audio path
+ * @param spectrum  Pointer to the analyzer
+ * @param samples   Pointer to the samples, mono
+ * @param count     Amount of samples, even
+ */
+void spectrumPush(spectrum_t* spectrum, const int16_t* samples, uint32_t count);
+
+/**
+ * @brief Returns whether samples were pushed since the last analysis
+ * @param spectrum  Pointer to the analyzer
+ */
+bool spectrumIsUpdated(const spectrum_t* spectrum);
+
+/**
+ * @brief Analyses the samples of the history that are delay input samples behind the last pushed one, or the oldest
+ *        ones for a longer delay. Each band takes the bins between the geometric means of its centre frequency and
+ *        the ones of its neighbours, at least one bin.
+ * @param spectrum      Pointer to the analyzer
+ * @param delay         Input samples pushed after the last analysed one, e.g. the ones waiting to be output
+ * @param frequencies   Pointer to the centre frequencies of the bands, in Hz and ascending
+ * @param levels        Pointer to where the level of each band is saved, in dB relative to a full scale sine and
+ *                      not under SPECTRUM_FLOOR_DB
+ * @param bandCount     Amount of bands
+ */
+void spectrumCompute(spectrum_t* spectrum, uint32_t delay, const uint16_t* frequencies, float* levels, uint8_t bandCount);
+
+/*******************************************************************************
+ ******************************************************************************/
+
+#endif /* SPECTRUM_H_ */
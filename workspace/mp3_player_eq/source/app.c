@@ -61,6 +61,9 @@ void appRun (void)
 		uiRun(event);
 		audioRun(event);
 	}
+
+	// Decode whenever there is space in the output ring, between the events
+	audioFill();
 }
 
 /*******************************************************************************
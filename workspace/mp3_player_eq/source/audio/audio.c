@@ -10,6 +10,7 @@
 
 #include "board/board.h"
 #include "audio.h"
+#include "MK64F12.h"
 
 #include <stdbool.h>
 #include <string.h>
@@ -18,11 +19,14 @@
 #include "drivers/HAL/HD44780_LCD/HD44780_LCD.h"
 #include "drivers/MCAL/equaliser/equaliser_iir.h"
 #include "drivers/MCAL/dac_dma/dac_dma.h"
-#include "drivers/MCAL/cfft/cfft.h"
 #include "drivers/HAL/timer/timer.h"
 #include "drivers/MCAL/gpio/gpio.h"
 
 #include "lib/mp3decoder/mp3decoder.h"
+#include "lib/pcm_ring/pcm_ring.h"
+#include "lib/output_stage/output_stage.h"
+#include "lib/resampler/resampler.h"
+#include "lib/spectrum/spectrum.h"
 #include "lib/vumeter/vumeter.h"
 #include "lib/fatfs/ff.h"
 #include "display/display.h"
@@ -31,24 +35,37 @@
  * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
  ******************************************************************************/
 
-#define AUDIO_PROCESSING_RETRIES        		(10)
 #define AUDIO_STRING_BUFFER_SIZE        		(128)
 #define AUDIO_LCD_FPS_MS                		(200)
 #define AUDIO_LCD_ROTATION_TIME_MS  	  		(350)
 #define AUDIO_LCD_LINE_NUMBER       	  		(0)
-#define AUDIO_FRAME_SIZE 				            (4096)
-#define AUDIO_FULL_SCALE 				            (82e3)
-#define AUDIO_DEFAULT_SAMPLE_RATE       		(44100)
+#define AUDIO_SPECTRUM_RANGE_DB             (48)      // Levels shown by the LED matrix columns, under a full scale sine
+#define AUDIO_OUTPUT_RATE               		(44100)   // DAC rate, every song is resampled to it
+#define AUDIO_RESAMPLER_QUALITY             (RESAMPLER_QUALITY_HIGH)
+#define AUDIO_INPUT_SIZE                    (1152)    // Decoded samples taken by the resampler at a time
 #define AUDIO_MAX_FILENAME_LEN          		(128)
-#define AUDIO_BUFFER_COUNT              		(2)
+#define AUDIO_BUFFER_COUNT              		(4)       // Blocks of the output ring
+#define AUDIO_RING_LOW_WATERMARK            (1)       // Fills every free block at or under this level
+#define AUDIO_RING_HIGH_WATERMARK           (3)       // Slow work (prefetch) only at or over this level
 #define AUDIO_BUFFER_SIZE               		(4096)
 #define AUDIO_FLOAT_MAX                 		(1)
-#define AUDIO_MAX_VOLUME                    (100)
+#define AUDIO_MAX_VOLUME                    (OUTPUT_STAGE_MAX_VOLUME)
+#define AUDIO_OUTPUT_SHIFT                  (19)      // Decoded samples to DAC codes, 16 to 12 bits
+#define AUDIO_EQ_OUTPUT_SHIFT               (14)      // Equalised samples to DAC codes, with the makeup gain
+#define AUDIO_EQ_MAKEUP_GAIN                (25000)   // Q15, 5e4 / 32768 DAC steps per equaliser output step
 #define AUDIO_VOLUME_DURATION_MS            (2000)
+#define AUDIO_VOLUME_RAMP_MS                (20)      // Volume, mute and equaliser gain changes fade over this time
+#define AUDIO_DECODER_COUNT                 (2)
+#define AUDIO_PREFETCH_MS                   (5000)
+#define AUDIO_LOAD_HIGH_PERCENT             (85)      // Decodes in half rate above this CPU load
+#define AUDIO_LOAD_LOW_PERCENT              (40)      // Back to full rate below this load, measured in half rate
+#define AUDIO_LOAD_SMOOTHING                (4)       // Blocks averaged by the load monitor
 
 #define AUDIO_ENABLE_FFT
 #define AUDIO_ENABLE_EQ
+#define AUDIO_ENABLE_DITHER
 #define AUDIO_DEBUG_MODE
+#define AUDIO_LOAD_MONITOR
 
 /*******************************************************************************
  * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
@@ -76,29 +93,51 @@ typedef struct {
   uint32_t                  currentIndex;                     		// Index of the current file in the directory
   audio_state_t             currentState;                     		// State of current audio
 
-  // Audio output buffer
+  // Audio output ring, the DMA outputs its blocks in place
   uint16_t                  audioBuffer[AUDIO_BUFFER_COUNT][AUDIO_BUFFER_SIZE];
+  pcm_ring_t                ring;
+  bool                      draining;         // The last song ended, the DAC stops when the ring is empty
 
   // Display data
   struct {
     pixel_t                 displayMatrix[DISPLAY_COL_SIZE][DISPLAY_COL_SIZE];
     float                   colValues[DISPLAY_COL_SIZE];
+    spectrum_t              spectrum;         // Analyzer of the decoded blocks
+    int16_t                 spectrumHistory[SPECTRUM_HISTORY_SIZE(AUDIO_BUFFER_COUNT * AUDIO_BUFFER_SIZE)];   // As deep as the ring
+    volatile bool           frameDue;         // The display period elapsed, a new spectrum is shown
   } display;
   
   // MP3 data
   struct {
+    mp3decoder_storage_t      storage[AUDIO_DECODER_COUNT];   // Storage of the decoder instances
+    mp3decoder_t*             decoder;                        // Decoder of the song being played
+    mp3decoder_t*             nextDecoder;                    // Decoder where the next song is prefetched
     mp3decoder_tag_data_t     tagData;
     mp3decoder_frame_data_t   frameData;              
-    uint32_t                  sampleRate;        
-    int16_t                   buffer[MP3_DECODED_BUFFER_SIZE + 2 * AUDIO_BUFFER_SIZE];  
-    uint16_t                  samples;       
+    uint32_t                  sampleRate;                     // Of the song being decoded
+    int16_t                   input[AUDIO_INPUT_SIZE];        // Decoded samples, at the rate of the song
+    uint16_t                  inputStart;                     // First sample not resampled yet
+    uint16_t                  inputCount;                     // Samples not resampled yet
+    resampler_t               resampler;                      // From the rate of the song to the DAC rate
+    int16_t                   buffer[AUDIO_BUFFER_SIZE];      // Decoded block at the DAC rate, mono
   } mp3;      
-  
- struct {
-   float32_t input[AUDIO_FRAME_SIZE * 2];
-   float32_t output[AUDIO_FRAME_SIZE * 2];
- } fft;
 
+  // Next song prefetch
+  struct {
+    bool                      requested;                      // The prefetch was already tried for the current song
+    bool                      ready;                          // The next song is loaded in the next decoder
+    char                      file[AUDIO_MAX_FILENAME_LEN];   // Filename of the next song
+    mp3decoder_tag_data_t     tagData;
+    mp3decoder_frame_data_t   frameData;
+  } prefetch;
+
+  // CPU load monitor
+  struct {
+    uint32_t                  percent;                        // Share of the block period spent processing, averaged
+    mp3decoder_quality_t      quality;                        // Decoding quality of both decoders
+    mp3decoder_quality_t      nextQuality;                    // Quality picked by the monitor for the next block
+  } load;
+  
  struct {
 	 q15_t input[AUDIO_BUFFER_SIZE];
    q15_t output[AUDIO_BUFFER_SIZE];
@@ -107,6 +146,7 @@ typedef struct {
   // Volume and message buffers
   uint8_t volume;
   bool    mute;
+  output_stage_t  output;     // Volume and conversion of the samples to DAC codes
   char    volumeBuffer[AUDIO_STRING_BUFFER_SIZE];
   char    messageBuffer[AUDIO_STRING_BUFFER_SIZE];
   tim_id_t  volumeTimer;
@@ -165,6 +205,30 @@ static void audioSetState(audio_state_t state);
  */
 static void audioProcess(uint16_t* frame);
 
+/**
+ * @brief Fills free blocks of the output ring while playing
+ * @param prefill True to fill up to the high watermark, otherwise one block, or every free block if the ring is low
+ */
+static void audioFillRing(bool prefill);
+
+/**
+ * @brief Drops the blocks queued in the output ring, fills it with the current song and starts the DAC at its rate
+ */
+static void audioRestart(void);
+
+/**
+ * @brief Updates the CPU load with the time spent processing a block, and picks the decoding
+ *        quality of the next block: half rate when the block period is about to be exceeded
+ * @param cycles  Core clock cycles spent processing the block
+ */
+static void audioUpdateLoad(uint32_t cycles);
+
+/**
+ * @brief Sets the decoding quality of both decoders. The resampler takes the new rate, the DAC one does not change.
+ * @param quality New decoding quality
+ */
+static void audioSetQuality(mp3decoder_quality_t quality);
+
 /**
  * @brief Audio set the current string.
  * @param message New message
@@ -176,6 +240,17 @@ static void audioSetDisplayString(const char* message);
  */
 static void audioLcdUpdate(void);
 
+/**
+ * @brief Callback of the display period, requests a new spectrum.
+ */
+static void audioSpectrumTick(void);
+
+/**
+ * @brief Analyses the latest decoded samples and shows them in the matrix when a frame is due, unless the
+ *        output ring needs to be filled first.
+ */
+static void audioUpdateSpectrum(void);
+
 /**
  * @brief Fills matrix with colValues
  */
@@ -193,6 +268,25 @@ static bool audioPlay(const char* file, uint8_t index);
  */
 static bool audioPlayNext(void);
 
+/**
+ * @brief Finds the next audio file in the directory.
+ * @param file    Pointer to the file info to be filled
+ * @returns True if there is a next file
+ */
+static bool audioGetNextFile(FILINFO* file);
+
+/**
+ * @brief Loads the next audio file in the spare decoder and decodes its first frame.
+ */
+static void audioPrefetchNext(void);
+
+/**
+ * @brief Switches to the decoder of the next audio file, prefetching it first if needed.
+ *        The DAC keeps running, a new sample rate applies from the block being filled.
+ * @returns True if there was a next file
+ */
+static bool audioSwitchNext(void);
+
 /**
  * @brief Play the previous audio file in the directory.
  */
@@ -212,9 +306,8 @@ void  onVolumeTimeout(void);
  * ROM CONST VARIABLES WITH FILE LEVEL SCOPE
  ******************************************************************************/
  
-// Mapping the FFT bin to the led matrix columns, according to the equaliser band-pass frequency.                   
-//                                        80Hz    150Hz   330Hz   680Hz     1,2kHz    3,9kHz    12kHz     18kHz
-static const uint32_t FFT_COLUMN_BIN[] = { 2 * 4,      8 * 4,      16 * 4,       28 * 4,		56 * 4,       91 * 4,       180 * 4,		350*4};
+// Centre frequencies of the led matrix columns, in Hz. Octave bands, the analyzer goes up to a quarter of the DAC rate.
+static const uint16_t SPECTRUM_COLUMN_FREQUENCY[DISPLAY_COL_SIZE] = { 63, 125, 250, 500, 1000, 2000, 4000, 8000 };
 
 /*******************************************************************************
  * STATIC VARIABLES AND CONST VARIABLES WITH FILE LEVEL SCOPE
@@ -222,7 +315,6 @@ static const uint32_t FFT_COLUMN_BIN[] = { 2 * 4,      8 * 4,      16 * 4,
 
 static audio_context_t  context;
 static const pixel_t    clearPixel = {0,0,0};
-static float32_t        filterOutputF32[AUDIO_FRAME_SIZE];
 
 /*******************************************************************************
  *******************************************************************************
@@ -247,6 +339,10 @@ void audioInit(void)
     context.currentState = AUDIO_STATE_IDLE;
     context.volume = AUDIO_MAX_VOLUME / 2;
     context.mute = false;
+    outputStageInit(&context.output);
+#ifdef AUDIO_ENABLE_DITHER
+    outputStageSetDither(&context.output, true);
+#endif
 
     // Request timer for volume control
     context.volumeTimer = timerGetId();
@@ -254,20 +350,37 @@ void audioInit(void)
     // Initialization of the timer
     timerStart(timerGetId(), TIMER_MS2TICKS(AUDIO_LCD_FPS_MS), TIM_MODE_PERIODIC, audioLcdUpdate);
 
-    // FFT initialization
-    cfftInit(CFFT_4096);
+    // Spectrum analyzer, decoupled from the audio path and shown at the display rate
+    spectrumInit(&context.display.spectrum, AUDIO_OUTPUT_RATE, context.display.spectrumHistory,
+                 sizeof(context.display.spectrumHistory) / sizeof(context.display.spectrumHistory[0]));
+    timerStart(timerGetId(), TIMER_MS2TICKS(DISPLAY_FPS_MS), TIM_MODE_PERIODIC, audioSpectrumTick);
     
-    // MP3 Decoder init
-    MP3DecoderInit();
+    // MP3 Decoder init, one instance plays the current song while the other one prefetches the next
+    context.mp3.decoder = MP3DecoderCreateStatic(&context.mp3.storage[0]);
+    context.mp3.nextDecoder = MP3DecoderCreateStatic(&context.mp3.storage[1]);
+
+    // The DAC is mono, stereo songs are downmixed by the decoder before the synthesis filterbank
+    MP3DecoderSetOutputMode(context.mp3.decoder, MP3DECODER_OUTPUT_MONO);
+    MP3DecoderSetOutputMode(context.mp3.nextDecoder, MP3DECODER_OUTPUT_MONO);
 
     // DAC DMA init
     dacdmaInit();
-    dacdmaSetBuffers(context.audioBuffer[0], context.audioBuffer[1], AUDIO_BUFFER_SIZE);
-    dacdmaSetFreq(AUDIO_DEFAULT_SAMPLE_RATE);
+    pcmRingInit(&context.ring, context.audioBuffer[0], AUDIO_BUFFER_SIZE, AUDIO_BUFFER_COUNT, AUDIO_RING_LOW_WATERMARK, AUDIO_RING_HIGH_WATERMARK);
+    dacdmaSetRing(&context.ring);
+    dacdmaSetFreq(AUDIO_OUTPUT_RATE);
+    resamplerInit(&context.mp3.resampler, AUDIO_RESAMPLER_QUALITY, AUDIO_OUTPUT_RATE);
 
 #ifdef AUDIO_DEBUG_MODE
     gpioMode(PIN_PROCESSING, OUTPUT);
 #endif
+
+#ifdef AUDIO_LOAD_MONITOR
+    // The load is measured with the cycle counter of the core
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    context.load.quality = MP3DECODER_QUALITY_FULL;
+    context.load.nextQuality = MP3DECODER_QUALITY_FULL;
+#endif
   }
 }
 
@@ -305,6 +418,31 @@ void audioRun(event_t event)
   }
 }
 
+void audioFill(void)
+{
+  audioFillRing(false);
+  audioUpdateSpectrum();
+
+  // Load the next song during the last seconds of the current one, or right away if the duration is unknown.
+  // The SD is slow, so it waits until the ring is well ahead of the DAC.
+  if (!context.prefetch.requested && (context.currentState == AUDIO_STATE_PLAYING) && pcmRingIsHigh(&context.ring))
+  {
+    uint32_t duration = MP3DecoderGetDuration(context.mp3.decoder);
+    uint32_t position = MP3DecoderGetPosition(context.mp3.decoder);
+    if (duration < position + AUDIO_PREFETCH_MS)
+    {
+      audioPrefetchNext();
+    }
+  }
+
+  // The end of the last song was output
+  if (context.draining && (pcmRingLevel(&context.ring) == 0))
+  {
+    context.draining = false;
+    dacdmaStop();
+  }
+}
+
 void audioSetFolder(const char* path, const char* file, uint8_t index)
 {
   strcpy(context.currentPath, path);
@@ -331,30 +469,30 @@ static bool audioPlay(const char* file, uint8_t index)
   strcpy(context.currentFile, file);
   context.currentIndex = index;
 
+  // The prefetched song is no longer the next one
+  context.prefetch.requested = false;
+  context.prefetch.ready = false;
+
   // Load MP3 File
   sprintf(context.filePath, "%s/%s", context.currentPath, file);
-  if (MP3LoadFile(context.filePath))
+  if (MP3DecoderLoadFile(context.mp3.decoder, context.filePath))
   {
-	// Variable initialization
-    context.mp3.samples = 0;
-
     // Read ID3 tag if present
-    if (!MP3GetTagData(&(context.mp3.tagData)) || !strlen((char*) context.mp3.tagData.title))
+    if (!MP3DecoderGetTagData(context.mp3.decoder, &(context.mp3.tagData)) || !strlen((char*) context.mp3.tagData.title))
     {
       // If not, title will be filename 
       strcpy((char*) context.mp3.tagData.title, file);
     }
 
     // Get sample rate 
-    if (MP3GetNextFrameData(&context.mp3.frameData))
+    if (MP3DecoderGetNextFrameData(context.mp3.decoder, &context.mp3.frameData))
     {
       context.mp3.sampleRate = context.mp3.frameData.sampleRate; 
-      dacdmaSetFreq(context.mp3.sampleRate);
     }
 
     // Start sound reproduction
+    audioRestart();
     showFileTag();
-    dacdmaStart();
     success = true;
   }
   
@@ -362,9 +500,20 @@ static bool audioPlay(const char* file, uint8_t index)
 }
 
 static bool audioPlayNext(void)
+{
+  // The blocks of the previous song queued in the ring are skipped too
+  bool success = audioSwitchNext();
+  if (success)
+  {
+    audioRestart();
+    showFileTag();
+  }
+  return success;
+}
+
+static bool audioGetNextFile(FILINFO* file)
 {
   bool success = false;
-  FILINFO file;
   FRESULT fr;
   DIR dir;
   if (context.currentPath)
@@ -374,17 +523,13 @@ static bool audioPlayNext(void)
     {
       for (uint32_t i = 0 ; (i <= context.currentIndex) && (fr == FR_OK) ; i++)
       {  
-        fr = f_readdir(&dir, &file);
+        fr = f_readdir(&dir, file);
       }
       if (fr == FR_OK)
       {
-        if (file.fname[0])
+        if (file->fname[0])
         {
-          if (strcmp(file.fname, context.currentFile))
-          {
-            dacdmaStop();
-            success = audioPlay(file.fname, context.currentIndex + 1);
-          }
+          success = strcmp(file->fname, context.currentFile) != 0;
         }
       }
     }
@@ -393,6 +538,66 @@ static bool audioPlayNext(void)
   return success;
 }
 
+static void audioPrefetchNext(void)
+{
+  FILINFO file;
+  char filePath[AUDIO_MAX_FILENAME_LEN];
+
+  context.prefetch.requested = true;
+  context.prefetch.ready = false;
+  if (audioGetNextFile(&file))
+  {
+    sprintf(filePath, "%s/%s", context.currentPath, file.fname);
+    if (MP3DecoderLoadFile(context.mp3.nextDecoder, filePath) && MP3DecoderGetNextFrameData(context.mp3.nextDecoder, &context.prefetch.frameData))
+    {
+      if (!MP3DecoderGetTagData(context.mp3.nextDecoder, &(context.prefetch.tagData)) || !strlen((char*) context.prefetch.tagData.title))
+      {
+        strcpy((char*) context.prefetch.tagData.title, file.fname);
+      }
+
+      // Decode the first frame, so the switch does not have to wait for the decoder either
+      uint16_t samples, channels;
+      MP3DecoderDecodeSamples(context.mp3.nextDecoder, NULL, 0, &samples, &channels);
+      strcpy(context.prefetch.file, file.fname);
+      context.prefetch.ready = true;
+    }
+  }
+}
+
+static bool audioSwitchNext(void)
+{
+  bool success = false;
+
+  if (!context.prefetch.ready)
+  {
+    audioPrefetchNext();
+  }
+
+  if (context.prefetch.ready)
+  {
+    // Swap the decoders, the current one will prefetch the song after the next
+    mp3decoder_t* decoder = context.mp3.decoder;
+    context.mp3.decoder = context.mp3.nextDecoder;
+    context.mp3.nextDecoder = decoder;
+    context.prefetch.requested = false;
+    context.prefetch.ready = false;
+
+    strcpy(context.currentFile, context.prefetch.file);
+    context.currentIndex++;
+    context.mp3.tagData = context.prefetch.tagData;
+    context.mp3.frameData = context.prefetch.frameData;
+
+    // The DAC keeps its rate, the resampler converts from the rate of the next song
+    context.mp3.sampleRate = context.mp3.frameData.sampleRate;
+    resamplerSetInputRate(&context.mp3.resampler, context.mp3.sampleRate);
+
+    showFileTag();
+    success = true;
+  }
+
+  return success;
+}
+
 static bool audioPlayPrevious(void)
 {
   bool success = false;
@@ -458,7 +663,7 @@ static void audioRunPlaying(event_t event)
       break;
 
     case EVENTS_FRAME_FINISHED:
-      audioProcess(event.data.frame);
+      audioFill();
       break;
 
     default:
@@ -596,6 +801,34 @@ static void audioSetDisplayString(const char* message)
   context.messageChanged = true;
 }
 
+static void audioSpectrumTick(void)
+{
+  context.display.frameDue = true;
+}
+
+static void audioUpdateSpectrum(void)
+{
+  // A frame that finds the ring low waits for the next pass of the main loop, the refill goes first
+  if (context.display.frameDue && spectrumIsUpdated(&context.display.spectrum) && !pcmRingIsLow(&context.ring))
+  {
+    context.display.frameDue = false;
+
+    // The blocks are pushed when they are decoded, the ones in the ring are not heard yet. The oldest one is being
+    // output, about halfway through it.
+    uint32_t level = pcmRingLevel(&context.ring);
+    uint32_t delay = level ? (level * AUDIO_BUFFER_SIZE - AUDIO_BUFFER_SIZE / 2) : 0;
+    spectrumCompute(&context.display.spectrum, delay, SPECTRUM_COLUMN_FREQUENCY, context.display.colValues, DISPLAY_COL_SIZE);
+
+    // From dB to the height of each column, the matrix shows the top of the range
+    for (uint32_t i = 0; i < DISPLAY_COL_SIZE; i++)
+    {
+      float value = context.display.colValues[i] + AUDIO_SPECTRUM_RANGE_DB;
+      context.display.colValues[i] = (value < 0) ? 0 : ((value > AUDIO_SPECTRUM_RANGE_DB) ? AUDIO_SPECTRUM_RANGE_DB : value);
+    }
+    audioFillMatrix();
+  }
+}
+
 static void audioFillMatrix(void)
 {
   for(int i = 0; i < DISPLAY_COL_SIZE; i++)
@@ -605,48 +838,73 @@ static void audioFillMatrix(void)
       context.display.displayMatrix[i][j] = clearPixel;
     }
   }
-  vumeterMultiple((pixel_t*)context.display.displayMatrix, context.display.colValues, DISPLAY_COL_SIZE, AUDIO_FULL_SCALE, BAR_MODE + LINEAR_MODE);
+  vumeterMultiple((pixel_t*)context.display.displayMatrix, context.display.colValues, DISPLAY_COL_SIZE, AUDIO_SPECTRUM_RANGE_DB, BAR_MODE + LINEAR_MODE);
   displayFlip((ws2812_pixel_t*)context.display.displayMatrix);
 }
 
 void audioProcess(uint16_t* frame)
 {
-  uint16_t attempts = AUDIO_PROCESSING_RETRIES;
-  uint16_t sampleCount;
-  uint16_t channelCount = 1;
+  uint16_t sampleCount = 0;                 // Samples in the block, at the DAC rate
+  uint16_t count;
+  uint16_t channels;
   mp3decoder_result_t mp3Res = MP3DECODER_NO_ERROR;
-  mp3decoder_frame_data_t frameData;
 
 #ifdef AUDIO_DEBUG_MODE
     gpioWrite(PIN_PROCESSING, HIGH);
 #endif
 
-  // Get number of channels in next mp3 frame
-  if (MP3GetNextFrameData(&frameData))
-  {
-    channelCount = frameData.channelCount;
-  }
+#ifdef AUDIO_LOAD_MONITOR
+  uint32_t startCycles = DWT->CYCCNT;
+#endif
 
-  while ((context.mp3.samples < channelCount * AUDIO_BUFFER_SIZE) && attempts && (mp3Res == MP3DECODER_NO_ERROR))
+  while ((sampleCount < AUDIO_BUFFER_SIZE) && (mp3Res == MP3DECODER_NO_ERROR))
   {
-    // Decode next frame (STEREO output)
-    mp3Res = MP3GetDecodedFrame(context.mp3.buffer + context.mp3.samples, MP3_DECODED_BUFFER_SIZE, &sampleCount);
-
-    if (mp3Res == MP3DECODER_NO_ERROR)
+    // Decode at the rate of the song when the resampler took every decoded sample, the decoder keeps the ones
+    // that do not fit
+    if (context.mp3.inputCount == 0)
     {
-      // Update sample count
-      context.mp3.samples += sampleCount;
-    }
-    else if (mp3Res == MP3DECODER_FILE_END)
-    {
-      // Raise file end flag
-      audioSetState(AUDIO_STATE_FINISHED);
-      dacdmaStop();
+      uint16_t request = AUDIO_INPUT_SIZE;
+#ifdef AUDIO_LOAD_MONITOR
+      // Only switched once every sample decoded at the previous quality was resampled, both the ones taken from
+      // the decoder and the ones it still keeps from its last frame, which are taken alone first
+      if (context.load.nextQuality != context.load.quality)
+      {
+        uint16_t pending = MP3DecoderGetPendingSamples(context.mp3.decoder);
+        if (pending == 0)
+        {
+          audioSetQuality(context.load.nextQuality);
+        }
+        else
+        {
+          request = pending;
+        }
+      }
+#endif
+      mp3Res = MP3DecoderDecodeSamples(context.mp3.decoder, context.mp3.input, request, &count, &channels);
+      context.mp3.inputStart = 0;
+      context.mp3.inputCount = count;
     }
-    else
+
+    uint32_t consumed;
+    sampleCount += resamplerProcess(&context.mp3.resampler, context.mp3.input + context.mp3.inputStart, context.mp3.inputCount,
+                                    context.mp3.buffer + sampleCount, AUDIO_BUFFER_SIZE - sampleCount, &consumed);
+    context.mp3.inputStart += consumed;
+    context.mp3.inputCount -= consumed;
+
+    if ((mp3Res == MP3DECODER_FILE_END) && (context.mp3.inputCount == 0))
     {
-      // Verify the amount of retries
-      attempts--;
+      // Keep filling the block with the first samples of the next file, the decoder already removed the encoder
+      // delay and padding and the resampler takes the new rate, so there is no gap between both songs
+      if (audioSwitchNext())
+      {
+        mp3Res = MP3DECODER_NO_ERROR;
+      }
+      else
+      {
+        // Raise file end flag, the blocks in the ring are output before stopping the DAC
+        audioSetState(AUDIO_STATE_FINISHED);
+        context.draining = true;
+      }
     }
   }
 
@@ -654,64 +912,117 @@ void audioProcess(uint16_t* frame)
   gpioWrite(PIN_PROCESSING, LOW);
 #endif
 
+  // Pad with silence when the decoder could not fill the block
+  if (sampleCount < AUDIO_BUFFER_SIZE)
+  {
+    memset(context.mp3.buffer + sampleCount, 0, (AUDIO_BUFFER_SIZE - sampleCount) * sizeof(int16_t));
+  }
+
   // Data conditioning for next stage
   #ifdef AUDIO_ENABLE_EQ
   if (context.eqEnabled)
   {
     for (uint16_t i = 0; i < AUDIO_BUFFER_SIZE; i++)
     {
-      context.eq.input[i] = (uint16_t)context.mp3.buffer[channelCount * i];
+      context.eq.input[i] = (uint16_t)context.mp3.buffer[i];
       context.eq.output[i] = 0;
     }  
     // Equalising
     eqIirFilterFrame(context.eq.input, context.eq.output);
-    arm_q15_to_float(context.eq.output, filterOutputF32, AUDIO_FRAME_SIZE);
   }
   #endif
 
   #ifdef AUDIO_ENABLE_FFT
-  // Computing FFT
-  for (uint32_t i = 0; i < AUDIO_BUFFER_SIZE; i++)
+  // Only decimated into the analyzer history, the spectrum is computed at the display rate
+  spectrumPush(&context.display.spectrum, context.mp3.buffer, AUDIO_BUFFER_SIZE);
+  #endif
+
+  // Write samples to output buffer, the DAC output is unsigned, mono and 12 bit long
+  uint8_t volume = context.mute ? 0 : context.volume;
+  outputStageSetRamp(&context.output, AUDIO_VOLUME_RAMP_MS, AUDIO_OUTPUT_RATE);
+#ifdef AUDIO_ENABLE_EQ
+  if (context.eqEnabled)
   {
-    context.fft.input[i*2] = (float32_t)context.mp3.buffer[i];
-		context.fft.input[i*2+1] = 0;
-		context.fft.output[i*2] = 0;
-		context.fft.output[i*2+1] = 0;
-	}
-
-  cfft(context.fft.input, context.fft.output, true);
-  cfftGetMag(context.fft.output, context.fft.input);
-  for (uint32_t i = 0 ; i < DISPLAY_COL_SIZE ; i++)
+    outputStageSetGain(&context.output, volume, AUDIO_EQ_MAKEUP_GAIN, AUDIO_EQ_OUTPUT_SHIFT);
+    outputStageWrite(&context.output, context.eq.output, frame, AUDIO_BUFFER_SIZE);
+  }
+  else
   {
-    context.display.colValues[i] = context.fft.input[AUDIO_BUFFER_SIZE / 2 + FFT_COLUMN_BIN[i]];
+    outputStageSetGain(&context.output, volume, OUTPUT_STAGE_UNITY_GAIN, AUDIO_OUTPUT_SHIFT);
+    outputStageWrite(&context.output, context.mp3.buffer, frame, AUDIO_BUFFER_SIZE);
   }
+#else
+  outputStageSetGain(&context.output, volume, OUTPUT_STAGE_UNITY_GAIN, AUDIO_OUTPUT_SHIFT);
+  outputStageWrite(&context.output, context.mp3.buffer, frame, AUDIO_BUFFER_SIZE);
+#endif
 
-  audioFillMatrix();
-  #endif
+#ifdef AUDIO_LOAD_MONITOR
+  audioUpdateLoad(DWT->CYCCNT - startCycles);
+#endif
+}
 
-  double volume = (context.mute ? 0 : context.volume) / (double)AUDIO_MAX_VOLUME;
-  // Write samples to output buffer
-  for (uint16_t i = 0 ; i < AUDIO_BUFFER_SIZE ; i++)
+static void audioFillRing(bool prefill)
+{
+  bool filling = true;
+  while (filling && (context.currentState == AUDIO_STATE_PLAYING))
   {
-    // DAC output is unsigned, mono and 12 bit long
-#ifdef AUDIO_ENABLE_EQ
-    if (context.eqEnabled)
-    {
-      uint16_t aux = (uint16_t)((filterOutputF32[i] * 5e4 + 0.5) * volume + (DAC_FULL_SCALE / 2));
-      frame[i] = aux;
-    }
-    else
+    uint16_t* block = pcmRingAcquire(&context.ring);
+    if (block)
     {
-      frame[i] = (int16_t)(context.mp3.buffer[channelCount * i] / 16.0 + 0.5) * volume + (DAC_FULL_SCALE / 2);
+      audioProcess(block);
+      pcmRingCommit(&context.ring);
     }
-#else
-    frame[i] = (int16_t)(context.mp3.buffer[channelCount * i] / 16.0 + 0.5) * volume + (DAC_FULL_SCALE / 2);
-#endif
+
+    // One block per call keeps the events responsive, unless the DAC is about to run out of samples
+    filling = block && (prefill ? !pcmRingIsHigh(&context.ring) : pcmRingIsLow(&context.ring));
+  }
+}
+
+static void audioRestart(void)
+{
+  dacdmaStop();
+  pcmRingReset(&context.ring);
+  context.draining = false;
+  context.mp3.inputCount = 0;
+  resamplerReset(&context.mp3.resampler);
+  resamplerSetInputRate(&context.mp3.resampler, context.mp3.sampleRate);
+
+  audioSetState(AUDIO_STATE_PLAYING);
+  audioFillRing(true);
+  dacdmaStart();
+}
+
+static void audioUpdateLoad(uint32_t cycles)
+{
+  // Samples are output at the DAC rate, so the block must be ready within its own duration
+  uint32_t period = ((uint64_t)SystemCoreClock * AUDIO_BUFFER_SIZE) / AUDIO_OUTPUT_RATE;
+  uint32_t percent = ((uint64_t)cycles * 100) / period;
+  context.load.percent += ((int32_t)percent - (int32_t)context.load.percent) / AUDIO_LOAD_SMOOTHING;
+
+  // Wide hysteresis, the half rate block takes about half the share of the period of a full rate one
+  if ((context.load.quality == MP3DECODER_QUALITY_FULL) && (context.load.percent > AUDIO_LOAD_HIGH_PERCENT))
+  {
+    context.load.nextQuality = MP3DECODER_QUALITY_HALF_RATE;
+  }
+  else if ((context.load.quality == MP3DECODER_QUALITY_HALF_RATE) && (context.load.percent < AUDIO_LOAD_LOW_PERCENT))
+  {
+    context.load.nextQuality = MP3DECODER_QUALITY_FULL;
   }
+}
+
+static void audioSetQuality(mp3decoder_quality_t quality)
+{
+  MP3DecoderSetQuality(context.mp3.decoder, quality);
+  MP3DecoderSetQuality(context.mp3.nextDecoder, quality);
+  context.load.quality = quality;
+
+  // The next song was prefetched with the previous quality, it is loaded again
+  context.prefetch.requested = false;
+  context.prefetch.ready = false;
 
-  // Update MP3 decoding buffer
-  context.mp3.samples -= AUDIO_BUFFER_SIZE * channelCount;
-  memmove(context.mp3.buffer, context.mp3.buffer + AUDIO_BUFFER_SIZE * channelCount, context.mp3.samples * sizeof(int16_t));
+  // Every decoded sample was resampled already, the next ones are converted from the new rate
+  context.mp3.sampleRate = (quality == MP3DECODER_QUALITY_HALF_RATE) ? (context.mp3.sampleRate / 2) : (context.mp3.sampleRate * 2);
+  resamplerSetInputRate(&context.mp3.resampler, context.mp3.sampleRate);
 }
 
 void showFileTag(void)
@@ -44,6 +44,11 @@ void audioInit(void);
  */
 void audioRun(event_t event);
 
+/**
+ * @brief Fills the output ring with the audio being played, to be called on every cycle of the main loop.
+ */
+void audioFill(void);
+
 /**
  * @brief Filename and path of current song, starts playing the audio.
  * @param path      Directory path for the audio files
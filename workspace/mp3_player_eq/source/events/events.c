@@ -54,10 +54,9 @@ static void onSdCardRemoved(void);
 static void onSdCardInserted(void);
 
 /**
- * @brief Callback to be called when frame has finished
- * @param frame			Next frame to be updated
+ * @brief Callback to be called when a frame has finished and the output ring is running low
  */
-static void onFrameFinished(uint16_t* frame);
+static void onFrameFinished(void);
 
 /**
  * @brief Event generator which provides access to the internal events of the hardware queue.
@@ -220,11 +219,9 @@ static void onSdCardInserted(void)
 	push(&hardwareQueue, (void*)(&event));
 }
 
-static void onFrameFinished(uint16_t* frame)
+static void onFrameFinished(void)
 {
-	event_t event;
-	event.id = EVENTS_FRAME_FINISHED;
-	event.data.frame = frame;
+	event_t event = { .id = EVENTS_FRAME_FINISHED };
 	push(&hardwareQueue, (void*)(&event));
 
 #ifdef EVENT_DEBUG
@@ -35,7 +35,7 @@ typedef enum {
 	EVENTS_VOLUME_TOGGLE,			// Volume encoder was pressed, toggle between mute/unmute
 	EVENTS_SD_INSERTED,				// SD card was inserted
 	EVENTS_SD_REMOVED,				// SD card was removed
-	EVENTS_FRAME_FINISHED,	// Frame processing finished in the output stage
+	EVENTS_FRAME_FINISHED,	// Frame output finished and the output ring is running low
 
 	EVENTS_COUNT
 } event_id_t;